@@ -31,9 +31,9 @@
 #ifndef MUMTYPES_H
 #define MUMTYPES_H
 
-typedef unsigned char  uint8_t;
-typedef unsigned short uint16_t;
-typedef unsigned long  uint32_t;
+// exact widths on every data model; unsigned long is 64 bits on LP64
+#include <stddef.h>
+#include <stdint.h>
 
 #endif
 
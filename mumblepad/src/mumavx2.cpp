@@ -0,0 +1,248 @@
+//////////////////////////////////////////////////////////////////////////
+//                                                                      //
+//   Mumblepad Block Cipher                                             //
+//   Version 1, completed March 14, 2017                                //
+//                                                                      //
+//   Key size 4096 bytes, 32768 bits                                    //
+//   Six different block sizes: 128, 256, 512, 1024, 2048, 4096 bytes   //
+//   Encryption and decryption, runs on either CPU and GPU              //
+//   May run multi-threaded on CPU.                                     //
+//   Runs on GPU with OpenGL or OpenGL ES 2.0                           //
+//                                                                      //
+//   Encrypted blocks containing same plaintext are different, due to   //
+//   small amount of per-block random number padding.                   //
+//   Encrypted block contains length, 16-bit sequence number, 32-bit    //
+//   checksum.                                                          //
+//   No block cipher mode required                                      //
+//   Can use parallel processing, multi-threaded encrypt/decrypt        //
+//                                                                      //
+//   8 rounds, 2 passes per round                                       //
+//   Encrypt: diffusion pass followed by confusion pass.                //
+//   Decrypt: inverse confusion followed by inverse diffusion.          //
+//                                                                      //
+//   Free for non-commercial use, analysis/evaluation.                  //
+//                                                                      //
+//   Copyright 2017, Kyle Granger                                       //
+//   Email contact:  kyle.granger@chello.at                             //
+//                                                                      //
+//////////////////////////////////////////////////////////////////////////
+
+
+#include "mumavx2.h"
+
+#ifdef MUM_CPU_X86
+#include <immintrin.h>
+
+// one row of cells is 128 bytes, four AVX2 registers
+#define MUM_AVX2_ROW_SIZE        (MUM_CELLS_X * MUM_CELL_SIZE)
+#define MUM_AVX2_SUBTABLES       16
+#define MUM_AVX2_CELLS           8
+
+
+// The 256-entry substitution is split into sixteen 16-entry subtables, one
+// per high nibble, which fit pshufb. For subtable h the index is
+// (x ^ h<<4) +sat 0x70: when the high nibble of x is h this keeps the low
+// nibble and leaves bit 7 clear, otherwise bit 7 is set and pshufb returns
+// zero. OR-ing the sixteen lookups leaves exactly one non-zero candidate.
+// A row is substituted as four explicit registers, so each subtable is
+// loaded once per row and nothing is spilled.
+MUM_TARGET_AVX2 static __inline void SubstituteRow(__m256i &x0, __m256i &x1, __m256i &x2, __m256i &x3, uint8_t *table)
+{
+    __m256i bias = _mm256_set1_epi8(0x70);
+    __m256i r0 = _mm256_setzero_si256();
+    __m256i r1 = _mm256_setzero_si256();
+    __m256i r2 = _mm256_setzero_si256();
+    __m256i r3 = _mm256_setzero_si256();
+
+    for (uint32_t h = 0; h < MUM_AVX2_SUBTABLES; h++)
+    {
+        __m256i subtable = _mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i *)(table + h * 16)));
+        __m256i select = _mm256_set1_epi8((char)(h << 4));
+        r0 = _mm256_or_si256(r0, _mm256_shuffle_epi8(subtable, _mm256_adds_epu8(_mm256_xor_si256(x0, select), bias)));
+        r1 = _mm256_or_si256(r1, _mm256_shuffle_epi8(subtable, _mm256_adds_epu8(_mm256_xor_si256(x1, select), bias)));
+        r2 = _mm256_or_si256(r2, _mm256_shuffle_epi8(subtable, _mm256_adds_epu8(_mm256_xor_si256(x2, select), bias)));
+        r3 = _mm256_or_si256(r3, _mm256_shuffle_epi8(subtable, _mm256_adds_epu8(_mm256_xor_si256(x3, select), bias)));
+    }
+
+    x0 = r0;
+    x1 = r1;
+    x2 = r2;
+    x3 = r3;
+}
+
+
+// Rows outermost, so each row's table and subkey are shared by all blocks.
+MUM_TARGET_AVX2 void MumEncryptConfuseAvx2(uint8_t *src, uint8_t *dst, uint8_t *clav,
+    uint8_t *prm, uint32_t numRows, uint32_t numBlocks, uint32_t blockSize)
+{
+    for (uint32_t y = 0; y < numRows; y++)
+    {
+        for (uint32_t b = 0; b < numBlocks; b++)
+        {
+            uint8_t *rowSrc = src + b * blockSize;
+            uint8_t *rowDst = dst + b * blockSize;
+            __m256i x0 = _mm256_xor_si256(_mm256_loadu_si256((__m256i *)(rowSrc + 0)), _mm256_loadu_si256((__m256i *)(clav + 0)));
+            __m256i x1 = _mm256_xor_si256(_mm256_loadu_si256((__m256i *)(rowSrc + 32)), _mm256_loadu_si256((__m256i *)(clav + 32)));
+            __m256i x2 = _mm256_xor_si256(_mm256_loadu_si256((__m256i *)(rowSrc + 64)), _mm256_loadu_si256((__m256i *)(clav + 64)));
+            __m256i x3 = _mm256_xor_si256(_mm256_loadu_si256((__m256i *)(rowSrc + 96)), _mm256_loadu_si256((__m256i *)(clav + 96)));
+            SubstituteRow(x0, x1, x2, x3, prm + y * MUM_NUM_8BIT_VALUES);
+            _mm256_storeu_si256((__m256i *)(rowDst + 0), x0);
+            _mm256_storeu_si256((__m256i *)(rowDst + 32), x1);
+            _mm256_storeu_si256((__m256i *)(rowDst + 64), x2);
+            _mm256_storeu_si256((__m256i *)(rowDst + 96), x3);
+        }
+        src += MUM_AVX2_ROW_SIZE;
+        dst += MUM_AVX2_ROW_SIZE;
+        clav += MUM_AVX2_ROW_SIZE;
+    }
+}
+
+
+MUM_TARGET_AVX2 void MumDecryptConfuseAvx2(uint8_t *src, uint8_t *dst, uint8_t *clav,
+    uint8_t *prmI, uint32_t numRows, uint32_t numBlocks, uint32_t blockSize)
+{
+    for (uint32_t y = 0; y < numRows; y++)
+    {
+        for (uint32_t b = 0; b < numBlocks; b++)
+        {
+            uint8_t *rowSrc = src + b * blockSize;
+            uint8_t *rowDst = dst + b * blockSize;
+            __m256i x0 = _mm256_loadu_si256((__m256i *)(rowSrc + 0));
+            __m256i x1 = _mm256_loadu_si256((__m256i *)(rowSrc + 32));
+            __m256i x2 = _mm256_loadu_si256((__m256i *)(rowSrc + 64));
+            __m256i x3 = _mm256_loadu_si256((__m256i *)(rowSrc + 96));
+            SubstituteRow(x0, x1, x2, x3, prmI + y * MUM_NUM_8BIT_VALUES);
+            _mm256_storeu_si256((__m256i *)(rowDst + 0), _mm256_xor_si256(x0, _mm256_loadu_si256((__m256i *)(clav + 0))));
+            _mm256_storeu_si256((__m256i *)(rowDst + 32), _mm256_xor_si256(x1, _mm256_loadu_si256((__m256i *)(clav + 32))));
+            _mm256_storeu_si256((__m256i *)(rowDst + 64), _mm256_xor_si256(x2, _mm256_loadu_si256((__m256i *)(clav + 64))));
+            _mm256_storeu_si256((__m256i *)(rowDst + 96), _mm256_xor_si256(x3, _mm256_loadu_si256((__m256i *)(clav + 96))));
+        }
+        src += MUM_AVX2_ROW_SIZE;
+        dst += MUM_AVX2_ROW_SIZE;
+        clav += MUM_AVX2_ROW_SIZE;
+    }
+}
+
+
+// pshufb control that reorders the bytes inside each of the 8 cells
+MUM_TARGET_AVX2 static __inline __m256i CellShuffle(uint32_t order)
+{
+    return _mm256_add_epi8(_mm256_set1_epi32((int)order),
+        _mm256_setr_epi32(0, 0x04040404, 0x08080808, 0x0c0c0c0c, 0, 0x04040404, 0x08080808, 0x0c0c0c0c));
+}
+
+
+// Gathers the four source cells of 8 destination cells, reorders their
+// bytes and merges them under the round's bitmasks. The masks are disjoint,
+// so OR gives the same result as the scalar add. The 16-bit offsets are
+// widened to index vectors once and used for the same cells of every block.
+MUM_TARGET_AVX2 static __inline void DiffuseCells(uint8_t *src, uint8_t *dst,
+    uint16_t *offsets, uint32_t *masks, uint32_t numRows,
+    uint32_t numBlocks, uint32_t blockSize, uint32_t order1, uint32_t order2, uint32_t order3, uint32_t order4)
+{
+    uint32_t numCells = numRows * MUM_CELLS_X;
+    __m256i shuffle1 = CellShuffle(order1);
+    __m256i shuffle2 = CellShuffle(order2);
+    __m256i shuffle3 = CellShuffle(order3);
+    __m256i shuffle4 = CellShuffle(order4);
+    __m256i mask1 = _mm256_set1_epi8((char)masks[0]);
+    __m256i mask2 = _mm256_set1_epi8((char)masks[1]);
+    __m256i mask3 = _mm256_set1_epi8((char)masks[2]);
+    __m256i mask4 = _mm256_set1_epi8((char)masks[3]);
+
+    for (uint32_t n = 0; n < numCells; n += MUM_AVX2_CELLS)
+    {
+        __m256i index1 = _mm256_cvtepu16_epi32(_mm_loadu_si128((__m128i *)&offsets[0 * numCells + n]));
+        __m256i index2 = _mm256_cvtepu16_epi32(_mm_loadu_si128((__m128i *)&offsets[1 * numCells + n]));
+        __m256i index3 = _mm256_cvtepu16_epi32(_mm_loadu_si128((__m128i *)&offsets[2 * numCells + n]));
+        __m256i index4 = _mm256_cvtepu16_epi32(_mm_loadu_si128((__m128i *)&offsets[3 * numCells + n]));
+        for (uint32_t b = 0; b < numBlocks; b++)
+        {
+            const int *blockSrc = (const int *)(src + b * blockSize);
+            __m256i c1 = _mm256_i32gather_epi32(blockSrc, index1, 1);
+            __m256i c2 = _mm256_i32gather_epi32(blockSrc, index2, 1);
+            __m256i c3 = _mm256_i32gather_epi32(blockSrc, index3, 1);
+            __m256i c4 = _mm256_i32gather_epi32(blockSrc, index4, 1);
+            c1 = _mm256_and_si256(_mm256_shuffle_epi8(c1, shuffle1), mask1);
+            c2 = _mm256_and_si256(_mm256_shuffle_epi8(c2, shuffle2), mask2);
+            c3 = _mm256_and_si256(_mm256_shuffle_epi8(c3, shuffle3), mask3);
+            c4 = _mm256_and_si256(_mm256_shuffle_epi8(c4, shuffle4), mask4);
+            _mm256_storeu_si256((__m256i *)(dst + b * blockSize + n * MUM_CELL_SIZE),
+                _mm256_or_si256(_mm256_or_si256(c1, c2), _mm256_or_si256(c3, c4)));
+        }
+    }
+}
+
+
+MUM_TARGET_AVX2 void MumEncryptDiffuseAvx2(uint8_t *src, uint8_t *dst,
+    uint16_t *offsets, uint32_t *masks, uint32_t numRows,
+    uint32_t numBlocks, uint32_t blockSize)
+{
+    DiffuseCells(src, dst, offsets, masks, numRows, numBlocks, blockSize,
+        MUM_DIFFUSE_ORDER_1, MUM_DIFFUSE_ORDER_2, MUM_DIFFUSE_ORDER_3, MUM_DIFFUSE_ORDER_4);
+}
+
+
+MUM_TARGET_AVX2 void MumDecryptDiffuseAvx2(uint8_t *src, uint8_t *dst,
+    uint16_t *offsetsI, uint32_t *masks, uint32_t numRows,
+    uint32_t numBlocks, uint32_t blockSize)
+{
+    DiffuseCells(src, dst, offsetsI, masks, numRows, numBlocks, blockSize,
+        MUM_DIFFUSE_ORDER_I1, MUM_DIFFUSE_ORDER_I2, MUM_DIFFUSE_ORDER_I3, MUM_DIFFUSE_ORDER_I4);
+}
+
+
+// Each 32-byte chunk is loaded once, stored and added lane-wise into eight
+// 32-bit sums; the order of wraparound adds does not change the total.
+MUM_TARGET_AVX2 uint32_t MumCopyChecksumAvx2(uint8_t *dst, uint8_t *src, uint32_t size, uint32_t rotate)
+{
+    __m128i left = _mm_cvtsi32_si128((int)rotate);
+    __m128i right = _mm_cvtsi32_si128((int)(32 - rotate));
+    __m256i sum = _mm256_setzero_si256();
+
+    for (uint32_t i = 0; i < size; i += MUM_AVX2_CHECKSUM_CHUNK)
+    {
+        __m256i x = _mm256_loadu_si256((__m256i *)(src + i));
+        _mm256_storeu_si256((__m256i *)(dst + i), x);
+        sum = _mm256_add_epi32(sum, _mm256_or_si256(_mm256_sll_epi32(x, left), _mm256_srl_epi32(x, right)));
+    }
+
+    __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+    return (uint32_t)_mm_cvtsi128_si32(half);
+}
+
+#else
+
+// Never called: without x86, MUM_CPU_FEATURE_AVX2 is never set
+void MumEncryptConfuseAvx2(uint8_t *src, uint8_t *dst, uint8_t *clav,
+    uint8_t *prm, uint32_t numRows,
+    uint32_t numBlocks, uint32_t blockSize)
+{
+}
+
+void MumDecryptConfuseAvx2(uint8_t *src, uint8_t *dst, uint8_t *clav,
+    uint8_t *prmI, uint32_t numRows,
+    uint32_t numBlocks, uint32_t blockSize)
+{
+}
+
+void MumEncryptDiffuseAvx2(uint8_t *src, uint8_t *dst,
+    uint16_t *offsets, uint32_t *masks, uint32_t numRows,
+    uint32_t numBlocks, uint32_t blockSize)
+{
+}
+
+void MumDecryptDiffuseAvx2(uint8_t *src, uint8_t *dst,
+    uint16_t *offsetsI, uint32_t *masks, uint32_t numRows,
+    uint32_t numBlocks, uint32_t blockSize)
+{
+}
+
+uint32_t MumCopyChecksumAvx2(uint8_t *dst, uint8_t *src, uint32_t size, uint32_t rotate)
+{
+    return 0;
+}
+
+#endif
@@ -0,0 +1,70 @@
+//////////////////////////////////////////////////////////////////////////
+//                                                                      //
+//   Mumblepad Block Cipher                                             //
+//   Version 1, completed March 14, 2017                                //
+//                                                                      //
+//   Key size 4096 bytes, 32768 bits                                    //
+//   Six different block sizes: 128, 256, 512, 1024, 2048, 4096 bytes   //
+//   Encryption and decryption, runs on either CPU and GPU              //
+//   May run multi-threaded on CPU.                                     //
+//   Runs on GPU with OpenGL or OpenGL ES 2.0                           //
+//                                                                      //
+//   Encrypted blocks containing same plaintext are different, due to   //
+//   small amount of per-block random number padding.                   //
+//   Encrypted block contains length, 16-bit sequence number, 32-bit    //
+//   checksum.                                                          //
+//   No block cipher mode required                                      //
+//   Can use parallel processing, multi-threaded encrypt/decrypt        //
+//                                                                      //
+//   8 rounds, 2 passes per round                                       //
+//   Encrypt: diffusion pass followed by confusion pass.                //
+//   Decrypt: inverse confusion followed by inverse diffusion.          //
+//                                                                      //
+//   Free for non-commercial use, analysis/evaluation.                  //
+//                                                                      //
+//   Copyright 2017, Kyle Granger                                       //
+//   Email contact:  kyle.granger@chello.at                             //
+//                                                                      //
+//////////////////////////////////////////////////////////////////////////
+
+
+#ifndef MUMAVX2_H
+#define MUMAVX2_H
+
+#include "mumdefines.h"
+#include "mumcpu.h"
+
+// AVX2 versions of the CPU passes, selected at runtime when
+// MUM_CPU_FEATURE_AVX2 is set in TMumInfo::cpuFeatures. They produce the
+// same bytes as the scalar passes in CMumblepad, which remain the fallback.
+// Each pass runs over numBlocks blocks stored blockSize bytes apart.
+
+// Confusion pass, 32 bytes at a time: dst = prm[row][src ^ clav].
+// prm is the 8-bit table of the round, numRows 256-byte tables back to back.
+extern void MumEncryptConfuseAvx2(uint8_t *src, uint8_t *dst, uint8_t *clav,
+    uint8_t *prm, uint32_t numRows,
+    uint32_t numBlocks, uint32_t blockSize);
+
+// Inverse confusion pass: dst = prmI[row][src] ^ clav.
+extern void MumDecryptConfuseAvx2(uint8_t *src, uint8_t *dst, uint8_t *clav,
+    uint8_t *prmI, uint32_t numRows,
+    uint32_t numBlocks, uint32_t blockSize);
+
+// Diffusion pass, 8 cells at a time. offsets are the byte offsets of the
+// four source cells of each destination cell, TMumRoundContext::offsets.
+extern void MumEncryptDiffuseAvx2(uint8_t *src, uint8_t *dst,
+    uint16_t *offsets, uint32_t *masks, uint32_t numRows,
+    uint32_t numBlocks, uint32_t blockSize);
+
+// Inverse diffusion pass, with TMumRoundContext::offsetsI.
+extern void MumDecryptDiffuseAvx2(uint8_t *src, uint8_t *dst,
+    uint16_t *offsetsI, uint32_t *masks, uint32_t numRows,
+    uint32_t numBlocks, uint32_t blockSize);
+
+// Plaintext copy fused with the block checksum: copies size bytes, a
+// multiple of MUM_AVX2_CHECKSUM_CHUNK, and returns the wraparound sum of
+// their 32-bit words, each rotated left by rotate bits.
+#define MUM_AVX2_CHECKSUM_CHUNK  32
+extern uint32_t MumCopyChecksumAvx2(uint8_t *dst, uint8_t *src, uint32_t size, uint32_t rotate);
+
+#endif
@@ -0,0 +1,164 @@
+//////////////////////////////////////////////////////////////////////////
+//                                                                      //
+//   Mumblepad Block Cipher                                             //
+//   Version 1, completed March 14, 2017                                //
+//                                                                      //
+//   Key size 4096 bytes, 32768 bits                                    //
+//   Six different block sizes: 128, 256, 512, 1024, 2048, 4096 bytes   //
+//   Encryption and decryption, runs on either CPU and GPU              //
+//   May run multi-threaded on CPU.                                     //
+//   Runs on GPU with OpenGL or OpenGL ES 2.0                           //
+//                                                                      //
+//   Encrypted blocks containing same plaintext are different, due to   //
+//   small amount of per-block random number padding.                   //
+//   Encrypted block contains length, 16-bit sequence number, 32-bit    //
+//   checksum.                                                          //
+//   No block cipher mode required                                      //
+//   Can use parallel processing, multi-threaded encrypt/decrypt        //
+//                                                                      //
+//   8 rounds, 2 passes per round                                       //
+//   Encrypt: diffusion pass followed by confusion pass.                //
+//   Decrypt: inverse confusion followed by inverse diffusion.          //
+//                                                                      //
+//   Free for non-commercial use, analysis/evaluation.                  //
+//                                                                      //
+//   Copyright 2017, Kyle Granger                                       //
+//   Email contact:  kyle.granger@chello.at                             //
+//                                                                      //
+//////////////////////////////////////////////////////////////////////////
+
+
+
+#include "mumavx512.h"
+
+#ifdef MUM_CPU_X86
+#include <immintrin.h>
+
+// 64 bytes per zmm register, two per row of cells
+#define MUM_AVX512_VECTOR_SIZE   64
+#define MUM_AVX512_ROW_VECTORS   ((MUM_CELLS_X * MUM_CELL_SIZE) / MUM_AVX512_VECTOR_SIZE)
+#define MUM_AVX512_MAX_VECTORS   (MUM_SMALL_BLOCK_SIZE / MUM_AVX512_VECTOR_SIZE)
+
+// ternary logic immediate for a | (b & c)
+#define MUM_AVX512_OR_AND        0xf8
+
+
+// 256-entry byte lookup: vpermi2b covers 128 entries with the low 7 index
+// bits, bit 7 picks between the two halves of the table.
+MUM_TARGET_AVX512VBMI static __inline __m512i Lookup256(__m512i x, uint8_t *table)
+{
+    __m512i lo = _mm512_permutex2var_epi8(_mm512_loadu_si512(table), x, _mm512_loadu_si512(table + 64));
+    __m512i hi = _mm512_permutex2var_epi8(_mm512_loadu_si512(table + 128), x, _mm512_loadu_si512(table + 192));
+    return _mm512_mask_blend_epi8(_mm512_movepi8_mask(x), lo, hi);
+}
+
+
+// One diffusion pass over numVectors registers. With two registers the
+// 7-bit index of vpermi2b addresses the whole block, with four bit 7 of the
+// index selects the upper half as in Lookup256.
+MUM_TARGET_AVX512VBMI static __inline void Diffuse(__m512i v[MUM_AVX512_MAX_VECTORS], uint32_t numVectors,
+    uint8_t *permutes, uint32_t *masks)
+{
+    __m512i r[MUM_AVX512_MAX_VECTORS];
+    uint32_t k, position;
+
+    for (k = 0; k < numVectors; k++)
+        r[k] = _mm512_setzero_si512();
+
+    for (position = 0; position < MUM_NUM_POSITIONS; position++)
+    {
+        __m512i mask = _mm512_set1_epi8((char)masks[position]);
+        for (k = 0; k < numVectors; k++)
+        {
+            __m512i index = _mm512_loadu_si512(permutes + position * numVectors * MUM_AVX512_VECTOR_SIZE + k * MUM_AVX512_VECTOR_SIZE);
+            __m512i cells = _mm512_permutex2var_epi8(v[0], index, v[1]);
+            if (numVectors > 2)
+                cells = _mm512_mask_blend_epi8(_mm512_movepi8_mask(index), cells, _mm512_permutex2var_epi8(v[2], index, v[3]));
+            r[k] = _mm512_ternarylogic_epi32(r[k], cells, mask, MUM_AVX512_OR_AND);
+        }
+    }
+
+    for (k = 0; k < numVectors; k++)
+        v[k] = r[k];
+}
+
+
+MUM_TARGET_AVX512VBMI static __inline void EncryptRounds(uint8_t *src, uint8_t *dst, TMumRoundContext **rounds, uint32_t numRounds, uint32_t numVectors)
+{
+    __m512i v[MUM_AVX512_MAX_VECTORS];
+    uint32_t k, round;
+
+    for (k = 0; k < numVectors; k++)
+        v[k] = _mm512_loadu_si512(src + k * MUM_AVX512_VECTOR_SIZE);
+
+    for (round = 0; round < numRounds; round++)
+    {
+        TMumRoundContext *rc = rounds[round];
+        Diffuse(v, numVectors, rc->bytePermutes, rc->bitmasks);
+        for (k = 0; k < numVectors; k++)
+        {
+            __m512i clav = _mm512_loadu_si512(rc->subkey + k * MUM_AVX512_VECTOR_SIZE);
+            v[k] = Lookup256(_mm512_xor_si512(v[k], clav), rc->permute + (k / MUM_AVX512_ROW_VECTORS) * MUM_NUM_8BIT_VALUES);
+        }
+    }
+
+    for (k = 0; k < numVectors; k++)
+        _mm512_storeu_si512(dst + k * MUM_AVX512_VECTOR_SIZE, v[k]);
+}
+
+
+MUM_TARGET_AVX512VBMI static __inline void DecryptRounds(uint8_t *src, uint8_t *dst, TMumRoundContext **rounds, uint32_t numRounds, uint32_t numVectors)
+{
+    __m512i v[MUM_AVX512_MAX_VECTORS];
+    uint32_t k, round;
+
+    for (k = 0; k < numVectors; k++)
+        v[k] = _mm512_loadu_si512(src + k * MUM_AVX512_VECTOR_SIZE);
+
+    for (round = numRounds; round-- > 0; )
+    {
+        TMumRoundContext *rc = rounds[round];
+        for (k = 0; k < numVectors; k++)
+        {
+            __m512i clav = _mm512_loadu_si512(rc->subkey + k * MUM_AVX512_VECTOR_SIZE);
+            v[k] = _mm512_xor_si512(Lookup256(v[k], rc->permuteI + (k / MUM_AVX512_ROW_VECTORS) * MUM_NUM_8BIT_VALUES), clav);
+        }
+        Diffuse(v, numVectors, rc->bytePermutesI, rc->bitmasks);
+    }
+
+    for (k = 0; k < numVectors; k++)
+        _mm512_storeu_si512(dst + k * MUM_AVX512_VECTOR_SIZE, v[k]);
+}
+
+
+// The register count is passed as a constant, so each call site unrolls
+// completely and v[] never touches memory.
+MUM_TARGET_AVX512VBMI void MumEncryptSmallBlockAvx512(uint8_t *src, uint8_t *dst, TMumRoundContext **rounds, uint32_t numRows, uint32_t numRounds)
+{
+    if (numRows == 1)
+        EncryptRounds(src, dst, rounds, numRounds, 2);
+    else
+        EncryptRounds(src, dst, rounds, numRounds, 4);
+}
+
+
+MUM_TARGET_AVX512VBMI void MumDecryptSmallBlockAvx512(uint8_t *src, uint8_t *dst, TMumRoundContext **rounds, uint32_t numRows, uint32_t numRounds)
+{
+    if (numRows == 1)
+        DecryptRounds(src, dst, rounds, numRounds, 2);
+    else
+        DecryptRounds(src, dst, rounds, numRounds, 4);
+}
+
+#else
+
+// Never called: without x86, MUM_CPU_FEATURE_AVX512VBMI is never set
+void MumEncryptSmallBlockAvx512(uint8_t *src, uint8_t *dst, TMumRoundContext **rounds, uint32_t numRows, uint32_t numRounds)
+{
+}
+
+void MumDecryptSmallBlockAvx512(uint8_t *src, uint8_t *dst, TMumRoundContext **rounds, uint32_t numRows, uint32_t numRounds)
+{
+}
+
+#endif
@@ -0,0 +1,51 @@
+//////////////////////////////////////////////////////////////////////////
+//                                                                      //
+//   Mumblepad Block Cipher                                             //
+//   Version 1, completed March 14, 2017                                //
+//                                                                      //
+//   Key size 4096 bytes, 32768 bits                                    //
+//   Six different block sizes: 128, 256, 512, 1024, 2048, 4096 bytes   //
+//   Encryption and decryption, runs on either CPU and GPU              //
+//   May run multi-threaded on CPU.                                     //
+//   Runs on GPU with OpenGL or OpenGL ES 2.0                           //
+//                                                                      //
+//   Encrypted blocks containing same plaintext are different, due to   //
+//   small amount of per-block random number padding.                   //
+//   Encrypted block contains length, 16-bit sequence number, 32-bit    //
+//   checksum.                                                          //
+//   No block cipher mode required                                      //
+//   Can use parallel processing, multi-threaded encrypt/decrypt        //
+//                                                                      //
+//   8 rounds, 2 passes per round                                       //
+//   Encrypt: diffusion pass followed by confusion pass.                //
+//   Decrypt: inverse confusion followed by inverse diffusion.          //
+//                                                                      //
+//   Free for non-commercial use, analysis/evaluation.                  //
+//                                                                      //
+//   Copyright 2017, Kyle Granger                                       //
+//   Email contact:  kyle.granger@chello.at                             //
+//                                                                      //
+//////////////////////////////////////////////////////////////////////////
+
+
+#ifndef MUMAVX512_H
+#define MUMAVX512_H
+
+#include "mumdefines.h"
+#include "mumcpu.h"
+
+// Whole-block kernels for the 128- and 256-byte block types, selected at
+// runtime when MUM_CPU_FEATURE_AVX512VBMI is set. The block stays in two or
+// four zmm registers for all rounds: diffusion is one vpermi2b byte
+// permutation per position (TMumRoundContext::bytePermutes), confusion a
+// 256-entry vpermi2b lookup per row. numRows is 1 or 2.
+
+// Runs encrypt rounds 0..numRounds-1 on the packed block src, result in
+// dst; src may be dst.
+extern void MumEncryptSmallBlockAvx512(uint8_t *src, uint8_t *dst, TMumRoundContext **rounds, uint32_t numRows, uint32_t numRounds);
+
+// Runs decrypt rounds numRounds-1..0 on the encrypted block src, result
+// in dst; src may be dst.
+extern void MumDecryptSmallBlockAvx512(uint8_t *src, uint8_t *dst, TMumRoundContext **rounds, uint32_t numRows, uint32_t numRounds);
+
+#endif
@@ -29,6 +29,8 @@
 
 
 #include "mumblepad.h"
+#include "mumavx2.h"
+#include "mumavx512.h"
 #include "malloc.h"
 #include "string.h"
 #include "assert.h"
@@ -39,10 +41,18 @@
 CMumblepad::CMumblepad(TMumInfo *mumInfo) : CMumRenderer(mumInfo)
 {
     mMumInfo = mumInfo;
+    mTile[0] = nullptr;
+    mTile[1] = nullptr;
+    mTileCapacity = 0;
+    mPrefetch = nullptr;
+    mPrefetchSize = 0;
+    mJit = nullptr;
 }
 
 CMumblepad::~CMumblepad()
 {
+    delete[] mTile[0];
+    delete[] mTile[1];
     if (mPrng != nullptr)
     {
         delete mPrng;
@@ -58,9 +68,233 @@ void CMumblepad::InitKey()
         delete mPrng;
         mPrng = nullptr;
     }
-    mPrng = new CMumPrng(mMumInfo->subkeys[MUM_PRNG_SUBKEY_INDEX]);
+    mPrng = new CMumPrng(mMumInfo->subkeys[MUM_PRNG_SUBKEY_INDEX], 0);
 }
 
+void CMumblepad::EncryptRounds()
+{
+    EncryptTileRounds(mPingPongBlock[0], mPingPongBlock[0], mPingPongBlock[1], 1);
+}
+
+void CMumblepad::DecryptRounds()
+{
+    DecryptTileRounds(mPingPongBlock[0], mPingPongBlock[0], mPingPongBlock[1], 1);
+}
+
+void CMumblepad::EncryptTileRounds(uint8_t *src, uint8_t *blocks, uint8_t *scratch, uint32_t numBlocks)
+{
+    EncryptTileRoundsT(TMumGeometry(mMumInfo), src, blocks, scratch, numBlocks);
+}
+
+void CMumblepad::DecryptTileRounds(uint8_t *src, uint8_t *blocks, uint8_t *scratch, uint32_t numBlocks)
+{
+    DecryptTileRoundsT(TMumGeometry(mMumInfo), src, blocks, scratch, numBlocks);
+}
+
+// Small blocks stay in registers for all rounds when AVX-512 VBMI is
+// available; everything else runs pass by pass.
+template <class TGeometry>
+void CMumblepad::EncryptTileRoundsT(const TGeometry &geometry, uint8_t *src, uint8_t *blocks, uint8_t *scratch, uint32_t numBlocks)
+{
+    uint32_t blockSize = geometry.blockSize;
+
+    if ((mMumInfo->cpuFeatures & MUM_CPU_FEATURE_AVX512VBMI) && blockSize <= MUM_SMALL_BLOCK_SIZE && !JitEnabled())
+    {
+        PrefetchSlice(0, 1);
+        for (uint32_t b = 0; b < numBlocks; b++)
+            MumEncryptSmallBlockAvx512(src + b * blockSize, blocks + b * blockSize, mMumInfo->rounds, geometry.numRows, mMumInfo->numRoundsPerBlock);
+        return;
+    }
+    for (uint32_t r = 0; r < mMumInfo->numRoundsPerBlock; r++)
+    {
+        PrefetchSlice(r, mMumInfo->numRoundsPerBlock);
+        EncryptDiffuseBlocks(geometry, r, (r == 0) ? src : blocks, scratch, numBlocks);
+        EncryptConfuseBlocks(geometry, r, scratch, blocks, numBlocks);
+    }
+}
+
+template <class TGeometry>
+void CMumblepad::DecryptTileRoundsT(const TGeometry &geometry, uint8_t *src, uint8_t *blocks, uint8_t *scratch, uint32_t numBlocks)
+{
+    uint32_t blockSize = geometry.blockSize;
+    int lastRound = mMumInfo->numRoundsPerBlock - 1;
+
+    if ((mMumInfo->cpuFeatures & MUM_CPU_FEATURE_AVX512VBMI) && blockSize <= MUM_SMALL_BLOCK_SIZE && !JitEnabled())
+    {
+        PrefetchSlice(0, 1);
+        for (uint32_t b = 0; b < numBlocks; b++)
+            MumDecryptSmallBlockAvx512(src + b * blockSize, blocks + b * blockSize, mMumInfo->rounds, geometry.numRows, mMumInfo->numRoundsPerBlock);
+        return;
+    }
+    for (int r = lastRound; r >= 0; r--)
+    {
+        PrefetchSlice((uint32_t)(lastRound - r), mMumInfo->numRoundsPerBlock);
+        DecryptConfuseBlocks(geometry, (uint32_t)r, (r == lastRound) ? src : blocks, scratch, numBlocks);
+        DecryptDiffuseBlocks(geometry, (uint32_t)r, scratch, blocks, numBlocks);
+    }
+}
+
+
+// The tile grows when the engine's tile size is raised; it is never
+// shrunk, a smaller tileBlocks just uses part of it.
+void CMumblepad::AllocateTile()
+{
+    if (mTileCapacity >= mMumInfo->tileBlocks)
+        return;
+    delete[] mTile[0];
+    delete[] mTile[1];
+    mTileCapacity = mMumInfo->tileBlocks;
+    mTile[0] = new uint8_t[mTileCapacity * mMumInfo->encryptedBlockSize];
+    mTile[1] = new uint8_t[mTileCapacity * mMumInfo->encryptedBlockSize];
+}
+
+// Spread over the rounds, the prefetches of the next tile overlap with the
+// table lookups of this one instead of arriving as one burst.
+void CMumblepad::PrefetchSlice(uint32_t index, uint32_t numSlices)
+{
+    if (mPrefetch == nullptr)
+        return;
+    uint32_t sliceSize = (mPrefetchSize + numSlices - 1) / numSlices;
+    uint32_t offset = index * sliceSize;
+    if (offset >= mPrefetchSize)
+        return;
+    MumPrefetch(mPrefetch + offset, (offset + sliceSize > mPrefetchSize) ? mPrefetchSize - offset : sliceSize);
+}
+
+EMumError CMumblepad::EncryptTile(uint8_t *src, uint8_t *dst, uint8_t *packed, uint8_t *scratch, uint32_t numBlocks, uint32_t length, uint32_t seqnum)
+{
+    uint32_t blockSize = mMumInfo->encryptedBlockSize;
+    uint32_t plaintextBlockSize = mMumInfo->plaintextBlockSize;
+
+    uint8_t *blocks = mLargeBuffer ? packed : dst;
+
+    if (mMumInfo->paddingOn)
+    {
+        if (!mLargeBuffer && !Overlaps(src, numBlocks * plaintextBlockSize, dst, numBlocks * blockSize))
+            packed = dst;
+        for (uint32_t b = 0; b < numBlocks; b++)
+        {
+            SetPadding(src + b * plaintextBlockSize, length);
+            EMumError error = PackData(packed + b * blockSize, src + b * plaintextBlockSize, length, (uint16_t)(seqnum + b));
+            if (error != MUM_ERROR_OK) return error;
+        }
+        src = packed;
+    }
+    EncryptTileRounds(src, blocks, scratch, numBlocks);
+    if (mLargeBuffer)
+        MumStreamCopy(dst, blocks, numBlocks * blockSize);
+    return MUM_ERROR_OK;
+}
+
+EMumError CMumblepad::DecryptTile(uint8_t *src, uint8_t *dst, uint8_t *blocks, uint8_t *scratch, uint32_t numBlocks, uint32_t *outlength, uint32_t *seqnum)
+{
+    uint32_t blockSize = mMumInfo->encryptedBlockSize;
+    uint32_t length;
+
+    *outlength = 0;
+    if (!mMumInfo->paddingOn)
+    {
+        DecryptTileRounds(src, mLargeBuffer ? blocks : dst, scratch, numBlocks);
+        *outlength = numBlocks * blockSize;
+        if (mLargeBuffer)
+            MumStreamCopy(dst, blocks, *outlength);
+        return MUM_ERROR_OK;
+    }
+    DecryptTileRounds(src, blocks, scratch, numBlocks);
+    // scratch is free once the rounds are done; the large-buffer mode
+    // gathers the plaintext there
+    uint8_t *plaintext = mLargeBuffer ? scratch : dst;
+    for (uint32_t b = 0; b < numBlocks; b++)
+    {
+        EMumError error = UnpackData(blocks + b * blockSize, plaintext, &length, seqnum);
+        if (error != MUM_ERROR_OK) return error;
+        plaintext += length;
+        *outlength += length;
+    }
+    if (mLargeBuffer)
+        MumStreamCopy(dst, scratch, *outlength);
+    return MUM_ERROR_OK;
+}
+
+
+EMumError CMumblepad::EncryptBlock(uint8_t *src, uint8_t *dst, uint32_t length, uint32_t seqnum)
+{
+    EMumError error = EncryptTile(src, dst, mPingPongBlock[0], mPingPongBlock[1], 1, length, seqnum);
+    if (error != MUM_ERROR_OK)
+        return error;
+    numEncryptedBlocks++;
+    return MUM_ERROR_OK;
+}
+
+EMumError CMumblepad::DecryptBlock(uint8_t *src, uint8_t *dst, uint32_t *length, uint32_t *seqnum)
+{
+    numDecryptedBlocks++;
+    return DecryptTile(src, dst, mPingPongBlock[0], mPingPongBlock[1], 1, length, seqnum);
+}
+
+
+// Full blocks, a tile at a time; padding and sequence numbers are drawn in
+// block order, exactly as EncryptBlock would.
+EMumError CMumblepad::EncryptBlocks(uint8_t *src, uint8_t *dst, uint32_t numBlocks, uint32_t seqnum)
+{
+    uint32_t blockSize = mMumInfo->encryptedBlockSize;
+    uint32_t plaintextBlockSize = mMumInfo->plaintextBlockSize;
+
+    AllocateTile();
+    while (numBlocks > 0)
+    {
+        uint32_t tileBlocks = (numBlocks < mMumInfo->tileBlocks) ? numBlocks : mMumInfo->tileBlocks;
+        uint32_t nextBlocks = numBlocks - tileBlocks;
+        if (nextBlocks > mMumInfo->tileBlocks)
+            nextBlocks = mMumInfo->tileBlocks;
+        mPrefetch = (mLargeBuffer && nextBlocks > 0) ? src + tileBlocks * plaintextBlockSize : nullptr;
+        mPrefetchSize = nextBlocks * plaintextBlockSize;
+        EMumError error = EncryptTile(src, dst, mTile[0], mTile[1], tileBlocks, plaintextBlockSize, seqnum);
+        if (error != MUM_ERROR_OK)
+        {
+            mPrefetch = nullptr;
+            return error;
+        }
+        src += tileBlocks * plaintextBlockSize;
+        dst += tileBlocks * blockSize;
+        seqnum += tileBlocks;
+        numEncryptedBlocks += tileBlocks;
+        numBlocks -= tileBlocks;
+    }
+    return MUM_ERROR_OK;
+}
+
+EMumError CMumblepad::DecryptBlocks(uint8_t *src, uint8_t *dst, uint32_t numBlocks, uint32_t *outlength)
+{
+    uint32_t blockSize = mMumInfo->encryptedBlockSize;
+    uint32_t length, seqnum;
+
+    *outlength = 0;
+    AllocateTile();
+    while (numBlocks > 0)
+    {
+        uint32_t tileBlocks = (numBlocks < mMumInfo->tileBlocks) ? numBlocks : mMumInfo->tileBlocks;
+        uint32_t nextBlocks = numBlocks - tileBlocks;
+        if (nextBlocks > mMumInfo->tileBlocks)
+            nextBlocks = mMumInfo->tileBlocks;
+        mPrefetch = (mLargeBuffer && nextBlocks > 0) ? src + tileBlocks * blockSize : nullptr;
+        mPrefetchSize = nextBlocks * blockSize;
+        EMumError error = DecryptTile(src, dst, mTile[0], mTile[1], tileBlocks, &length, &seqnum);
+        *outlength += length;
+        if (error != MUM_ERROR_OK)
+        {
+            mPrefetch = nullptr;
+            return error;
+        }
+        src += tileBlocks * blockSize;
+        dst += length;
+        numDecryptedBlocks += tileBlocks;
+        numBlocks -= tileBlocks;
+    }
+    return MUM_ERROR_OK;
+}
+
+
 void CMumblepad::EncryptUpload(uint8_t *data)
 {
     memcpy(mPingPongBlock[0], data, mMumInfo->encryptedBlockSize);
@@ -72,147 +306,196 @@ void CMumblepad::DecryptUpload(uint8_t *data)
 }
 
 
-
+// first pass for encrypt
+// source = 0, destination = 1
 void CMumblepad::EncryptDiffuse(uint32_t round)
 {
-    uint32_t x, y, srcPosX1, srcPosY1, srcPosX2, srcPosY2, srcPosX3, srcPosY3, srcPosX4, srcPosY4;
+    EncryptDiffuseBlocks(TMumGeometry(mMumInfo), round, mPingPongBlock[0], mPingPongBlock[1], 1);
+}
+
+// second pass for encrypt
+// source = 1, destination = 0
+void CMumblepad::EncryptConfuse(uint32_t round)
+{
+    EncryptConfuseBlocks(TMumGeometry(mMumInfo), round, mPingPongBlock[1], mPingPongBlock[0], 1);
+}
+
+// first pass for decrypt
+// source = 0, destination = 1
+void CMumblepad::DecryptConfuse(uint32_t round)
+{
+    DecryptConfuseBlocks(TMumGeometry(mMumInfo), round, mPingPongBlock[0], mPingPongBlock[1], 1);
+}
+
+// second pass for decrypt
+// source = 1, destination = 0
+void CMumblepad::DecryptDiffuse(uint32_t round)
+{
+    DecryptDiffuseBlocks(TMumGeometry(mMumInfo), round, mPingPongBlock[1], mPingPongBlock[0], 1);
+}
+
+
+template <class TGeometry>
+void CMumblepad::EncryptDiffuseBlocks(const TGeometry &geometry, uint32_t round, uint8_t *src, uint8_t *dst, uint32_t numBlocks)
+{
+    uint32_t n, b;
     uint32_t maskA, maskB, maskC, maskD;
     uint8_t *mappedSrc1, *mappedSrc2, *mappedSrc3, *mappedSrc4;
-    uint8_t *src;
-    uint8_t *dst;
-    uint32_t numRows = mMumInfo->numRows;
-
-    // first pass for encrypt
-    // source = 0, destination = 1
-    src = mPingPongBlock[0];
-    dst = mPingPongBlock[1];
-
-    maskA = mMumInfo->bitmasks[round][0];
-    maskB = mMumInfo->bitmasks[round][1];
-    maskC = mMumInfo->bitmasks[round][2];
-    maskD = mMumInfo->bitmasks[round][3];
-    for ( y = 0; y < numRows; y++ )
+    uint8_t *cellDst;
+    uint32_t numRows = geometry.numRows;
+    uint32_t numCells = numRows * MUM_CELLS_X;
+    uint32_t blockSize = geometry.blockSize;
+    TMumRoundContext *rc = mMumInfo->rounds[round];
+
+    if (JitEnabled())
+    {
+        mJit->EncryptDiffuse(round)(src, dst, numBlocks, blockSize);
+        return;
+    }
+    if (mMumInfo->cpuFeatures & MUM_CPU_FEATURE_AVX2)
     {
-        for ( x = 0; x < MUM_CELLS_X; x++ )
+        MumEncryptDiffuseAvx2(src, dst, rc->offsets, rc->bitmasks, numRows, numBlocks, blockSize);
+        return;
+    }
+
+    maskA = rc->bitmasks[0];
+    maskB = rc->bitmasks[1];
+    maskC = rc->bitmasks[2];
+    maskD = rc->bitmasks[3];
+    for ( n = 0; n < numCells; n++ )
+    {
+        uint16_t *offsets = rc->offsets + n;
+        for ( b = 0; b < numBlocks; b++ )
         {
-            srcPosX1 = mMumInfo->positionTables5bitX[round][y][x][0];
-            srcPosY1 = mMumInfo->positionTables5bitY[round][y][x][0];
-            mappedSrc1 = src + srcPosX1 * MUM_CELL_SIZE + srcPosY1 * MUM_CELLS_X * MUM_CELL_SIZE;
-            srcPosX2 = mMumInfo->positionTables5bitX[round][y][x][1];
-            srcPosY2 = mMumInfo->positionTables5bitY[round][y][x][1];
-            mappedSrc2 = src + srcPosX2 * MUM_CELL_SIZE + srcPosY2 * MUM_CELLS_X * MUM_CELL_SIZE;
-            srcPosX3 = mMumInfo->positionTables5bitX[round][y][x][2];
-            srcPosY3 = mMumInfo->positionTables5bitY[round][y][x][2];
-            mappedSrc3 = src + srcPosX3 * MUM_CELL_SIZE + srcPosY3 * MUM_CELLS_X * MUM_CELL_SIZE;
-            srcPosX4 = mMumInfo->positionTables5bitX[round][y][x][3];
-            srcPosY4 = mMumInfo->positionTables5bitY[round][y][x][3];
-            mappedSrc4 = src + srcPosX4 * MUM_CELL_SIZE + srcPosY4 * MUM_CELLS_X * MUM_CELL_SIZE;
-            dst[0] = (mappedSrc1[0] & maskA) + (mappedSrc2[2] & maskB) + (mappedSrc3[3] & maskC) + (mappedSrc4[1] & maskD);
-            dst[1] = (mappedSrc1[2] & maskA) + (mappedSrc2[3] & maskB) + (mappedSrc3[1] & maskC) + (mappedSrc4[0] & maskD);
-            dst[2] = (mappedSrc1[3] & maskA) + (mappedSrc2[1] & maskB) + (mappedSrc3[0] & maskC) + (mappedSrc4[2] & maskD);
-            dst[3] = (mappedSrc1[1] & maskA) + (mappedSrc2[0] & maskB) + (mappedSrc3[2] & maskC) + (mappedSrc4[3] & maskD);
-            dst += 4;
+            mappedSrc1 = src + b * blockSize + offsets[0 * numCells];
+            mappedSrc2 = src + b * blockSize + offsets[1 * numCells];
+            mappedSrc3 = src + b * blockSize + offsets[2 * numCells];
+            mappedSrc4 = src + b * blockSize + offsets[3 * numCells];
+            cellDst = dst + b * blockSize + n * MUM_CELL_SIZE;
+            cellDst[0] = (mappedSrc1[0] & maskA) + (mappedSrc2[2] & maskB) + (mappedSrc3[3] & maskC) + (mappedSrc4[1] & maskD);
+            cellDst[1] = (mappedSrc1[2] & maskA) + (mappedSrc2[3] & maskB) + (mappedSrc3[1] & maskC) + (mappedSrc4[0] & maskD);
+            cellDst[2] = (mappedSrc1[3] & maskA) + (mappedSrc2[1] & maskB) + (mappedSrc3[0] & maskC) + (mappedSrc4[2] & maskD);
+            cellDst[3] = (mappedSrc1[1] & maskA) + (mappedSrc2[0] & maskB) + (mappedSrc3[2] & maskC) + (mappedSrc4[3] & maskD);
         }
     }
 }
 
 
-void CMumblepad::EncryptConfuse(uint32_t round)
+template <class TGeometry>
+void CMumblepad::EncryptConfuseBlocks(const TGeometry &geometry, uint32_t round, uint8_t *src, uint8_t *dst, uint32_t numBlocks)
 {
-    uint32_t x, y;
+    uint32_t i, y, b;
     uint8_t *clav;
-    uint8_t *src;
-    uint8_t *dst;
-    uint32_t *prm;
-    uint32_t numRows = mMumInfo->numRows;
+    uint8_t *prm;
+    uint32_t numRows = geometry.numRows;
+    uint32_t blockSize = geometry.blockSize;
+    uint32_t rowSize = MUM_CELLS_X * MUM_CELL_SIZE;
+    TMumRoundContext *rc = mMumInfo->rounds[round];
 
-    // second pass for encrypt
-    // source = 1, destination = 0
-    src = mPingPongBlock[1];
-    dst = mPingPongBlock[0];
-    clav = mMumInfo->subkeys[round];
+    if (mMumInfo->cpuFeatures & MUM_CPU_FEATURE_AVX2)
+    {
+        MumEncryptConfuseAvx2(src, dst, rc->subkey, rc->permute, numRows, numBlocks, blockSize);
+        return;
+    }
 
     for ( y = 0; y < numRows; y++ )
     {
-        prm = mMumInfo->permuteTables8bit[round][y];
-        for ( x = 0; x < MUM_CELLS_X; x++ )
+        prm = rc->permute + y * MUM_NUM_8BIT_VALUES;
+        clav = rc->subkey + y * rowSize;
+        for ( b = 0; b < numBlocks; b++ )
         {
-            *dst++ = (uint8_t)prm[ (uint8_t)(*src++ ^ *clav++) ];
-            *dst++ = (uint8_t)prm[ (uint8_t)(*src++ ^ *clav++) ];
-            *dst++ = (uint8_t)prm[ (uint8_t)(*src++ ^ *clav++) ];
-            *dst++ = (uint8_t)prm[ (uint8_t)(*src++ ^ *clav++) ];
+            uint8_t *rowSrc = src + b * blockSize + y * rowSize;
+            uint8_t *rowDst = dst + b * blockSize + y * rowSize;
+            for ( i = 0; i < rowSize; i += 4 )
+            {
+                rowDst[i + 0] = prm[rowSrc[i + 0] ^ clav[i + 0]];
+                rowDst[i + 1] = prm[rowSrc[i + 1] ^ clav[i + 1]];
+                rowDst[i + 2] = prm[rowSrc[i + 2] ^ clav[i + 2]];
+                rowDst[i + 3] = prm[rowSrc[i + 3] ^ clav[i + 3]];
+            }
         }
     }
 }
 
 
-void CMumblepad::DecryptConfuse(uint32_t round)
+template <class TGeometry>
+void CMumblepad::DecryptConfuseBlocks(const TGeometry &geometry, uint32_t round, uint8_t *src, uint8_t *dst, uint32_t numBlocks)
 {
-    uint32_t x, y;
-    uint8_t *src, *dst, *clav;
-    uint32_t *prm;
-    uint32_t numRows = mMumInfo->numRows;
+    uint32_t i, y, b;
+    uint8_t *clav;
+    uint8_t *prm;
+    uint32_t numRows = geometry.numRows;
+    uint32_t blockSize = geometry.blockSize;
+    uint32_t rowSize = MUM_CELLS_X * MUM_CELL_SIZE;
+    TMumRoundContext *rc = mMumInfo->rounds[round];
 
-    // first pass for decrypt
-    // source = 0, destination = 1
-    src = mPingPongBlock[0];
-    dst = mPingPongBlock[1];
+    if (mMumInfo->cpuFeatures & MUM_CPU_FEATURE_AVX2)
+    {
+        MumDecryptConfuseAvx2(src, dst, rc->subkey, rc->permuteI, numRows, numBlocks, blockSize);
+        return;
+    }
 
-    clav = mMumInfo->subkeys[round];
     for ( y = 0; y < numRows; y++ )
     {
-        prm = mMumInfo->permuteTables8bitI[round][y];
-        for ( x = 0; x < MUM_CELLS_X; x++ )
+        prm = rc->permuteI + y * MUM_NUM_8BIT_VALUES;
+        clav = rc->subkey + y * rowSize;
+        for ( b = 0; b < numBlocks; b++ )
         {
-            *dst++ = (uint8_t)prm[*src++] ^ *clav++;
-            *dst++ = (uint8_t)prm[*src++] ^ *clav++;
-            *dst++ = (uint8_t)prm[*src++] ^ *clav++;
-            *dst++ = (uint8_t)prm[*src++] ^ *clav++;
+            uint8_t *rowSrc = src + b * blockSize + y * rowSize;
+            uint8_t *rowDst = dst + b * blockSize + y * rowSize;
+            for ( i = 0; i < rowSize; i += 4 )
+            {
+                rowDst[i + 0] = prm[rowSrc[i + 0]] ^ clav[i + 0];
+                rowDst[i + 1] = prm[rowSrc[i + 1]] ^ clav[i + 1];
+                rowDst[i + 2] = prm[rowSrc[i + 2]] ^ clav[i + 2];
+                rowDst[i + 3] = prm[rowSrc[i + 3]] ^ clav[i + 3];
+            }
         }
     }
 }
 
-void CMumblepad::DecryptDiffuse(uint32_t round)
+
+template <class TGeometry>
+void CMumblepad::DecryptDiffuseBlocks(const TGeometry &geometry, uint32_t round, uint8_t *src, uint8_t *dst, uint32_t numBlocks)
 {
-    uint32_t x, y, srcPosX1, srcPosY1, srcPosX2, srcPosY2, srcPosX3, srcPosY3, srcPosX4, srcPosY4;
+    uint32_t n, b;
     uint32_t maskA, maskB, maskC, maskD;
-    uint8_t *src;
-    uint8_t *dst;
-    uint8_t *mappedSrc1;
-    uint8_t *mappedSrc2;
-    uint8_t *mappedSrc3;
-    uint8_t *mappedSrc4;
-    uint32_t numRows = mMumInfo->numRows;
-
-    // second pass for decrypt
-    // source = 1, destination = 0
-    src = mPingPongBlock[1];
-    dst = mPingPongBlock[0];
-
-    maskA = mMumInfo->bitmasks[round][0];
-    maskB = mMumInfo->bitmasks[round][1];
-    maskC = mMumInfo->bitmasks[round][2];
-    maskD = mMumInfo->bitmasks[round][3];
-    for ( y = 0; y < numRows; y++ )
+    uint8_t *mappedSrc1, *mappedSrc2, *mappedSrc3, *mappedSrc4;
+    uint8_t *cellDst;
+    uint32_t numRows = geometry.numRows;
+    uint32_t numCells = numRows * MUM_CELLS_X;
+    uint32_t blockSize = geometry.blockSize;
+    TMumRoundContext *rc = mMumInfo->rounds[round];
+
+    if (JitEnabled())
     {
-        for ( x = 0; x < MUM_CELLS_X; x++ )
+        mJit->DecryptDiffuse(round)(src, dst, numBlocks, blockSize);
+        return;
+    }
+    if (mMumInfo->cpuFeatures & MUM_CPU_FEATURE_AVX2)
+    {
+        MumDecryptDiffuseAvx2(src, dst, rc->offsetsI, rc->bitmasks, numRows, numBlocks, blockSize);
+        return;
+    }
+
+    maskA = rc->bitmasks[0];
+    maskB = rc->bitmasks[1];
+    maskC = rc->bitmasks[2];
+    maskD = rc->bitmasks[3];
+    for ( n = 0; n < numCells; n++ )
+    {
+        uint16_t *offsets = rc->offsetsI + n;
+        for ( b = 0; b < numBlocks; b++ )
         {
-            srcPosX1 = mMumInfo->positionTables5bitXI[round][y][x][0];
-            srcPosY1 = mMumInfo->positionTables5bitYI[round][y][x][0];
-            mappedSrc1 = src + srcPosX1 * MUM_CELL_SIZE + srcPosY1 * MUM_CELLS_X* MUM_CELL_SIZE;
-            srcPosX2 = mMumInfo->positionTables5bitXI[round][y][x][1];
-            srcPosY2 = mMumInfo->positionTables5bitYI[round][y][x][1];
-            mappedSrc2 = src + srcPosX2 * MUM_CELL_SIZE + srcPosY2 * MUM_CELLS_X* MUM_CELL_SIZE;
-            srcPosX3 = mMumInfo->positionTables5bitXI[round][y][x][2];
-            srcPosY3 = mMumInfo->positionTables5bitYI[round][y][x][2];
-            mappedSrc3 = src + srcPosX3 * MUM_CELL_SIZE + srcPosY3 * MUM_CELLS_X* MUM_CELL_SIZE;
-            srcPosX4 = mMumInfo->positionTables5bitXI[round][y][x][3];
-            srcPosY4 = mMumInfo->positionTables5bitYI[round][y][x][3];
-            mappedSrc4 = src + srcPosX4 * MUM_CELL_SIZE + srcPosY4 * MUM_CELLS_X* MUM_CELL_SIZE;
-            *dst++ = (mappedSrc1[0] & maskA) + (mappedSrc2[3] & maskB) + (mappedSrc3[2] & maskC) + (mappedSrc4[1] & maskD);
-            *dst++ = (mappedSrc1[3] & maskA) + (mappedSrc2[2] & maskB) + (mappedSrc3[1] & maskC) + (mappedSrc4[0] & maskD);
-            *dst++ = (mappedSrc1[1] & maskA) + (mappedSrc2[0] & maskB) + (mappedSrc3[3] & maskC) + (mappedSrc4[2] & maskD);
-            *dst++ = (mappedSrc1[2] & maskA) + (mappedSrc2[1] & maskB) + (mappedSrc3[0] & maskC) + (mappedSrc4[3] & maskD);
+            mappedSrc1 = src + b * blockSize + offsets[0 * numCells];
+            mappedSrc2 = src + b * blockSize + offsets[1 * numCells];
+            mappedSrc3 = src + b * blockSize + offsets[2 * numCells];
+            mappedSrc4 = src + b * blockSize + offsets[3 * numCells];
+            cellDst = dst + b * blockSize + n * MUM_CELL_SIZE;
+            cellDst[0] = (mappedSrc1[0] & maskA) + (mappedSrc2[3] & maskB) + (mappedSrc3[2] & maskC) + (mappedSrc4[1] & maskD);
+            cellDst[1] = (mappedSrc1[3] & maskA) + (mappedSrc2[2] & maskB) + (mappedSrc3[1] & maskC) + (mappedSrc4[0] & maskD);
+            cellDst[2] = (mappedSrc1[1] & maskA) + (mappedSrc2[0] & maskB) + (mappedSrc3[3] & maskC) + (mappedSrc4[2] & maskD);
+            cellDst[3] = (mappedSrc1[2] & maskA) + (mappedSrc2[1] & maskB) + (mappedSrc3[0] & maskC) + (mappedSrc4[3] & maskD);
         }
     }
 }
@@ -227,3 +510,17 @@ void CMumblepad::DecryptDownload(uint8_t *data)
 }
 
 
+
+
+// the rounds CMumblepadT runs for each block type
+#define MUM_INSTANTIATE_TILE_ROUNDS(blockType) \
+    template void CMumblepad::EncryptTileRoundsT(const TMumBlockGeometry<blockType> &geometry, uint8_t *src, uint8_t *blocks, uint8_t *scratch, uint32_t numBlocks); \
+    template void CMumblepad::DecryptTileRoundsT(const TMumBlockGeometry<blockType> &geometry, uint8_t *src, uint8_t *blocks, uint8_t *scratch, uint32_t numBlocks);
+
+MUM_INSTANTIATE_TILE_ROUNDS(MUM_BLOCKTYPE_128)
+MUM_INSTANTIATE_TILE_ROUNDS(MUM_BLOCKTYPE_256)
+MUM_INSTANTIATE_TILE_ROUNDS(MUM_BLOCKTYPE_512)
+MUM_INSTANTIATE_TILE_ROUNDS(MUM_BLOCKTYPE_1024)
+MUM_INSTANTIATE_TILE_ROUNDS(MUM_BLOCKTYPE_2048)
+MUM_INSTANTIATE_TILE_ROUNDS(MUM_BLOCKTYPE_4096)
+MUM_INSTANTIATE_TILE_ROUNDS(MUM_BLOCKTYPE_8192)
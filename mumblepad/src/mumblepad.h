@@ -32,6 +32,26 @@
 #define __MUMBLEPAD_H
 
 #include "mumrenderer.h"
+#include "mumjit.h"
+
+// Block geometry the scalar passes are instantiated for. The generic
+// renderer reads it from TMumInfo; TMumBlockGeometry has it as
+// compile-time constants for CMumblepadT.
+struct TMumGeometry
+{
+    TMumGeometry(const TMumInfo *mumInfo) : numRows(mumInfo->numRows), blockSize(mumInfo->encryptedBlockSize) {}
+    uint32_t numRows;
+    uint32_t blockSize;
+};
+
+template <EMumBlockType blockType> struct TMumBlockGeometry;
+template <> struct TMumBlockGeometry<MUM_BLOCKTYPE_128>  { enum { numRows = 1,  blockSize = MUM_BLOCK_SIZE_R1 }; };
+template <> struct TMumBlockGeometry<MUM_BLOCKTYPE_256>  { enum { numRows = 2,  blockSize = MUM_BLOCK_SIZE_R2 }; };
+template <> struct TMumBlockGeometry<MUM_BLOCKTYPE_512>  { enum { numRows = 4,  blockSize = MUM_BLOCK_SIZE_R4 }; };
+template <> struct TMumBlockGeometry<MUM_BLOCKTYPE_1024> { enum { numRows = 8,  blockSize = MUM_BLOCK_SIZE_R8 }; };
+template <> struct TMumBlockGeometry<MUM_BLOCKTYPE_2048> { enum { numRows = 16, blockSize = MUM_BLOCK_SIZE_R16 }; };
+template <> struct TMumBlockGeometry<MUM_BLOCKTYPE_4096> { enum { numRows = 32, blockSize = MUM_BLOCK_SIZE_R32 }; };
+template <> struct TMumBlockGeometry<MUM_BLOCKTYPE_8192> { enum { numRows = 64, blockSize = MUM_BLOCK_SIZE_R64 }; };
 
 class CMumblepad : public CMumRenderer {
 public:
@@ -46,6 +66,63 @@ public:
     virtual void DecryptUpload(uint8_t *data);
     virtual void DecryptDownload(uint8_t *data);
     virtual void InitKey();
+    virtual void EncryptRounds();
+    virtual void DecryptRounds();
+    virtual EMumError EncryptBlock(uint8_t *src, uint8_t *dst, uint32_t length, uint32_t seqnum);
+    virtual EMumError DecryptBlock(uint8_t *src, uint8_t *dst, uint32_t *length, uint32_t *seqnum);
+    virtual EMumError EncryptBlocks(uint8_t *src, uint8_t *dst, uint32_t numBlocks, uint32_t seqnum);
+    virtual EMumError DecryptBlocks(uint8_t *src, uint8_t *dst, uint32_t numBlocks, uint32_t *outlength);
+    // EncryptTile packs a tile that overlaps its output into mTile first
+    virtual uint32_t StagedBlocks() { return mMumInfo->tileBlocks; }
+protected:
+    // A tile of numBlocks blocks without staging copies: encryption packs
+    // straight into dst and runs the rounds there, decryption reads src in
+    // its first pass. packed takes the packed tile only when src and dst
+    // overlap, blocks takes the decrypted tile before unpacking; scratch is
+    // the other ping-pong half. length is the plaintext length of each block.
+    // In the large-buffer mode the rounds run entirely in packed or blocks
+    // and the result is streamed out to dst.
+    EMumError EncryptTile(uint8_t *src, uint8_t *dst, uint8_t *packed, uint8_t *scratch, uint32_t numBlocks, uint32_t length, uint32_t seqnum);
+    EMumError DecryptTile(uint8_t *src, uint8_t *dst, uint8_t *blocks, uint8_t *scratch, uint32_t numBlocks, uint32_t *outlength, uint32_t *seqnum);
+    // Rounds and passes over a tile of numBlocks contiguous blocks, round
+    // by round, so each round's tables stay hot across the tile. Within a
+    // pass the blocks are interleaved, so each table entry is loaded once
+    // for all of them and their load chains overlap. The first pass reads
+    // src, every later pass alternates between scratch and blocks, so the
+    // result ends up in blocks; src may be blocks.
+    // The tile driver calls them once per tile; CMumblepadT overrides them
+    // with the passes instantiated for its block type.
+    virtual void EncryptTileRounds(uint8_t *src, uint8_t *blocks, uint8_t *scratch, uint32_t numBlocks);
+    virtual void DecryptTileRounds(uint8_t *src, uint8_t *blocks, uint8_t *scratch, uint32_t numBlocks);
+    // The same for a given geometry, TMumGeometry or a TMumBlockGeometry;
+    // instantiated in mumblepad.cpp
+    template <class TGeometry>
+    void EncryptTileRoundsT(const TGeometry &geometry, uint8_t *src, uint8_t *blocks, uint8_t *scratch, uint32_t numBlocks);
+    template <class TGeometry>
+    void DecryptTileRoundsT(const TGeometry &geometry, uint8_t *src, uint8_t *blocks, uint8_t *scratch, uint32_t numBlocks);
+    template <class TGeometry>
+    void EncryptDiffuseBlocks(const TGeometry &geometry, uint32_t round, uint8_t *src, uint8_t *dst, uint32_t numBlocks);
+    template <class TGeometry>
+    void EncryptConfuseBlocks(const TGeometry &geometry, uint32_t round, uint8_t *src, uint8_t *dst, uint32_t numBlocks);
+    template <class TGeometry>
+    void DecryptConfuseBlocks(const TGeometry &geometry, uint32_t round, uint8_t *src, uint8_t *dst, uint32_t numBlocks);
+    template <class TGeometry>
+    void DecryptDiffuseBlocks(const TGeometry &geometry, uint32_t round, uint8_t *src, uint8_t *dst, uint32_t numBlocks);
+    void AllocateTile();
+    // prefetches slice index of numSlices slices of the next tile's source
+    void PrefetchSlice(uint32_t index, uint32_t numSlices);
+    // the diffusion passes go through mJit when CMumblepadJit has compiled
+    // them for the key and SSE4.1 is enabled
+    bool JitEnabled() { return mJit != nullptr && mJit->Compiled() && (mMumInfo->cpuFeatures & MUM_CPU_FEATURE_SSE41); }
+
+    // ping-pong halves of the tile, room for mTileCapacity blocks
+    uint8_t *mTile[2];
+    uint32_t mTileCapacity;
+    // the next tile's source while a tile of a large buffer is in the rounds
+    const uint8_t *mPrefetch;
+    uint32_t mPrefetchSize;
+    // owned by CMumblepadJit, nullptr for the other CPU renderers
+    CMumJit *mJit;
 };
 
 
@@ -396,7 +396,7 @@ void CMumblepadGla::InitKey()
         delete mPrng;
         mPrng = nullptr;
     }
-    mPrng = new CMumPrng(mMumInfo->subkeys[MUM_PRNG_SUBKEY_INDEX]);
+    mPrng = new CMumPrng(mMumInfo->subkeys[MUM_PRNG_SUBKEY_INDEX], 0);
 }
 
 
@@ -432,11 +432,11 @@ void CMumblepadGla::WriteTextures()
 
         mGlw->glBindTexture( GL_TEXTURE_2D, mLutTexturePermute[round] );
         mGlw->glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, MUM_NUM_8BIT_VALUES,
-            mMumInfo->numRows, GL_LUMINANCE, GL_UNSIGNED_BYTE, mMumInfo->permuteTextureData[round]);
+            mMumInfo->numRows, GL_LUMINANCE, GL_UNSIGNED_BYTE, mMumInfo->permuteTextureData[round * mMumInfo->numPermuteRows]);
 
         mGlw->glBindTexture( GL_TEXTURE_2D, mLutTexturePermuteI[round] );
         mGlw->glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, MUM_NUM_8BIT_VALUES,
-            mMumInfo->numRows, GL_LUMINANCE, GL_UNSIGNED_BYTE, mMumInfo->permuteTextureDataI[round]);
+            mMumInfo->numRows, GL_LUMINANCE, GL_UNSIGNED_BYTE, mMumInfo->permuteTextureDataI[round * mMumInfo->numPermuteRows]);
     }
 }
 
@@ -428,7 +428,7 @@ void CMumblepadGlb::InitKey()
         delete mPrng;
         mPrng = nullptr;
     }
-    mPrng = new CMumPrng(mMumInfo->subkeys[MUM_PRNG_SUBKEY_INDEX]);
+    mPrng = new CMumPrng(mMumInfo->subkeys[MUM_PRNG_SUBKEY_INDEX], 0);
 }
 
 void CMumblepadGlb::WriteTextures()
@@ -448,11 +448,11 @@ void CMumblepadGlb::WriteTextures()
 
         mGlw->glBindTexture( GL_TEXTURE_2D, mLutTexturePermute );
         mGlw->glTexSubImage2D(GL_TEXTURE_2D, 0, 0, r*MUM_CELLS_MAX_Y, MUM_NUM_8BIT_VALUES,
-            MUM_CELLS_MAX_Y, GL_LUMINANCE, GL_UNSIGNED_BYTE, mMumInfo->permuteTextureData[r]);
+            MUM_CELLS_MAX_Y, GL_LUMINANCE, GL_UNSIGNED_BYTE, mMumInfo->permuteTextureData[r * mMumInfo->numPermuteRows]);
 
         mGlw->glBindTexture( GL_TEXTURE_2D, mLutTexturePermuteI );
         mGlw->glTexSubImage2D(GL_TEXTURE_2D, 0, 0, r*MUM_CELLS_MAX_Y, MUM_NUM_8BIT_VALUES,
-            MUM_CELLS_MAX_Y, GL_LUMINANCE, GL_UNSIGNED_BYTE, mMumInfo->permuteTextureDataI[indicesB[r]]);
+            MUM_CELLS_MAX_Y, GL_LUMINANCE, GL_UNSIGNED_BYTE, mMumInfo->permuteTextureDataI[indicesB[r] * mMumInfo->numPermuteRows]);
 
         mGlw->glBindTexture( GL_TEXTURE_2D, mLutTextureBitmask );
         mGlw->glTexSubImage2D(GL_TEXTURE_2D, 0, 0, r*MUM_CELLS_MAX_Y, MUM_NUM_8BIT_VALUES,
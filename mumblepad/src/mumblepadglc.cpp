@@ -482,11 +482,11 @@ void CMumblepadGlc::WriteTextures()
 
         mGlw->glBindTexture( GL_TEXTURE_2D, mLutTexturePermute );
         mGlw->glTexSubImage2D(GL_TEXTURE_2D, 0, 0, r*MUM_CELLS_MAX_Y, MUM_NUM_8BIT_VALUES,
-            MUM_CELLS_MAX_Y, GL_LUMINANCE, GL_UNSIGNED_BYTE, mMumInfo->permuteTextureData[r]);
+            MUM_CELLS_MAX_Y, GL_LUMINANCE, GL_UNSIGNED_BYTE, mMumInfo->permuteTextureData[r * mMumInfo->numPermuteRows]);
 
         mGlw->glBindTexture( GL_TEXTURE_2D, mLutTexturePermuteI );
         mGlw->glTexSubImage2D(GL_TEXTURE_2D, 0, 0, r*MUM_CELLS_MAX_Y, MUM_NUM_8BIT_VALUES,
-            MUM_CELLS_MAX_Y, GL_LUMINANCE, GL_UNSIGNED_BYTE, mMumInfo->permuteTextureDataI[indicesB[r]]);
+            MUM_CELLS_MAX_Y, GL_LUMINANCE, GL_UNSIGNED_BYTE, mMumInfo->permuteTextureDataI[indicesB[r] * mMumInfo->numPermuteRows]);
 
         mGlw->glBindTexture( GL_TEXTURE_2D, mLutTextureBitmask );
         mGlw->glTexSubImage2D(GL_TEXTURE_2D, 0, 0, r*MUM_CELLS_MAX_Y, MUM_NUM_8BIT_VALUES,
@@ -0,0 +1,52 @@
+//////////////////////////////////////////////////////////////////////////
+//                                                                      //
+//   Mumblepad Block Cipher                                             //
+//   Version 1, completed March 14, 2017                                //
+//                                                                      //
+//   Key size 4096 bytes, 32768 bits                                    //
+//   Six different block sizes: 128, 256, 512, 1024, 2048, 4096 bytes   //
+//   Encryption and decryption, runs on either CPU and GPU              //
+//   May run multi-threaded on CPU.                                     //
+//   Runs on GPU with OpenGL or OpenGL ES 2.0                           //
+//                                                                      //
+//   Encrypted blocks containing same plaintext are different, due to   //
+//   small amount of per-block random number padding.                   //
+//   Encrypted block contains length, 16-bit sequence number, 32-bit    //
+//   checksum.                                                          //
+//   No block cipher mode required                                      //
+//   Can use parallel processing, multi-threaded encrypt/decrypt        //
+//                                                                      //
+//   8 rounds, 2 passes per round                                       //
+//   Encrypt: diffusion pass followed by confusion pass.                //
+//   Decrypt: inverse confusion followed by inverse diffusion.          //
+//                                                                      //
+//   Free for non-commercial use, analysis/evaluation.                  //
+//                                                                      //
+//   Copyright 2017, Kyle Granger                                       //
+//   Email contact:  kyle.granger@chello.at                             //
+//                                                                      //
+//////////////////////////////////////////////////////////////////////////
+
+
+
+#include "mumblepadjit.h"
+
+
+CMumblepadJit::CMumblepadJit(TMumInfo *mumInfo) : CMumblepad(mumInfo)
+{
+    mJit = new CMumJit(mMumInfo->numRows);
+}
+
+CMumblepadJit::~CMumblepadJit()
+{
+    delete mJit;
+    mJit = nullptr;
+}
+
+
+// CMumEngine::InitKey has filled the key context by now.
+void CMumblepadJit::InitKey()
+{
+    CMumblepad::InitKey();
+    mJit->Compile(mMumInfo);
+}
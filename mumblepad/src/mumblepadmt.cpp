@@ -28,214 +28,522 @@
 //////////////////////////////////////////////////////////////////////////
 
 
-#include <windows.h>
 #include "mumblepadmt.h"
+#include "mumrequest.h"
 #include "malloc.h"
 #include "string.h"
 #include "assert.h"
 #include "stdio.h"
+#include <thread>
 
 
+// Memory is placed on the node of the thread that first touches it, so
+// work that creates or fills a node's tables runs on a thread pinned there.
+static void MumRunOnCpu(uint32_t cpu, const std::function<void()> &work)
+{
+    std::thread thread([&]() { CMumTopology::Pin(cpu); work(); });
+    thread.join();
+}
 
-CMumblepadMt::CMumblepadMt(TMumInfo *mumInfo, uint32_t numThreads) : CMumRenderer(mumInfo)
+
+// numThreads is how many workers of the pool a call is spread over at most.
+// A worker's state for the engine is only made once it gets a ticket of the
+// engine, see Worker, so an engine costs no more than the workers it uses.
+CMumblepadMt::CMumblepadMt(TMumInfo *mumInfo, uint32_t numThreads, EMumPlacementType placement) : CMumRenderer(mumInfo)
 {
     mMumInfo = mumInfo;
-    mNumThreads = numThreads;
-    mStarted = false;
-    for (int i = 0; i < MUM_MAX_THREADS; i++)
-        mThreads[i] = nullptr;
-    mServerSignal = CreateEvent(NULL, FALSE, FALSE, "MumServerSignal");
-    for (uint32_t i = 0; i < mNumThreads; i++)
-        mThreads[i] = new CMumblepadThread(mMumInfo, i + 1, mServerSignal);
-    Start();
-    Sleep(100);
+    mPool = CMumWorkerPool::Acquire(placement);
+    if (numThreads == 0 && mPool->IsPlaced())
+        numThreads = mPool->NumWorkers();
+    mNumThreads = (numThreads < MUM_MAX_THREADS) ? numThreads : MUM_MAX_THREADS;
+    mNumWorkers = mPool->NumWorkers();
+    mWorkers = new std::atomic<CMumblepadThread *>[mNumWorkers];
+    uint32_t numNodes = 0;
+    for (uint32_t w = 0; w < mNumWorkers; w++)
+    {
+        mWorkers[w] = nullptr;
+        if (mPool->IsPlaced() && mPool->Node(w) >= numNodes)
+            numNodes = mPool->Node(w) + 1;
+    }
+    TMumNode none = { 0, nullptr, nullptr };
+    mNodes.resize(numNodes, none);
+    mPriority = MUM_PRIORITY_BULK;
+    mInlineBlocks = MUM_INLINE_BLOCKS;
 }
 
+// Every synchronous call has returned; the asynchronous requests are waited
+// for, after which no worker touches the engine again
 CMumblepadMt::~CMumblepadMt()
 {
-    Stop();
-    for (uint32_t i = 0; i < mNumThreads; i++)
-        delete mThreads[i];
-    CloseHandle(mServerSignal);
+    mRequests.Wait(0);
+    for (uint32_t w = 0; w < mNumWorkers; w++)
+        delete mWorkers[w];
+    delete[] mWorkers;
+    for (uint32_t i = 0; i < mInline.size(); i++)
+        delete mInline[i];
+    for (uint32_t n = 0; n < mNodes.size(); n++)
+    {
+        delete mNodes[n].keyContext;
+        delete mNodes[n].mumInfo;
+    }
+    CMumWorkerPool::Release(mPool);
+}
+
+// The engine keeps its workers' and inline renderers' state, and its hold
+// on the pool, so the pool's threads keep running while it is idle. Their
+// PRNGs and the node copies of the key go; the engine wipes its own.
+void CMumblepadMt::Recycle()
+{
+    mRequests.Wait(0);
+    for (uint32_t w = 0; w < mNumWorkers; w++)
+    {
+        CMumblepadThread *worker = mWorkers[w];
+        if (worker == nullptr)
+            continue;
+        worker->Recycle();
+        worker->mBytesDone = 0;
+        worker->mBusyMicroseconds = 0;
+    }
+    for (uint32_t i = 0; i < mInline.size(); i++)
+        mInline[i]->Recycle();
+    for (uint32_t n = 0; n < mNodes.size(); n++)
+    {
+        TMumNode &node = mNodes[n];
+        if (node.mumInfo == nullptr)
+            continue;
+        MumWipeKeyTables(node.mumInfo);
+        node.keyContext->Wipe();
+    }
+    mPriority = MUM_PRIORITY_BULK;
+    mInlineBlocks = MUM_INLINE_BLOCKS;
+}
+
+// The pool worker's state for the engine, made by the worker itself on its
+// first ticket of the engine; only that worker asks for it. Meanwhile other
+// workers may be running the engine's tickets, so nothing they read is
+// written: the renderer's block geometry is already in mMumInfo.
+CMumblepadThread *CMumblepadMt::Worker(uint32_t worker)
+{
+    CMumblepadThread *state = mWorkers[worker];
+    if (state != nullptr)
+        return state;
+    std::lock_guard<std::mutex> lock(mWorkersMutex);
+    TMumInfo *mumInfo = mPool->IsPlaced() ? NodeInfo(mPool->Place(worker)) : mMumInfo;
+    state = new CMumblepadThread(mumInfo, worker + 1, mPool->Node(worker), mPool);
+    mWorkers[worker] = state;
+    return state;
+}
+
+// The copy is made by the first worker of the node that needs it, under
+// mWorkersMutex; the worker is pinned to a CPU of the node, so the pages
+// are the node's own.
+TMumInfo *CMumblepadMt::NodeInfo(const TMumCpu &place)
+{
+    TMumNode &node = mNodes[place.node];
+    if (node.mumInfo == nullptr)
+    {
+        node.cpu = place.cpu;
+        node.mumInfo = new TMumInfo;
+        memcpy(node.mumInfo, mMumInfo, sizeof(TMumInfo));
+        node.keyContext = new CMumKeyContext(mMumInfo->numRows);
+        if (mMumInfo->keyInitialized)
+            node.keyContext->Init(node.mumInfo);
+    }
+    return node.mumInfo;
+}
+
+// The engine has just completed the key schedule in its own TMumInfo
+void CMumblepadMt::InitKey()
+{
+    std::lock_guard<std::mutex> lock(mWorkersMutex);
+    for (uint32_t n = 0; n < mNodes.size(); n++)
+    {
+        TMumNode &node = mNodes[n];
+        if (node.mumInfo == nullptr)
+            continue;
+        MumRunOnCpu(node.cpu, [&]() {
+            memcpy(node.mumInfo, mMumInfo, sizeof(TMumInfo));
+            node.keyContext->Init(node.mumInfo);
+        });
+    }
+    for (uint32_t w = 0; w < mNumWorkers; w++)
+    {
+        CMumblepadThread *worker = mWorkers[w];
+        if (worker != nullptr)
+            worker->InitKey();
+    }
+    std::lock_guard<std::mutex> inlineLock(mInlineMutex);
+    for (uint32_t i = 0; i < mInline.size(); i++)
+        mInline[i]->InitKey();
+}
+
+// The engine has just changed a setting in its own TMumInfo. Settings only
+// change between calls, so no worker reads the node copies meanwhile.
+void CMumblepadMt::SettingsChanged()
+{
+    std::lock_guard<std::mutex> lock(mWorkersMutex);
+    for (uint32_t n = 0; n < mNodes.size(); n++)
+    {
+        TMumInfo *mumInfo = mNodes[n].mumInfo;
+        if (mumInfo == nullptr)
+            continue;
+        mumInfo->cpuFeatures = mMumInfo->cpuFeatures;
+        mumInfo->tileBlocks = mMumInfo->tileBlocks;
+        mumInfo->largeBufferSize = mMumInfo->largeBufferSize;
+    }
+}
+
+uint32_t CMumblepadMt::NumNodes()
+{
+    return mNodes.empty() ? 1 : (uint32_t)mNodes.size();
+}
+
+// numWorkers counts the pool's workers on the node, shared with the other
+// engines; bytes and microseconds are this engine's work only
+EMumError CMumblepadMt::GetNodeStats(uint32_t node, uint32_t *numWorkers, uint64_t *bytes, uint64_t *microseconds)
+{
+    if (node >= NumNodes())
+        return MUM_ERROR_INVALID_NODE;
+    *numWorkers = 0;
+    *bytes = 0;
+    *microseconds = 0;
+    for (uint32_t w = 0; w < mNumWorkers; w++)
+    {
+        if (mPool->Node(w) != node)
+            continue;
+        (*numWorkers)++;
+        CMumblepadThread *worker = mWorkers[w];
+        if (worker == nullptr)
+            continue;
+        *bytes += worker->mBytesDone;
+        *microseconds += worker->mBusyMicroseconds;
+    }
+    return MUM_ERROR_OK;
+}
+
+EMumError CMumblepadMt::GetPriority(EMumPriority *priority)
+{
+    *priority = mPriority;
+    return MUM_ERROR_OK;
 }
 
+EMumError CMumblepadMt::SetPriority(EMumPriority priority)
+{
+    mPriority = priority;
+    return MUM_ERROR_OK;
+}
 
-void CMumblepadMt::Start()
+EMumError CMumblepadMt::GetInlineBlocks(uint32_t *inlineBlocks)
 {
-    mStarted = true;
-    for (uint32_t i = 0; i < mNumThreads; i++)
-        mThreads[i]->Start();
+    *inlineBlocks = mInlineBlocks;
+    return MUM_ERROR_OK;
 }
 
-void CMumblepadMt::Stop()
+EMumError CMumblepadMt::SetInlineBlocks(uint32_t inlineBlocks)
 {
-    for (uint32_t i = 0; i < mNumThreads; i++)
-        mThreads[i]->Stop();
-    Sleep(100);
-    mStarted = false;
+    mInlineBlocks = inlineBlocks;
+    return MUM_ERROR_OK;
 }
 
+// A single block goes through the pool like any other call, to whichever
+// worker is free, unless it runs inline; any number of callers may have
+// blocks in flight.
 EMumError CMumblepadMt::EncryptBlock(uint8_t *src, uint8_t *dst, uint32_t length, uint32_t seqnum)
 {
-    if (mNumThreads == 0 || mThreads[0] == nullptr)
+    TMumJob job;
+
+    if (mNumThreads == 0)
         return MUM_ERROR_MTRENDERER_NO_THREADS;
-    return mThreads[0]->EncryptBlock(src, dst, length, seqnum);
+    job.type = MUM_JOB_TYPE_ENCRYPT_BLOCK;
+    job.priority = mPriority;
+    job.src = src;
+    job.dst = dst;
+    job.length = length;
+    job.seqNum = seqnum;
+    job.inPlace = false;
+    job.largeBuffer = IsLargeBuffer(length);
+    job.grainBlocks = 1;
+    Dispatch(job, 1);
+    return job.error;
 }
 
 EMumError CMumblepadMt::DecryptBlock(uint8_t *src, uint8_t *dst, uint32_t *length, uint32_t *seqnum)
 {
-    if (mNumThreads == 0 || mThreads[0] == nullptr)
+    TMumJob job;
+
+    if (mNumThreads == 0)
         return MUM_ERROR_MTRENDERER_NO_THREADS;
-    return mThreads[0]->DecryptBlock(src, dst, length, seqnum);
+    job.type = MUM_JOB_TYPE_DECRYPT_BLOCK;
+    job.priority = mPriority;
+    job.src = src;
+    job.dst = dst;
+    job.length = mMumInfo->encryptedBlockSize;
+    job.seqNum = 0;
+    job.inPlace = false;
+    job.largeBuffer = IsLargeBuffer(job.length);
+    job.grainBlocks = 1;
+    Dispatch(job, 1);
+    *length = job.outlength;
+    *seqnum = job.seqNum;
+    return job.error;
+}
+
+// About MUM_GRAINS_PER_WORKER grains per worker: a request of a few blocks
+// still reaches every worker, a large one leaves enough grains for stealing
+// to even out the end of the call. Grains stay below MUM_MAX_BYTES_PER_JOB.
+uint32_t CMumblepadMt::GrainBlocks(uint32_t numBlocks, uint32_t blockSize)
+{
+    uint32_t maxGrainBlocks = MUM_MAX_BYTES_PER_JOB / blockSize;
+    uint32_t grainBlocks = numBlocks / (mNumThreads * MUM_GRAINS_PER_WORKER);
+    if (grainBlocks > maxGrainBlocks)
+        grainBlocks = maxGrainBlocks;
+    if (grainBlocks < 1)
+        grainBlocks = 1;
+    return grainBlocks;
 }
 
+// one slot per worker, no more slots than there are grains
+uint32_t CMumblepadMt::NumSlots(uint32_t numGrains)
+{
+    return (numGrains < mNumThreads) ? numGrains : mNumThreads;
+}
 
-EMumError CMumblepadMt::Encrypt(uint8_t *src, uint8_t *dst, uint32_t length, uint32_t *outlength, uint16_t seqNum)
+// the blocks of an Encrypt or Decrypt job, 1 for the block calls
+uint32_t CMumblepadMt::NumBlocks(const TMumJob &job)
 {
-    uint32_t plaintextSize, encryptedSize;
+    switch (job.type)
+    {
+    case MUM_JOB_TYPE_ENCRYPT:
+        return (job.length + mMumInfo->plaintextBlockSize - 1) / mMumInfo->plaintextBlockSize;
+    case MUM_JOB_TYPE_DECRYPT:
+        return (job.length + mMumInfo->encryptedBlockSize - 1) / mMumInfo->encryptedBlockSize;
+    default:
+        return 1;
+    }
+}
 
-    *outlength = 0;
-    for (uint32_t i = 0; i < mNumThreads; i++)
-        mThreads[i]->mEncryptLength = 0;
+// Splits the grains evenly over numSlots slots of the job
+void CMumblepadMt::Spread(TMumJob &job, TMumSlot *slots, uint32_t numSlots, uint32_t numGrains)
+{
+    job.renderer = this;
+    job.slots = slots;
+    job.numSlots = numSlots;
+    job.outlength = 0;
+    job.error = MUM_ERROR_OK;
+    job.pending = numSlots;
+    for (uint32_t i = 0; i < numSlots; i++)
+    {
+        slots[i].range.Set(
+            (uint32_t)((uint64_t)numGrains * i / numSlots),
+            (uint32_t)((uint64_t)numGrains * (i + 1) / numSlots));
+        slots[i].node = 0;
+    }
+}
 
-    uint32_t blocksPerJob = MUM_MAX_BYTES_PER_JOB / mMumInfo->plaintextBlockSize;
-    while (length > 0)
+// Spreads the grains over a slot per worker and queues a ticket per slot,
+// at the job's priority. Every range is set before the tickets are queued,
+// so no early thief finds a share missing. The tickets of concurrent calls
+// interleave in the queue; a worker done with one call's slot takes the
+// next ticket of whichever call is waiting. The job may be complete, and
+// an asynchronous one freed, by the time the tickets are all queued.
+void CMumblepadMt::Submit(TMumJob &job, TMumSlot *slots, uint32_t numGrains)
+{
+    uint32_t numSlots = NumSlots(numGrains);
+    std::vector<TMumTicket> tickets(numSlots);
+
+    Spread(job, slots, numSlots, numGrains);
+    for (uint32_t i = 0; i < numSlots; i++)
     {
-        TMumJob job;
-
-        // Prepare a job
-        //
-        if (length >= mMumInfo->plaintextBlockSize * blocksPerJob)
-            plaintextSize = mMumInfo->plaintextBlockSize * blocksPerJob;
-        else
-            plaintextSize = length;
-        encryptedSize = plaintextSize * mMumInfo->encryptedBlockSize / mMumInfo->plaintextBlockSize;
-
-        length -= plaintextSize;
-        job.state = MUM_JOB_STATE_NONE;
-        job.type = MUM_JOB_TYPE_ENCRYPT;
-        job.src = src;
-        job.dst = dst;
-        job.length = plaintextSize;
-        job.seqNum = seqNum;
-
-        // Update pointers;
-        src += plaintextSize;
-        dst += encryptedSize;
-        seqNum += (uint16_t) blocksPerJob;
-
-        // Hand off the job
-        bool assigned = false;
-        while (!assigned)
-        {
-            for (uint32_t i = 0; i < mNumThreads; i++)
-            {
-                if (mThreads[i]->mJob.state == MUM_JOB_STATE_DONE)
-                {
-                    mThreads[i]->mJob = job;
-                    mThreads[i]->mJob.state = MUM_JOB_STATE_ASSIGNED;
-                    SetEvent(mThreads[i]->mWorkerSignal);
-                    assigned = true;
-                    break;
-                }
-            }
-            if (!assigned)
-            {
-                WaitForSingleObject(mServerSignal, 100);
-                ResetEvent(mServerSignal);
-            }
-            else
-                break;
-        }
+        tickets[i].job = &job;
+        tickets[i].slot = i;
     }
+    mPool->Push(tickets.data(), numSlots, job.priority);
+}
 
-    while (true)
+// A free inline renderer, or a new one while there are streams left for
+// it; nullptr once they are all lent out. There are only ever as many as
+// callers have run inline at the same time.
+CMumblepadThread *CMumblepadMt::BorrowInline()
+{
+    std::lock_guard<std::mutex> lock(mInlineMutex);
+    if (mInlineFree.empty())
     {
-        bool working = false;
-        for (uint32_t i = 0; i < mNumThreads; i++)
-        {
-            if (mThreads[i]->mJob.state != MUM_JOB_STATE_DONE)
-                working = true;
-        }
-        if (!working)
-            break;
+        if (mInline.size() >= MUM_MAX_THREADS - mNumWorkers)
+            return nullptr;
+        CMumblepadThread *renderer = new CMumblepadThread(mMumInfo, mNumWorkers + 1 + (uint32_t)mInline.size(), 0, nullptr);
+        mInline.push_back(renderer);
+        return renderer;
     }
-    for (uint32_t i = 0; i < mNumThreads; i++)
-        *outlength += mThreads[i]->mEncryptLength;
-    return MUM_ERROR_OK;
+    CMumblepadThread *renderer = mInlineFree.back();
+    mInlineFree.pop_back();
+    return renderer;
 }
 
-EMumError CMumblepadMt::Decrypt(uint8_t *src, uint8_t *dst, uint32_t length, uint32_t *outlength)
+void CMumblepadMt::ReturnInline(CMumblepadThread *renderer)
+{
+    std::lock_guard<std::mutex> lock(mInlineMutex);
+    mInlineFree.push_back(renderer);
+}
+
+// Runs the job with its slots on the caller's stack and waits until the
+// worker of the last slot has completed it. A job of at most mInlineBlocks
+// blocks is instead run right here, as a single slot, on an inline
+// renderer: it costs less than handing it to a worker and waking the
+// caller again, and does not wait behind queued jobs.
+void CMumblepadMt::Dispatch(TMumJob &job, uint32_t numGrains)
 {
-    uint32_t plaintextSize, encryptedSize;
+    CMumblepadThread *renderer = (NumBlocks(job) <= mInlineBlocks) ? BorrowInline() : nullptr;
+    std::vector<TMumSlot> slots((renderer == nullptr) ? NumSlots(numGrains) : 0);
 
-    for (uint32_t i = 0; i < mNumThreads; i++)
-        mThreads[i]->mDecryptLength = 0;
+    job.request = nullptr;
+    job.latch.Add(1);
+    if (renderer != nullptr)
+    {
+        TMumSlot slot;
+        TMumTicket ticket = { &job, 0 };
+        Spread(job, &slot, 1, numGrains);
+        renderer->RunTicket(ticket);
+        ReturnInline(renderer);
+    }
+    else
+        Submit(job, slots.data(), numGrains);
+    job.latch.Wait(0);
+}
 
-    *outlength = 0;
-    uint32_t blocksPerJob = MUM_MAX_BYTES_PER_JOB / mMumInfo->encryptedBlockSize;
-    while (length > 0)
+// An empty request completes right away, on the caller's thread
+void CMumblepadMt::Launch(CMumRequest *request, uint32_t numGrains)
+{
+    if (numGrains == 0)
     {
-        TMumJob job;
-
-        // Prepare a job
-        //
-        if (length >= mMumInfo->encryptedBlockSize * blocksPerJob)
-            encryptedSize = mMumInfo->encryptedBlockSize * blocksPerJob;
-        else
-            encryptedSize = length;
-        plaintextSize = encryptedSize * mMumInfo->plaintextBlockSize / mMumInfo->encryptedBlockSize;
-
-        length -= encryptedSize;
-        job.state = MUM_JOB_STATE_NONE;
-        job.type = MUM_JOB_TYPE_DECRYPT;
-        job.src = src;
-        job.dst = dst;
-        job.length = encryptedSize;
-        job.seqNum = 0;
-
-        // Update pointers;
-        src += encryptedSize;
-        dst += plaintextSize;
-
-        // Hand off the job
-        bool assigned = false;
-        while (!assigned)
-        {
-            for (uint32_t i = 0; i < mNumThreads; i++)
-            {
-                if (mThreads[i]->mJob.state == MUM_JOB_STATE_DONE)
-                {
-                    mThreads[i]->mJob = job;
-                    mThreads[i]->mJob.state = MUM_JOB_STATE_ASSIGNED;
-                    SetEvent(mThreads[i]->mWorkerSignal);
-                    assigned = true;
-                    break;
-                }
-            }
-            if (!assigned)
-            {
-                WaitForSingleObject(mServerSignal, 100);
-                ResetEvent(mServerSignal);
-            }
-            else
-                break;
-        }
+        request->Complete();
+        return;
     }
+    request->mSlots = new TMumSlot[NumSlots(numGrains)];
+    Submit(request->mJob, request->mSlots, numGrains);
+}
 
-    while (true)
+// Fills in an Encrypt job and returns its number of grains. In place, with
+// padding, each grain's plaintext is first moved to where its encrypted
+// blocks go, last grain first. Every grain is then encrypted in place
+// within its own part of the buffer, so they can run in any order.
+uint32_t CMumblepadMt::PrepareEncrypt(TMumJob &job, uint8_t *src, uint8_t *dst, uint32_t length, uint16_t seqNum)
+{
+    uint32_t numBlocks = (length + mMumInfo->plaintextBlockSize - 1) / mMumInfo->plaintextBlockSize;
+    job.type = MUM_JOB_TYPE_ENCRYPT;
+    job.src = src;
+    job.dst = dst;
+    job.length = length;
+    job.seqNum = seqNum;
+    job.inPlace = (src == dst && mMumInfo->paddingOn);
+    job.largeBuffer = IsLargeBuffer(length);
+    job.grainBlocks = GrainBlocks(numBlocks, mMumInfo->plaintextBlockSize);
+    uint32_t numGrains = (numBlocks + job.grainBlocks - 1) / job.grainBlocks;
+
+    if (job.inPlace)
     {
-        bool working = false;
-        for (uint32_t i = 0; i < mNumThreads; i++)
+        uint32_t plaintextGrainSize = job.grainBlocks * mMumInfo->plaintextBlockSize;
+        uint32_t encryptedGrainSize = job.grainBlocks * mMumInfo->encryptedBlockSize;
+        for (uint32_t g = numGrains; g-- > 1; )
         {
-            if (mThreads[i]->mJob.state != MUM_JOB_STATE_DONE)
-                working = true;
+            uint32_t plaintextSize = (g == numGrains - 1) ? length - g * plaintextGrainSize : plaintextGrainSize;
+            memmove(dst + g * encryptedGrainSize, src + g * plaintextGrainSize, plaintextSize);
         }
-        if (!working)
-            break;
     }
-    for (uint32_t i = 0; i < mNumThreads; i++)
-        *outlength += mThreads[i]->mDecryptLength;
+    return numGrains;
+}
+
+// Fills in a Decrypt job and returns its number of grains. In place, with
+// padding, every grain decrypts within its own encrypted blocks, see
+// CMumblepadThread::CompleteJob.
+uint32_t CMumblepadMt::PrepareDecrypt(TMumJob &job, uint8_t *src, uint8_t *dst, uint32_t length)
+{
+    uint32_t numBlocks = (length + mMumInfo->encryptedBlockSize - 1) / mMumInfo->encryptedBlockSize;
+    job.type = MUM_JOB_TYPE_DECRYPT;
+    job.src = src;
+    job.dst = dst;
+    job.length = length;
+    job.seqNum = 0;
+    job.inPlace = (src == dst && mMumInfo->paddingOn);
+    job.largeBuffer = IsLargeBuffer(length);
+    job.grainBlocks = GrainBlocks(numBlocks, mMumInfo->encryptedBlockSize);
+    return (numBlocks + job.grainBlocks - 1) / job.grainBlocks;
+}
+
+EMumError CMumblepadMt::Encrypt(uint8_t *src, uint8_t *dst, uint32_t length, uint32_t *outlength, uint16_t seqNum)
+{
+    return EncryptWithPriority(src, dst, length, outlength, seqNum, mPriority);
+}
+
+EMumError CMumblepadMt::Decrypt(uint8_t *src, uint8_t *dst, uint32_t length, uint32_t *outlength)
+{
+    return DecryptWithPriority(src, dst, length, outlength, mPriority);
+}
+
+EMumError CMumblepadMt::EncryptWithPriority(uint8_t *src, uint8_t *dst, uint32_t length, uint32_t *outlength, uint16_t seqNum,
+    EMumPriority priority)
+{
+    TMumJob job;
+
+    *outlength = 0;
+    if (mNumThreads == 0)
+        return MUM_ERROR_MTRENDERER_NO_THREADS;
+
+    uint32_t numGrains = PrepareEncrypt(job, src, dst, length, seqNum);
+    if (numGrains == 0)
+        return MUM_ERROR_OK;
+    job.priority = priority;
+    Dispatch(job, numGrains);
+
+    *outlength = job.outlength;
+    return job.error;
+}
+
+EMumError CMumblepadMt::DecryptWithPriority(uint8_t *src, uint8_t *dst, uint32_t length, uint32_t *outlength,
+    EMumPriority priority)
+{
+    TMumJob job;
+
+    *outlength = 0;
+    if (mNumThreads == 0)
+        return MUM_ERROR_MTRENDERER_NO_THREADS;
+
+    uint32_t numGrains = PrepareDecrypt(job, src, dst, length);
+    if (numGrains == 0)
+        return MUM_ERROR_OK;
+    job.priority = priority;
+    Dispatch(job, numGrains);
+
+    *outlength = job.outlength;
+    return job.error;
+}
+
+// *request is set before the work is queued; a detached request may be
+// complete and freed before Launch returns.
+EMumError CMumblepadMt::EncryptAsync(uint8_t *src, uint8_t *dst, uint32_t length, uint16_t seqNum, EMumPriority priority,
+    MumCompletionCallback callback, void *userData, void **request)
+{
+    if (mNumThreads == 0)
+        return MUM_ERROR_MTRENDERER_NO_THREADS;
+
+    CMumRequest *mumRequest = new CMumRequest(callback, userData, request == nullptr, &mRequests);
+    if (request != nullptr)
+        *request = mumRequest;
+    mumRequest->mJob.priority = priority;
+    Launch(mumRequest, PrepareEncrypt(mumRequest->mJob, src, dst, length, seqNum));
+    return MUM_ERROR_OK;
+}
+
+EMumError CMumblepadMt::DecryptAsync(uint8_t *src, uint8_t *dst, uint32_t length, EMumPriority priority,
+    MumCompletionCallback callback, void *userData, void **request)
+{
+    if (mNumThreads == 0)
+        return MUM_ERROR_MTRENDERER_NO_THREADS;
+
+    CMumRequest *mumRequest = new CMumRequest(callback, userData, request == nullptr, &mRequests);
+    if (request != nullptr)
+        *request = mumRequest;
+    mumRequest->mJob.priority = priority;
+    Launch(mumRequest, PrepareDecrypt(mumRequest->mJob, src, dst, length));
     return MUM_ERROR_OK;
 }
 
@@ -31,24 +31,55 @@
 #ifndef __MUMBLEPADMT_H
 #define __MUMBLEPADMT_H
 
+#include <vector>
+#include <functional>
+#include <mutex>
 #include "mumblepadthread.h"
+#include "mumkeycontext.h"
+#include "mumtopology.h"
+#include "mumworkerpool.h"
 
-#define MUM_MAX_THREADS 16
-#define MUM_MAX_BYTES_PER_JOB (16*MUM_MAX_BLOCK_SIZE)
+// one PRNG stream each, see CMumblepadThread::NewPrng; no pool has more
+// workers, nor is a call spread over more
+#define MUM_MAX_THREADS (MUM_PRNG_NUM_AREAS * MUM_PRNG_NUM_STREAMS - 1)
+// upper bound of a grain, the unit of work the workers take and steal
+#define MUM_MAX_BYTES_PER_JOB (16*MUM_BLOCK_SIZE_R32)
+// grains per worker a request is split into, if it is large enough
+#define MUM_GRAINS_PER_WORKER 8
+
+
+// A NUMA node's copy of the engine's TMumInfo and key context, read by the
+// workers placed on the node. It is made and refilled on cpu, one of the
+// node's CPUs, so its pages are the node's own.
+typedef struct TMumNode
+{
+    uint32_t cpu;
+    TMumInfo *mumInfo;
+    CMumKeyContext *keyContext;
+} TMumNode;
 
 
 class CMumblepadMt : public CMumRenderer {
 public:
-    CMumblepadMt(TMumInfo *mumInfo, uint32_t numThreads);
+    CMumblepadMt(TMumInfo *mumInfo, uint32_t numThreads, EMumPlacementType placement);
     ~CMumblepadMt();
 
-    void Start();
-    void Stop();
-
     virtual EMumError EncryptBlock(uint8_t *src, uint8_t *dst, uint32_t length, uint32_t seqnum);
     virtual EMumError DecryptBlock(uint8_t *src, uint8_t *dst, uint32_t *length, uint32_t *seqnum);
     virtual EMumError Encrypt(uint8_t *src, uint8_t *dst, uint32_t length, uint32_t *outlength, uint16_t seqNum);
     virtual EMumError Decrypt(uint8_t *src, uint8_t *dst, uint32_t length, uint32_t *outlength);
+    virtual EMumError EncryptWithPriority(uint8_t *src, uint8_t *dst, uint32_t length, uint32_t *outlength, uint16_t seqNum,
+        EMumPriority priority);
+    virtual EMumError DecryptWithPriority(uint8_t *src, uint8_t *dst, uint32_t length, uint32_t *outlength,
+        EMumPriority priority);
+    virtual EMumError EncryptAsync(uint8_t *src, uint8_t *dst, uint32_t length, uint16_t seqNum, EMumPriority priority,
+        MumCompletionCallback callback, void *userData, void **request);
+    virtual EMumError DecryptAsync(uint8_t *src, uint8_t *dst, uint32_t length, EMumPriority priority,
+        MumCompletionCallback callback, void *userData, void **request);
+    // the calls above may run concurrently, and keep no count of blocks
+    virtual void ResetEncryption() {}
+    virtual void ResetDecryption() {}
+    virtual void Recycle();
 
     virtual void EncryptDiffuse(uint32_t round);
     virtual void EncryptConfuse(uint32_t round);
@@ -58,12 +89,54 @@ public:
     virtual void EncryptDownload(uint8_t *data);
     virtual void DecryptUpload(uint8_t *data);
     virtual void DecryptDownload(uint8_t *data);
-    virtual void InitKey() { return;  }
+    virtual void InitKey();
+    virtual void SettingsChanged();
+    virtual uint32_t NumNodes();
+    virtual EMumError GetNodeStats(uint32_t node, uint32_t *numWorkers, uint64_t *bytes, uint64_t *microseconds);
+    virtual EMumError GetPriority(EMumPriority *priority);
+    virtual EMumError SetPriority(EMumPriority priority);
+    virtual EMumError GetInlineBlocks(uint32_t *inlineBlocks);
+    virtual EMumError SetInlineBlocks(uint32_t inlineBlocks);
+    // the pool worker's state for this engine; only called by that worker
+    CMumblepadThread *Worker(uint32_t worker);
 private:
+    TMumInfo *NodeInfo(const TMumCpu &place);
+    uint32_t GrainBlocks(uint32_t numBlocks, uint32_t blockSize);
+    uint32_t NumSlots(uint32_t numGrains);
+    uint32_t NumBlocks(const TMumJob &job);
+    uint32_t PrepareEncrypt(TMumJob &job, uint8_t *src, uint8_t *dst, uint32_t length, uint16_t seqNum);
+    uint32_t PrepareDecrypt(TMumJob &job, uint8_t *src, uint8_t *dst, uint32_t length);
+    void Spread(TMumJob &job, TMumSlot *slots, uint32_t numSlots, uint32_t numGrains);
+    void Submit(TMumJob &job, TMumSlot *slots, uint32_t numGrains);
+    CMumblepadThread *BorrowInline();
+    void ReturnInline(CMumblepadThread *renderer);
+    void Dispatch(TMumJob &job, uint32_t numGrains);
+    void Launch(CMumRequest *request, uint32_t numGrains);
+    // the most pool workers a call is spread over
     uint32_t mNumThreads;
-    CMumblepadThread *mThreads[MUM_MAX_THREADS];
-    HANDLE mServerSignal;
-    bool mStarted;
+    // shared with the other engines of the same placement
+    CMumWorkerPool *mPool;
+    // by pool worker, nullptr until the worker's first ticket of the engine;
+    // worker w draws on PRNG stream w + 1
+    std::atomic<CMumblepadThread *> *mWorkers;
+    uint32_t mNumWorkers;
+    // by node index, empty without a placement; a node's copy is made with
+    // the first worker state on it
+    std::vector<TMumNode> mNodes;
+    // held while worker states and node copies are made or refilled
+    std::mutex mWorkersMutex;
+    // asynchronous requests not yet complete, see CMumRequest
+    CMumLatch mRequests;
+    // of the calls made from now on without a priority of their own
+    std::atomic<EMumPriority> mPriority;
+    // calls of at most this many blocks run on the caller's thread
+    std::atomic<uint32_t> mInlineBlocks;
+    // renderers for those, on the engine's own tables, made as concurrent
+    // callers first need them; their streams follow the pool workers', and
+    // those not lent out are in mInlineFree
+    std::vector<CMumblepadThread *> mInline;
+    std::vector<CMumblepadThread *> mInlineFree;
+    std::mutex mInlineMutex;
 
 };
 
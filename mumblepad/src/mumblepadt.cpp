@@ -0,0 +1,76 @@
+//////////////////////////////////////////////////////////////////////////
+//                                                                      //
+//   Mumblepad Block Cipher                                             //
+//   Version 1, completed March 14, 2017                                //
+//                                                                      //
+//   Key size 4096 bytes, 32768 bits                                    //
+//   Six different block sizes: 128, 256, 512, 1024, 2048, 4096 bytes   //
+//   Encryption and decryption, runs on either CPU and GPU              //
+//   May run multi-threaded on CPU.                                     //
+//   Runs on GPU with OpenGL or OpenGL ES 2.0                           //
+//                                                                      //
+//   Encrypted blocks containing same plaintext are different, due to   //
+//   small amount of per-block random number padding.                   //
+//   Encrypted block contains length, 16-bit sequence number, 32-bit    //
+//   checksum.                                                          //
+//   No block cipher mode required                                      //
+//   Can use parallel processing, multi-threaded encrypt/decrypt        //
+//                                                                      //
+//   8 rounds, 2 passes per round                                       //
+//   Encrypt: diffusion pass followed by confusion pass.                //
+//   Decrypt: inverse confusion followed by inverse diffusion.          //
+//                                                                      //
+//   Free for non-commercial use, analysis/evaluation.                  //
+//                                                                      //
+//   Copyright 2017, Kyle Granger                                       //
+//   Email contact:  kyle.granger@chello.at                             //
+//                                                                      //
+//////////////////////////////////////////////////////////////////////////
+
+
+
+#include <assert.h>
+#include "mumblepadt.h"
+
+
+template <EMumBlockType blockType>
+CMumblepadT<blockType>::CMumblepadT(TMumInfo *mumInfo) : CMumblepad(mumInfo)
+{
+    assert(mumInfo->blockType == blockType);
+    assert(mumInfo->encryptedBlockSize == TMumBlockGeometry<blockType>::blockSize);
+}
+
+template <EMumBlockType blockType>
+void CMumblepadT<blockType>::EncryptTileRounds(uint8_t *src, uint8_t *blocks, uint8_t *scratch, uint32_t numBlocks)
+{
+    EncryptTileRoundsT(TMumBlockGeometry<blockType>(), src, blocks, scratch, numBlocks);
+}
+
+template <EMumBlockType blockType>
+void CMumblepadT<blockType>::DecryptTileRounds(uint8_t *src, uint8_t *blocks, uint8_t *scratch, uint32_t numBlocks)
+{
+    DecryptTileRoundsT(TMumBlockGeometry<blockType>(), src, blocks, scratch, numBlocks);
+}
+
+
+CMumRenderer *MumCreateSpecializedRenderer(TMumInfo *mumInfo)
+{
+    switch (mumInfo->blockType)
+    {
+    case MUM_BLOCKTYPE_128:
+        return new CMumblepadT<MUM_BLOCKTYPE_128>(mumInfo);
+    case MUM_BLOCKTYPE_256:
+        return new CMumblepadT<MUM_BLOCKTYPE_256>(mumInfo);
+    case MUM_BLOCKTYPE_512:
+        return new CMumblepadT<MUM_BLOCKTYPE_512>(mumInfo);
+    case MUM_BLOCKTYPE_1024:
+        return new CMumblepadT<MUM_BLOCKTYPE_1024>(mumInfo);
+    case MUM_BLOCKTYPE_2048:
+        return new CMumblepadT<MUM_BLOCKTYPE_2048>(mumInfo);
+    case MUM_BLOCKTYPE_4096:
+        return new CMumblepadT<MUM_BLOCKTYPE_4096>(mumInfo);
+    case MUM_BLOCKTYPE_8192:
+        return new CMumblepadT<MUM_BLOCKTYPE_8192>(mumInfo);
+    }
+    return new CMumblepad(mumInfo);
+}
@@ -0,0 +1,56 @@
+//////////////////////////////////////////////////////////////////////////
+//                                                                      //
+//   Mumblepad Block Cipher                                             //
+//   Version 1, completed March 14, 2017                                //
+//                                                                      //
+//   Key size 4096 bytes, 32768 bits                                    //
+//   Six different block sizes: 128, 256, 512, 1024, 2048, 4096 bytes   //
+//   Encryption and decryption, runs on either CPU and GPU              //
+//   May run multi-threaded on CPU.                                     //
+//   Runs on GPU with OpenGL or OpenGL ES 2.0                           //
+//                                                                      //
+//   Encrypted blocks containing same plaintext are different, due to   //
+//   small amount of per-block random number padding.                   //
+//   Encrypted block contains length, 16-bit sequence number, 32-bit    //
+//   checksum.                                                          //
+//   No block cipher mode required                                      //
+//   Can use parallel processing, multi-threaded encrypt/decrypt        //
+//                                                                      //
+//   8 rounds, 2 passes per round                                       //
+//   Encrypt: diffusion pass followed by confusion pass.                //
+//   Decrypt: inverse confusion followed by inverse diffusion.          //
+//                                                                      //
+//   Free for non-commercial use, analysis/evaluation.                  //
+//                                                                      //
+//   Copyright 2017, Kyle Granger                                       //
+//   Email contact:  kyle.granger@chello.at                             //
+//                                                                      //
+//////////////////////////////////////////////////////////////////////////
+
+
+
+#ifndef __MUMBLEPADT_H
+#define __MUMBLEPADT_H
+
+#include "mumblepad.h"
+
+// CPU renderer specialized for one block type. CMumblepad's tile driver
+// runs the rounds through these overrides, which use the scalar passes
+// instantiated with the block type's rows and block size as constants.
+// CMumblepad stays the generic version (MUM_ENGINE_TYPE_CPU_GENERIC);
+// both produce the same bytes.
+template <EMumBlockType blockType>
+class CMumblepadT : public CMumblepad {
+public:
+    CMumblepadT(TMumInfo *mumInfo);
+
+protected:
+    virtual void EncryptTileRounds(uint8_t *src, uint8_t *blocks, uint8_t *scratch, uint32_t numBlocks);
+    virtual void DecryptTileRounds(uint8_t *src, uint8_t *blocks, uint8_t *scratch, uint32_t numBlocks);
+};
+
+
+// Instantiates the CMumblepadT matching mumInfo->blockType.
+extern CMumRenderer *MumCreateSpecializedRenderer(TMumInfo *mumInfo);
+
+#endif
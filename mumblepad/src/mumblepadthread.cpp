@@ -28,42 +28,32 @@
 //////////////////////////////////////////////////////////////////////////
 
 
-#include <windows.h>
 #include "mumblepadthread.h"
+#include "mumblepadmt.h"
+#include "mumplatform.h"
+#include "mumrequest.h"
+#include <chrono>
 #include "malloc.h"
 #include "string.h"
 #include "assert.h"
 #include "stdio.h"
 
-DWORD WINAPI MumRun(LPVOID param)
-{
-    CMumblepadThread *mumblepadThread = (CMumblepadThread*)param;
-    mumblepadThread->Run();
-    return 0;
-}
 
-CMumblepadThread::CMumblepadThread(TMumInfo *mumInfo, uint32_t id, HANDLE serverSignal) : CMumRenderer(mumInfo)
+CMumblepadThread::CMumblepadThread(TMumInfo *mumInfo, uint32_t id, uint32_t node, CMumWorkerPool *pool) : CMumblepad(mumInfo)
 {
     mMumInfo = mumInfo;
     mId = id;
-    mJob.state = MUM_JOB_STATE_DONE;
-    mEncryptLength = 0;
-    mDecryptLength = 0;
-    // each of 16 threads gets their own set of 16 subkeys (64KB in total) for the PRNG
-    mPrng = new CMumPrng(mMumInfo->subkeys[MUM_PRNG_SUBKEY_INDEX + (mId & 15) * 16]);
-
-    char signalname[32];
-    sprintf_s(signalname, "mWorkerThreadSignal-%d", id);
-    mWorkerSignal = CreateEvent(NULL, FALSE, FALSE, signalname);
-    mServerSignal = serverSignal;
-    mThreadHandle = CreateThread(NULL, 0, MumRun, this, CREATE_SUSPENDED, &mThreadID);
+    mNode = node;
+    mPool = pool;
+    mJob = nullptr;
+    mBytesDone = 0;
+    mBusyMicroseconds = 0;
+    mPrng = NewPrng();
 }
 
 
 CMumblepadThread::~CMumblepadThread()
 {
-    CloseHandle(mThreadHandle);
-    CloseHandle(mWorkerSignal);
     if (mPrng != nullptr)
     {
         delete mPrng;
@@ -71,17 +61,7 @@ CMumblepadThread::~CMumblepadThread()
     }
 }
 
-void CMumblepadThread::Start()
-{
-    ResumeThread(mThreadHandle);
-}
-
-void CMumblepadThread::Stop()
-{
-    mRunning = false;
-    SetEvent(mWorkerSignal);
-}
-
+// the subkeys only hold the key from here on, so the PRNG is seeded again
 void CMumblepadThread::InitKey()
 {
     if (mPrng != nullptr)
@@ -89,204 +69,167 @@ void CMumblepadThread::InitKey()
         delete mPrng;
         mPrng = nullptr;
     }
+    mPrng = NewPrng();
 }
 
 
-void CMumblepadThread::EncryptUpload(uint8_t *data)
+// Worker n draws its padding from PRNG subkey area n % MUM_PRNG_NUM_AREAS,
+// 16 subkeys (64KB) each, and from stream n / MUM_PRNG_NUM_AREAS within
+// it, so no two of up to MUM_MAX_THREADS workers share a stream. Workers
+// 1 to 15 keep the streams of the 16-thread engine.
+CMumPrng *CMumblepadThread::NewPrng()
 {
-    memcpy(mPingPongBlock[0], data, mMumInfo->encryptedBlockSize);
+    uint32_t area = mId % MUM_PRNG_NUM_AREAS;
+    uint32_t stream = mId / MUM_PRNG_NUM_AREAS;
+    return new CMumPrng(mMumInfo->subkeys[MUM_PRNG_SUBKEY_INDEX + area * (MUM_PRNG_SUBKEY_SIZE / MUM_KEY_SIZE)], stream);
 }
 
-void CMumblepadThread::DecryptUpload(uint8_t *data)
+// Grain g starts at block g * grainBlocks; only the last grain of the
+// request may be shorter.
+void CMumblepadThread::RunGrain(uint32_t grain)
 {
-    EncryptUpload(data);
-}
-
+    uint32_t outlength = 0;
+    uint32_t block = grain * mJob->grainBlocks;
+    uint32_t plaintextOffset = block * mMumInfo->plaintextBlockSize;
+    uint32_t encryptedOffset = block * mMumInfo->encryptedBlockSize;
 
-
-void CMumblepadThread::EncryptDiffuse(uint32_t round)
-{
-    uint32_t x, y, srcPosX1, srcPosY1, srcPosX2, srcPosY2, srcPosX3, srcPosY3, srcPosX4, srcPosY4;
-    uint32_t maskA, maskB, maskC, maskD;
-    uint8_t *mappedSrc1, *mappedSrc2, *mappedSrc3, *mappedSrc4;
-    uint8_t *src;
-    uint8_t *dst;
-    uint32_t numRows = mMumInfo->numRows;
-
-    // first pass for encrypt
-    // source = 0, destination = 1
-    src = mPingPongBlock[0];
-    dst = mPingPongBlock[1];
-
-    maskA = mMumInfo->bitmasks[round][0];
-    maskB = mMumInfo->bitmasks[round][1];
-    maskC = mMumInfo->bitmasks[round][2];
-    maskD = mMumInfo->bitmasks[round][3];
-    for ( y = 0; y < numRows; y++ )
+    switch (mJob->type)
     {
-        for ( x = 0; x < MUM_CELLS_X; x++ )
-        {
-            srcPosX1 = mMumInfo->positionTables5bitX[round][y][x][0];
-            srcPosY1 = mMumInfo->positionTables5bitY[round][y][x][0];
-            mappedSrc1 = src + srcPosX1 * MUM_CELL_SIZE + srcPosY1 * MUM_CELLS_X * MUM_CELL_SIZE;
-            srcPosX2 = mMumInfo->positionTables5bitX[round][y][x][1];
-            srcPosY2 = mMumInfo->positionTables5bitY[round][y][x][1];
-            mappedSrc2 = src + srcPosX2 * MUM_CELL_SIZE + srcPosY2 * MUM_CELLS_X * MUM_CELL_SIZE;
-            srcPosX3 = mMumInfo->positionTables5bitX[round][y][x][2];
-            srcPosY3 = mMumInfo->positionTables5bitY[round][y][x][2];
-            mappedSrc3 = src + srcPosX3 * MUM_CELL_SIZE + srcPosY3 * MUM_CELLS_X * MUM_CELL_SIZE;
-            srcPosX4 = mMumInfo->positionTables5bitX[round][y][x][3];
-            srcPosY4 = mMumInfo->positionTables5bitY[round][y][x][3];
-            mappedSrc4 = src + srcPosX4 * MUM_CELL_SIZE + srcPosY4 * MUM_CELLS_X * MUM_CELL_SIZE;
-            dst[0] = (mappedSrc1[0] & maskA) + (mappedSrc2[2] & maskB) + (mappedSrc3[3] & maskC) + (mappedSrc4[1] & maskD);
-            dst[1] = (mappedSrc1[2] & maskA) + (mappedSrc2[3] & maskB) + (mappedSrc3[1] & maskC) + (mappedSrc4[0] & maskD);
-            dst[2] = (mappedSrc1[3] & maskA) + (mappedSrc2[1] & maskB) + (mappedSrc3[0] & maskC) + (mappedSrc4[2] & maskD);
-            dst[3] = (mappedSrc1[1] & maskA) + (mappedSrc2[0] & maskB) + (mappedSrc3[2] & maskC) + (mappedSrc4[3] & maskD);
-            dst += 4;
-        }
+    case MUM_JOB_TYPE_ENCRYPT:
+    {
+        uint32_t length = mJob->grainBlocks * mMumInfo->plaintextBlockSize;
+        if (length > mJob->length - plaintextOffset)
+            length = mJob->length - plaintextOffset;
+        uint8_t *src = mJob->src + (mJob->inPlace ? encryptedOffset : plaintextOffset);
+        RecordError(Encrypt(src, mJob->dst + encryptedOffset, length, &outlength, (uint16_t)(mJob->seqNum + block)));
+        mJob->outlength += outlength;
+        mBytesDone += length;
+        break;
     }
-}
-
-
-void CMumblepadThread::EncryptConfuse(uint32_t round)
-{
-    uint32_t x, y;
-    uint8_t *clav;
-    uint8_t *src;
-    uint8_t *dst;
-    uint32_t *prm;
-    uint32_t numRows = mMumInfo->numRows;
-
-    // second pass for encrypt
-    // source = 1, destination = 0
-    src = mPingPongBlock[1];
-    dst = mPingPongBlock[0];
-    clav = mMumInfo->subkeys[round];
-
-    for ( y = 0; y < numRows; y++ )
+    case MUM_JOB_TYPE_DECRYPT:
     {
-        prm = mMumInfo->permuteTables8bit[round][y];
-        for ( x = 0; x < MUM_CELLS_X; x++ )
-        {
-            *dst++ = (uint8_t)prm[ (uint8_t)(*src++ ^ *clav++) ];
-            *dst++ = (uint8_t)prm[ (uint8_t)(*src++ ^ *clav++) ];
-            *dst++ = (uint8_t)prm[ (uint8_t)(*src++ ^ *clav++) ];
-            *dst++ = (uint8_t)prm[ (uint8_t)(*src++ ^ *clav++) ];
-        }
+        uint32_t length = mJob->grainBlocks * mMumInfo->encryptedBlockSize;
+        if (length > mJob->length - encryptedOffset)
+            length = mJob->length - encryptedOffset;
+        uint8_t *dst = mJob->dst + (mJob->inPlace ? encryptedOffset : plaintextOffset);
+        RecordError(Decrypt(mJob->src + encryptedOffset, dst, length, &outlength));
+        mJob->outlength += outlength;
+        mBytesDone += length;
+        break;
+    }
+    case MUM_JOB_TYPE_ENCRYPT_BLOCK:
+        RecordError(EncryptBlock(mJob->src, mJob->dst, mJob->length, mJob->seqNum));
+        mBytesDone += mJob->length;
+        break;
+    case MUM_JOB_TYPE_DECRYPT_BLOCK:
+        RecordError(DecryptBlock(mJob->src, mJob->dst, &outlength, &mJob->seqNum));
+        mJob->outlength = outlength;
+        mBytesDone += mMumInfo->encryptedBlockSize;
+        break;
+    default:
+        printf_s("mWorkerThreadSignal-%d got bad type %d\n", mId, mJob->type);
     }
 }
 
-
-void CMumblepadThread::DecryptConfuse(uint32_t round)
+// Grains run on several workers at once; the job reports the first error
+// any of them had, the later ones are dropped.
+void CMumblepadThread::RecordError(EMumError error)
 {
-    uint32_t x, y;
-    uint8_t *src, *dst, *clav;
-    uint32_t *prm;
-    uint32_t numRows = mMumInfo->numRows;
-
-    // first pass for decrypt
-    // source = 0, destination = 1
-    src = mPingPongBlock[0];
-    dst = mPingPongBlock[1];
+    EMumError expected = MUM_ERROR_OK;
+    if (error != MUM_ERROR_OK)
+        mJob->error.compare_exchange_strong(expected, error);
+}
 
-    clav = mMumInfo->subkeys[round];
-    for ( y = 0; y < numRows; y++ )
+// Tries the job's other slots in turn, starting after this one, so thieves
+// spread over the victims; those worked on from the same NUMA node first,
+// whose buffers are more likely in the node's caches.
+bool CMumblepadThread::Steal(uint32_t slot)
+{
+    for (int pass = 0; pass < 2; pass++)
     {
-        prm = mMumInfo->permuteTables8bitI[round][y];
-        for ( x = 0; x < MUM_CELLS_X; x++ )
+        bool sameNode = (pass == 0);
+        for (uint32_t i = 1; i < mJob->numSlots; i++)
         {
-            *dst++ = (uint8_t)prm[*src++] ^ *clav++;
-            *dst++ = (uint8_t)prm[*src++] ^ *clav++;
-            *dst++ = (uint8_t)prm[*src++] ^ *clav++;
-            *dst++ = (uint8_t)prm[*src++] ^ *clav++;
+            TMumSlot *victim = &mJob->slots[(slot + i) % mJob->numSlots];
+            if ((victim->node == mNode) == sameNode && victim->range.StealHalf(&mJob->slots[slot].range))
+                return true;
         }
     }
+    return false;
 }
 
-void CMumblepadThread::DecryptDiffuse(uint32_t round)
+// In place, with padding, every grain has decrypted within its own
+// encrypted blocks; the plaintext of the grains is moved together here.
+// After an error the grains' output lengths do not add up to a layout, so
+// the buffer is left as it is.
+void CMumblepadThread::CompleteJob(TMumJob *job)
 {
-    uint32_t x, y, srcPosX1, srcPosY1, srcPosX2, srcPosY2, srcPosX3, srcPosY3, srcPosX4, srcPosY4;
-    uint32_t maskA, maskB, maskC, maskD;
-    uint8_t *src;
-    uint8_t *dst;
-    uint8_t *mappedSrc1;
-    uint8_t *mappedSrc2;
-    uint8_t *mappedSrc3;
-    uint8_t *mappedSrc4;
-    uint32_t numRows = mMumInfo->numRows;
-
-    // second pass for decrypt
-    // source = 1, destination = 0
-    src = mPingPongBlock[1];
-    dst = mPingPongBlock[0];
-
-    maskA = mMumInfo->bitmasks[round][0];
-    maskB = mMumInfo->bitmasks[round][1];
-    maskC = mMumInfo->bitmasks[round][2];
-    maskD = mMumInfo->bitmasks[round][3];
-    for ( y = 0; y < numRows; y++ )
+    if (job->type == MUM_JOB_TYPE_DECRYPT && job->inPlace && job->error == MUM_ERROR_OK)
     {
-        for ( x = 0; x < MUM_CELLS_X; x++ )
+        uint32_t outlength = job->outlength;
+        uint32_t plaintextGrainSize = job->grainBlocks * mMumInfo->plaintextBlockSize;
+        uint32_t encryptedGrainSize = job->grainBlocks * mMumInfo->encryptedBlockSize;
+        for (uint32_t g = 1; g * plaintextGrainSize < outlength; g++)
         {
-            srcPosX1 = mMumInfo->positionTables5bitXI[round][y][x][0];
-            srcPosY1 = mMumInfo->positionTables5bitYI[round][y][x][0];
-            mappedSrc1 = src + srcPosX1 * MUM_CELL_SIZE + srcPosY1 * MUM_CELLS_X* MUM_CELL_SIZE;
-            srcPosX2 = mMumInfo->positionTables5bitXI[round][y][x][1];
-            srcPosY2 = mMumInfo->positionTables5bitYI[round][y][x][1];
-            mappedSrc2 = src + srcPosX2 * MUM_CELL_SIZE + srcPosY2 * MUM_CELLS_X* MUM_CELL_SIZE;
-            srcPosX3 = mMumInfo->positionTables5bitXI[round][y][x][2];
-            srcPosY3 = mMumInfo->positionTables5bitYI[round][y][x][2];
-            mappedSrc3 = src + srcPosX3 * MUM_CELL_SIZE + srcPosY3 * MUM_CELLS_X* MUM_CELL_SIZE;
-            srcPosX4 = mMumInfo->positionTables5bitXI[round][y][x][3];
-            srcPosY4 = mMumInfo->positionTables5bitYI[round][y][x][3];
-            mappedSrc4 = src + srcPosX4 * MUM_CELL_SIZE + srcPosY4 * MUM_CELLS_X* MUM_CELL_SIZE;
-            *dst++ = (mappedSrc1[0] & maskA) + (mappedSrc2[3] & maskB) + (mappedSrc3[2] & maskC) + (mappedSrc4[1] & maskD);
-            *dst++ = (mappedSrc1[3] & maskA) + (mappedSrc2[2] & maskB) + (mappedSrc3[1] & maskC) + (mappedSrc4[0] & maskD);
-            *dst++ = (mappedSrc1[1] & maskA) + (mappedSrc2[0] & maskB) + (mappedSrc3[3] & maskC) + (mappedSrc4[2] & maskD);
-            *dst++ = (mappedSrc1[2] & maskA) + (mappedSrc2[1] & maskB) + (mappedSrc3[0] & maskC) + (mappedSrc4[3] & maskD);
+            uint32_t plaintextSize = outlength - g * plaintextGrainSize;
+            if (plaintextSize > plaintextGrainSize)
+                plaintextSize = plaintextGrainSize;
+            memmove(job->dst + g * plaintextGrainSize, job->dst + g * encryptedGrainSize, plaintextSize);
         }
     }
+    if (job->request != nullptr)
+        job->request->Complete();
+    else
+        job->latch.CountDown();
 }
 
-void CMumblepadThread::EncryptDownload(uint8_t *data)
-{
-    memcpy( data, mPingPongBlock[0], mMumInfo->encryptedBlockSize);
-}
-void CMumblepadThread::DecryptDownload(uint8_t *data)
+// Between two grains of a bulk job, the worker runs the interactive
+// tickets that are queued, of any engine, each on its own state for that
+// engine (worker mId - 1). Returns the time spent on them, in microseconds.
+uint64_t CMumblepadThread::Preempt()
 {
-    EncryptDownload(data);
-}
+    TMumTicket ticket;
 
+    if (!mPool->PopInteractive(&ticket))
+        return 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    do
+    {
+        ticket.job->renderer->Worker(mId - 1)->RunTicket(ticket);
+    } while (mPool->PopInteractive(&ticket));
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
 
-void CMumblepadThread::Run()
+// The slot's range may already have been stolen empty when the ticket
+// comes up; the worker then only helps with what is left. Only the worker
+// of the last slot touches the job after its slot is done, and nothing is
+// touched once the job is complete: its engine may be gone by then. An
+// interactive ticket may run within a bulk one on the same state, so the
+// job being run is put back afterwards.
+void CMumblepadThread::RunTicket(const TMumTicket &ticket)
 {
-    mRunning = true;
-    mJob.state = MUM_JOB_STATE_DONE;
-    while (mRunning)
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    TMumJob *job = ticket.job;
+    TMumJob *previous = mJob;
+    TMumSlot *slot = &job->slots[ticket.slot];
+    bool preemptible = (mPool != nullptr && job->priority == MUM_PRIORITY_BULK);
+    uint64_t preempted = 0;
+    uint32_t grain;
+
+    mJob = job;
+    slot->node = mNode;
+    do
     {
-        if (mJob.state != MUM_JOB_STATE_ASSIGNED)
+        while (slot->range.Pop(&grain))
         {
-            WaitForSingleObject(mWorkerSignal, 100);
-            ResetEvent(mWorkerSignal);
-            continue;
+            RunGrain(grain);
+            if (preemptible)
+                preempted += Preempt();
         }
+    } while (Steal(ticket.slot));
+    mJob = previous;
+    mBusyMicroseconds += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count() - preempted;
 
-        mJob.state = MUM_JOB_STATE_WORKING;
-        switch (mJob.type)
-        {
-        case MUM_JOB_TYPE_ENCRYPT:
-            Encrypt(mJob.src, mJob.dst, mJob.length, &mJob.outlength, mJob.seqNum);
-            mEncryptLength += mJob.outlength;
-            break;
-
-        case MUM_JOB_TYPE_DECRYPT:
-            Decrypt(mJob.src, mJob.dst, mJob.length, &mJob.outlength);
-            mDecryptLength += mJob.outlength;
-            break;
-        default:
-            printf_s("mWorkerThreadSignal-%d got bad type %d\n", mId, mJob.type);
-        }
-        mJob.state = MUM_JOB_STATE_DONE;
-        SetEvent(mServerSignal);
-    }
+    if (--job->pending == 0)
+        CompleteJob(job);
 }
@@ -31,59 +31,99 @@
 #ifndef __MUMBLEPADTHREAD_H
 #define __MUMBLEPADTHREAD_H
 
-#include "mumrenderer.h"
+#include <atomic>
+#include "mumblepad.h"
+#include "mumsignal.h"
+#include "mumrange.h"
+#include "mumqueue.h"
 
 
-typedef enum EMumJobState {
-    MUM_JOB_STATE_NONE = -1,
-    MUM_JOB_STATE_DONE = 0,
-    MUM_JOB_STATE_ASSIGNED = 1,
-    MUM_JOB_STATE_WORKING = 2,
-} EMumJobState;
-
 typedef enum EMumJobType {
     MUM_JOB_TYPE_ENCRYPT = 0,
     MUM_JOB_TYPE_DECRYPT = 1,
+    MUM_JOB_TYPE_ENCRYPT_BLOCK = 2,
+    MUM_JOB_TYPE_DECRYPT_BLOCK = 3,
 } EMumJobType;
 
+// One worker's share of a job: the grains it has yet to do, stolen from by
+// the others, and the NUMA node of the worker that took the slot's ticket
+typedef struct TMumSlot
+{
+    CMumRange range;
+    std::atomic<uint32_t> node;
+} TMumSlot;
+
+class CMumRequest;
+class CMumblepadMt;
+class CMumWorkerPool;
+
+// One Encrypt, Decrypt, EncryptBlock or DecryptBlock call, kept on the
+// caller's stack until its latch has counted down, or owned by a
+// CMumRequest if the call is asynchronous. Encrypt and Decrypt are split
+// into grains of grainBlocks blocks, spread evenly over numSlots slots; a
+// worker that takes a slot's ticket does its grains and then steals from
+// the other slots. The block calls are a single slot of a single grain.
 typedef struct TMumJob
 {
-    EMumJobState state;
+    CMumblepadMt *renderer;
     EMumJobType type;
     uint8_t *src;
     uint8_t *dst;
     uint32_t length;
-    uint32_t outlength;
-    uint16_t seqNum;
+    // the first block's; DecryptBlock returns the block's here
+    uint32_t seqNum;
+    // in place with padding, each grain's plaintext sits where its encrypted blocks go
+    bool inPlace;
+    // whether the whole request is a large buffer, see CMumRenderer::IsLargeBuffer
+    bool largeBuffer;
+    // the queue its tickets go to; bulk jobs give way to interactive ones
+    EMumPriority priority;
+    uint32_t grainBlocks;
+    TMumSlot *slots;
+    uint32_t numSlots;
+    // summed over the grains
+    std::atomic<uint32_t> outlength;
+    // the first error of any grain, see CMumblepadThread::RecordError
+    std::atomic<EMumError> error;
+    // slots whose worker has not yet found nothing left to do or steal; the
+    // last one completes the job
+    std::atomic<uint32_t> pending;
+    // counted down once the job is complete
+    CMumLatch latch;
+    // nullptr for a call that waits on the latch itself
+    CMumRequest *request;
 } TMumRenderJob;
 
 
-class CMumblepadThread : public CMumRenderer {
+// A pool worker's state for one MT engine: the CMumblepad passes on its
+// own ping-pong blocks and PRNG, and the engine's tables or its node's
+// copy of them. Only ever used by that worker. The engine's inline
+// renderers are the same without a pool, lent to one caller at a time.
+class CMumblepadThread : public CMumblepad {
 public:
-    CMumblepadThread(TMumInfo *mumInfo, uint32_t id, HANDLE serverSignal);
+    CMumblepadThread(TMumInfo *mumInfo, uint32_t id, uint32_t node, CMumWorkerPool *pool);
     ~CMumblepadThread();
-    virtual void EncryptDiffuse(uint32_t round);
-    virtual void EncryptConfuse(uint32_t round);
-    virtual void DecryptConfuse(uint32_t round);
-    virtual void DecryptDiffuse(uint32_t round);
-    virtual void EncryptUpload(uint8_t *data);
-    virtual void EncryptDownload(uint8_t *data);
-    virtual void DecryptUpload(uint8_t *data);
-    virtual void DecryptDownload(uint8_t *data);
     virtual void InitKey();
-    uint8_t mPingPongBlock[2][MUM_MAX_BLOCK_SIZE];
+    // a grain is a slice of the request, so the request's size decides
+    virtual bool IsLargeBuffer(uint32_t length) { return mJob->largeBuffer; }
     uint32_t mId;
-    TMumJob mJob;
-    HANDLE mThreadHandle;
-    HANDLE mWorkerSignal;
-    HANDLE mServerSignal;
-    uint32_t mThreadID;
-    bool mRunning;
-    uint32_t mEncryptLength;
-    uint32_t mDecryptLength;
-    void Run();
-    void Start();
-    void Stop();
+    // the index of the worker's NUMA node
+    uint32_t mNode;
+    // bytes of grains done and time spent on tickets of the engine
+    std::atomic<uint64_t> mBytesDone;
+    std::atomic<uint64_t> mBusyMicroseconds;
+    void RunTicket(const TMumTicket &ticket);
+private:
+    CMumPrng *NewPrng();
+    void CompleteJob(TMumJob *job);
+    void RunGrain(uint32_t grain);
+    void RecordError(EMumError error);
+    bool Steal(uint32_t slot);
+    uint64_t Preempt();
+    // the pool of the worker, nullptr for an inline renderer
+    CMumWorkerPool *mPool;
+    // the job of the ticket being run
+    TMumJob *mJob;
 };
 
 
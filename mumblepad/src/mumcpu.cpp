@@ -0,0 +1,103 @@
+//////////////////////////////////////////////////////////////////////////
+//                                                                      //
+//   Mumblepad Block Cipher                                             //
+//   Version 1, completed March 14, 2017                                //
+//                                                                      //
+//   Key size 4096 bytes, 32768 bits                                    //
+//   Six different block sizes: 128, 256, 512, 1024, 2048, 4096 bytes   //
+//   Encryption and decryption, runs on either CPU and GPU              //
+//   May run multi-threaded on CPU.                                     //
+//   Runs on GPU with OpenGL or OpenGL ES 2.0                           //
+//                                                                      //
+//   Encrypted blocks containing same plaintext are different, due to   //
+//   small amount of per-block random number padding.                   //
+//   Encrypted block contains length, 16-bit sequence number, 32-bit    //
+//   checksum.                                                          //
+//   No block cipher mode required                                      //
+//   Can use parallel processing, multi-threaded encrypt/decrypt        //
+//                                                                      //
+//   8 rounds, 2 passes per round                                       //
+//   Encrypt: diffusion pass followed by confusion pass.                //
+//   Decrypt: inverse confusion followed by inverse diffusion.          //
+//                                                                      //
+//   Free for non-commercial use, analysis/evaluation.                  //
+//                                                                      //
+//   Copyright 2017, Kyle Granger                                       //
+//   Email contact:  kyle.granger@chello.at                             //
+//                                                                      //
+//////////////////////////////////////////////////////////////////////////
+
+
+#include "mumcpu.h"
+#if defined(MUM_CPU_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(MUM_CPU_X86)
+#include <cpuid.h>
+#endif
+
+#ifdef MUM_CPU_X86
+
+static void MumCpuid(uint32_t leaf, uint32_t subleaf, uint32_t regs[4])
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuidex(info, (int)leaf, (int)subleaf);
+    for (int i = 0; i < 4; i++)
+        regs[i] = (uint32_t)info[i];
+#else
+    unsigned int a, b, c, d;
+    __cpuid_count(leaf, subleaf, a, b, c, d);
+    regs[0] = a;
+    regs[1] = b;
+    regs[2] = c;
+    regs[3] = d;
+#endif
+}
+
+static uint32_t MumXgetbv()
+{
+#if defined(_MSC_VER)
+    return (uint32_t)_xgetbv(0);
+#else
+    uint32_t eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return eax;
+#endif
+}
+
+#endif
+
+uint32_t MumDetectCpuFeatures()
+{
+    uint32_t features = 0;
+#ifdef MUM_CPU_X86
+    uint32_t regs[4];
+
+    MumCpuid(0, 0, regs);
+    uint32_t maxLeaf = regs[0];
+    if (maxLeaf < 1)
+        return features;
+
+    MumCpuid(1, 0, regs);
+    if ((regs[2] & (1 << 9)) && (regs[2] & (1 << 19)))
+        features |= MUM_CPU_FEATURE_SSE41;
+    if (maxLeaf < 7)
+        return features;
+
+    // OSXSAVE and AVX, then make sure the OS saves the YMM state
+    if ((regs[2] & (1 << 27)) == 0 || (regs[2] & (1 << 28)) == 0)
+        return features;
+    uint32_t xcr0 = MumXgetbv();
+    if ((xcr0 & 0x6) != 0x6)
+        return features;
+
+    MumCpuid(7, 0, regs);
+    if (regs[1] & (1 << 5))
+        features |= MUM_CPU_FEATURE_AVX2;
+
+    // AVX512F, AVX512BW and AVX512VBMI, with the opmask and ZMM state enabled
+    if ((regs[1] & (1 << 16)) && (regs[1] & (1 << 30)) && (regs[2] & (1 << 1)) && (xcr0 & 0xe6) == 0xe6)
+        features |= MUM_CPU_FEATURE_AVX512VBMI;
+#endif
+    return features;
+}
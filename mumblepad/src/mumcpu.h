@@ -0,0 +1,65 @@
+//////////////////////////////////////////////////////////////////////////
+//                                                                      //
+//   Mumblepad Block Cipher                                             //
+//   Version 1, completed March 14, 2017                                //
+//                                                                      //
+//   Key size 4096 bytes, 32768 bits                                    //
+//   Six different block sizes: 128, 256, 512, 1024, 2048, 4096 bytes   //
+//   Encryption and decryption, runs on either CPU and GPU              //
+//   May run multi-threaded on CPU.                                     //
+//   Runs on GPU with OpenGL or OpenGL ES 2.0                           //
+//                                                                      //
+//   Encrypted blocks containing same plaintext are different, due to   //
+//   small amount of per-block random number padding.                   //
+//   Encrypted block contains length, 16-bit sequence number, 32-bit    //
+//   checksum.                                                          //
+//   No block cipher mode required                                      //
+//   Can use parallel processing, multi-threaded encrypt/decrypt        //
+//                                                                      //
+//   8 rounds, 2 passes per round                                       //
+//   Encrypt: diffusion pass followed by confusion pass.                //
+//   Decrypt: inverse confusion followed by inverse diffusion.          //
+//                                                                      //
+//   Free for non-commercial use, analysis/evaluation.                  //
+//                                                                      //
+//   Copyright 2017, Kyle Granger                                       //
+//   Email contact:  kyle.granger@chello.at                             //
+//                                                                      //
+//////////////////////////////////////////////////////////////////////////
+
+
+#ifndef MUMCPU_H
+#define MUMCPU_H
+
+#include "mumtypes.h"
+
+// SIMD features the CPU kernels may use, as bits of TMumInfo::cpuFeatures.
+// Same values as EMumCpuFeature in mumpublic.h.
+#define MUM_CPU_FEATURE_AVX2        0x00000001
+// AVX-512 F, BW and VBMI together
+#define MUM_CPU_FEATURE_AVX512VBMI  0x00000002
+// SSSE3 and SSE4.1 together, used by the code CMumJit generates
+#define MUM_CPU_FEATURE_SSE41       0x00000004
+
+// x86 and x64, the only processors with kernels beyond the scalar passes;
+// elsewhere MumDetectCpuFeatures reports no features, so none is called.
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define MUM_CPU_X86
+#endif
+
+// Kernels using instructions above the compiler's baseline are tagged
+// with these, so they can live next to the scalar code and be picked at
+// runtime. MSVC accepts the intrinsics without any tagging.
+#if defined(__GNUC__)
+#define MUM_TARGET_AVX2 __attribute__((target("avx2")))
+#define MUM_TARGET_AVX512VBMI __attribute__((target("avx2,avx512f,avx512bw,avx512vbmi")))
+#else
+#define MUM_TARGET_AVX2
+#define MUM_TARGET_AVX512VBMI
+#endif
+
+// Returns the MUM_CPU_FEATURE_ bits supported by both the processor and
+// the operating system (CPUID plus XGETBV for the AVX register state).
+extern uint32_t MumDetectCpuFeatures();
+
+#endif
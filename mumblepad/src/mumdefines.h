@@ -35,12 +35,19 @@
 #include "mumpublic.h"
 
 #define MUM_NUM_ROUNDS 8
-#define MUM_MAX_BLOCK_SIZE     4096
+#define MUM_MAX_BLOCK_SIZE     8192
 #define MUM_KEY_MASK        4095
 // 8 subkeys, 1 per round for confusion pass, XOR
 // 8 subkeyss, 1 per round for 3-bit tables, diffusion pass bitmasks
 // 8 * 32 subkeys, 1 per row and per round confusion pass
 // 8 * 4 subkeys, 1 per color channel and per round for diffusion pass.
+// The 8192-byte block type has twice the rows, so it takes the extra subkeys
+// after the ones of the PRNG threads: the second half of each round's XOR
+// subkey, the 8-bit tables of rows 32..63, and the second half of each
+// position table's subkey bytes.
+#define MUM_SUBKEY_INDEX_XOR_EXT       560
+#define MUM_SUBKEY_INDEX_8BIT_EXT      568
+#define MUM_SUBKEY_INDEX_POSITION_EXT  824
 // number of color channels in RGBA pixel
 #define MUN_NUM_POSITIONS 4
 #define MUM_NUM_CYCLES 7
@@ -52,6 +59,12 @@
 #define MUM_LENGTH_BLOCKTYPE_MASK  0x0000e000
 #define MUM_LENGTH_BLOCKTYPE_SHIFT 13
 
+#define MUM_BLOCK_SIZE_R64     8192
+#define MUM_ENCRYPT_SIZE_R64   8096
+#define MUM_BLOCK_SIZE_A_R64   5004
+#define MUM_BLOCK_SIZE_B_R64   3092
+#define MUM_PADDING_SIZE_R64   88
+
 #define MUM_BLOCK_SIZE_R32     4096
 #define MUM_ENCRYPT_SIZE_R32   4000
 #define MUM_BLOCK_SIZE_A_R32   2472
@@ -90,7 +103,10 @@
 #define MUM_PADDING_SIZE_R1   8
 
 #define MUM_CELLS_X             32
+// rows of the GPU renderers' textures
 #define MUM_CELLS_MAX_Y         32
+// rows of the CPU renderers' tables, MUM_BLOCKTYPE_8192
+#define MUM_CELLS_MAX_ROWS      64
 // for gpub 32*8
 #define MUM_CELLS_YB        256
 #define MUM_CELL_SIZE       4
@@ -99,10 +115,51 @@
 // #define MUM_PADDING_SIZE    88
 
 #define MUM_MASK_TABLE_ROWS 32
+// blocks up to this size fit in registers, see mumavx512.cpp
+#define MUM_SMALL_BLOCK_SIZE    MUM_BLOCK_SIZE_R2
+// default round-major tile, see CMumEngine::SetTileBlocks
+#define MUM_DEFAULT_TILE_SIZE   (4*MUM_BLOCK_SIZE_R32)
+#define MUM_DEFAULT_TILE_BLOCKS 8
+// Encrypt and Decrypt calls of at least this many bytes prefetch their
+// source and write their output past the caches, see CMumEngine::SetLargeBufferSize
+#define MUM_DEFAULT_LARGE_BUFFER_SIZE  (16*1024*1024)
+// key context, see CMumKeyContext: tables are cache line aligned, and
+// contexts of at least MUM_HUGE_PAGE_MIN_SIZE bytes are backed by 2 MB pages
+#define MUM_CACHE_LINE_SIZE     64
+#define MUM_HUGE_PAGE_SIZE      (2*1024*1024)
+#define MUM_HUGE_PAGE_MIN_SIZE  (64*1024)
+
+// diffusion pass: for each of the four source cells, the source byte that
+// feeds destination bytes 0..3, packed lowest byte first. I = inverse.
+#define MUM_DIFFUSE_ORDER_1      0x01030200
+#define MUM_DIFFUSE_ORDER_2      0x00010302
+#define MUM_DIFFUSE_ORDER_3      0x02000103
+#define MUM_DIFFUSE_ORDER_4      0x03020001
+#define MUM_DIFFUSE_ORDER_I1     0x02010300
+#define MUM_DIFFUSE_ORDER_I2     0x01000203
+#define MUM_DIFFUSE_ORDER_I3     0x00030102
+#define MUM_DIFFUSE_ORDER_I4     0x03020001
 
 #define MUM_NUM_3BIT_VALUES      8
 #define MUM_NUM_8BIT_VALUES    256
-#define MUM_MAX_10BIT_VALUES  1024
+#define MUM_MAX_11BIT_VALUES  2048
+
+// total = 8192 bytes
+// payload = 8096
+// padding = 88 (32/12/12/32)
+// info = 8
+typedef struct TMumBlockR64
+{
+    uint8_t paddingA[32];
+    uint8_t dataA[MUM_BLOCK_SIZE_A_R64];
+    uint8_t paddingB[12];
+    uint8_t checksum[4];
+    uint8_t length[2];
+    uint8_t seqnum[2];
+    uint8_t paddingC[12];
+    uint8_t dataB[MUM_BLOCK_SIZE_B_R64];
+    uint8_t paddingD[32];
+} TMumBlockR64;
 
 // total = 4096 bytes
 // payload = 4000
@@ -206,7 +263,50 @@ typedef struct TMumBlockR1
     uint8_t paddingD[2];
 } TMumBlockR1;
 
-
+// Where the parts of a packed block sit, as byte offsets and sizes. Every
+// block type has the parts in the order of the structs above, and the
+// padding parts take consecutive bytes of the block's padding.
+typedef struct TMumBlockLayout
+{
+    EMumBlockType blockType;
+    uint32_t encryptSize;
+    uint32_t paddingA;
+    uint32_t dataA;
+    uint32_t paddingB;
+    // checksum, length and seqnum, 8 bytes
+    uint32_t info;
+    uint32_t paddingC;
+    uint32_t dataB;
+    uint32_t paddingD;
+    uint32_t paddingASize;
+    uint32_t dataASize;
+    uint32_t paddingBSize;
+    uint32_t paddingCSize;
+    uint32_t dataBSize;
+    uint32_t paddingDSize;
+} TMumBlockLayout;
+
+
+
+
+// The tables the CPU passes of one round read, sized for the block type
+// and stored contiguously after this header. numCells = numRows*MUM_CELLS_X.
+typedef struct TMumRoundContext
+{
+    uint32_t bitmasks[MUM_NUM_POSITIONS];
+    // subkey bytes xor-ed in the confusion pass, numCells*MUM_CELL_SIZE
+    uint8_t *subkey;
+    // 8-bit substitution tables, numRows tables of 256 entries
+    uint8_t *permute;
+    uint8_t *permuteI;
+    // byte offsets of the four source cells of every cell, [position][cell],
+    // so 8 cells load as one gather index vector
+    uint16_t *offsets;
+    uint16_t *offsetsI;
+    // source byte of every destination byte, [position][byte], small blocks only
+    uint8_t *bytePermutes;
+    uint8_t *bytePermutesI;
+} TMumRoundContext;
 
 
 typedef struct TMumInfo 
@@ -220,29 +320,41 @@ typedef struct TMumInfo
     uint32_t encryptedBlockSize;
     uint32_t paddingSize;
     uint32_t numRoundsPerBlock;
-
+    // MUM_CPU_FEATURE_ bits the CPU renderers may use
+    uint32_t cpuFeatures;
+    // blocks taken through each round together, 1..MUM_MAX_TILE_BLOCKS
+    uint32_t tileBlocks;
+    // Encrypt/Decrypt sizes from which the large-buffer mode is used
+    uint32_t largeBufferSize;
 
     uint8_t key[MUM_KEY_SIZE];
-    uint8_t subkeys[MUM_NUM_SUBKEYS][MUM_KEY_SIZE];
+    // numSubkeys subkeys, sized for the block type and owned by the engine;
+    // the MT renderer's node copies share them
+    uint32_t numSubkeys;
+    uint8_t (*subkeys)[MUM_KEY_SIZE];
 
     // permutation tables
     uint32_t permuteTables3bit[MUM_NUM_ROUNDS][MUM_NUM_3BIT_VALUES];
-    uint32_t permuteTables8bit[MUM_NUM_ROUNDS][MUM_CELLS_MAX_Y][MUM_NUM_8BIT_VALUES];
-    uint32_t permuteTables8bitI[MUM_NUM_ROUNDS][MUM_CELLS_MAX_Y][MUM_NUM_8BIT_VALUES];
-    uint32_t permuteTables10bit[MUM_NUM_ROUNDS][MUN_NUM_POSITIONS][MUM_MAX_10BIT_VALUES];
+    // The 8-bit tables, here and in the texture data below, have
+    // numPermuteRows rows per round, row y of round r at
+    // [r * numPermuteRows + y]: numRows, or MUM_CELLS_MAX_Y for the GPU
+    // renderers that upload that many. Owned by the engine, like the subkeys.
+    uint32_t numPermuteRows;
+    uint32_t (*permuteTables8bit)[MUM_NUM_8BIT_VALUES];
+    uint32_t (*permuteTables8bitI)[MUM_NUM_8BIT_VALUES];
+    uint32_t permuteTables11bit[MUM_NUM_ROUNDS][MUN_NUM_POSITIONS][MUM_MAX_11BIT_VALUES];
 
 
     // tables derived from permuation tables
     uint32_t bitmasks[MUM_NUM_ROUNDS][4];
-    uint32_t positionTables5bitX[MUM_NUM_ROUNDS][MUM_CELLS_MAX_Y][MUM_CELLS_X][MUM_NUM_POSITIONS];
-    uint32_t positionTables5bitY[MUM_NUM_ROUNDS][MUM_CELLS_MAX_Y][MUM_CELLS_X][MUM_NUM_POSITIONS];
-    uint32_t positionTables5bitXI[MUM_NUM_ROUNDS][MUM_CELLS_MAX_Y][MUM_CELLS_X][MUM_NUM_POSITIONS];
-    uint32_t positionTables5bitYI[MUM_NUM_ROUNDS][MUM_CELLS_MAX_Y][MUM_CELLS_X][MUM_NUM_POSITIONS];
+
+    // the CPU renderers' tables of each round, in the engine's key context
+    TMumRoundContext *rounds[MUM_NUM_ROUNDS];
 
     // precomputed texture data, 8-bit unsigned
     uint8_t bitmaskTextureData[MUM_NUM_ROUNDS][MUM_MASK_TABLE_ROWS*MUM_NUM_8BIT_VALUES];
-    uint8_t permuteTextureData[MUM_NUM_ROUNDS][MUM_CELLS_MAX_Y][MUM_NUM_8BIT_VALUES];
-    uint8_t permuteTextureDataI[MUM_NUM_ROUNDS][MUM_CELLS_MAX_Y][MUM_NUM_8BIT_VALUES];
+    uint8_t (*permuteTextureData)[MUM_NUM_8BIT_VALUES];
+    uint8_t (*permuteTextureDataI)[MUM_NUM_8BIT_VALUES];
     uint8_t positionTextureDataX[MUM_NUM_ROUNDS][MUM_CELLS_MAX_Y][MUM_CELLS_X][MUM_NUM_POSITIONS];
     uint8_t positionTextureDataY[MUM_NUM_ROUNDS][MUM_CELLS_MAX_Y][MUM_CELLS_X][MUM_NUM_POSITIONS];
     uint8_t positionTextureDataYB[MUM_NUM_ROUNDS][MUM_CELLS_MAX_Y][MUM_CELLS_X][MUM_NUM_POSITIONS];
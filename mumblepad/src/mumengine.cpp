@@ -34,8 +34,12 @@
 #include "stdio.h"
 #include "stdlib.h"
 #include "mumengine.h"
+#include "mumcpu.h"
 #include "mumblepad.h"
+#include "mumblepadjit.h"
 #include "mumblepadmt.h"
+#include "mumblepadt.h"
+#include "mumplatform.h"
 #ifdef USE_MUM_OPENGL
 #include "mumblepadgla.h"
 #include "mumblepadglb.h"
@@ -85,24 +89,34 @@ CMumGlWrapper *CMumEngine::mMumGlWrapper = NULL;
 #endif
 
 
-CMumEngine::CMumEngine(EMumEngineType engineType, EMumBlockType blockType, EMumPaddingType paddingType, uint32_t numThreads)
+CMumEngine::CMumEngine(EMumEngineType engineType, EMumBlockType blockType, EMumPaddingType paddingType, uint32_t numThreads, EMumPlacementType placement)
 {
-    mMumInfo.engineType = engineType;
-    mMumInfo.paddingOn = (paddingType == MUM_PADDING_TYPE_ON);
-    mMumInfo.blockType = blockType;
-    mMumInfo.keyInitialized = false;
-
-    mMumInfo.numRoundsPerBlock = 8;
+    // the key tables run to hundreds of KB, so they live on the heap
+    mMumInfo = new TMumInfo;
+    mMumInfo->engineType = engineType;
+    mMumInfo->paddingOn = (paddingType == MUM_PADDING_TYPE_ON);
+    mMumInfo->blockType = blockType;
+    mMumInfo->keyInitialized = false;
+    // filled in by the renderer
+    mMumInfo->numRows = 0;
+    memset(mMumInfo->rounds, 0, sizeof(mMumInfo->rounds));
+    // the extension subkeys are only used by the 8192-byte block type
+    mMumInfo->numSubkeys = (blockType == MUM_BLOCKTYPE_8192) ? MUM_NUM_SUBKEYS : MUM_NUM_SUBKEYS_4096;
+    mMumInfo->subkeys = new uint8_t[mMumInfo->numSubkeys][MUM_KEY_SIZE];
+    mNumThreads = numThreads;
+    mPlacement = placement;
+
+    mMumInfo->numRoundsPerBlock = 8;
 #ifdef USE_MUM_OPENGL
-    if (engineType >= MUM_ENGINE_TYPE_GPU_B)
-        mMumInfo.numRoundsPerBlock = 1;
+    if (engineType == MUM_ENGINE_TYPE_GPU_B)
+        mMumInfo->numRoundsPerBlock = 1;
 #endif
 
-    InitXorTextureData();
-
 #ifdef USE_MUM_OPENGL
-    if ( engineType >= MUM_ENGINE_TYPE_GPU_A )
+    // only the GPU renderers' textures use it
+    if ( engineType == MUM_ENGINE_TYPE_GPU_A || engineType == MUM_ENGINE_TYPE_GPU_B )
     {
+        InitXorTextureData();
         if ( mMumGlWrapper == NULL )
         {
             mMumGlWrapper = new CMumGlWrapper();
@@ -110,49 +124,194 @@ CMumEngine::CMumEngine(EMumEngineType engineType, EMumBlockType blockType, EMumP
         }
     }
 #endif
-    switch ( mMumInfo.engineType )
+    switch ( mMumInfo->engineType )
     {
     case MUM_ENGINE_TYPE_CPU:
-        mMumRenderer = new CMumblepad(&mMumInfo);
+        mMumRenderer = MumCreateSpecializedRenderer(mMumInfo);
+        break;
+    case MUM_ENGINE_TYPE_CPU_GENERIC:
+        mMumRenderer = new CMumblepad(mMumInfo);
+        break;
+    case MUM_ENGINE_TYPE_CPU_JIT:
+        mMumRenderer = new CMumblepadJit(mMumInfo);
         break;
     case MUM_ENGINE_TYPE_CPU_MT:
-        mMumRenderer = new CMumblepadMt(&mMumInfo, numThreads);
+        mMumRenderer = new CMumblepadMt(mMumInfo, numThreads, placement);
         break;
 #ifdef USE_MUM_OPENGL
     case MUM_ENGINE_TYPE_GPU_A:
-        mMumRenderer = new CMumblepadGla(&mMumInfo, mMumGlWrapper);
+        mMumRenderer = new CMumblepadGla(mMumInfo, mMumGlWrapper);
         break;
     case MUM_ENGINE_TYPE_GPU_B:
-        mMumRenderer = new CMumblepadGlb(&mMumInfo, mMumGlWrapper);
+        mMumRenderer = new CMumblepadGlb(mMumInfo, mMumGlWrapper);
         break;
 #endif
     default:
         assert(0);
     }
 
+    InitSettings();
+
+    // numRows is known once the renderer is created
+    mMumInfo->numPermuteRows = mMumInfo->numRows;
+    if ((engineType == MUM_ENGINE_TYPE_GPU_A || engineType == MUM_ENGINE_TYPE_GPU_B) && mMumInfo->numPermuteRows < MUM_CELLS_MAX_Y)
+        mMumInfo->numPermuteRows = MUM_CELLS_MAX_Y;
+    uint32_t numPermuteRows = MUM_NUM_ROUNDS * mMumInfo->numPermuteRows;
+    mMumInfo->permuteTables8bit = new uint32_t[numPermuteRows][MUM_NUM_8BIT_VALUES];
+    mMumInfo->permuteTables8bitI = new uint32_t[numPermuteRows][MUM_NUM_8BIT_VALUES];
+    mMumInfo->permuteTextureData = new uint8_t[numPermuteRows][MUM_NUM_8BIT_VALUES];
+    mMumInfo->permuteTextureDataI = new uint8_t[numPermuteRows][MUM_NUM_8BIT_VALUES];
+    // the GPU renderers upload all numPermuteRows rows
+    memset(mMumInfo->permuteTextureData, 0, numPermuteRows * sizeof(mMumInfo->permuteTextureData[0]));
+    memset(mMumInfo->permuteTextureDataI, 0, numPermuteRows * sizeof(mMumInfo->permuteTextureDataI[0]));
+    mKeyContext = new CMumKeyContext(mMumInfo->numRows);
+}
+
+// The settings an application may change, as a new engine has them. The
+// block sizes are known once the renderer is created.
+void CMumEngine::InitSettings()
+{
+    mMumInfo->cpuFeatures = MumDetectCpuFeatures();
+    // tiles of about MUM_DEFAULT_TILE_SIZE bytes, so both ping-pong halves
+    // of a tile stay in L1
+    mMumInfo->tileBlocks = MUM_DEFAULT_TILE_SIZE / mMumInfo->encryptedBlockSize;
+    if (mMumInfo->tileBlocks > MUM_DEFAULT_TILE_BLOCKS)
+        mMumInfo->tileBlocks = MUM_DEFAULT_TILE_BLOCKS;
+    mMumInfo->largeBufferSize = MUM_DEFAULT_LARGE_BUFFER_SIZE;
+}
+
+bool CMumEngine::Matches(EMumEngineType engineType, EMumBlockType blockType, EMumPaddingType paddingType, uint32_t numThreads, EMumPlacementType placement)
+{
+    return mMumInfo->engineType == engineType && mMumInfo->blockType == blockType
+        && mMumInfo->paddingOn == (paddingType == MUM_PADDING_TYPE_ON)
+        && mNumThreads == numThreads && mPlacement == placement;
+}
+
+// The renderer's work in flight is waited for. The key, its subkeys and
+// its tables are wiped, so the next owner of the engine finds nothing of
+// the last one's key.
+void CMumEngine::Recycle()
+{
+    mMumRenderer->Recycle();
+    mMumInfo->keyInitialized = false;
+    MumWipeKeyTables(mMumInfo);
+    MumWipe(mMumInfo->subkeys, mMumInfo->numSubkeys * sizeof(mMumInfo->subkeys[0]));
+    uint32_t numPermuteRows = MUM_NUM_ROUNDS * mMumInfo->numPermuteRows;
+    MumWipe(mMumInfo->permuteTables8bit, numPermuteRows * sizeof(mMumInfo->permuteTables8bit[0]));
+    MumWipe(mMumInfo->permuteTables8bitI, numPermuteRows * sizeof(mMumInfo->permuteTables8bitI[0]));
+    MumWipe(mMumInfo->permuteTextureData, numPermuteRows * sizeof(mMumInfo->permuteTextureData[0]));
+    MumWipe(mMumInfo->permuteTextureDataI, numPermuteRows * sizeof(mMumInfo->permuteTextureDataI[0]));
+    mKeyContext->Wipe();
+    InitSettings();
+    mMumRenderer->SettingsChanged();
 }
 
 CMumEngine::~CMumEngine()
 {
     delete mMumRenderer;
+    delete mKeyContext;
+    delete[] mMumInfo->subkeys;
+    delete[] mMumInfo->permuteTables8bit;
+    delete[] mMumInfo->permuteTables8bitI;
+    delete[] mMumInfo->permuteTextureData;
+    delete[] mMumInfo->permuteTextureDataI;
+    delete mMumInfo;
 }
 
 uint32_t CMumEngine::PlaintextBlockSize()
 {
-    return mMumInfo.plaintextBlockSize;
+    return mMumInfo->plaintextBlockSize;
 }
 
 uint32_t CMumEngine::EncryptedBlockSize()
 {
-    return mMumInfo.encryptedBlockSize;
+    return mMumInfo->encryptedBlockSize;
 }
 
 uint32_t CMumEngine::EncryptedSize(uint32_t plaintextSize)
 {
-    uint32_t encryptedOutputSize = ((plaintextSize + mMumInfo.plaintextBlockSize - 1) / mMumInfo.plaintextBlockSize) * mMumInfo.encryptedBlockSize;
+    uint32_t encryptedOutputSize = ((plaintextSize + mMumInfo->plaintextBlockSize - 1) / mMumInfo->plaintextBlockSize) * mMumInfo->encryptedBlockSize;
     return encryptedOutputSize;
 }
 
+uint32_t CMumEngine::GetCpuFeatures()
+{
+    return mMumInfo->cpuFeatures;
+}
+
+// Features the processor lacks are dropped, so the scalar passes are always
+// a valid fallback.
+void CMumEngine::SetCpuFeatures(uint32_t features)
+{
+    mMumInfo->cpuFeatures = features & MumDetectCpuFeatures();
+    mMumRenderer->SettingsChanged();
+}
+
+uint32_t CMumEngine::GetTileBlocks()
+{
+    return mMumInfo->tileBlocks;
+}
+
+EMumError CMumEngine::SetTileBlocks(uint32_t tileBlocks)
+{
+    if (tileBlocks == 0 || tileBlocks > MUM_MAX_TILE_BLOCKS)
+        return MUM_ERROR_INVALID_TILE_SIZE;
+    mMumInfo->tileBlocks = tileBlocks;
+    mMumRenderer->SettingsChanged();
+    return MUM_ERROR_OK;
+}
+
+uint32_t CMumEngine::GetLargeBufferSize()
+{
+    return mMumInfo->largeBufferSize;
+}
+
+// Buffers much larger than the last-level cache gain from streaming; the
+// default is well above it, so working sets that fit stay cached.
+void CMumEngine::SetLargeBufferSize(uint32_t largeBufferSize)
+{
+    mMumInfo->largeBufferSize = largeBufferSize;
+    mMumRenderer->SettingsChanged();
+}
+
+uint32_t CMumEngine::GetNumNodes()
+{
+    return mMumRenderer->NumNodes();
+}
+
+EMumError CMumEngine::GetNodeStats(uint32_t node, uint32_t *numWorkers, uint64_t *bytes, uint64_t *microseconds)
+{
+    return mMumRenderer->GetNodeStats(node, numWorkers, bytes, microseconds);
+}
+
+EMumError CMumEngine::GetPriority(EMumPriority *priority)
+{
+    return mMumRenderer->GetPriority(priority);
+}
+
+// the job queue has a ring per priority, and no more
+static bool MumIsPriority(EMumPriority priority)
+{
+    return priority == MUM_PRIORITY_BULK || priority == MUM_PRIORITY_INTERACTIVE;
+}
+
+EMumError CMumEngine::SetPriority(EMumPriority priority)
+{
+    if (!MumIsPriority(priority))
+        return MUM_ERROR_INVALID_PRIORITY;
+    return mMumRenderer->SetPriority(priority);
+}
+
+EMumError CMumEngine::GetInlineBlocks(uint32_t *inlineBlocks)
+{
+    return mMumRenderer->GetInlineBlocks(inlineBlocks);
+}
+
+EMumError CMumEngine::SetInlineBlocks(uint32_t inlineBlocks)
+{
+    return mMumRenderer->SetInlineBlocks(inlineBlocks);
+}
+
 
 EMumError CMumEngine::EncryptFile(char *srcfile, char *dstfile)
 {
@@ -165,7 +324,7 @@ EMumError CMumEngine::EncryptFile(char *srcfile, char *dstfile)
     uint32_t readsize;
     uint32_t seqnum = 0;
 
-    if (!mMumInfo.keyInitialized)
+    if (!mMumInfo->keyInitialized)
         return MUM_ERROR_KEY_NOT_INITIALIZED;
 
     mMumRenderer->ResetEncryption();
@@ -189,8 +348,8 @@ EMumError CMumEngine::EncryptFile(char *srcfile, char *dstfile)
     while ( remaining > 0 )
     {
         // set read size
-        if ( remaining > mMumInfo.plaintextBlockSize)
-            readsize = mMumInfo.plaintextBlockSize;
+        if ( remaining > mMumInfo->plaintextBlockSize)
+            readsize = mMumInfo->plaintextBlockSize;
         else readsize = remaining;
         remaining -= readsize;
 
@@ -217,8 +376,8 @@ EMumError CMumEngine::EncryptFile(char *srcfile, char *dstfile)
         else
         {
             // write to destination
-            res = fwrite(outbuffer,1,mMumInfo.encryptedBlockSize,outfile);
-            if ( res != mMumInfo.encryptedBlockSize)
+            res = fwrite(outbuffer,1,mMumInfo->encryptedBlockSize,outfile);
+            if ( res != mMumInfo->encryptedBlockSize)
             {
                 fclose(infile);
                 fclose(outfile);
@@ -229,7 +388,7 @@ EMumError CMumEngine::EncryptFile(char *srcfile, char *dstfile)
     while (latency > 0)
     {
         uint8_t dummy[MUM_MAX_BLOCK_SIZE];
-        error = EncryptBlock(dummy, outbuffer, mMumInfo.plaintextBlockSize, seqnum++);
+        error = EncryptBlock(dummy, outbuffer, mMumInfo->plaintextBlockSize, seqnum++);
         if ( error == MUM_ERROR_BUFFER_WAIT_ENCRYPT)
             continue;
         if (error != MUM_ERROR_OK)
@@ -238,8 +397,8 @@ EMumError CMumEngine::EncryptFile(char *srcfile, char *dstfile)
             fclose(outfile);
             return error;
         }
-        res = fwrite(outbuffer,1,mMumInfo.encryptedBlockSize,outfile);
-        if ( res != mMumInfo.encryptedBlockSize)
+        res = fwrite(outbuffer,1,mMumInfo->encryptedBlockSize,outfile);
+        if ( res != mMumInfo->encryptedBlockSize)
         {
             fclose(infile);
             fclose(outfile);
@@ -265,7 +424,7 @@ EMumError CMumEngine::DecryptFile(char *srcfile, char *dstfile)
     uint32_t decryptSize, seqnum;
     uint8_t firstBlock[MUM_MAX_BLOCK_SIZE];
 
-    if (!mMumInfo.keyInitialized)
+    if (!mMumInfo->keyInitialized)
         return MUM_ERROR_KEY_NOT_INITIALIZED;
 
     mMumRenderer->ResetDecryption();
@@ -290,19 +449,19 @@ EMumError CMumEngine::DecryptFile(char *srcfile, char *dstfile)
     while ( remaining > 0 )
     {
         // read in from source
-        res = fread(inbuffer, 1, mMumInfo.encryptedBlockSize, infile);
-        if ( res != mMumInfo.encryptedBlockSize)
+        res = fread(inbuffer, 1, mMumInfo->encryptedBlockSize, infile);
+        if ( res != mMumInfo->encryptedBlockSize)
         {
             assert(0);
             fclose(infile);
             fclose(outfile);
             return MUM_ERROR_FILEIO_INPUT;
         }
-        remaining -= mMumInfo.encryptedBlockSize;
+        remaining -= mMumInfo->encryptedBlockSize;
         if ( firstTime )
         {
             firstTime = false;
-            memcpy(firstBlock, inbuffer, mMumInfo.encryptedBlockSize);
+            memcpy(firstBlock, inbuffer, mMumInfo->encryptedBlockSize);
         }
 
         // do encrypt
@@ -342,7 +501,7 @@ EMumError CMumEngine::DecryptFile(char *srcfile, char *dstfile)
             fclose(outfile);
             return MUM_ERROR_FILEIO_OUTPUT;
         }
-        remaining -= mMumInfo.encryptedBlockSize;
+        remaining -= mMumInfo->encryptedBlockSize;
         latency--;
     }
     fclose(infile);
@@ -351,33 +510,103 @@ EMumError CMumEngine::DecryptFile(char *srcfile, char *dstfile)
 }
 
 
+// the renderer's priority for the calls made without one; the renderers
+// without workers have none, and ignore the bulk priority they are given
+EMumPriority CMumEngine::DefaultPriority()
+{
+    EMumPriority priority = MUM_PRIORITY_BULK;
+    mMumRenderer->GetPriority(&priority);
+    return priority;
+}
+
 EMumError CMumEngine::Encrypt(uint8_t *src, uint8_t *dst, uint32_t length, uint32_t *outlength, uint16_t seqNum)
 {
-    if (!mMumInfo.keyInitialized)
+    return EncryptWithPriority(src, dst, length, outlength, seqNum, DefaultPriority());
+}
+
+EMumError CMumEngine::Decrypt(uint8_t *src, uint8_t *dst, uint32_t length, uint32_t *outlength)
+{
+    return DecryptWithPriority(src, dst, length, outlength, DefaultPriority());
+}
+
+EMumError CMumEngine::EncryptWithPriority(uint8_t *src, uint8_t *dst, uint32_t length, uint32_t *outlength, uint16_t seqNum,
+    EMumPriority priority)
+{
+    if (!MumIsPriority(priority))
+        return MUM_ERROR_INVALID_PRIORITY;
+    if (!mMumInfo->keyInitialized)
         return MUM_ERROR_KEY_NOT_INITIALIZED;
+    if (src != dst && src < dst + EncryptedSize(length) && dst < src + length)
+        return MUM_ERROR_OVERLAPPING_BUFFERS;
     mMumRenderer->ResetEncryption();
-    return mMumRenderer->Encrypt(src, dst, length, outlength, seqNum);
+    return mMumRenderer->EncryptWithPriority(src, dst, length, outlength, seqNum, priority);
 }
 
-EMumError CMumEngine::Decrypt(uint8_t *src, uint8_t *dst, uint32_t length, uint32_t *outlength)
+EMumError CMumEngine::DecryptWithPriority(uint8_t *src, uint8_t *dst, uint32_t length, uint32_t *outlength,
+    EMumPriority priority)
 {
-    if (!mMumInfo.keyInitialized)
+    if (!MumIsPriority(priority))
+        return MUM_ERROR_INVALID_PRIORITY;
+    if (!mMumInfo->keyInitialized)
         return MUM_ERROR_KEY_NOT_INITIALIZED;
+    // the plaintext takes at most plaintextBlockSize of every block
+    uint32_t maxPlaintextSize = length / mMumInfo->encryptedBlockSize * mMumInfo->plaintextBlockSize;
+    if (src != dst && src < dst + maxPlaintextSize && dst < src + length)
+        return MUM_ERROR_OVERLAPPING_BUFFERS;
     mMumRenderer->ResetDecryption();
-    return mMumRenderer->Decrypt(src, dst, length, outlength);
+    return mMumRenderer->DecryptWithPriority(src, dst, length, outlength, priority);
+}
+
+EMumError CMumEngine::EncryptAsync(uint8_t *src, uint8_t *dst, uint32_t length, uint16_t seqNum,
+    MumCompletionCallback callback, void *userData, void **request)
+{
+    return EncryptAsyncWithPriority(src, dst, length, seqNum, DefaultPriority(), callback, userData, request);
+}
+
+EMumError CMumEngine::DecryptAsync(uint8_t *src, uint8_t *dst, uint32_t length,
+    MumCompletionCallback callback, void *userData, void **request)
+{
+    return DecryptAsyncWithPriority(src, dst, length, DefaultPriority(), callback, userData, request);
+}
+
+// the same checks as Encrypt and Decrypt
+EMumError CMumEngine::EncryptAsyncWithPriority(uint8_t *src, uint8_t *dst, uint32_t length, uint16_t seqNum, EMumPriority priority,
+    MumCompletionCallback callback, void *userData, void **request)
+{
+    if (!MumIsPriority(priority))
+        return MUM_ERROR_INVALID_PRIORITY;
+    if (!mMumInfo->keyInitialized)
+        return MUM_ERROR_KEY_NOT_INITIALIZED;
+    if (src != dst && src < dst + EncryptedSize(length) && dst < src + length)
+        return MUM_ERROR_OVERLAPPING_BUFFERS;
+    return mMumRenderer->EncryptAsync(src, dst, length, seqNum, priority, callback, userData, request);
+}
+
+EMumError CMumEngine::DecryptAsyncWithPriority(uint8_t *src, uint8_t *dst, uint32_t length, EMumPriority priority,
+    MumCompletionCallback callback, void *userData, void **request)
+{
+    if (!MumIsPriority(priority))
+        return MUM_ERROR_INVALID_PRIORITY;
+    if (!mMumInfo->keyInitialized)
+        return MUM_ERROR_KEY_NOT_INITIALIZED;
+    uint32_t maxPlaintextSize = length / mMumInfo->encryptedBlockSize * mMumInfo->plaintextBlockSize;
+    if (src != dst && src < dst + maxPlaintextSize && dst < src + length)
+        return MUM_ERROR_OVERLAPPING_BUFFERS;
+    return mMumRenderer->DecryptAsync(src, dst, length, priority, callback, userData, request);
 }
 
 
 
 // Return little-endian integer read from key at a specific offset. Depending on
 // the offset, this may roll-around from the end of the subkey data to the start.
-uint32_t CMumEngine::GetSubkeyInteger(uint8_t *subkey, uint32_t offset)
+// subkeySize is a power of two, one or more subkeys back to back.
+uint32_t CMumEngine::GetSubkeyInteger(uint8_t *subkey, uint32_t subkeySize, uint32_t offset)
 {
     uint32_t value = 0;
     for (uint32_t i = 0; i < 4; i++)
     {
         value <<= 8;
-        value += subkey[(offset + (3-i)) & MUM_KEY_MASK];
+        value += subkey[(offset + (3-i)) & (subkeySize - 1)];
     }
     return value;
 }
@@ -389,7 +618,7 @@ void CMumEngine::InitXorTextureData()
     {
         for (uint32_t col = 0; col < MUM_NUM_8BIT_VALUES; col++ )
         {
-            mMumInfo.xorTextureData[row*MUM_NUM_8BIT_VALUES+col] = (uint8_t)( row ^ col );
+            mMumInfo->xorTextureData[row*MUM_NUM_8BIT_VALUES+col] = (uint8_t)( row ^ col );
         }
     }
 }
@@ -397,14 +626,14 @@ void CMumEngine::InitXorTextureData()
 
 EMumError CMumEngine::EncryptBlock(uint8_t *src, uint8_t *dst, uint32_t length, uint32_t seqnum)
 {
-    if (!mMumInfo.keyInitialized)
+    if (!mMumInfo->keyInitialized)
         return MUM_ERROR_KEY_NOT_INITIALIZED;
     return mMumRenderer->EncryptBlock(src, dst, length, seqnum);
 }
 
 EMumError CMumEngine::DecryptBlock(uint8_t *src, uint8_t *dst, uint32_t *length, uint32_t *seqnum)
 {
-    if (!mMumInfo.keyInitialized)
+    if (!mMumInfo->keyInitialized)
         return MUM_ERROR_KEY_NOT_INITIALIZED;
     return mMumRenderer->DecryptBlock(src, dst, length, seqnum);
 }
@@ -414,24 +643,24 @@ void CMumEngine::CreatePrimeCycleWithOffset(uint32_t primeIndex, uint32_t offset
     uint32_t prime = primeNumberTable[primeIndex&255];
     for (uint32_t i = 0; i < MUM_KEY_SIZE; i++)
     {
-        outCycle[i] = mMumInfo.key[offset&MUM_KEY_MASK];
+        outCycle[i] = mMumInfo->key[offset&MUM_KEY_MASK];
         offset += prime;
     }
 }
 
 
-void CMumEngine::CreatePermuteTable(uint8_t *subkey, uint32_t numEntries, uint32_t *outTable)
+void CMumEngine::CreatePermuteTable(uint8_t *subkey, uint32_t subkeySize, uint32_t numEntries, uint32_t *outTable)
 {
-    uint32_t used[MUM_MAX_10BIT_VALUES];
+    uint32_t used[MUM_MAX_11BIT_VALUES];
 
-    assert(numEntries <= MUM_MAX_10BIT_VALUES);
+    assert(numEntries <= MUM_MAX_11BIT_VALUES);
     memset(used, 0, numEntries*sizeof(uint32_t));
     memset(outTable, 0xff, numEntries*sizeof(uint32_t));
 
     uint32_t offset = 0;
     for (uint32_t n = 0; n < numEntries - 1; n++)
     {
-        uint32_t s = GetSubkeyInteger(subkey, offset);
+        uint32_t s = GetSubkeyInteger(subkey, subkeySize, offset);
         offset += 4;
 
         uint32_t mod = numEntries - n;
@@ -478,17 +707,17 @@ void CMumEngine::InitBitmasks()
     for ( round = 0; round < MUM_NUM_ROUNDS; round++ )
     {
         // now that we have our permuations, create the bitmasks themselves
-        mMumInfo.bitmasks[round][0] = (1 << mMumInfo.permuteTables3bit[round][0]) + (1 << mMumInfo.permuteTables3bit[round][1]);
-        mMumInfo.bitmasks[round][1] = (1 << mMumInfo.permuteTables3bit[round][2]) + (1 << mMumInfo.permuteTables3bit[round][3]);
-        mMumInfo.bitmasks[round][2] = (1 << mMumInfo.permuteTables3bit[round][4]) + (1 << mMumInfo.permuteTables3bit[round][5]);
-        mMumInfo.bitmasks[round][3] = (1 << mMumInfo.permuteTables3bit[round][6]) + (1 << mMumInfo.permuteTables3bit[round][7]);
+        mMumInfo->bitmasks[round][0] = (1 << mMumInfo->permuteTables3bit[round][0]) + (1 << mMumInfo->permuteTables3bit[round][1]);
+        mMumInfo->bitmasks[round][1] = (1 << mMumInfo->permuteTables3bit[round][2]) + (1 << mMumInfo->permuteTables3bit[round][3]);
+        mMumInfo->bitmasks[round][2] = (1 << mMumInfo->permuteTables3bit[round][4]) + (1 << mMumInfo->permuteTables3bit[round][5]);
+        mMumInfo->bitmasks[round][3] = (1 << mMumInfo->permuteTables3bit[round][6]) + (1 << mMumInfo->permuteTables3bit[round][7]);
         for ( row = 0; row < MUM_MASK_TABLE_ROWS; row++ )
         {
             index = row / 8;
-            mask = mMumInfo.bitmasks[round][index];
+            mask = mMumInfo->bitmasks[round][index];
             for ( col = 0; col < MUM_NUM_8BIT_VALUES; col++ )
             {
-                mMumInfo.bitmaskTextureData[round][row*MUM_NUM_8BIT_VALUES+col] = (uint8_t)(col & mask);
+                mMumInfo->bitmaskTextureData[round][row*MUM_NUM_8BIT_VALUES+col] = (uint8_t)(col & mask);
             }
         }
     }
@@ -501,9 +730,13 @@ void CMumEngine::InitPositionTables()
     uint32_t n, round;
     uint32_t x, y, mapX, mapY;
     uint32_t position, value;
-    uint32_t numRows = mMumInfo.numRows;
+    uint32_t numRows = mMumInfo->numRows;
 
-    uint32_t textureScalar = 4096/mMumInfo.plaintextBlockSize;
+    // only the GPU renderers read these, and they stop at MUM_CELLS_MAX_Y rows
+    if (numRows > MUM_CELLS_MAX_Y)
+        return;
+
+    uint32_t textureScalar = 4096/mMumInfo->plaintextBlockSize;
     for ( round = 0; round < MUM_NUM_ROUNDS; round++ )
     {
         for (n = 0; n < numRows*MUM_CELLS_X; n++)
@@ -513,19 +746,15 @@ void CMumEngine::InitPositionTables()
             for ( position = 0; position < MUM_NUM_POSITIONS; position++ )
             {
                 //index = (n * primes[position]) % (numRows*MUM_CELLS_X);
-                value = mMumInfo.permuteTables10bit[round][position][n];
+                value = mMumInfo->permuteTables11bit[round][position][n];
                 mapX = value % MUM_CELLS_X;
                 mapY = value / MUM_CELLS_X;
-                mMumInfo.positionTables5bitX[round][y][x][position] = mapX;
-                mMumInfo.positionTables5bitY[round][y][x][position] = mapY;
-                mMumInfo.positionTables5bitXI[round][mapY][mapX][position] = x;
-                mMumInfo.positionTables5bitYI[round][mapY][mapX][position] = y;
-                mMumInfo.positionTextureDataX[round][y][x][position] = (uint8_t)(mapX * 8 + 4);
-                mMumInfo.positionTextureDataY[round][y][x][position] = (uint8_t)(mapY * 8 * textureScalar + 4 * textureScalar);
-                mMumInfo.positionTextureDataYB[round][y][x][position] = (uint8_t)(mapY + round*numRows);
-                mMumInfo.positionTextureDataXI[round][mapY][mapX][position] = (uint8_t)(x * 8 + 4);
-                mMumInfo.positionTextureDataYI[round][mapY][mapX][position] = (uint8_t)(y * 8 * textureScalar+ 4 * textureScalar);
-                mMumInfo.positionTextureDataYIB[round][mapY][mapX][position] = (uint8_t)(y + (7-round)*numRows);
+                mMumInfo->positionTextureDataX[round][y][x][position] = (uint8_t)(mapX * 8 + 4);
+                mMumInfo->positionTextureDataY[round][y][x][position] = (uint8_t)(mapY * 8 * textureScalar + 4 * textureScalar);
+                mMumInfo->positionTextureDataYB[round][y][x][position] = (uint8_t)(mapY + round*numRows);
+                mMumInfo->positionTextureDataXI[round][mapY][mapX][position] = (uint8_t)(x * 8 + 4);
+                mMumInfo->positionTextureDataYI[round][mapY][mapX][position] = (uint8_t)(y * 8 * textureScalar+ 4 * textureScalar);
+                mMumInfo->positionTextureDataYIB[round][mapY][mapX][position] = (uint8_t)(y + (7-round)*numRows);
             }
         }
     }
@@ -537,7 +766,7 @@ void CMumEngine::InitSubkeys()
     uint8_t cycles[MUM_NUM_CYCLES][MUM_KEY_SIZE];
     uint32_t offset = 0;
     uint32_t index = 0;
-    for (uint32_t s = 0; s < MUM_NUM_SUBKEYS; s++)
+    for (uint32_t s = 0; s < mMumInfo->numSubkeys; s++)
     {
         uint8_t *pcycles[MUM_NUM_CYCLES];
         for (uint32_t i = 0; i < MUM_NUM_CYCLES; i++)
@@ -547,7 +776,7 @@ void CMumEngine::InitSubkeys()
             index += MUM_CYCLE_INDEX_INCREMENT;
             offset += MUM_CYCLE_OFFSET_INCREMENT;
         }
-        uint8_t *subkey = mMumInfo.subkeys[s];
+        uint8_t *subkey = mMumInfo->subkeys[s];
         for (uint32_t i = 0; i < MUM_KEY_SIZE; i++)
         {
             uint8_t value = *pcycles[0]++;
@@ -562,26 +791,34 @@ void CMumEngine::InitSubkeys()
 void CMumEngine::InitPermuteTables()
 {
     uint32_t round, y, n;
-    uint32_t numRows = mMumInfo.numRows;
+    uint32_t numRows = mMumInfo->numRows;
     // first eight subkeys used for confusion pass.
     uint32_t subkeyIndex = 8;
 
     for ( round = 0; round < MUM_NUM_ROUNDS; round++ )
     {
-        CreatePermuteTable(mMumInfo.subkeys[subkeyIndex++], MUM_NUM_3BIT_VALUES, mMumInfo.permuteTables3bit[round]);
+        CreatePermuteTable(mMumInfo->subkeys[subkeyIndex++], MUM_KEY_SIZE, MUM_NUM_3BIT_VALUES, mMumInfo->permuteTables3bit[round]);
     }
 
     for ( round = 0; round < MUM_NUM_ROUNDS; round++ )
     {
         for ( y = 0; y < numRows; y++ )
         {
-            CreatePermuteTable(mMumInfo.subkeys[subkeyIndex++], MUM_NUM_8BIT_VALUES, mMumInfo.permuteTables8bit[round][y]);
+            // rows past MUM_CELLS_MAX_Y take extension subkeys, so the
+            // subkeys of all other tables stay where the 4096-byte block has them
+            uint8_t *subkey;
+            if (y < MUM_CELLS_MAX_Y)
+                subkey = mMumInfo->subkeys[subkeyIndex++];
+            else
+                subkey = mMumInfo->subkeys[MUM_SUBKEY_INDEX_8BIT_EXT + round * (MUM_CELLS_MAX_ROWS - MUM_CELLS_MAX_Y) + y - MUM_CELLS_MAX_Y];
+            uint32_t row = round * mMumInfo->numPermuteRows + y;
+            CreatePermuteTable(subkey, MUM_KEY_SIZE, MUM_NUM_8BIT_VALUES, mMumInfo->permuteTables8bit[row]);
             for ( n = 0; n < MUM_NUM_8BIT_VALUES; n++ )
-                mMumInfo.permuteTables8bitI[round][y][mMumInfo.permuteTables8bit[round][y][n]] = n;
+                mMumInfo->permuteTables8bitI[row][mMumInfo->permuteTables8bit[row][n]] = n;
             for ( n = 0; n < MUM_NUM_8BIT_VALUES; n++ )
             {
-                mMumInfo.permuteTextureData[round][y][n] = (uint8_t)mMumInfo.permuteTables8bit[round][y][n];
-                mMumInfo.permuteTextureDataI[round][y][n] = (uint8_t)mMumInfo.permuteTables8bitI[round][y][n];
+                mMumInfo->permuteTextureData[row][n] = (uint8_t)mMumInfo->permuteTables8bit[row][n];
+                mMumInfo->permuteTextureDataI[row][n] = (uint8_t)mMumInfo->permuteTables8bitI[row][n];
             }
         }
     }
@@ -589,20 +826,35 @@ void CMumEngine::InitPermuteTables()
     for ( round = 0; round < MUM_NUM_ROUNDS; round++ )
     {
         for (uint32_t position = 0; position < MUN_NUM_POSITIONS; position++)
-            CreatePermuteTable(mMumInfo.subkeys[subkeyIndex++], numRows*MUM_CELLS_X, mMumInfo.permuteTables10bit[round][position]);
+        {
+            uint32_t numEntries = numRows*MUM_CELLS_X;
+            if (numEntries * 4 <= MUM_KEY_SIZE)
+            {
+                CreatePermuteTable(mMumInfo->subkeys[subkeyIndex++], MUM_KEY_SIZE, numEntries, mMumInfo->permuteTables11bit[round][position]);
+            }
+            else
+            {
+                // 4 subkey bytes per entry: append an extension subkey
+                uint8_t subkey[2 * MUM_KEY_SIZE];
+                memcpy(subkey, mMumInfo->subkeys[subkeyIndex++], MUM_KEY_SIZE);
+                memcpy(subkey + MUM_KEY_SIZE, mMumInfo->subkeys[MUM_SUBKEY_INDEX_POSITION_EXT + round * MUN_NUM_POSITIONS + position], MUM_KEY_SIZE);
+                CreatePermuteTable(subkey, 2 * MUM_KEY_SIZE, numEntries, mMumInfo->permuteTables11bit[round][position]);
+            }
+        }
     }
 }
 
 
 EMumError CMumEngine::InitKey(uint8_t *key)
 {
-    memcpy(mMumInfo.key, key, MUM_KEY_SIZE);
+    memcpy(mMumInfo->key, key, MUM_KEY_SIZE);
     InitSubkeys();
     InitPermuteTables();
     InitPositionTables();
     InitBitmasks();
+    mKeyContext->Init(mMumInfo);
     mMumRenderer->InitKey();
-    mMumInfo.keyInitialized = true;
+    mMumInfo->keyInitialized = true;
     return MUM_ERROR_OK;
 }
 
@@ -623,10 +875,10 @@ EMumError CMumEngine::LoadKey(char *keyfile)
 
 EMumError CMumEngine::GetSubkey(uint32_t index, uint8_t *subkey)
 {
-    if (!mMumInfo.keyInitialized) 
+    if (!mMumInfo->keyInitialized) 
         return MUM_ERROR_KEY_NOT_INITIALIZED;
-    if (index >= MUM_NUM_SUBKEYS)
+    if (index >= mMumInfo->numSubkeys)
         return MUM_ERROR_SUBKEY_INDEX_OUTOFRANGE;
-    memcpy(subkey, mMumInfo.subkeys[index],MUM_KEY_SIZE);
+    memcpy(subkey, mMumInfo->subkeys[index],MUM_KEY_SIZE);
     return MUM_ERROR_OK;
 }
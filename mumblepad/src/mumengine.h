@@ -34,6 +34,7 @@
 #include "mumdefines.h"
 #include "mumprng.h"
 #include "mumrenderer.h"
+#include "mumkeycontext.h"
 #ifdef USE_MUM_OPENGL
 #include "mumglwrapper.h"
 #endif
@@ -41,14 +42,31 @@
 class CMumEngine
 {
 public:
-    CMumEngine(EMumEngineType engineType, EMumBlockType blockType, EMumPaddingType paddingType, uint32_t numThreads);
+    CMumEngine(EMumEngineType engineType, EMumBlockType blockType, EMumPaddingType paddingType, uint32_t numThreads, EMumPlacementType placement);
     ~CMumEngine();
+    // whether the engine was created with these arguments
+    bool Matches(EMumEngineType engineType, EMumBlockType blockType, EMumPaddingType paddingType, uint32_t numThreads, EMumPlacementType placement);
+    // back to the state of a new engine, for CMumEnginePool
+    void Recycle();
+    EMumEngineType GetEngineType() { return mMumInfo->engineType; }
     EMumError InitKey(uint8_t *key);
     EMumError LoadKey(char *keyfile);
     EMumError GetSubkey(uint32_t index, uint8_t *subkey);
     uint32_t PlaintextBlockSize();
     uint32_t EncryptedBlockSize();
     uint32_t EncryptedSize(uint32_t plaintextSize);
+    uint32_t GetCpuFeatures();
+    void SetCpuFeatures(uint32_t features);
+    uint32_t GetTileBlocks();
+    EMumError SetTileBlocks(uint32_t tileBlocks);
+    uint32_t GetLargeBufferSize();
+    void SetLargeBufferSize(uint32_t largeBufferSize);
+    uint32_t GetNumNodes();
+    EMumError GetNodeStats(uint32_t node, uint32_t *numWorkers, uint64_t *bytes, uint64_t *microseconds);
+    EMumError GetPriority(EMumPriority *priority);
+    EMumError SetPriority(EMumPriority priority);
+    EMumError GetInlineBlocks(uint32_t *inlineBlocks);
+    EMumError SetInlineBlocks(uint32_t inlineBlocks);
     EMumError EncryptBlock(uint8_t *src, uint8_t *dst, uint32_t length, uint32_t seqnum);
     EMumError DecryptBlock(uint8_t *src, uint8_t *dst, uint32_t *length, uint32_t *seqnum);
 
@@ -56,13 +74,30 @@ public:
     EMumError DecryptFile(char *srcfile, char *dstfile);
     EMumError Encrypt(uint8_t *src, uint8_t *dst, uint32_t length, uint32_t *outlength, uint16_t seqNum);
     EMumError Decrypt(uint8_t *src, uint8_t *dst, uint32_t length, uint32_t *outlength);
+    EMumError EncryptAsync(uint8_t *src, uint8_t *dst, uint32_t length, uint16_t seqNum,
+        MumCompletionCallback callback, void *userData, void **request);
+    EMumError DecryptAsync(uint8_t *src, uint8_t *dst, uint32_t length,
+        MumCompletionCallback callback, void *userData, void **request);
+    EMumError EncryptWithPriority(uint8_t *src, uint8_t *dst, uint32_t length, uint32_t *outlength, uint16_t seqNum,
+        EMumPriority priority);
+    EMumError DecryptWithPriority(uint8_t *src, uint8_t *dst, uint32_t length, uint32_t *outlength,
+        EMumPriority priority);
+    EMumError EncryptAsyncWithPriority(uint8_t *src, uint8_t *dst, uint32_t length, uint16_t seqNum, EMumPriority priority,
+        MumCompletionCallback callback, void *userData, void **request);
+    EMumError DecryptAsyncWithPriority(uint8_t *src, uint8_t *dst, uint32_t length, EMumPriority priority,
+        MumCompletionCallback callback, void *userData, void **request);
 
 private:
-    TMumInfo mMumInfo;
+    TMumInfo *mMumInfo;
     CMumRenderer *mMumRenderer;
-    uint32_t GetSubkeyInteger(uint8_t *subkey, uint32_t offset);
+    CMumKeyContext *mKeyContext;
+    uint32_t mNumThreads;
+    EMumPlacementType mPlacement;
+    void InitSettings();
+    EMumPriority DefaultPriority();
+    uint32_t GetSubkeyInteger(uint8_t *subkey, uint32_t subkeySize, uint32_t offset);
     void InitXorTextureData();
-    void CreatePermuteTable(uint8_t *subkey, uint32_t numEntries, uint32_t *outTable);
+    void CreatePermuteTable(uint8_t *subkey, uint32_t subkeySize, uint32_t numEntries, uint32_t *outTable);
     void CreatePrimeCycleWithOffset(uint32_t primeIndex, uint32_t offset, uint8_t *outCycle);
 
 #ifdef USE_MUM_OPENGL
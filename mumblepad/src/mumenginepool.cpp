@@ -0,0 +1,105 @@
+//////////////////////////////////////////////////////////////////////////
+//                                                                      //
+//   Mumblepad Block Cipher                                             //
+//   Version 1, completed March 14, 2017                                //
+//                                                                      //
+//   Key size 4096 bytes, 32768 bits                                    //
+//   Six different block sizes: 128, 256, 512, 1024, 2048, 4096 bytes   //
+//   Encryption and decryption, runs on either CPU and GPU              //
+//   May run multi-threaded on CPU.                                     //
+//   Runs on GPU with OpenGL or OpenGL ES 2.0                           //
+//                                                                      //
+//   Encrypted blocks containing same plaintext are different, due to   //
+//   small amount of per-block random number padding.                   //
+//   Encrypted block contains length, 16-bit sequence number, 32-bit    //
+//   checksum.                                                          //
+//   No block cipher mode required                                      //
+//   Can use parallel processing, multi-threaded encrypt/decrypt        //
+//                                                                      //
+//   8 rounds, 2 passes per round                                       //
+//   Encrypt: diffusion pass followed by confusion pass.                //
+//   Decrypt: inverse confusion followed by inverse diffusion.          //
+//                                                                      //
+//   Free for non-commercial use, analysis/evaluation.                  //
+//                                                                      //
+//   Copyright 2017, Kyle Granger                                       //
+//   Email contact:  kyle.granger@chello.at                             //
+//                                                                      //
+//////////////////////////////////////////////////////////////////////////
+
+
+
+#include "mumenginepool.h"
+
+
+std::mutex CMumEnginePool::sMutex;
+std::vector<CMumEngine *> CMumEnginePool::sIdle;
+uint32_t CMumEnginePool::sSize = 0;
+
+
+// The most recently used engine of the kind is taken, its memory the most
+// likely still in cache
+CMumEngine *CMumEnginePool::Take(EMumEngineType engineType, EMumBlockType blockType, EMumPaddingType paddingType,
+    uint32_t numThreads, EMumPlacementType placement)
+{
+    std::lock_guard<std::mutex> lock(sMutex);
+    for (size_t i = sIdle.size(); i-- > 0; )
+    {
+        CMumEngine *engine = sIdle[i];
+        if (engine->Matches(engineType, blockType, paddingType, numThreads, placement))
+        {
+            sIdle.erase(sIdle.begin() + i);
+            return engine;
+        }
+    }
+    return nullptr;
+}
+
+// The engine is recycled before it is kept, which waits for its
+// asynchronous requests as deleting it would
+bool CMumEnginePool::Give(CMumEngine *engine)
+{
+    switch (engine->GetEngineType())
+    {
+    case MUM_ENGINE_TYPE_CPU:
+    case MUM_ENGINE_TYPE_CPU_MT:
+    case MUM_ENGINE_TYPE_CPU_GENERIC:
+    case MUM_ENGINE_TYPE_CPU_JIT:
+        break;
+    default:
+        return false;
+    }
+    if (Size() == 0)
+        return false;
+
+    engine->Recycle();
+    std::lock_guard<std::mutex> lock(sMutex);
+    if (sIdle.size() >= sSize)
+        return false;
+    sIdle.push_back(engine);
+    return true;
+}
+
+uint32_t CMumEnginePool::Size()
+{
+    std::lock_guard<std::mutex> lock(sMutex);
+    return sSize;
+}
+
+// The engines are deleted outside the lock; the last MT engine of a
+// placement ends the pool's threads.
+void CMumEnginePool::SetSize(uint32_t size)
+{
+    std::vector<CMumEngine *> excess;
+    {
+        std::lock_guard<std::mutex> lock(sMutex);
+        sSize = size;
+        if (sIdle.size() > size)
+        {
+            excess.assign(sIdle.begin(), sIdle.end() - size);
+            sIdle.erase(sIdle.begin(), sIdle.end() - size);
+        }
+    }
+    for (size_t i = 0; i < excess.size(); i++)
+        delete excess[i];
+}
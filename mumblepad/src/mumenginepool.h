@@ -0,0 +1,61 @@
+//////////////////////////////////////////////////////////////////////////
+//                                                                      //
+//   Mumblepad Block Cipher                                             //
+//   Version 1, completed March 14, 2017                                //
+//                                                                      //
+//   Key size 4096 bytes, 32768 bits                                    //
+//   Six different block sizes: 128, 256, 512, 1024, 2048, 4096 bytes   //
+//   Encryption and decryption, runs on either CPU and GPU              //
+//   May run multi-threaded on CPU.                                     //
+//   Runs on GPU with OpenGL or OpenGL ES 2.0                           //
+//                                                                      //
+//   Encrypted blocks containing same plaintext are different, due to   //
+//   small amount of per-block random number padding.                   //
+//   Encrypted block contains length, 16-bit sequence number, 32-bit    //
+//   checksum.                                                          //
+//   No block cipher mode required                                      //
+//   Can use parallel processing, multi-threaded encrypt/decrypt        //
+//                                                                      //
+//   8 rounds, 2 passes per round                                       //
+//   Encrypt: diffusion pass followed by confusion pass.                //
+//   Decrypt: inverse confusion followed by inverse diffusion.          //
+//                                                                      //
+//   Free for non-commercial use, analysis/evaluation.                  //
+//                                                                      //
+//   Copyright 2017, Kyle Granger                                       //
+//   Email contact:  kyle.granger@chello.at                             //
+//                                                                      //
+//////////////////////////////////////////////////////////////////////////
+
+
+
+#ifndef MUMENGINEPOOL_H
+#define MUMENGINEPOOL_H
+
+#include <vector>
+#include <mutex>
+#include "mumengine.h"
+
+// Engines MumDestroyEngine has given back, kept for MumCreateEngine to
+// hand out again with their renderers, buffers, PRNGs and, for the MT
+// engines, their hold on the worker pool. Only CPU engines are kept, at
+// most Size() of them over all types; the pool is empty unless a size is
+// set.
+class CMumEnginePool {
+public:
+    // an idle engine created with these arguments, or nullptr
+    static CMumEngine *Take(EMumEngineType engineType, EMumBlockType blockType, EMumPaddingType paddingType,
+        uint32_t numThreads, EMumPlacementType placement);
+    // false if the engine is not kept, and is to be deleted
+    static bool Give(CMumEngine *engine);
+    static uint32_t Size();
+    // deletes the idle engines beyond the new size, oldest first
+    static void SetSize(uint32_t size);
+private:
+    static std::mutex sMutex;
+    // most recently given back last
+    static std::vector<CMumEngine *> sIdle;
+    static uint32_t sSize;
+};
+
+#endif
@@ -0,0 +1,296 @@
+//////////////////////////////////////////////////////////////////////////
+//                                                                      //
+//   Mumblepad Block Cipher                                             //
+//   Version 1, completed March 14, 2017                                //
+//                                                                      //
+//   Key size 4096 bytes, 32768 bits                                    //
+//   Six different block sizes: 128, 256, 512, 1024, 2048, 4096 bytes   //
+//   Encryption and decryption, runs on either CPU and GPU              //
+//   May run multi-threaded on CPU.                                     //
+//   Runs on GPU with OpenGL or OpenGL ES 2.0                           //
+//                                                                      //
+//   Encrypted blocks containing same plaintext are different, due to   //
+//   small amount of per-block random number padding.                   //
+//   Encrypted block contains length, 16-bit sequence number, 32-bit    //
+//   checksum.                                                          //
+//   No block cipher mode required                                      //
+//   Can use parallel processing, multi-threaded encrypt/decrypt        //
+//                                                                      //
+//   8 rounds, 2 passes per round                                       //
+//   Encrypt: diffusion pass followed by confusion pass.                //
+//   Decrypt: inverse confusion followed by inverse diffusion.          //
+//                                                                      //
+//   Free for non-commercial use, analysis/evaluation.                  //
+//                                                                      //
+//   Copyright 2017, Kyle Granger                                       //
+//   Email contact:  kyle.granger@chello.at                             //
+//                                                                      //
+//////////////////////////////////////////////////////////////////////////
+
+
+
+
+#include "mumjit.h"
+#include "string.h"
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define MUM_JIT_X64
+#endif
+
+// general purpose registers by encoding
+#define MUM_JIT_RCX   1
+#define MUM_JIT_RDX   2
+#define MUM_JIT_RSI   6
+#define MUM_JIT_RDI   7
+#define MUM_JIT_R8    8
+#define MUM_JIT_R9    9
+#define MUM_JIT_R10  10
+#define MUM_JIT_R11  11
+
+// the four source cells of four destination cells go through one register
+// each, so a group of four cells is one 16-byte store
+#define MUM_JIT_GROUP_CELLS   4
+// upper bounds of the code emitted per group and per pass outside the
+// groups, constant pool included
+#define MUM_JIT_GROUP_SIZE  320
+#define MUM_JIT_PASS_SIZE   256
+
+
+static uint32_t MumJitPageSize()
+{
+#if defined(_WIN32)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwPageSize;
+#else
+    return 4096;
+#endif
+}
+
+static void EmitDword(uint8_t *&p, uint32_t value)
+{
+    memcpy(p, &value, 4);
+    p += 4;
+}
+
+// mov dst, src on 32 or 64 bits; a 32-bit move clears the upper half
+static void EmitMov(uint8_t *&p, uint32_t dst, uint32_t src, bool wide)
+{
+    uint8_t rex = 0x40 | (wide ? 0x08 : 0) | ((src & 8) ? 0x04 : 0) | ((dst & 8) ? 0x01 : 0);
+    if (rex != 0x40)
+        *p++ = rex;
+    *p++ = 0x89;
+    *p++ = (uint8_t)(0xc0 | ((src & 7) << 3) | (dst & 7));
+}
+
+// SSE instruction with a [base + disp] operand: prefix, REX, opcode and
+// ModRM, with the shortest displacement. base is r8 or r9.
+static void EmitSseMem(uint8_t *&p, uint8_t prefix, const uint8_t *opcode, uint32_t opcodeSize,
+    uint32_t xmm, uint32_t base, uint32_t disp)
+{
+    *p++ = prefix;
+    *p++ = 0x41;
+    memcpy(p, opcode, opcodeSize);
+    p += opcodeSize;
+    if (disp < 0x80)
+    {
+        *p++ = (uint8_t)(0x40 | (xmm << 3) | (base & 7));
+        *p++ = (uint8_t)disp;
+    }
+    else
+    {
+        *p++ = (uint8_t)(0x80 | (xmm << 3) | (base & 7));
+        EmitDword(p, disp);
+    }
+}
+
+// SSE instruction with a 16-byte aligned RIP-relative constant
+static void EmitSseRip(uint8_t *&p, const uint8_t *opcode, uint32_t opcodeSize, uint32_t xmm, uint8_t *constant)
+{
+    *p++ = 0x66;
+    memcpy(p, opcode, opcodeSize);
+    p += opcodeSize;
+    *p++ = (uint8_t)(0x05 | (xmm << 3));
+    EmitDword(p, (uint32_t)(constant - (p + 4)));
+}
+
+
+CMumJit::CMumJit(uint32_t numRows)
+{
+    mNumRows = numRows;
+    mCodeSize = 0;
+    mAllocatedSize = 0;
+    mCode = nullptr;
+    memset(mEncryptDiffuse, 0, sizeof(mEncryptDiffuse));
+    memset(mDecryptDiffuse, 0, sizeof(mDecryptDiffuse));
+}
+
+CMumJit::~CMumJit()
+{
+    Free();
+}
+
+
+void CMumJit::Free()
+{
+    if (mCode == nullptr)
+        return;
+#if defined(_WIN32)
+    VirtualFree(mCode, 0, MEM_RELEASE);
+#else
+    munmap(mCode, mAllocatedSize);
+#endif
+    mCode = nullptr;
+    memset(mEncryptDiffuse, 0, sizeof(mEncryptDiffuse));
+    memset(mDecryptDiffuse, 0, sizeof(mDecryptDiffuse));
+}
+
+
+// The code is written to read-write pages which are then made read-execute,
+// so no page is ever writable and executable at once. A new key gets new
+// pages.
+bool CMumJit::Compile(TMumInfo *mumInfo)
+{
+    Free();
+#ifdef MUM_JIT_X64
+    static const uint32_t order[MUM_NUM_POSITIONS] = {
+        MUM_DIFFUSE_ORDER_1, MUM_DIFFUSE_ORDER_2, MUM_DIFFUSE_ORDER_3, MUM_DIFFUSE_ORDER_4 };
+    static const uint32_t orderI[MUM_NUM_POSITIONS] = {
+        MUM_DIFFUSE_ORDER_I1, MUM_DIFFUSE_ORDER_I2, MUM_DIFFUSE_ORDER_I3, MUM_DIFFUSE_ORDER_I4 };
+    uint32_t numGroups = mNumRows * MUM_CELLS_X / MUM_JIT_GROUP_CELLS;
+    uint32_t passSize = MUM_JIT_PASS_SIZE + numGroups * MUM_JIT_GROUP_SIZE;
+    uint32_t pageSize = MumJitPageSize();
+
+    mAllocatedSize = (2 * MUM_NUM_ROUNDS * passSize + pageSize - 1) & ~(pageSize - 1);
+#if defined(_WIN32)
+    mCode = (uint8_t *)VirtualAlloc(NULL, mAllocatedSize, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+    void *code = mmap(NULL, mAllocatedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    mCode = (code != MAP_FAILED) ? (uint8_t *)code : nullptr;
+#endif
+    if (mCode == nullptr)
+        return false;
+
+    uint8_t *p = mCode;
+    for (uint32_t round = 0; round < MUM_NUM_ROUNDS; round++)
+    {
+        TMumRoundContext *rc = mumInfo->rounds[round];
+        mEncryptDiffuse[round] = EmitDiffuse(p, rc, rc->offsets, order);
+        mDecryptDiffuse[round] = EmitDiffuse(p, rc, rc->offsetsI, orderI);
+    }
+    mCodeSize = (uint32_t)(p - mCode);
+
+#if defined(_WIN32)
+    DWORD oldProtect;
+    bool protect = VirtualProtect(mCode, mAllocatedSize, PAGE_EXECUTE_READ, &oldProtect) != 0;
+    FlushInstructionCache(GetCurrentProcess(), mCode, mAllocatedSize);
+#else
+    bool protect = mprotect(mCode, mAllocatedSize, PROT_READ | PROT_EXEC) == 0;
+#endif
+    if (!protect)
+    {
+        Free();
+        return false;
+    }
+    return true;
+#else
+    (void)mumInfo;
+    return false;
+#endif
+}
+
+
+// For a group of four destination cells, source position k of the four
+// cells is gathered into xmm k with movd and pinsrd, its bytes reordered
+// by pshufb and masked with pand; the four registers are OR-ed together
+// and stored. The masks are disjoint, so OR is the sum the table-driven
+// passes compute. Registers: r8 source block, r9 destination block, r10
+// blocks left, r11 block size.
+TMumDiffuseCode CMumJit::EmitDiffuse(uint8_t *&code, TMumRoundContext *rc, uint16_t *offsets, const uint32_t *order)
+{
+    static const uint8_t movd[] = { 0x0f, 0x6e };
+    static const uint8_t pinsrd[] = { 0x0f, 0x3a, 0x22 };
+    static const uint8_t pshufb[] = { 0x0f, 0x38, 0x00 };
+    static const uint8_t pand[] = { 0x0f, 0xdb };
+    static const uint8_t movdqu[] = { 0x0f, 0x7f };
+    uint32_t numCells = mNumRows * MUM_CELLS_X;
+    uint8_t *p = code;
+
+    // constant pool: the pshufb controls, then the masks, 16 bytes each
+    while ((uintptr_t)p & 15)
+        *p++ = 0xcc;
+    uint8_t *shuffles = p;
+    uint8_t *masks = p + MUM_NUM_POSITIONS * 16;
+    for (uint32_t k = 0; k < MUM_NUM_POSITIONS; k++)
+    {
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            shuffles[k * 16 + i] = (uint8_t)((i & ~3) + ((order[k] >> (8 * (i & 3))) & 0xff));
+            masks[k * 16 + i] = (uint8_t)rc->bitmasks[k];
+        }
+    }
+    p += 2 * MUM_NUM_POSITIONS * 16;
+    TMumDiffuseCode entry = (TMumDiffuseCode)p;
+
+    // arguments into r8..r11, the block count and size zero-extended
+#if defined(_WIN32)
+    EmitMov(p, MUM_JIT_R10, MUM_JIT_R8, false);
+    EmitMov(p, MUM_JIT_R11, MUM_JIT_R9, false);
+    EmitMov(p, MUM_JIT_R8, MUM_JIT_RCX, true);
+    EmitMov(p, MUM_JIT_R9, MUM_JIT_RDX, true);
+#else
+    EmitMov(p, MUM_JIT_R10, MUM_JIT_RDX, false);
+    EmitMov(p, MUM_JIT_R11, MUM_JIT_RCX, false);
+    EmitMov(p, MUM_JIT_R8, MUM_JIT_RDI, true);
+    EmitMov(p, MUM_JIT_R9, MUM_JIT_RSI, true);
+#endif
+    // test r10d, r10d; jz done
+    *p++ = 0x45; *p++ = 0x85; *p++ = 0xd2;
+    *p++ = 0x0f; *p++ = 0x84;
+    uint8_t *skip = p;
+    p += 4;
+
+    uint8_t *loop = p;
+    for (uint32_t n = 0; n < numCells; n += MUM_JIT_GROUP_CELLS)
+    {
+        for (uint32_t k = 0; k < MUM_NUM_POSITIONS; k++)
+        {
+            uint16_t *cellOffsets = offsets + k * numCells + n;
+            EmitSseMem(p, 0x66, movd, sizeof(movd), k, MUM_JIT_R8, cellOffsets[0]);
+            for (uint32_t c = 1; c < MUM_JIT_GROUP_CELLS; c++)
+            {
+                EmitSseMem(p, 0x66, pinsrd, sizeof(pinsrd), k, MUM_JIT_R8, cellOffsets[c]);
+                *p++ = (uint8_t)c;
+            }
+        }
+        for (uint32_t k = 0; k < MUM_NUM_POSITIONS; k++)
+        {
+            EmitSseRip(p, pshufb, sizeof(pshufb), k, shuffles + k * 16);
+            EmitSseRip(p, pand, sizeof(pand), k, masks + k * 16);
+        }
+        // por xmm0, xmm1; por xmm2, xmm3; por xmm0, xmm2
+        *p++ = 0x66; *p++ = 0x0f; *p++ = 0xeb; *p++ = 0xc1;
+        *p++ = 0x66; *p++ = 0x0f; *p++ = 0xeb; *p++ = 0xd3;
+        *p++ = 0x66; *p++ = 0x0f; *p++ = 0xeb; *p++ = 0xc2;
+        EmitSseMem(p, 0xf3, movdqu, sizeof(movdqu), 0, MUM_JIT_R9, n * MUM_CELL_SIZE);
+    }
+
+    // add r8, r11; add r9, r11; dec r10d; jnz loop
+    *p++ = 0x4d; *p++ = 0x01; *p++ = 0xd8;
+    *p++ = 0x4d; *p++ = 0x01; *p++ = 0xd9;
+    *p++ = 0x41; *p++ = 0xff; *p++ = 0xca;
+    *p++ = 0x0f; *p++ = 0x85;
+    EmitDword(p, (uint32_t)(loop - (p + 4)));
+    uint32_t skipDistance = (uint32_t)(p - (skip + 4));
+    memcpy(skip, &skipDistance, 4);
+    // ret
+    *p++ = 0xc3;
+
+    code = p;
+    return entry;
+}
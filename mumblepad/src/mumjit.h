@@ -0,0 +1,74 @@
+//////////////////////////////////////////////////////////////////////////
+//                                                                      //
+//   Mumblepad Block Cipher                                             //
+//   Version 1, completed March 14, 2017                                //
+//                                                                      //
+//   Key size 4096 bytes, 32768 bits                                    //
+//   Six different block sizes: 128, 256, 512, 1024, 2048, 4096 bytes   //
+//   Encryption and decryption, runs on either CPU and GPU              //
+//   May run multi-threaded on CPU.                                     //
+//   Runs on GPU with OpenGL or OpenGL ES 2.0                           //
+//                                                                      //
+//   Encrypted blocks containing same plaintext are different, due to   //
+//   small amount of per-block random number padding.                   //
+//   Encrypted block contains length, 16-bit sequence number, 32-bit    //
+//   checksum.                                                          //
+//   No block cipher mode required                                      //
+//   Can use parallel processing, multi-threaded encrypt/decrypt        //
+//                                                                      //
+//   8 rounds, 2 passes per round                                       //
+//   Encrypt: diffusion pass followed by confusion pass.                //
+//   Decrypt: inverse confusion followed by inverse diffusion.          //
+//                                                                      //
+//   Free for non-commercial use, analysis/evaluation.                  //
+//                                                                      //
+//   Copyright 2017, Kyle Granger                                       //
+//   Email contact:  kyle.granger@chello.at                             //
+//                                                                      //
+//////////////////////////////////////////////////////////////////////////
+
+
+
+
+#ifndef MUMJIT_H
+#define MUMJIT_H
+
+#include "mumdefines.h"
+
+// A diffusion pass over numBlocks blocks stored blockSize bytes apart.
+typedef void (*TMumDiffuseCode)(uint8_t *src, uint8_t *dst, uint32_t numBlocks, uint32_t blockSize);
+
+// x86-64 code for the diffusion passes of one key. The source offsets of
+// every cell and the round's masks are known once the key schedule is
+// complete, so each round's diffuse and inverse diffuse pass is emitted
+// as straight-line code with the offsets as displacements and the masks
+// in a constant pool, instead of reading TMumRoundContext::offsets per
+// cell. The generated code uses SSSE3 and SSE4.1, and only registers that
+// are volatile in both the Windows and System V calling conventions.
+class CMumJit
+{
+public:
+    CMumJit(uint32_t numRows);
+    ~CMumJit();
+    // Generates the passes for a TMumInfo whose rounds are initialized.
+    // Returns false when the host is not x86-64 or the executable memory
+    // can't be had; the table-driven passes must be used then.
+    bool Compile(TMumInfo *mumInfo);
+    bool Compiled() { return mCode != nullptr; }
+    TMumDiffuseCode EncryptDiffuse(uint32_t round) { return mEncryptDiffuse[round]; }
+    TMumDiffuseCode DecryptDiffuse(uint32_t round) { return mDecryptDiffuse[round]; }
+    uint32_t CodeSize() { return mCodeSize; }
+
+private:
+    // Emits one pass at code and advances it; returns the entry point.
+    TMumDiffuseCode EmitDiffuse(uint8_t *&code, TMumRoundContext *rc, uint16_t *offsets, const uint32_t *order);
+    void Free();
+    uint32_t mNumRows;
+    uint32_t mCodeSize;
+    uint32_t mAllocatedSize;
+    uint8_t *mCode;
+    TMumDiffuseCode mEncryptDiffuse[MUM_NUM_ROUNDS];
+    TMumDiffuseCode mDecryptDiffuse[MUM_NUM_ROUNDS];
+};
+
+#endif
@@ -0,0 +1,257 @@
+//////////////////////////////////////////////////////////////////////////
+//                                                                      //
+//   Mumblepad Block Cipher                                             //
+//   Version 1, completed March 14, 2017                                //
+//                                                                      //
+//   Key size 4096 bytes, 32768 bits                                    //
+//   Six different block sizes: 128, 256, 512, 1024, 2048, 4096 bytes   //
+//   Encryption and decryption, runs on either CPU and GPU              //
+//   May run multi-threaded on CPU.                                     //
+//   Runs on GPU with OpenGL or OpenGL ES 2.0                           //
+//                                                                      //
+//   Encrypted blocks containing same plaintext are different, due to   //
+//   small amount of per-block random number padding.                   //
+//   Encrypted block contains length, 16-bit sequence number, 32-bit    //
+//   checksum.                                                          //
+//   No block cipher mode required                                      //
+//   Can use parallel processing, multi-threaded encrypt/decrypt        //
+//                                                                      //
+//   8 rounds, 2 passes per round                                       //
+//   Encrypt: diffusion pass followed by confusion pass.                //
+//   Decrypt: inverse confusion followed by inverse diffusion.          //
+//                                                                      //
+//   Free for non-commercial use, analysis/evaluation.                  //
+//                                                                      //
+//   Copyright 2017, Kyle Granger                                       //
+//   Email contact:  kyle.granger@chello.at                             //
+//                                                                      //
+//////////////////////////////////////////////////////////////////////////
+
+
+
+#include "mumkeycontext.h"
+#include "mumplatform.h"
+#include "string.h"
+#include "stdlib.h"
+#if defined(_WIN32)
+#include <windows.h>
+#include <malloc.h>
+#else
+#include <sys/mman.h>
+#endif
+
+
+static uint32_t MumAlignSize(uint32_t size, uint32_t alignment)
+{
+    return (size + alignment - 1) & ~(alignment - 1);
+}
+
+
+// Lays out the rounds one after the other. Within a round the tables used
+// by encryption come first, then those used by decryption.
+CMumKeyContext::CMumKeyContext(uint32_t numRows)
+{
+    uint32_t numCells = numRows * MUM_CELLS_X;
+    uint32_t blockSize = numCells * MUM_CELL_SIZE;
+    uint32_t headerSize = MumAlignSize(sizeof(TMumRoundContext), MUM_CACHE_LINE_SIZE);
+    uint32_t subkeySize = MumAlignSize(blockSize, MUM_CACHE_LINE_SIZE);
+    uint32_t permuteSize = MumAlignSize(numRows * MUM_NUM_8BIT_VALUES, MUM_CACHE_LINE_SIZE);
+    uint32_t offsetsSize = MumAlignSize(MUM_NUM_POSITIONS * numCells * sizeof(uint16_t), MUM_CACHE_LINE_SIZE);
+    uint32_t bytePermutesSize = 0;
+    uint32_t roundSize;
+
+    if (blockSize <= MUM_SMALL_BLOCK_SIZE)
+        bytePermutesSize = MumAlignSize(MUM_NUM_POSITIONS * blockSize, MUM_CACHE_LINE_SIZE);
+    roundSize = headerSize + subkeySize + 2 * (permuteSize + offsetsSize + bytePermutesSize);
+
+    mNumRows = numRows;
+    mRoundSize = roundSize;
+    mSize = MUM_NUM_ROUNDS * roundSize;
+    Allocate();
+    memset(mData, 0, mSize);
+
+    for (uint32_t round = 0; round < MUM_NUM_ROUNDS; round++)
+    {
+        uint8_t *data = mData + round * roundSize;
+        TMumRoundContext *rc = (TMumRoundContext *)data;
+        data += headerSize;
+        rc->subkey = data;
+        data += subkeySize;
+        rc->permute = data;
+        data += permuteSize;
+        rc->offsets = (uint16_t *)data;
+        data += offsetsSize;
+        rc->bytePermutes = bytePermutesSize ? data : nullptr;
+        data += bytePermutesSize;
+        rc->permuteI = data;
+        data += permuteSize;
+        rc->offsetsI = (uint16_t *)data;
+        data += offsetsSize;
+        rc->bytePermutesI = bytePermutesSize ? data : nullptr;
+        mRounds[round] = rc;
+    }
+}
+
+
+CMumKeyContext::~CMumKeyContext()
+{
+    Free();
+}
+
+
+// Contexts of MUM_HUGE_PAGE_MIN_SIZE and more are rounded up to whole 2 MB
+// pages. Explicit huge pages are tried first (MAP_HUGETLB, or
+// MEM_LARGE_PAGES which needs SeLockMemoryPrivilege); otherwise the memory
+// is 2 MB aligned and marked for transparent huge pages where the system
+// has them. Smaller contexts are only cache line aligned, they take a few
+// 4 KB pages anyway.
+void CMumKeyContext::Allocate()
+{
+    uint32_t alignment = MUM_CACHE_LINE_SIZE;
+
+    mData = nullptr;
+    mMapped = false;
+    mHugePages = false;
+    mAllocatedSize = MumAlignSize(mSize, MUM_CACHE_LINE_SIZE);
+
+    if (mSize >= MUM_HUGE_PAGE_MIN_SIZE)
+    {
+        mAllocatedSize = MumAlignSize(mSize, MUM_HUGE_PAGE_SIZE);
+#if defined(_WIN32)
+        SIZE_T largePage = GetLargePageMinimum();
+        if (largePage != 0 && mAllocatedSize % largePage == 0)
+            mData = (uint8_t *)VirtualAlloc(NULL, mAllocatedSize, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+#elif defined(MAP_HUGETLB)
+        void *data = mmap(NULL, mAllocatedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (data != MAP_FAILED)
+            mData = (uint8_t *)data;
+#endif
+        if (mData != nullptr)
+        {
+            mMapped = true;
+            mHugePages = true;
+            return;
+        }
+        alignment = MUM_HUGE_PAGE_SIZE;
+    }
+
+#if defined(_WIN32)
+    mData = (uint8_t *)_aligned_malloc(mAllocatedSize, alignment);
+#else
+    void *data = nullptr;
+    if (posix_memalign(&data, alignment, mAllocatedSize) == 0)
+        mData = (uint8_t *)data;
+#if defined(MADV_HUGEPAGE)
+    if (mData != nullptr && alignment == MUM_HUGE_PAGE_SIZE)
+        mHugePages = (madvise(mData, mAllocatedSize, MADV_HUGEPAGE) == 0);
+#endif
+#endif
+}
+
+
+void CMumKeyContext::Free()
+{
+    if (mData == nullptr)
+        return;
+#if defined(_WIN32)
+    if (mMapped)
+        VirtualFree(mData, 0, MEM_RELEASE);
+    else
+        _aligned_free(mData);
+#else
+    if (mMapped)
+        munmap(mData, mAllocatedSize);
+    else
+        free(mData);
+#endif
+    mData = nullptr;
+}
+
+
+// The tables of every round, after its header; the header's pointers
+// stay, its bitmasks are cleared
+void CMumKeyContext::Wipe()
+{
+    for (uint32_t round = 0; round < MUM_NUM_ROUNDS; round++)
+    {
+        TMumRoundContext *rc = mRounds[round];
+        uint32_t headerSize = (uint32_t)(rc->subkey - (uint8_t *)rc);
+        MumWipe(rc->bitmasks, sizeof(rc->bitmasks));
+        MumWipe(rc->subkey, mRoundSize - headerSize);
+    }
+}
+
+
+void MumWipeKeyTables(TMumInfo *mumInfo)
+{
+    MumWipe(mumInfo->key, sizeof(mumInfo->key));
+    MumWipe(mumInfo->permuteTables3bit, sizeof(mumInfo->permuteTables3bit));
+    MumWipe(mumInfo->permuteTables11bit, sizeof(mumInfo->permuteTables11bit));
+    MumWipe(mumInfo->bitmasks, sizeof(mumInfo->bitmasks));
+    MumWipe(mumInfo->bitmaskTextureData, sizeof(mumInfo->bitmaskTextureData));
+    MumWipe(mumInfo->positionTextureDataX, sizeof(mumInfo->positionTextureDataX));
+    MumWipe(mumInfo->positionTextureDataY, sizeof(mumInfo->positionTextureDataY));
+    MumWipe(mumInfo->positionTextureDataYB, sizeof(mumInfo->positionTextureDataYB));
+    MumWipe(mumInfo->positionTextureDataXI, sizeof(mumInfo->positionTextureDataXI));
+    MumWipe(mumInfo->positionTextureDataYI, sizeof(mumInfo->positionTextureDataYI));
+    MumWipe(mumInfo->positionTextureDataYIB, sizeof(mumInfo->positionTextureDataYIB));
+}
+
+
+void CMumKeyContext::Init(TMumInfo *mumInfo)
+{
+    uint32_t round, position, n, i, y;
+    uint32_t numCells = mNumRows * MUM_CELLS_X;
+    uint32_t order[MUM_NUM_POSITIONS] = { MUM_DIFFUSE_ORDER_1, MUM_DIFFUSE_ORDER_2, MUM_DIFFUSE_ORDER_3, MUM_DIFFUSE_ORDER_4 };
+    uint32_t orderI[MUM_NUM_POSITIONS] = { MUM_DIFFUSE_ORDER_I1, MUM_DIFFUSE_ORDER_I2, MUM_DIFFUSE_ORDER_I3, MUM_DIFFUSE_ORDER_I4 };
+
+    for ( round = 0; round < MUM_NUM_ROUNDS; round++ )
+    {
+        TMumRoundContext *rc = mRounds[round];
+
+        memcpy(rc->bitmasks, mumInfo->bitmasks[round], sizeof(rc->bitmasks));
+        if (numCells * MUM_CELL_SIZE <= MUM_KEY_SIZE)
+        {
+            memcpy(rc->subkey, mumInfo->subkeys[round], numCells * MUM_CELL_SIZE);
+        }
+        else
+        {
+            // 8192-byte block: the round's subkey, then its extension subkey
+            memcpy(rc->subkey, mumInfo->subkeys[round], MUM_KEY_SIZE);
+            memcpy(rc->subkey + MUM_KEY_SIZE, mumInfo->subkeys[MUM_SUBKEY_INDEX_XOR_EXT + round], numCells * MUM_CELL_SIZE - MUM_KEY_SIZE);
+        }
+        for ( y = 0; y < mNumRows; y++ )
+        {
+            memcpy(rc->permute + y * MUM_NUM_8BIT_VALUES, mumInfo->permuteTextureData[round * mumInfo->numPermuteRows + y], MUM_NUM_8BIT_VALUES);
+            memcpy(rc->permuteI + y * MUM_NUM_8BIT_VALUES, mumInfo->permuteTextureDataI[round * mumInfo->numPermuteRows + y], MUM_NUM_8BIT_VALUES);
+        }
+
+        for ( position = 0; position < MUM_NUM_POSITIONS; position++ )
+        {
+            uint16_t *offsets = rc->offsets + position * numCells;
+            uint16_t *offsetsI = rc->offsetsI + position * numCells;
+            for ( n = 0; n < numCells; n++ )
+            {
+                uint32_t value = mumInfo->permuteTables11bit[round][position][n];
+                offsets[n] = (uint16_t)(value * MUM_CELL_SIZE);
+                offsetsI[value] = (uint16_t)(n * MUM_CELL_SIZE);
+            }
+
+            // small blocks: the cell offsets expanded to byte offsets, so the
+            // whole diffusion of one position is a single byte permutation
+            if (rc->bytePermutes == nullptr)
+                continue;
+            uint8_t *bytePermutes = rc->bytePermutes + position * numCells * MUM_CELL_SIZE;
+            uint8_t *bytePermutesI = rc->bytePermutesI + position * numCells * MUM_CELL_SIZE;
+            for ( n = 0; n < numCells; n++ )
+            {
+                for ( i = 0; i < MUM_CELL_SIZE; i++ )
+                {
+                    bytePermutes[n * MUM_CELL_SIZE + i] = (uint8_t)(offsets[n] + ((order[position] >> (i * 8)) & 0xff));
+                    bytePermutesI[n * MUM_CELL_SIZE + i] = (uint8_t)(offsetsI[n] + ((orderI[position] >> (i * 8)) & 0xff));
+                }
+            }
+        }
+        mumInfo->rounds[round] = rc;
+    }
+}
@@ -0,0 +1,74 @@
+//////////////////////////////////////////////////////////////////////////
+//                                                                      //
+//   Mumblepad Block Cipher                                             //
+//   Version 1, completed March 14, 2017                                //
+//                                                                      //
+//   Key size 4096 bytes, 32768 bits                                    //
+//   Six different block sizes: 128, 256, 512, 1024, 2048, 4096 bytes   //
+//   Encryption and decryption, runs on either CPU and GPU              //
+//   May run multi-threaded on CPU.                                     //
+//   Runs on GPU with OpenGL or OpenGL ES 2.0                           //
+//                                                                      //
+//   Encrypted blocks containing same plaintext are different, due to   //
+//   small amount of per-block random number padding.                   //
+//   Encrypted block contains length, 16-bit sequence number, 32-bit    //
+//   checksum.                                                          //
+//   No block cipher mode required                                      //
+//   Can use parallel processing, multi-threaded encrypt/decrypt        //
+//                                                                      //
+//   8 rounds, 2 passes per round                                       //
+//   Encrypt: diffusion pass followed by confusion pass.                //
+//   Decrypt: inverse confusion followed by inverse diffusion.          //
+//                                                                      //
+//   Free for non-commercial use, analysis/evaluation.                  //
+//                                                                      //
+//   Copyright 2017, Kyle Granger                                       //
+//   Email contact:  kyle.granger@chello.at                             //
+//                                                                      //
+//////////////////////////////////////////////////////////////////////////
+
+
+
+#ifndef MUMKEYCONTEXT_H
+#define MUMKEYCONTEXT_H
+
+#include "mumdefines.h"
+
+// The key schedule as the CPU renderers read it. TMumInfo sizes every
+// table for MUM_CELLS_MAX_Y rows; the key context holds only the rows of
+// the engine's block type, and each round's tables sit together after its
+// TMumRoundContext header, so a round touches one contiguous region.
+// Large contexts are backed by huge pages to save TLB entries.
+class CMumKeyContext
+{
+public:
+    CMumKeyContext(uint32_t numRows);
+    ~CMumKeyContext();
+    // Fills the tables from a TMumInfo whose key schedule is complete and
+    // points mumInfo->rounds at them.
+    void Init(TMumInfo *mumInfo);
+    // Clears the tables, before Init with another key
+    void Wipe();
+    TMumRoundContext *Round(uint32_t round) { return mRounds[round]; }
+    uint32_t Size() { return mSize; }
+    bool HugePages() { return mHugePages; }
+
+private:
+    void Allocate();
+    void Free();
+    uint32_t mNumRows;
+    uint32_t mSize;
+    uint32_t mRoundSize;
+    uint32_t mAllocatedSize;
+    bool mHugePages;
+    bool mMapped;
+    uint8_t *mData;
+    TMumRoundContext *mRounds[MUM_NUM_ROUNDS];
+};
+
+// Clears the key of a TMumInfo and the tables derived from it, except the
+// subkeys and the 8-bit tables, which the MT renderer's node copies share
+// with the engine
+extern void MumWipeKeyTables(TMumInfo *mumInfo);
+
+#endif
@@ -0,0 +1,64 @@
+//////////////////////////////////////////////////////////////////////////
+//                                                                      //
+//   Mumblepad Block Cipher                                             //
+//   Version 1, completed March 14, 2017                                //
+//                                                                      //
+//   Key size 4096 bytes, 32768 bits                                    //
+//   Six different block sizes: 128, 256, 512, 1024, 2048, 4096 bytes   //
+//   Encryption and decryption, runs on either CPU and GPU              //
+//   May run multi-threaded on CPU.                                     //
+//   Runs on GPU with OpenGL or OpenGL ES 2.0                           //
+//                                                                      //
+//   Encrypted blocks containing same plaintext are different, due to   //
+//   small amount of per-block random number padding.                   //
+//   Encrypted block contains length, 16-bit sequence number, 32-bit    //
+//   checksum.                                                          //
+//   No block cipher mode required                                      //
+//   Can use parallel processing, multi-threaded encrypt/decrypt        //
+//                                                                      //
+//   8 rounds, 2 passes per round                                       //
+//   Encrypt: diffusion pass followed by confusion pass.                //
+//   Decrypt: inverse confusion followed by inverse diffusion.          //
+//                                                                      //
+//   Free for non-commercial use, analysis/evaluation.                  //
+//                                                                      //
+//   Copyright 2017, Kyle Granger                                       //
+//   Email contact:  kyle.granger@chello.at                             //
+//                                                                      //
+//////////////////////////////////////////////////////////////////////////
+
+
+
+#ifndef MUMPLATFORM_H
+#define MUMPLATFORM_H
+
+#include <stdio.h>
+#include <string.h>
+
+// The bounds-checked stdio functions of the MSVC runtime, for the other
+// compilers; only the forms the library uses.
+#if !defined(_MSC_VER)
+static inline int fopen_s(FILE **file, const char *filename, const char *mode)
+{
+    *file = fopen(filename, mode);
+    return (*file != NULL) ? 0 : 1;
+}
+#define sprintf_s snprintf
+#define printf_s printf
+#endif
+
+// Clears memory that held key material. A plain memset of memory that is
+// not read again may be dropped by the compiler; here it may not.
+static inline void MumWipe(void *data, size_t size)
+{
+#if defined(__GNUC__)
+    memset(data, 0, size);
+    __asm__ __volatile__("" : : "r"(data) : "memory");
+#else
+    volatile unsigned char *bytes = (volatile unsigned char *)data;
+    while (size-- > 0)
+        *bytes++ = 0;
+#endif
+}
+
+#endif
@@ -33,11 +33,14 @@
 #include "stdio.h"
 #include "stdlib.h"
 #include "mumprng.h"
+#include "mumplatform.h"
 
 
 
-CMumPrng::CMumPrng(uint8_t *subkeyData)
+CMumPrng::CMumPrng(uint8_t *subkeyData, uint32_t stream)
 {
+    assert(stream < MUM_PRNG_NUM_STREAMS);
+    mStream = stream;
     memcpy(mSubkeyData, subkeyData, MUM_PRNG_SUBKEY_SIZE);
     memset(mReadyData, 0, MUM_PRNG_SUBKEY_SIZE);
     mReadIndex = 0;
@@ -45,8 +48,12 @@ CMumPrng::CMumPrng(uint8_t *subkeyData)
     Regenerate();
 }
 
+// its state and its copy of the subkeys come from the key
 CMumPrng::~CMumPrng()
 {
+    MumWipe(mState, sizeof(mState));
+    MumWipe(mSubkeyData, sizeof(mSubkeyData));
+    MumWipe(mReadyData, sizeof(mReadyData));
 }
 
 
@@ -67,8 +74,9 @@ void CMumPrng::Init()
         mState[i] = i;
 
     // our subkey area is 64KB -- for the state initialization we will
-    // use a 256-byte from there, 89 bytes before the end.
-    uint8_t *prngKey = &mSubkeyData[MUM_PRNG_SUBKEY_SIZE - 256 - 89];
+    // use a 256-byte from there, 89 bytes before the end for stream 0,
+    // each further stream the 256 bytes before the previous one.
+    uint8_t *prngKey = &mSubkeyData[MUM_PRNG_SUBKEY_SIZE - 256 - 89 - mStream * 256];
     uint32_t j = 0;
     for (int i = 0; i < 256; i++)
     {
@@ -89,9 +97,9 @@ void CMumPrng::Fetch(uint8_t *dst, uint32_t size)
 void CMumPrng::XorWithSubkey()
 {
     uint32_t *src = (uint32_t*) mReadyData;
-    uint32_t *xor = (uint32_t*) mSubkeyData;
+    uint32_t *subkey = (uint32_t*) mSubkeyData;
     for (uint32_t i = 0; i < MUM_PRNG_SUBKEY_SIZE / 4; i++)
-        *src++ ^= *xor++;
+        *src++ ^= *subkey++;
 }
 
 void CMumPrng::Regenerate()
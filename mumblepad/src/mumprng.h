@@ -34,6 +34,11 @@
 #include "mumdefines.h"
 
 #define MUM_PRNG_SUBKEY_SIZE   (MUM_KEY_SIZE*16)
+// subkey areas of MUM_PRNG_SUBKEY_SIZE from MUM_PRNG_SUBKEY_INDEX on
+#define MUM_PRNG_NUM_AREAS     16
+// Streams per subkey area: stream s keys RC4 from the 256 bytes that end
+// 89 + s * 256 bytes before the end of the area, so no two share a byte
+#define MUM_PRNG_NUM_STREAMS   ((MUM_PRNG_SUBKEY_SIZE - 89) / 256)
 #define MUM_PRNG_SEED1 0xb11924e1
 #define MUM_PRNG_SEED2 0x6d73e55f
 
@@ -41,7 +46,7 @@
 class CMumPrng
 {
 public:
-    CMumPrng(uint8_t *subkeyData);
+    CMumPrng(uint8_t *subkeyData, uint32_t stream);
     ~CMumPrng();
     void Fetch(uint8_t *dst, uint32_t size);
 
@@ -54,6 +59,7 @@ private:
     uint32_t mA;
     uint32_t mB;
     uint32_t mReadIndex;
+    uint32_t mStream;
     uint8_t mSubkeyData[MUM_PRNG_SUBKEY_SIZE];
     uint8_t mReadyData[MUM_PRNG_SUBKEY_SIZE];
 
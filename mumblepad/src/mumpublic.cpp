@@ -30,7 +30,11 @@
 
 #include "mumpublic.h"
 #include "mumengine.h"
+#include "mumenginepool.h"
+#include "mumrequest.h"
+#include "mumplatform.h"
 #include "stdio.h"
+#include "string.h"
 #include "assert.h"
 
 
@@ -50,7 +54,20 @@ EMumError MumEncryptedSize(void *mev, uint32_t plaintextSize, uint32_t *encrypte
 void MumDestroyEngine(void *mev)
 {
     CMumEngine *me = (CMumEngine *)mev;
-    delete me;
+    if (!CMumEnginePool::Give(me))
+        delete me;
+}
+
+EMumError MumGetEnginePoolSize(uint32_t *maxIdleEngines)
+{
+    *maxIdleEngines = CMumEnginePool::Size();
+    return MUM_ERROR_OK;
+}
+
+EMumError MumSetEnginePoolSize(uint32_t maxIdleEngines)
+{
+    CMumEnginePool::SetSize(maxIdleEngines);
+    return MUM_ERROR_OK;
 }
 
 EMumError MumPlaintextBlockSize(void *mev, uint32_t *plaintextBlockSize)
@@ -68,6 +85,86 @@ EMumError MumEncryptedBlockSize(void *mev, uint32_t *encryptedBlockSize)
     return MUM_ERROR_OK;
 }
 
+EMumError MumGetCpuFeatures(void *mev, uint32_t *features)
+{
+    CMumEngine *me = (CMumEngine *)mev;
+    *features = me->GetCpuFeatures();
+    return MUM_ERROR_OK;
+}
+
+
+EMumError MumSetCpuFeatures(void *mev, uint32_t features)
+{
+    CMumEngine *me = (CMumEngine *)mev;
+    me->SetCpuFeatures(features);
+    return MUM_ERROR_OK;
+}
+
+EMumError MumGetTileBlocks(void *mev, uint32_t *tileBlocks)
+{
+    CMumEngine *me = (CMumEngine *)mev;
+    *tileBlocks = me->GetTileBlocks();
+    return MUM_ERROR_OK;
+}
+
+EMumError MumSetTileBlocks(void *mev, uint32_t tileBlocks)
+{
+    CMumEngine *me = (CMumEngine *)mev;
+    return me->SetTileBlocks(tileBlocks);
+}
+
+EMumError MumGetLargeBufferSize(void *mev, uint32_t *largeBufferSize)
+{
+    CMumEngine *me = (CMumEngine *)mev;
+    *largeBufferSize = me->GetLargeBufferSize();
+    return MUM_ERROR_OK;
+}
+
+EMumError MumSetLargeBufferSize(void *mev, uint32_t largeBufferSize)
+{
+    CMumEngine *me = (CMumEngine *)mev;
+    me->SetLargeBufferSize(largeBufferSize);
+    return MUM_ERROR_OK;
+}
+
+
+EMumError MumGetNumNodes(void *mev, uint32_t *numNodes)
+{
+    CMumEngine *me = (CMumEngine *)mev;
+    *numNodes = me->GetNumNodes();
+    return MUM_ERROR_OK;
+}
+
+EMumError MumGetNodeStats(void *mev, uint32_t node, uint32_t *numWorkers, uint64_t *bytes, uint64_t *microseconds)
+{
+    CMumEngine *me = (CMumEngine *)mev;
+    return me->GetNodeStats(node, numWorkers, bytes, microseconds);
+}
+
+EMumError MumGetPriority(void *mev, EMumPriority *priority)
+{
+    CMumEngine *me = (CMumEngine *)mev;
+    return me->GetPriority(priority);
+}
+
+EMumError MumSetPriority(void *mev, EMumPriority priority)
+{
+    CMumEngine *me = (CMumEngine *)mev;
+    return me->SetPriority(priority);
+}
+
+EMumError MumGetInlineBlocks(void *mev, uint32_t *inlineBlocks)
+{
+    CMumEngine *me = (CMumEngine *)mev;
+    return me->GetInlineBlocks(inlineBlocks);
+}
+
+EMumError MumSetInlineBlocks(void *mev, uint32_t inlineBlocks)
+{
+    CMumEngine *me = (CMumEngine *)mev;
+    return me->SetInlineBlocks(inlineBlocks);
+}
+
 
 EMumError MumInitKey(void *mev, uint8_t *key)
 {
@@ -109,6 +206,67 @@ EMumError MumDecrypt(void *mev, uint8_t *src, uint8_t *dst, uint32_t length, uin
 }
 
 
+EMumError MumEncryptAsync(void *mev, uint8_t *src, uint8_t *dst, uint32_t length, uint16_t seqNum,
+    MumCompletionCallback callback, void *userData, void **request)
+{
+    CMumEngine *me = (CMumEngine *)mev;
+    return me->EncryptAsync(src, dst, length, seqNum, callback, userData, request);
+}
+
+EMumError MumDecryptAsync(void *mev, uint8_t *src, uint8_t *dst, uint32_t length,
+    MumCompletionCallback callback, void *userData, void **request)
+{
+    CMumEngine *me = (CMumEngine *)mev;
+    return me->DecryptAsync(src, dst, length, callback, userData, request);
+}
+
+EMumError MumEncryptWithPriority(void *mev, uint8_t *src, uint8_t *dst, uint32_t length, uint32_t *outlength, uint16_t seqNum,
+    EMumPriority priority)
+{
+    CMumEngine *me = (CMumEngine *)mev;
+    return me->EncryptWithPriority(src, dst, length, outlength, seqNum, priority);
+}
+
+EMumError MumDecryptWithPriority(void *mev, uint8_t *src, uint8_t *dst, uint32_t length, uint32_t *outlength,
+    EMumPriority priority)
+{
+    CMumEngine *me = (CMumEngine *)mev;
+    return me->DecryptWithPriority(src, dst, length, outlength, priority);
+}
+
+EMumError MumEncryptAsyncWithPriority(void *mev, uint8_t *src, uint8_t *dst, uint32_t length, uint16_t seqNum,
+    EMumPriority priority, MumCompletionCallback callback, void *userData, void **request)
+{
+    CMumEngine *me = (CMumEngine *)mev;
+    return me->EncryptAsyncWithPriority(src, dst, length, seqNum, priority, callback, userData, request);
+}
+
+EMumError MumDecryptAsyncWithPriority(void *mev, uint8_t *src, uint8_t *dst, uint32_t length,
+    EMumPriority priority, MumCompletionCallback callback, void *userData, void **request)
+{
+    CMumEngine *me = (CMumEngine *)mev;
+    return me->DecryptAsyncWithPriority(src, dst, length, priority, callback, userData, request);
+}
+
+EMumError MumPollRequest(void *request)
+{
+    CMumRequest *mr = (CMumRequest *)request;
+    return mr->Poll();
+}
+
+EMumError MumWaitRequest(void *request, uint32_t *outlength)
+{
+    CMumRequest *mr = (CMumRequest *)request;
+    return mr->Wait(outlength);
+}
+
+void MumDestroyRequest(void *request)
+{
+    CMumRequest *mr = (CMumRequest *)request;
+    delete mr;
+}
+
+
 EMumError MumEncryptBlock(void *mev, uint8_t *src, uint8_t *dst, uint32_t length, uint32_t seqnum)
 {
     CMumEngine *me = (CMumEngine *)mev;
@@ -130,16 +288,35 @@ EMumError MumGetSubkey(void *mev, uint32_t index, uint8_t *subkey)
 
 void *MumCreateEngine(EMumEngineType engineType, EMumBlockType blockType, EMumPaddingType paddingType, uint32_t numThreads)
 {
-    if ( engineType < MUM_ENGINE_TYPE_CPU)
+    return MumCreateEngineWithPlacement(engineType, blockType, paddingType, numThreads, MUM_PLACEMENT_NONE);
+}
+
+void *MumCreateEngineWithPlacement(EMumEngineType engineType, EMumBlockType blockType, EMumPaddingType paddingType,
+    uint32_t numThreads, EMumPlacementType placement)
+{
+    if ((uint32_t)placement > MUM_PLACEMENT_SMT)
         return NULL;
+    switch (engineType)
+    {
+    case MUM_ENGINE_TYPE_CPU:
+    case MUM_ENGINE_TYPE_CPU_MT:
+    case MUM_ENGINE_TYPE_CPU_GENERIC:
+    case MUM_ENGINE_TYPE_CPU_JIT:
+        break;
 #ifdef USE_MUM_OPENGL
-    if ( engineType > MUM_ENGINE_TYPE_GPU_B)
-        return NULL;
-#else
-    if ( engineType > MUM_ENGINE_TYPE_CPU)
-        return NULL;
+    case MUM_ENGINE_TYPE_GPU_A:
+    case MUM_ENGINE_TYPE_GPU_B:
+        // the GPU renderers' textures are at most MUM_CELLS_MAX_Y rows high
+        if (blockType > MUM_BLOCKTYPE_4096)
+            return NULL;
+        break;
 #endif
-    CMumEngine *me = new CMumEngine(engineType, blockType, paddingType, numThreads);
+    default:
+        return NULL;
+    }
+    CMumEngine *me = CMumEnginePool::Take(engineType, blockType, paddingType, numThreads, placement);
+    if (me == NULL)
+        me = new CMumEngine(engineType, blockType, paddingType, numThreads, placement);
     return me;
 }
 
@@ -172,6 +349,8 @@ EMumError MumGetInfoFromEncryptedFileName(char *infilename, EMumBlockType *block
         *blockType = MUM_BLOCKTYPE_2048;
     else if (!strcmp(ext, ".mu6"))
         *blockType = MUM_BLOCKTYPE_4096;
+    else if (!strcmp(ext, ".mu7"))
+        *blockType = MUM_BLOCKTYPE_8192;
     else
         return MUM_ERROR_INVALID_FILE_EXTENSION;
 
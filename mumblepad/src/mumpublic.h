@@ -33,11 +33,20 @@
 
 #include "mumtypes.h"
 
+// the GPU engines are built on Windows only
+#ifdef _WIN32
 #define USE_MUM_OPENGL
+#endif
 
 #define MUM_KEY_SIZE          4096
-#define MUM_NUM_SUBKEYS        560
+#define MUM_NUM_SUBKEYS        856
+// subkeys of the block types up to MUM_BLOCKTYPE_4096; only
+// MUM_BLOCKTYPE_8192 has all MUM_NUM_SUBKEYS
+#define MUM_NUM_SUBKEYS_4096   560
 #define MUM_PRNG_SUBKEY_INDEX  304
+#define MUM_MAX_TILE_BLOCKS     64
+// requests of at most this many blocks run on the caller's thread by default
+#define MUM_INLINE_BLOCKS        4
 
 
 typedef enum EMumEngineType {
@@ -46,6 +55,12 @@ typedef enum EMumEngineType {
     MUM_ENGINE_TYPE_CPU_MT = 101,
     MUM_ENGINE_TYPE_GPU_A  = 102,
     MUM_ENGINE_TYPE_GPU_B  = 103,
+    // CPU renderer with the block geometry read at run time; same output as
+    // MUM_ENGINE_TYPE_CPU, which is specialized per block type
+    MUM_ENGINE_TYPE_CPU_GENERIC = 104,
+    // CPU renderer whose diffusion passes are x86-64 code generated for the
+    // key at MumInitKey; same output as MUM_ENGINE_TYPE_CPU_GENERIC
+    MUM_ENGINE_TYPE_CPU_JIT = 105,
 } EMumEngineType;
 
 typedef enum EMumError {
@@ -67,6 +82,15 @@ typedef enum EMumError {
     MUM_ERROR_SUBKEY_INDEX_OUTOFRANGE = -1015,
     MUM_ERROR_KEY_NOT_INITIALIZED = -1016,
     MUM_ERROR_LENGTH_TOO_SMALL = -1017,
+    MUM_ERROR_INVALID_TILE_SIZE = -1018,
+    // src and dst overlap without being the same buffer, or the renderer
+    // cannot encrypt in place
+    MUM_ERROR_OVERLAPPING_BUFFERS = -1019,
+    MUM_ERROR_INVALID_NODE = -1020,
+    // the asynchronous request has not completed yet
+    MUM_ERROR_REQUEST_PENDING = -1021,
+    // neither MUM_PRIORITY_BULK nor MUM_PRIORITY_INTERACTIVE
+    MUM_ERROR_INVALID_PRIORITY = -1022,
 } EMumError;
 
 typedef enum EMumBlockType {
@@ -81,7 +105,9 @@ typedef enum EMumBlockType {
     // maximum encrypt size is 2000 bytes
     MUM_BLOCKTYPE_2048 = 5,
     // maximum encrypt size is 4000 bytes
-    MUM_BLOCKTYPE_4096 = 6
+    MUM_BLOCKTYPE_4096 = 6,
+    // maximum encrypt size is 8096 bytes, CPU engines only
+    MUM_BLOCKTYPE_8192 = 7
 } EMumBlockType;
 
 typedef enum EMumPaddingType {
@@ -91,21 +117,157 @@ typedef enum EMumPaddingType {
     MUM_PADDING_TYPE_ON = 1,
 } EMumPaddingType;
 
+// SIMD instruction sets the CPU engines may use; detected with CPUID when
+// the engine is created. Without any, the scalar passes are used.
+typedef enum EMumCpuFeature {
+    MUM_CPU_FEATURE_NONE = 0x00000000,
+    MUM_CPU_FEATURE_AVX2 = 0x00000001,
+    MUM_CPU_FEATURE_AVX512VBMI = 0x00000002,
+    MUM_CPU_FEATURE_SSE41 = 0x00000004,
+} EMumCpuFeature;
+
+// Where the workers of MUM_ENGINE_TYPE_CPU_MT run. With a placement each
+// worker is pinned to a hardware thread, filling one NUMA node before the
+// next, and each node gets its own copy of the key tables, which only its
+// workers read.
+typedef enum EMumPlacementType {
+    // wherever the OS schedules them, all reading the engine's tables
+    MUM_PLACEMENT_NONE = 0,
+    // one worker per physical core
+    MUM_PLACEMENT_CORE = 1,
+    // one worker per hardware thread, SMT siblings included
+    MUM_PLACEMENT_SMT = 2,
+} EMumPlacementType;
+
+// Which of the queued work of MUM_ENGINE_TYPE_CPU_MT engines the shared
+// workers take first. Interactive work is taken before any bulk work that
+// is queued, and a worker on a bulk call also turns to it between grains.
+typedef enum EMumPriority {
+    MUM_PRIORITY_BULK = 0,
+    MUM_PRIORITY_INTERACTIVE = 1,
+} EMumPriority;
+
+// Runs on the worker that completes an asynchronous request, once its
+// output is in place, or within the call for an empty one; request is the
+// handle MumEncryptAsync or MumDecryptAsync returned, or NULL if none was
+// asked for. It should return quickly. It holds one of the shared workers,
+// so it must not call MumWaitRequest or MumDestroyRequest on a request
+// still in flight, make synchronous calls on an MT engine, or call
+// MumDestroyEngine on the request's engine, which waits for the request
+// itself. It may queue asynchronous requests and destroy other engines.
+typedef void (*MumCompletionCallback)(void *request, EMumError error, uint32_t outlength, void *userData);
+
 
+// For MUM_ENGINE_TYPE_CPU_MT, numThreads is how many workers a call is
+// spread over at most. The workers are shared by all MT engines of the
+// process, one per hardware thread, started with the first engine and
+// ended with the last.
 extern void * MumCreateEngine(EMumEngineType engineType, EMumBlockType blockType, EMumPaddingType paddingType, uint32_t numThreads);
+// MumCreateEngine with the workers of MUM_ENGINE_TYPE_CPU_MT placed; with a
+// placement, numThreads 0 spreads calls over every place. Engines with the
+// same placement share the workers. Other engine types ignore the placement.
+extern void * MumCreateEngineWithPlacement(EMumEngineType engineType, EMumBlockType blockType, EMumPaddingType paddingType,
+    uint32_t numThreads, EMumPlacementType placement);
+// waits for the engine's asynchronous requests to complete first
 extern void MumDestroyEngine(void *me);
+// returns how many destroyed engines are kept for reuse, 0 unless set.
+extern EMumError MumGetEnginePoolSize(uint32_t *maxIdleEngines);
+// With a pool size, MumDestroyEngine keeps up to that many CPU engines,
+// over all engine types, with their buffers and, for MUM_ENGINE_TYPE_CPU_MT,
+// the workers running. A later MumCreateEngine with the same arguments
+// takes one back, as it was when created and without a usable key: its
+// key, subkeys and key tables are wiped when it is destroyed, and
+// MumInitKey schedules the new key in full. Setting a smaller size frees
+// the idle engines beyond it; 0 frees them all.
+extern EMumError MumSetEnginePoolSize(uint32_t maxIdleEngines);
 extern EMumError MumInitKey(void *me, uint8_t *key);
 extern EMumError MumGetSubkey(void *me, uint32_t index, uint8_t *subkey);
 extern EMumError MumLoadKey(void *me, char *keyfile);
+// On a MUM_ENGINE_TYPE_CPU_MT engine, MumEncryptBlock, MumDecryptBlock,
+// MumEncrypt and MumDecrypt may be called from any number of threads at
+// once; their work shares the engine's workers. The other engine types,
+// and all other calls, take one thread at a time. The key and the settings
+// below change only while no call or asynchronous request is in flight.
 extern EMumError MumEncryptBlock(void *me, uint8_t *src, uint8_t *dst, uint32_t length, uint32_t seqnum);
 extern EMumError MumDecryptBlock(void *me, uint8_t *src, uint8_t *dst, uint32_t *length, uint32_t *seqnum);
+// src and dst may be the same buffer for both; to encrypt in place it has
+// to hold the encrypted size, see MumEncryptedSize.
 extern EMumError MumEncrypt(void *me, uint8_t *src, uint8_t *dst, uint32_t length, uint32_t *outlength, uint16_t seqNum);
 extern EMumError MumDecrypt(void *me, uint8_t *src, uint8_t *dst, uint32_t length, uint32_t *outlength);
+// MumEncrypt and MumDecrypt on a MUM_ENGINE_TYPE_CPU_MT engine without
+// waiting: both return once the work is queued, and src and dst must stay
+// untouched until the request completes. Any number of requests may be in
+// flight. callback may be NULL. With request NULL the request frees itself
+// once complete; otherwise *request is a handle for MumPollRequest and
+// MumWaitRequest, freed with MumDestroyRequest. Other engine types return
+// MUM_ERROR_RENDERER_NOT_MULTITHREADED.
+extern EMumError MumEncryptAsync(void *me, uint8_t *src, uint8_t *dst, uint32_t length, uint16_t seqNum,
+    MumCompletionCallback callback, void *userData, void **request);
+extern EMumError MumDecryptAsync(void *me, uint8_t *src, uint8_t *dst, uint32_t length,
+    MumCompletionCallback callback, void *userData, void **request);
+// MumEncrypt, MumDecrypt, MumEncryptAsync and MumDecryptAsync with a
+// priority for this call's work instead of the engine's, see
+// MumSetPriority; the other engine types ignore it, but like
+// MumSetPriority all return MUM_ERROR_INVALID_PRIORITY for a value that is
+// no EMumPriority.
+extern EMumError MumEncryptWithPriority(void *me, uint8_t *src, uint8_t *dst, uint32_t length, uint32_t *outlength, uint16_t seqNum,
+    EMumPriority priority);
+extern EMumError MumDecryptWithPriority(void *me, uint8_t *src, uint8_t *dst, uint32_t length, uint32_t *outlength,
+    EMumPriority priority);
+extern EMumError MumEncryptAsyncWithPriority(void *me, uint8_t *src, uint8_t *dst, uint32_t length, uint16_t seqNum,
+    EMumPriority priority, MumCompletionCallback callback, void *userData, void **request);
+extern EMumError MumDecryptAsyncWithPriority(void *me, uint8_t *src, uint8_t *dst, uint32_t length,
+    EMumPriority priority, MumCompletionCallback callback, void *userData, void **request);
+// MUM_ERROR_REQUEST_PENDING while the request runs, then its result
+extern EMumError MumPollRequest(void *request);
+// waits until the request completes; returns its result and output length
+extern EMumError MumWaitRequest(void *request, uint32_t *outlength);
+// waits until the request completes, then frees it
+extern void MumDestroyRequest(void *request);
 extern EMumError MumEncryptFile(void *me, char *srcfile, char *dstfile);
 extern EMumError MumDecryptFile(void *me, char *srcfile, char *dstfile);
 extern EMumError MumPlaintextBlockSize(void *me, uint32_t *plaintextBlockSize);
 extern EMumError MumEncryptedBlockSize(void *me, uint32_t *encryptedBlockSize);
 extern EMumError MumEncryptedSize(void *me, uint32_t plaintextSize, uint32_t *encryptedSize);
+// returns the EMumCpuFeature bits the CPU engines currently use.
+extern EMumError MumGetCpuFeatures(void *me, uint32_t *features);
+// restricts the EMumCpuFeature bits the CPU engines may use, e.g. MUM_CPU_FEATURE_NONE
+// for the scalar passes. Bits the processor does not support are ignored.
+extern EMumError MumSetCpuFeatures(void *me, uint32_t features);
+// returns the number of blocks the CPU engines take through a round before
+// starting the next round (round-major tiles).
+extern EMumError MumGetTileBlocks(void *me, uint32_t *tileBlocks);
+// sets the tile size, 1..MUM_MAX_TILE_BLOCKS; 1 runs each block through all
+// rounds on its own. Larger tiles reuse each round's tables across more
+// blocks, as long as the tile itself stays in cache.
+extern EMumError MumSetTileBlocks(void *me, uint32_t tileBlocks);
+// returns the size from which MumEncrypt and MumDecrypt use the large-buffer
+// mode: the CPU engines prefetch the source ahead and write the output with
+// non-temporal stores, so it does not push the tables out of the caches.
+extern EMumError MumGetLargeBufferSize(void *me, uint32_t *largeBufferSize);
+// sets that size in bytes; 0 always uses the mode, 0xffffffff never does.
+extern EMumError MumSetLargeBufferSize(void *me, uint32_t largeBufferSize);
+// returns the number of NUMA nodes the workers of MUM_ENGINE_TYPE_CPU_MT
+// run on, 1 without a placement.
+extern EMumError MumGetNumNodes(void *me, uint32_t *numNodes);
+// returns, for node 0..numNodes-1, its number of workers, the bytes they
+// encrypted or decrypted since the engine was created, and the time they
+// spent on it in microseconds, summed over the workers. Calls run on the
+// caller's thread, see MumSetInlineBlocks, are not counted.
+extern EMumError MumGetNodeStats(void *me, uint32_t node, uint32_t *numWorkers, uint64_t *bytes, uint64_t *microseconds);
+// returns the priority of the calls of a MUM_ENGINE_TYPE_CPU_MT engine
+// made without one, MUM_PRIORITY_BULK unless set. Other engine types return
+// MUM_ERROR_RENDERER_NOT_MULTITHREADED for it and the three below.
+extern EMumError MumGetPriority(void *me, EMumPriority *priority);
+// sets it, for the calls made from then on; MUM_ERROR_INVALID_PRIORITY for
+// a value that is no EMumPriority, whatever the engine type.
+extern EMumError MumSetPriority(void *me, EMumPriority priority);
+// returns the most blocks a MumEncrypt, MumDecrypt, MumEncryptBlock or
+// MumDecryptBlock call on a MUM_ENGINE_TYPE_CPU_MT engine has to run on the
+// caller's thread instead of the workers, MUM_INLINE_BLOCKS unless set.
+extern EMumError MumGetInlineBlocks(void *me, uint32_t *inlineBlocks);
+// sets it; 0 hands every call to the workers.
+extern EMumError MumSetInlineBlocks(void *me, uint32_t inlineBlocks);
 // adds a file extension to a file based, based on the block size/type:
 // .mu1 = 128-byte block
 // .mu2 = 256-byte block
@@ -113,6 +275,7 @@ extern EMumError MumEncryptedSize(void *me, uint32_t plaintextSize, uint32_t *en
 // .mu4 = 1024-byte block
 // .mu5 = 2048-byte block
 // .mu6 = 4096-byte block
+// .mu7 = 8192-byte block
 extern EMumError MumCreateEncryptedFileName(EMumBlockType blockType, char *infilename, char *outfilename, size_t outlength);
 // returns original filename (stripped of Mumblepad extension), plus block type used.
 extern EMumError MumGetInfoFromEncryptedFileName(char *infilename, EMumBlockType *blockType, char *outfilename, size_t outlength);
@@ -0,0 +1,170 @@
+//////////////////////////////////////////////////////////////////////////
+//                                                                      //
+//   Mumblepad Block Cipher                                             //
+//   Version 1, completed March 14, 2017                                //
+//                                                                      //
+//   Key size 4096 bytes, 32768 bits                                    //
+//   Six different block sizes: 128, 256, 512, 1024, 2048, 4096 bytes   //
+//   Encryption and decryption, runs on either CPU and GPU              //
+//   May run multi-threaded on CPU.                                     //
+//   Runs on GPU with OpenGL or OpenGL ES 2.0                           //
+//                                                                      //
+//   Encrypted blocks containing same plaintext are different, due to   //
+//   small amount of per-block random number padding.                   //
+//   Encrypted block contains length, 16-bit sequence number, 32-bit    //
+//   checksum.                                                          //
+//   No block cipher mode required                                      //
+//   Can use parallel processing, multi-threaded encrypt/decrypt        //
+//                                                                      //
+//   8 rounds, 2 passes per round                                       //
+//   Encrypt: diffusion pass followed by confusion pass.                //
+//   Decrypt: inverse confusion followed by inverse diffusion.          //
+//                                                                      //
+//   Free for non-commercial use, analysis/evaluation.                  //
+//                                                                      //
+//   Copyright 2017, Kyle Granger                                       //
+//   Email contact:  kyle.granger@chello.at                             //
+//                                                                      //
+//////////////////////////////////////////////////////////////////////////
+
+
+#include <thread>
+#include "mumqueue.h"
+
+
+CMumTicketRing::CMumTicketRing()
+{
+    mCells = new TMumQueueCell[MUM_QUEUE_SIZE];
+    for (uint32_t i = 0; i < MUM_QUEUE_SIZE; i++)
+        mCells[i].sequence = i;
+    mPushPosition = 0;
+    mPopPosition = 0;
+}
+
+CMumTicketRing::~CMumTicketRing()
+{
+    delete[] mCells;
+}
+
+// The cell at position is free for this round of the ring when its
+// sequence equals position; a smaller one is still to be popped from the
+// previous round, so the ring is full.
+bool CMumTicketRing::TryPush(const TMumTicket &ticket)
+{
+    uint32_t position = mPushPosition;
+    while (true)
+    {
+        TMumQueueCell *cell = &mCells[position & (MUM_QUEUE_SIZE - 1)];
+        int32_t difference = (int32_t)(cell->sequence - position);
+        if (difference == 0)
+        {
+            if (mPushPosition.compare_exchange_weak(position, position + 1))
+            {
+                cell->ticket = ticket;
+                cell->sequence = position + 1;
+                return true;
+            }
+        }
+        else if (difference < 0)
+            return false;
+        else
+            position = mPushPosition;
+    }
+}
+
+// The cell at position holds a ticket when its sequence is position + 1;
+// it is handed back for the next round as position + MUM_QUEUE_SIZE.
+bool CMumTicketRing::TryPop(TMumTicket *ticket)
+{
+    uint32_t position = mPopPosition;
+    while (true)
+    {
+        TMumQueueCell *cell = &mCells[position & (MUM_QUEUE_SIZE - 1)];
+        int32_t difference = (int32_t)(cell->sequence - (position + 1));
+        if (difference == 0)
+        {
+            if (mPopPosition.compare_exchange_weak(position, position + 1))
+            {
+                *ticket = cell->ticket;
+                cell->sequence = position + MUM_QUEUE_SIZE;
+                return true;
+            }
+        }
+        else if (difference < 0)
+            return false;
+        else
+            position = mPopPosition;
+    }
+}
+
+
+CMumJobQueue::CMumJobQueue()
+{
+    mClosed = false;
+}
+
+// The tickets queued so far are released before waiting on a full ring,
+// since other callers' tickets may be what fills it.
+void CMumJobQueue::Push(const TMumTicket *tickets, uint32_t count, EMumPriority priority)
+{
+    CMumTicketRing *ring = &mRings[priority];
+    uint32_t pending = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        while (!ring->TryPush(tickets[i]))
+        {
+            if (pending > 0)
+            {
+                mTickets.Release(pending);
+                pending = 0;
+            }
+            std::this_thread::yield();
+        }
+        pending++;
+    }
+    if (pending > 0)
+        mTickets.Release(pending);
+}
+
+uint32_t CMumJobQueue::TryPush(const TMumTicket *tickets, uint32_t count, EMumPriority priority)
+{
+    CMumTicketRing *ring = &mRings[priority];
+    uint32_t pushed = 0;
+    while (pushed < count && ring->TryPush(tickets[pushed]))
+        pushed++;
+    if (pushed > 0)
+        mTickets.Release(pushed);
+    return pushed;
+}
+
+// Every acquired unit stands for a pushed ticket, in one ring or the
+// other, but an earlier push may still be filling the cell at a head, so
+// the pop is retried until the ticket shows.
+bool CMumJobQueue::Pop(TMumTicket *ticket)
+{
+    mTickets.Acquire();
+    if (mClosed)
+        return false;
+    while (!mRings[MUM_PRIORITY_INTERACTIVE].TryPop(ticket) && !mRings[MUM_PRIORITY_BULK].TryPop(ticket))
+        MumPause();
+    return true;
+}
+
+// The unit taken may stand for a bulk ticket when the interactive one it
+// was meant for has gone to another worker; it is handed back then.
+bool CMumJobQueue::PopInteractive(TMumTicket *ticket)
+{
+    CMumTicketRing *ring = &mRings[MUM_PRIORITY_INTERACTIVE];
+    if (ring->IsEmpty() || !mTickets.TryAcquire())
+        return false;
+    if (ring->TryPop(ticket))
+        return true;
+    mTickets.Release(1);
+    return false;
+}
+
+void CMumJobQueue::Close(uint32_t numConsumers)
+{
+    mClosed = true;
+    mTickets.Release(numConsumers);
+}
@@ -0,0 +1,106 @@
+//////////////////////////////////////////////////////////////////////////
+//                                                                      //
+//   Mumblepad Block Cipher                                             //
+//   Version 1, completed March 14, 2017                                //
+//                                                                      //
+//   Key size 4096 bytes, 32768 bits                                    //
+//   Six different block sizes: 128, 256, 512, 1024, 2048, 4096 bytes   //
+//   Encryption and decryption, runs on either CPU and GPU              //
+//   May run multi-threaded on CPU.                                     //
+//   Runs on GPU with OpenGL or OpenGL ES 2.0                           //
+//                                                                      //
+//   Encrypted blocks containing same plaintext are different, due to   //
+//   small amount of per-block random number padding.                   //
+//   Encrypted block contains length, 16-bit sequence number, 32-bit    //
+//   checksum.                                                          //
+//   No block cipher mode required                                      //
+//   Can use parallel processing, multi-threaded encrypt/decrypt        //
+//                                                                      //
+//   8 rounds, 2 passes per round                                       //
+//   Encrypt: diffusion pass followed by confusion pass.                //
+//   Decrypt: inverse confusion followed by inverse diffusion.          //
+//                                                                      //
+//   Free for non-commercial use, analysis/evaluation.                  //
+//                                                                      //
+//   Copyright 2017, Kyle Granger                                       //
+//   Email contact:  kyle.granger@chello.at                             //
+//                                                                      //
+//////////////////////////////////////////////////////////////////////////
+
+
+#ifndef MUMQUEUE_H
+#define MUMQUEUE_H
+
+#include <atomic>
+#include "mumdefines.h"
+#include "mumsignal.h"
+
+// cells in the ring of CMumJobQueue, a power of two
+#define MUM_QUEUE_SIZE 4096
+
+struct TMumJob;
+
+// A share of a job for one worker: the job and which of its ranges of
+// grains the worker starts on, see CMumblepadThread::RunTicket
+typedef struct TMumTicket
+{
+    struct TMumJob *job;
+    uint32_t slot;
+} TMumTicket;
+
+// Bounded lock-free ring of tickets. Each cell carries a sequence number
+// that says whether it is free for the push of a given round or holds a
+// ticket for the pop of that round, so producers and consumers only
+// contend on their own position counter.
+class CMumTicketRing {
+public:
+    CMumTicketRing();
+    ~CMumTicketRing();
+
+    // false if the ring is full
+    bool TryPush(const TMumTicket &ticket);
+    // false if the ring is empty, or the ticket at the head is still being pushed
+    bool TryPop(TMumTicket *ticket);
+    // a hint only, the ring may change right away
+    bool IsEmpty() { return mPopPosition == mPushPosition; }
+private:
+    typedef struct TMumQueueCell
+    {
+        std::atomic<uint32_t> sequence;
+        TMumTicket ticket;
+    } TMumQueueCell;
+
+    TMumQueueCell *mCells;
+    // producers and consumers on cache lines of their own
+    uint8_t mPushPadding[MUM_CACHE_LINE_SIZE];
+    std::atomic<uint32_t> mPushPosition;
+    uint8_t mPopPadding[MUM_CACHE_LINE_SIZE];
+    std::atomic<uint32_t> mPopPosition;
+    uint8_t mEndPadding[MUM_CACHE_LINE_SIZE];
+};
+
+// The tickets between any number of callers of the MT engines and the
+// workers of a pool, a ring per priority. A semaphore counts the queued
+// tickets of both, so idle workers park instead of polling; a worker that
+// gets a unit takes an interactive ticket if there is one.
+class CMumJobQueue {
+public:
+    CMumJobQueue();
+
+    // queues count tickets, waiting while the ring is full
+    void Push(const TMumTicket *tickets, uint32_t count, EMumPriority priority);
+    // queues tickets until the ring is full; returns how many it queued
+    uint32_t TryPush(const TMumTicket *tickets, uint32_t count, EMumPriority priority);
+    // waits for a ticket; false once the queue is closed
+    bool Pop(TMumTicket *ticket);
+    // an interactive ticket if one is queued, without waiting
+    bool PopInteractive(TMumTicket *ticket);
+    // makes Pop return false for numConsumers waiting workers
+    void Close(uint32_t numConsumers);
+private:
+    CMumTicketRing mRings[MUM_PRIORITY_INTERACTIVE + 1];
+    std::atomic<bool> mClosed;
+    CMumSemaphore mTickets;
+};
+
+#endif
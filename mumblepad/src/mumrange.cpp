@@ -0,0 +1,79 @@
+//////////////////////////////////////////////////////////////////////////
+//                                                                      //
+//   Mumblepad Block Cipher                                             //
+//   Version 1, completed March 14, 2017                                //
+//                                                                      //
+//   Key size 4096 bytes, 32768 bits                                    //
+//   Six different block sizes: 128, 256, 512, 1024, 2048, 4096 bytes   //
+//   Encryption and decryption, runs on either CPU and GPU              //
+//   May run multi-threaded on CPU.                                     //
+//   Runs on GPU with OpenGL or OpenGL ES 2.0                           //
+//                                                                      //
+//   Encrypted blocks containing same plaintext are different, due to   //
+//   small amount of per-block random number padding.                   //
+//   Encrypted block contains length, 16-bit sequence number, 32-bit    //
+//   checksum.                                                          //
+//   No block cipher mode required                                      //
+//   Can use parallel processing, multi-threaded encrypt/decrypt        //
+//                                                                      //
+//   8 rounds, 2 passes per round                                       //
+//   Encrypt: diffusion pass followed by confusion pass.                //
+//   Decrypt: inverse confusion followed by inverse diffusion.          //
+//                                                                      //
+//   Free for non-commercial use, analysis/evaluation.                  //
+//                                                                      //
+//   Copyright 2017, Kyle Granger                                       //
+//   Email contact:  kyle.granger@chello.at                             //
+//                                                                      //
+//////////////////////////////////////////////////////////////////////////
+
+
+#include "mumrange.h"
+
+
+CMumRange::CMumRange()
+{
+    mRange = 0;
+}
+
+void CMumRange::Set(uint32_t head, uint32_t tail)
+{
+    mRange = ((uint64_t)head << 32) | tail;
+}
+
+bool CMumRange::Pop(uint32_t *grain)
+{
+    uint64_t range = mRange;
+    while (true)
+    {
+        uint32_t head = (uint32_t)(range >> 32);
+        uint32_t tail = (uint32_t)range;
+        if (head >= tail)
+            return false;
+        if (mRange.compare_exchange_weak(range, ((uint64_t)(head + 1) << 32) | tail))
+        {
+            *grain = head;
+            return true;
+        }
+    }
+}
+
+// A grain leaves this range before it shows up in the thief's, so a worker
+// that finds every range empty may quit while the thief still has work.
+bool CMumRange::StealHalf(CMumRange *thief)
+{
+    uint64_t range = mRange;
+    while (true)
+    {
+        uint32_t head = (uint32_t)(range >> 32);
+        uint32_t tail = (uint32_t)range;
+        if (head >= tail)
+            return false;
+        uint32_t middle = tail - (tail - head + 1) / 2;
+        if (mRange.compare_exchange_weak(range, ((uint64_t)head << 32) | middle))
+        {
+            thief->Set(middle, tail);
+            return true;
+        }
+    }
+}
@@ -0,0 +1,55 @@
+//////////////////////////////////////////////////////////////////////////
+//                                                                      //
+//   Mumblepad Block Cipher                                             //
+//   Version 1, completed March 14, 2017                                //
+//                                                                      //
+//   Key size 4096 bytes, 32768 bits                                    //
+//   Six different block sizes: 128, 256, 512, 1024, 2048, 4096 bytes   //
+//   Encryption and decryption, runs on either CPU and GPU              //
+//   May run multi-threaded on CPU.                                     //
+//   Runs on GPU with OpenGL or OpenGL ES 2.0                           //
+//                                                                      //
+//   Encrypted blocks containing same plaintext are different, due to   //
+//   small amount of per-block random number padding.                   //
+//   Encrypted block contains length, 16-bit sequence number, 32-bit    //
+//   checksum.                                                          //
+//   No block cipher mode required                                      //
+//   Can use parallel processing, multi-threaded encrypt/decrypt        //
+//                                                                      //
+//   8 rounds, 2 passes per round                                       //
+//   Encrypt: diffusion pass followed by confusion pass.                //
+//   Decrypt: inverse confusion followed by inverse diffusion.          //
+//                                                                      //
+//   Free for non-commercial use, analysis/evaluation.                  //
+//                                                                      //
+//   Copyright 2017, Kyle Granger                                       //
+//   Email contact:  kyle.granger@chello.at                             //
+//                                                                      //
+//////////////////////////////////////////////////////////////////////////
+
+
+#ifndef MUMRANGE_H
+#define MUMRANGE_H
+
+#include <atomic>
+#include "mumtypes.h"
+
+// The grains a worker of the MT renderer has yet to do, [head, tail). The
+// owner takes grains one by one from the head; an idle worker steals the
+// back half. Both ends are packed into one word, so every change is a
+// single compare-and-swap and a grain is never taken twice.
+class CMumRange {
+public:
+    CMumRange();
+
+    // only while nobody steals, or into an empty range by its owner
+    void Set(uint32_t head, uint32_t tail);
+    // takes the grain at the head; false once the range is empty
+    bool Pop(uint32_t *grain);
+    // moves the back half, rounded up, of this range into the empty thief
+    bool StealHalf(CMumRange *thief);
+private:
+    std::atomic<uint64_t> mRange;
+};
+
+#endif
@@ -33,74 +33,130 @@
 #include <string.h>
 #include "stdio.h"
 #include "stdlib.h"
+#include "stddef.h"
+#include <emmintrin.h>
 #include "mumrenderer.h"
+#include "mumavx2.h"
+
+
+#define MUM_BLOCK_LAYOUT(blockType, block, encryptSize) { blockType, encryptSize, \
+    offsetof(block, paddingA), offsetof(block, dataA), offsetof(block, paddingB), offsetof(block, checksum), \
+    offsetof(block, paddingC), offsetof(block, dataB), offsetof(block, paddingD), \
+    sizeof(((block *)0)->paddingA), sizeof(((block *)0)->dataA), sizeof(((block *)0)->paddingB), \
+    sizeof(((block *)0)->paddingC), sizeof(((block *)0)->dataB), sizeof(((block *)0)->paddingD) }
+
+// from MUM_BLOCKTYPE_128 up
+static const TMumBlockLayout mumBlockLayouts[] = {
+    MUM_BLOCK_LAYOUT(MUM_BLOCKTYPE_128, TMumBlockR1, MUM_ENCRYPT_SIZE_R1),
+    MUM_BLOCK_LAYOUT(MUM_BLOCKTYPE_256, TMumBlockR2, MUM_ENCRYPT_SIZE_R2),
+    MUM_BLOCK_LAYOUT(MUM_BLOCKTYPE_512, TMumBlockR4, MUM_ENCRYPT_SIZE_R4),
+    MUM_BLOCK_LAYOUT(MUM_BLOCKTYPE_1024, TMumBlockR8, MUM_ENCRYPT_SIZE_R8),
+    MUM_BLOCK_LAYOUT(MUM_BLOCKTYPE_2048, TMumBlockR16, MUM_ENCRYPT_SIZE_R16),
+    MUM_BLOCK_LAYOUT(MUM_BLOCKTYPE_4096, TMumBlockR32, MUM_ENCRYPT_SIZE_R32),
+    MUM_BLOCK_LAYOUT(MUM_BLOCKTYPE_8192, TMumBlockR64, MUM_ENCRYPT_SIZE_R64),
+};
+
+const TMumBlockLayout *MumGetBlockLayout(EMumBlockType blockType)
+{
+    return &mumBlockLayouts[blockType - MUM_BLOCKTYPE_128];
+}
 
+void MumPrefetch(const uint8_t *src, uint32_t size)
+{
+    for (uint32_t i = 0; i < size; i += MUM_CACHE_LINE_SIZE)
+        _mm_prefetch((const char *)src + i, _MM_HINT_T0);
+}
 
-CMumRenderer::CMumRenderer(TMumInfo *mumInfo)
+// The head up to a 16-byte boundary and the tail are copied normally; the
+// fence orders the streamed stores before anything the caller does next.
+void MumStreamCopy(uint8_t *dst, const uint8_t *src, uint32_t size)
 {
-    mMumInfo = mumInfo;
-    mPrng = nullptr;
-    switch (mMumInfo->blockType)
+    uint32_t head = (uint32_t)((16 - ((size_t)dst & 15)) & 15);
+    if (head > size)
+        head = size;
+    memcpy(dst, src, head);
+    dst += head;
+    src += head;
+    size -= head;
+    for (; size >= 16; size -= 16, dst += 16, src += 16)
+        _mm_stream_si128((__m128i *)dst, _mm_loadu_si128((const __m128i *)src));
+    memcpy(dst, src, size);
+    _mm_sfence();
+}
+
+
+// The block sizes and rows of the engine's block type
+static void MumInitBlockGeometry(TMumInfo *mumInfo)
+{
+    switch (mumInfo->blockType)
     {
+    case MUM_BLOCKTYPE_8192:
+        mumInfo->encryptedBlockSize = MUM_BLOCK_SIZE_R64;
+        mumInfo->plaintextBlockSize = mumInfo->paddingOn ? MUM_ENCRYPT_SIZE_R64 : MUM_BLOCK_SIZE_R64;
+        mumInfo->paddingSize = MUM_PADDING_SIZE_R64;
+        mumInfo->numRows = 64;
+        break;
+
     case MUM_BLOCKTYPE_4096:
-        mMumInfo->encryptedBlockSize = MUM_BLOCK_SIZE_R32;
-        mMumInfo->plaintextBlockSize = mMumInfo->paddingOn ? MUM_ENCRYPT_SIZE_R32 : MUM_BLOCK_SIZE_R32;
-        mMumInfo->paddingSize = MUM_PADDING_SIZE_R32;
-        mMumInfo->numRows = 32;
-        packData = &CMumRenderer::PackDataR32;
-        unpackData = &CMumRenderer::UnpackDataR32;
+        mumInfo->encryptedBlockSize = MUM_BLOCK_SIZE_R32;
+        mumInfo->plaintextBlockSize = mumInfo->paddingOn ? MUM_ENCRYPT_SIZE_R32 : MUM_BLOCK_SIZE_R32;
+        mumInfo->paddingSize = MUM_PADDING_SIZE_R32;
+        mumInfo->numRows = 32;
         break;
 
     case MUM_BLOCKTYPE_2048:
-        mMumInfo->encryptedBlockSize = MUM_BLOCK_SIZE_R16;
-        mMumInfo->plaintextBlockSize = mMumInfo->paddingOn ? MUM_ENCRYPT_SIZE_R16 : MUM_BLOCK_SIZE_R16;
-        mMumInfo->paddingSize = MUM_PADDING_SIZE_R16;
-        mMumInfo->numRows = 16;
-        packData = &CMumRenderer::PackDataR16;
-        unpackData = &CMumRenderer::UnpackDataR16;
+        mumInfo->encryptedBlockSize = MUM_BLOCK_SIZE_R16;
+        mumInfo->plaintextBlockSize = mumInfo->paddingOn ? MUM_ENCRYPT_SIZE_R16 : MUM_BLOCK_SIZE_R16;
+        mumInfo->paddingSize = MUM_PADDING_SIZE_R16;
+        mumInfo->numRows = 16;
         break;
 
     case MUM_BLOCKTYPE_1024:
-        mMumInfo->encryptedBlockSize = MUM_BLOCK_SIZE_R8;
-        mMumInfo->plaintextBlockSize = mMumInfo->paddingOn ? MUM_ENCRYPT_SIZE_R8 : MUM_BLOCK_SIZE_R8;
-        mMumInfo->paddingSize = MUM_PADDING_SIZE_R8;
-        mMumInfo->numRows = 8;
-        packData = &CMumRenderer::PackDataR8;
-        unpackData = &CMumRenderer::UnpackDataR8;
+        mumInfo->encryptedBlockSize = MUM_BLOCK_SIZE_R8;
+        mumInfo->plaintextBlockSize = mumInfo->paddingOn ? MUM_ENCRYPT_SIZE_R8 : MUM_BLOCK_SIZE_R8;
+        mumInfo->paddingSize = MUM_PADDING_SIZE_R8;
+        mumInfo->numRows = 8;
         break;
 
     case MUM_BLOCKTYPE_512:
-        mMumInfo->encryptedBlockSize = MUM_BLOCK_SIZE_R4;
-        mMumInfo->plaintextBlockSize = mMumInfo->paddingOn ? MUM_ENCRYPT_SIZE_R4 : MUM_BLOCK_SIZE_R4;
-        mMumInfo->paddingSize = MUM_PADDING_SIZE_R4;
-        mMumInfo->numRows = 4;
-        packData = &CMumRenderer::PackDataR4;
-        unpackData = &CMumRenderer::UnpackDataR4;
+        mumInfo->encryptedBlockSize = MUM_BLOCK_SIZE_R4;
+        mumInfo->plaintextBlockSize = mumInfo->paddingOn ? MUM_ENCRYPT_SIZE_R4 : MUM_BLOCK_SIZE_R4;
+        mumInfo->paddingSize = MUM_PADDING_SIZE_R4;
+        mumInfo->numRows = 4;
         break;
 
     case MUM_BLOCKTYPE_256:
-        mMumInfo->encryptedBlockSize = MUM_BLOCK_SIZE_R2;
-        mMumInfo->plaintextBlockSize = mMumInfo->paddingOn ? MUM_ENCRYPT_SIZE_R2 : MUM_BLOCK_SIZE_R2;
-        mMumInfo->paddingSize = MUM_PADDING_SIZE_R2;
-        mMumInfo->numRows = 2;
-        packData = &CMumRenderer::PackDataR2;
-        unpackData = &CMumRenderer::UnpackDataR2;
+        mumInfo->encryptedBlockSize = MUM_BLOCK_SIZE_R2;
+        mumInfo->plaintextBlockSize = mumInfo->paddingOn ? MUM_ENCRYPT_SIZE_R2 : MUM_BLOCK_SIZE_R2;
+        mumInfo->paddingSize = MUM_PADDING_SIZE_R2;
+        mumInfo->numRows = 2;
         break;
 
     case MUM_BLOCKTYPE_128:
-        mMumInfo->encryptedBlockSize = MUM_BLOCK_SIZE_R1;
-        mMumInfo->plaintextBlockSize = mMumInfo->paddingOn ? MUM_ENCRYPT_SIZE_R1 : MUM_BLOCK_SIZE_R1;
-        mMumInfo->paddingSize = MUM_PADDING_SIZE_R1;
-        mMumInfo->numRows = 1;
-        packData = &CMumRenderer::PackDataR1;
-        unpackData = &CMumRenderer::UnpackDataR1;
+        mumInfo->encryptedBlockSize = MUM_BLOCK_SIZE_R1;
+        mumInfo->plaintextBlockSize = mumInfo->paddingOn ? MUM_ENCRYPT_SIZE_R1 : MUM_BLOCK_SIZE_R1;
+        mumInfo->paddingSize = MUM_PADDING_SIZE_R1;
+        mumInfo->numRows = 1;
         break;
 
     }
+}
+
+CMumRenderer::CMumRenderer(TMumInfo *mumInfo)
+{
+    mMumInfo = mumInfo;
+    mPrng = nullptr;
+    mPaddingReplay = nullptr;
+    mLargeBuffer = false;
+    // the engine's renderer fills in the block geometry; the MT renderer's
+    // worker states, made while other workers run, only read it
+    if (mMumInfo->numRows == 0)
+        MumInitBlockGeometry(mMumInfo);
+    mBlockLayout = MumGetBlockLayout(mMumInfo->blockType);
 
     numEncryptedBlocks = 0;
     numDecryptedBlocks = 0;
-    blockLatency = (mMumInfo->engineType < MUM_ENGINE_TYPE_GPU_B) ? 0 : 7;
+    blockLatency = (mMumInfo->engineType == MUM_ENGINE_TYPE_GPU_B) ? 7 : 0;
 }
 
 CMumRenderer::~CMumRenderer()
@@ -112,6 +168,17 @@ CMumRenderer::~CMumRenderer()
     }
 }
 
+void CMumRenderer::Recycle()
+{
+    ResetEncryption();
+    ResetDecryption();
+    if (mPrng != nullptr)
+    {
+        delete mPrng;
+        mPrng = nullptr;
+    }
+}
+
 
 
 
@@ -123,6 +190,23 @@ EMumError CMumRenderer::Encrypt(uint8_t *src, uint8_t *dst, uint32_t length, uin
     uint8_t dummy[MUM_MAX_BLOCK_SIZE];
 
     *outlength = 0;
+    mLargeBuffer = IsLargeBuffer(length);
+    if (src == dst && mMumInfo->paddingOn)
+        return EncryptInPlace(src, length, outlength, seqNum);
+    // runs of full blocks go through the batch path, unless the renderer
+    // returns its blocks late
+    if (blockLatency == 0 && length >= 2 * mMumInfo->plaintextBlockSize)
+    {
+        uint32_t numBlocks = length / mMumInfo->plaintextBlockSize;
+        error = EncryptBlocks(src, dst, numBlocks, seqNum);
+        if (error != MUM_ERROR_OK)
+            return error;
+        src += numBlocks * mMumInfo->plaintextBlockSize;
+        dst += numBlocks * mMumInfo->encryptedBlockSize;
+        length -= numBlocks * mMumInfo->plaintextBlockSize;
+        *outlength += numBlocks * mMumInfo->encryptedBlockSize;
+        seqNum += (uint16_t)numBlocks;
+    }
     while (length > 0 )
     {
         if ( length >= mMumInfo->plaintextBlockSize)
@@ -131,6 +215,8 @@ EMumError CMumRenderer::Encrypt(uint8_t *src, uint8_t *dst, uint32_t length, uin
         {
             encryptSize = length;
             memcpy(dummy,src, encryptSize);
+            // without padding the rest of the block goes out as it is
+            memset(dummy + encryptSize, 0, mMumInfo->plaintextBlockSize - encryptSize);
             src = dummy;
         }
         length -= encryptSize;
@@ -162,6 +248,60 @@ EMumError CMumRenderer::Encrypt(uint8_t *src, uint8_t *dst, uint32_t length, uin
     return error;
 }
 
+// The encrypted blocks are larger than the plaintext ones, so going front
+// to back every block would overwrite plaintext not read yet. Going back to
+// front, a block only overwrites its own plaintext and that of the blocks
+// after it, which are done; EncryptBlocks reads up to StagedBlocks() blocks
+// completely before writing any. The random bytes are still drawn in block
+// order, so the output matches encrypting into a separate buffer.
+EMumError CMumRenderer::EncryptInPlace(uint8_t *data, uint32_t length, uint32_t *outlength, uint16_t seqNum)
+{
+    uint32_t plaintextBlockSize = mMumInfo->plaintextBlockSize;
+    uint32_t blockSize = mMumInfo->encryptedBlockSize;
+    uint32_t paddingSize = mMumInfo->paddingSize;
+    uint32_t numBlocks = length / plaintextBlockSize;
+    uint32_t tail = length % plaintextBlockSize;
+    uint32_t numDrawn = numBlocks + (tail ? 1 : 0);
+    EMumError error = MUM_ERROR_OK;
+
+    *outlength = 0;
+    // blocks that come out late are written behind the ones going in
+    if (blockLatency != 0)
+        return MUM_ERROR_OVERLAPPING_BUFFERS;
+
+    // same Fetch calls as SetPadding, which replays them
+    uint8_t *drawn = new uint8_t[numDrawn * paddingSize + plaintextBlockSize];
+    for (uint32_t b = 0; b < numDrawn; b++)
+        mPrng->Fetch(drawn + b * paddingSize, paddingSize);
+    if (tail)
+        mPrng->Fetch(drawn + numDrawn * paddingSize, plaintextBlockSize - tail);
+
+    if (tail)
+    {
+        uint8_t last[MUM_MAX_BLOCK_SIZE];
+        memcpy(last, data + numBlocks * plaintextBlockSize, tail);
+        mPaddingReplay = drawn + numBlocks * paddingSize;
+        error = EncryptBlock(last, data + numBlocks * blockSize, tail, (uint16_t)(seqNum + numBlocks));
+    }
+    uint32_t stagedBlocks = StagedBlocks();
+    uint32_t b = numBlocks;
+    while (error == MUM_ERROR_OK && b > 0)
+    {
+        uint32_t n = (b < stagedBlocks) ? b : stagedBlocks;
+        b -= n;
+        mPaddingReplay = drawn + b * paddingSize;
+        error = EncryptBlocks(data + b * plaintextBlockSize, data + b * blockSize, n, (uint16_t)(seqNum + b));
+    }
+    mPaddingReplay = nullptr;
+    delete[] drawn;
+    if (error != MUM_ERROR_OK)
+        return error;
+    *outlength = numDrawn * blockSize;
+    return MUM_ERROR_OK;
+}
+
+// In place needs nothing special: a block never unpacks to more bytes than
+// it has, and both paths read a block before writing its plaintext.
 EMumError CMumRenderer::Decrypt(uint8_t *src, uint8_t *dst, uint32_t length, uint32_t *outlength)
 {
     uint32_t seqnum = 0;
@@ -173,6 +313,12 @@ EMumError CMumRenderer::Decrypt(uint8_t *src, uint8_t *dst, uint32_t length, uin
         return MUM_ERROR_INVALID_DECRYPT_SIZE;
 
     *outlength = 0;
+    mLargeBuffer = IsLargeBuffer(length);
+    if (blockLatency == 0 && length >= 2 * mMumInfo->encryptedBlockSize)
+    {
+        uint32_t numBlocks = length / mMumInfo->encryptedBlockSize;
+        return DecryptBlocks(src, dst, numBlocks, outlength);
+    }
     while (length)
     {
         uint32_t encryptSize = 0;
@@ -210,7 +356,7 @@ EMumError CMumRenderer::EncryptBlock(uint8_t *src, uint8_t *dst, uint32_t length
     if (mMumInfo->paddingOn)
     {
         SetPadding(src, length);
-        EMumError error = (this->*packData)(src, length, seqnum);
+        EMumError error = PackData(mPackedData, src, length, seqnum);
         if (error != MUM_ERROR_OK) return error;
         EncryptUpload(mPackedData);
     }
@@ -219,11 +365,7 @@ EMumError CMumRenderer::EncryptBlock(uint8_t *src, uint8_t *dst, uint32_t length
         EncryptUpload(src);
     }
 
-    for (uint32_t r = 0; r < mMumInfo->numRoundsPerBlock; r++)
-    {
-        EncryptDiffuse(r);
-        EncryptConfuse(r);
-    }
+    EncryptRounds();
 
     EncryptDownload(dst);
 
@@ -236,18 +378,14 @@ EMumError CMumRenderer::EncryptBlock(uint8_t *src, uint8_t *dst, uint32_t length
 EMumError CMumRenderer::DecryptBlock(uint8_t *src, uint8_t *dst, uint32_t *length, uint32_t *seqnum)
 {
     DecryptUpload(src);
-    for (int r = mMumInfo->numRoundsPerBlock - 1; r >= 0; r-- )
-    {
-        DecryptConfuse((uint32_t)r);
-        DecryptDiffuse((uint32_t)r);
-    }
+    DecryptRounds();
     numDecryptedBlocks++;
     if (numDecryptedBlocks <= blockLatency)
         return MUM_ERROR_BUFFER_WAIT_DECRYPT;
     if (mMumInfo->paddingOn)
     {
         DecryptDownload(mPackedData);
-        EMumError error = (this->*unpackData)(dst, length, seqnum);
+        EMumError error = UnpackData(mPackedData, dst, length, seqnum);
         if (error != MUM_ERROR_OK) return error;
     }
     else
@@ -259,493 +397,197 @@ EMumError CMumRenderer::DecryptBlock(uint8_t *src, uint8_t *dst, uint32_t *lengt
 }
 
 
-EMumError CMumRenderer::PackDataR32(uint8_t *unpackedData, uint32_t length, uint32_t seqnum)
-{
-    TMumBlockR32 *block = (TMumBlockR32 *)mPackedData;
-
-    if (length > MUM_ENCRYPT_SIZE_R32)
-        return MUM_ERROR_INVALID_ENCRYPT_SIZE;
-
-    uint32_t checksum = ComputeChecksum(unpackedData, MUM_ENCRYPT_SIZE_R32);
-
-    // first third of padding
-    memcpy(block->paddingA, &mPadding[0], 32);
-
-    // part A of data
-    memcpy(block->dataA, unpackedData, MUM_BLOCK_SIZE_A_R32);
-    unpackedData += MUM_BLOCK_SIZE_A_R32;
-
-    // second part of paddingxx
-    memcpy(block->paddingB, &mPadding[32], 12);
-
-    block->checksum[0] = (uint8_t)checksum;
-    checksum >>= 8;
-    block->checksum[1] = (uint8_t)checksum;
-    checksum >>= 8;
-    block->checksum[2] = (uint8_t)checksum;
-    checksum >>= 8;
-    block->checksum[3] = (uint8_t)checksum;
-    length += (MUM_BLOCKTYPE_4096 << MUM_LENGTH_BLOCKTYPE_SHIFT);
-    block->length[0] = (uint8_t)(length % 256);
-    block->length[1] = (uint8_t)(length / 256);
-    block->seqnum[0] = (uint8_t)(seqnum % 256);
-    block->seqnum[1] = (uint8_t)(seqnum / 256);
-
-
-    // third part of padding
-    memcpy(block->paddingC, &mPadding[44], 12);
-
-    // second part of data
-    memcpy(block->dataB, unpackedData, MUM_BLOCK_SIZE_B_R32);
-
-    // fourth part of padding
-    memcpy(block->paddingD, &mPadding[56], 32);
-    return MUM_ERROR_OK;
-}
-
-EMumError CMumRenderer::UnpackDataR32(uint8_t *unpackedData, uint32_t *length, uint32_t *seqnum)
+// Block by block; renderers that can interleave several blocks override
+// these.
+EMumError CMumRenderer::EncryptBlocks(uint8_t *src, uint8_t *dst, uint32_t numBlocks, uint32_t seqnum)
 {
-    TMumBlockR32 *block = (TMumBlockR32 *)mPackedData;
-
-    memcpy(unpackedData, block->dataA, MUM_BLOCK_SIZE_A_R32);
-    memcpy(unpackedData + MUM_BLOCK_SIZE_A_R32, block->dataB, MUM_BLOCK_SIZE_B_R32);
-
-    uint32_t lengthField = block->length[0];
-    lengthField += block->length[1] << 8;
-    if (((lengthField & MUM_LENGTH_BLOCKTYPE_MASK) >> MUM_LENGTH_BLOCKTYPE_SHIFT) != MUM_BLOCKTYPE_4096)
-        return MUM_ERROR_INVALID_ENCRYPTED_BLOCK;
-    *length = (lengthField & MUM_LENGTH_LENGTH_MASK);
-    if (*length > MUM_ENCRYPT_SIZE_R32)
-    {
-        *length = 0;
-        return MUM_ERROR_INVALID_ENCRYPTED_BLOCK;
-    }
-
-    uint32_t checksumA = block->checksum[0];
-    checksumA += block->checksum[1] << 8;
-    checksumA += block->checksum[2] << 16;
-    checksumA += block->checksum[3] << 24;
-    uint32_t checksumB = ComputeChecksum(unpackedData, MUM_ENCRYPT_SIZE_R32);
-    if (checksumA != checksumB)
+    for (uint32_t b = 0; b < numBlocks; b++)
     {
-        *length = 0;
-        return MUM_ERROR_INVALID_ENCRYPTED_BLOCK;
+        EMumError error = EncryptBlock(src, dst, mMumInfo->plaintextBlockSize, (uint16_t)(seqnum + b));
+        if (error != MUM_ERROR_OK)
+            return error;
+        src += mMumInfo->plaintextBlockSize;
+        dst += mMumInfo->encryptedBlockSize;
     }
-
-    *seqnum = block->seqnum[0];
-    *seqnum += block->seqnum[1] << 8;
     return MUM_ERROR_OK;
 }
 
-
-EMumError CMumRenderer::PackDataR16(uint8_t *unpackedData, uint32_t length, uint32_t seqnum)
-{
-    TMumBlockR16 *block = (TMumBlockR16 *)mPackedData;
-
-    if (length > MUM_ENCRYPT_SIZE_R16)
-        return MUM_ERROR_INVALID_ENCRYPT_SIZE;
-
-    uint32_t checksum = ComputeChecksum(unpackedData, MUM_ENCRYPT_SIZE_R16);
-
-    // first third of padding
-    memcpy(block->paddingA, &mPadding[0], 16);
-
-    // part A of data
-    memcpy(block->dataA, unpackedData, MUM_BLOCK_SIZE_A_R16);
-    unpackedData += MUM_BLOCK_SIZE_A_R16;
-
-    // second part of padding
-    memcpy(block->paddingB, &mPadding[16], 4);
-
-
-    block->checksum[0] = (uint8_t)checksum;
-    checksum >>= 8;
-    block->checksum[1] = (uint8_t)checksum;
-    checksum >>= 8;
-    block->checksum[2] = (uint8_t)checksum;
-    checksum >>= 8;
-    block->checksum[3] = (uint8_t)checksum;
-    length += (MUM_BLOCKTYPE_2048 << MUM_LENGTH_BLOCKTYPE_SHIFT);
-    block->length[0] = (uint8_t)(length % 256);
-    block->length[1] = (uint8_t)(length / 256);
-    block->seqnum[0] = (uint8_t)(seqnum % 256);
-    block->seqnum[1] = (uint8_t)(seqnum / 256);
-
-
-    // third part of padding
-    memcpy(block->paddingC, &mPadding[20], 4);
-
-    // second part of data
-    memcpy(block->dataB, unpackedData, MUM_BLOCK_SIZE_B_R16);
-
-    // fourth part of padding
-    memcpy(block->paddingD, &mPadding[24], 16);
-    return MUM_ERROR_OK;
-}
-
-EMumError CMumRenderer::UnpackDataR16(uint8_t *unpackedData, uint32_t *length, uint32_t *seqnum)
+EMumError CMumRenderer::DecryptBlocks(uint8_t *src, uint8_t *dst, uint32_t numBlocks, uint32_t *outlength)
 {
-    TMumBlockR16 *block = (TMumBlockR16 *)mPackedData;
-
-    memcpy(unpackedData, block->dataA, MUM_BLOCK_SIZE_A_R16);
-    memcpy(unpackedData + MUM_BLOCK_SIZE_A_R16, block->dataB, MUM_BLOCK_SIZE_B_R16);
-
-    uint32_t lengthField = block->length[0];
-    lengthField += block->length[1] << 8;
-    if (((lengthField & MUM_LENGTH_BLOCKTYPE_MASK) >> MUM_LENGTH_BLOCKTYPE_SHIFT) != MUM_BLOCKTYPE_2048)
-        return MUM_ERROR_INVALID_ENCRYPTED_BLOCK;
-    *length = (lengthField & MUM_LENGTH_LENGTH_MASK);
-    if (*length > MUM_ENCRYPT_SIZE_R16)
-    {
-        *length = 0;
-        return MUM_ERROR_INVALID_ENCRYPTED_BLOCK;
-    }
+    uint32_t length, seqnum;
 
-    uint32_t checksumA = block->checksum[0];
-    checksumA += block->checksum[1] << 8;
-    checksumA += block->checksum[2] << 16;
-    checksumA += block->checksum[3] << 24;
-    uint32_t checksumB = ComputeChecksum(unpackedData, MUM_ENCRYPT_SIZE_R16);
-    if (checksumA != checksumB)
+    *outlength = 0;
+    for (uint32_t b = 0; b < numBlocks; b++)
     {
-        *length = 0;
-        return MUM_ERROR_INVALID_ENCRYPTED_BLOCK;
+        EMumError error = DecryptBlock(src, dst, &length, &seqnum);
+        if (error != MUM_ERROR_OK)
+            return error;
+        src += mMumInfo->encryptedBlockSize;
+        dst += length;
+        *outlength += length;
     }
-
-    *seqnum = block->seqnum[0];
-    *seqnum += block->seqnum[1] << 8;
     return MUM_ERROR_OK;
 }
 
 
-EMumError CMumRenderer::PackDataR8(uint8_t *unpackedData, uint32_t length, uint32_t seqnum)
-{
-    TMumBlockR8 *block = (TMumBlockR8 *)mPackedData;
-
-    if (length > MUM_ENCRYPT_SIZE_R8)
-        return MUM_ERROR_INVALID_ENCRYPT_SIZE;
-
-    uint32_t checksum = ComputeChecksum(unpackedData, MUM_ENCRYPT_SIZE_R8);
-
-    // first third of padding
-    memcpy(block->paddingA, &mPadding[0], 4);
-
-    // part A of data
-    memcpy(block->dataA, unpackedData, MUM_BLOCK_SIZE_A_R8);
-    unpackedData += MUM_BLOCK_SIZE_A_R8;
-
-    // second part of padding
-    memcpy(block->paddingB, &mPadding[4], 4);
-
-
-    block->checksum[0] = (uint8_t)checksum;
-    checksum >>= 8;
-    block->checksum[1] = (uint8_t)checksum;
-    checksum >>= 8;
-    block->checksum[2] = (uint8_t)checksum;
-    checksum >>= 8;
-    block->checksum[3] = (uint8_t)checksum;
-    length += (MUM_BLOCKTYPE_1024 << MUM_LENGTH_BLOCKTYPE_SHIFT);
-    block->length[0] = (uint8_t)(length % 256);
-    block->length[1] = (uint8_t)(length / 256);
-    block->seqnum[0] = (uint8_t)(seqnum % 256);
-    block->seqnum[1] = (uint8_t)(seqnum / 256);
-
-    // third part of padding
-    memcpy(block->paddingC, &mPadding[8], 4);
-
-    // second part of data
-    memcpy(block->dataB, unpackedData, MUM_BLOCK_SIZE_B_R8);
-
-    // fourth part of padding
-    memcpy(block->paddingD, &mPadding[12], 4);
-    return MUM_ERROR_OK;
-}
-
-EMumError CMumRenderer::UnpackDataR8(uint8_t *unpackedData, uint32_t *length, uint32_t *seqnum)
+// All rounds of the uploaded block, one pass at a time. Renderers that
+// can run the rounds in one go override these.
+void CMumRenderer::EncryptRounds()
 {
-    TMumBlockR8 *block = (TMumBlockR8 *)mPackedData;
-
-    memcpy(unpackedData, block->dataA, MUM_BLOCK_SIZE_A_R8);
-    memcpy(unpackedData + MUM_BLOCK_SIZE_A_R8, block->dataB, MUM_BLOCK_SIZE_B_R8);
-
-    uint32_t lengthField = block->length[0];
-    lengthField += block->length[1] << 8;
-    if (((lengthField & MUM_LENGTH_BLOCKTYPE_MASK) >> MUM_LENGTH_BLOCKTYPE_SHIFT) != MUM_BLOCKTYPE_1024)
-        return MUM_ERROR_INVALID_ENCRYPTED_BLOCK;
-    *length = (lengthField & MUM_LENGTH_LENGTH_MASK);
-    if (*length > MUM_ENCRYPT_SIZE_R8)
+    for (uint32_t r = 0; r < mMumInfo->numRoundsPerBlock; r++)
     {
-        *length = 0;
-        return MUM_ERROR_INVALID_ENCRYPTED_BLOCK;
+        EncryptDiffuse(r);
+        EncryptConfuse(r);
     }
+}
 
-    uint32_t checksumA = block->checksum[0];
-    checksumA += block->checksum[1] << 8;
-    checksumA += block->checksum[2] << 16;
-    checksumA += block->checksum[3] << 24;
-    uint32_t checksumB = ComputeChecksum(unpackedData, MUM_ENCRYPT_SIZE_R8);
-    if (checksumA != checksumB)
+void CMumRenderer::DecryptRounds()
+{
+    for (int r = mMumInfo->numRoundsPerBlock - 1; r >= 0; r-- )
     {
-        *length = 0;
-        return MUM_ERROR_INVALID_ENCRYPTED_BLOCK;
+        DecryptConfuse((uint32_t)r);
+        DecryptDiffuse((uint32_t)r);
     }
-
-    *seqnum = block->seqnum[0];
-    *seqnum += block->seqnum[1] << 8;
-    return MUM_ERROR_OK;
 }
 
 
-EMumError CMumRenderer::PackDataR4(uint8_t *unpackedData, uint32_t length, uint32_t seqnum)
+// The padding runs take consecutive bytes of mPadding, A first. The
+// checksum, length and seqnum fields are little endian and adjacent, so
+// the block info is written as one 64-bit store. Instantiated per block
+// type, the layout is a constant: every part is copied with moves of its
+// exact size, and the data parts with fixed trip counts.
+template <EMumBlockType blockType>
+EMumError CMumRenderer::PackBlock(uint8_t *packedData, uint8_t *unpackedData, uint32_t length, uint32_t seqnum)
 {
-    TMumBlockR4 *block = (TMumBlockR4 *)mPackedData;
+    const TMumBlockLayout &layout = mumBlockLayouts[blockType - MUM_BLOCKTYPE_128];
+    uint8_t *padding = mPadding;
 
-    if (length > MUM_ENCRYPT_SIZE_R4)
+    if (length > layout.encryptSize)
         return MUM_ERROR_INVALID_ENCRYPT_SIZE;
 
-    uint32_t checksum = ComputeChecksum(unpackedData, MUM_ENCRYPT_SIZE_R4);
-
-    // first third of padding
-    memcpy(block->paddingA, &mPadding[0], 2);
-
-    // part A of data
-    memcpy(block->dataA, unpackedData, MUM_BLOCK_SIZE_A_R4);
-    unpackedData += MUM_BLOCK_SIZE_A_R4;
-
-    // second part of padding
-    memcpy(block->paddingB, &mPadding[2], 2);
-
-
-    block->checksum[0] = (uint8_t)checksum;
-    checksum >>= 8;
-    block->checksum[1] = (uint8_t)checksum;
-    checksum >>= 8;
-    block->checksum[2] = (uint8_t)checksum;
-    checksum >>= 8;
-    block->checksum[3] = (uint8_t)checksum;
-    length += (MUM_BLOCKTYPE_512 << MUM_LENGTH_BLOCKTYPE_SHIFT);
-    block->length[0] = (uint8_t)(length % 256);
-    block->length[1] = (uint8_t)(length / 256);
-    block->seqnum[0] = (uint8_t)(seqnum % 256);
-    block->seqnum[1] = (uint8_t)(seqnum / 256);
-
-
-    // third part of padding
-    memcpy(block->paddingC, &mPadding[4], 2);
-
-    // second part of data
-    memcpy(block->dataB, unpackedData, MUM_BLOCK_SIZE_B_R4);
-
-    // fourth part of padding
-    memcpy(block->paddingD, &mPadding[6], 2);
+    memcpy(packedData + layout.paddingA, padding, layout.paddingASize);
+    padding += layout.paddingASize;
+    memcpy(packedData + layout.paddingB, padding, layout.paddingBSize);
+    padding += layout.paddingBSize;
+    memcpy(packedData + layout.paddingC, padding, layout.paddingCSize);
+    padding += layout.paddingCSize;
+    memcpy(packedData + layout.paddingD, padding, layout.paddingDSize);
+
+    // both parts of data, summed into the checksum as they are copied
+    uint32_t checksum = CopyChecksum(packedData + layout.dataA, unpackedData, layout.dataASize, 0);
+    checksum += CopyChecksum(packedData + layout.dataB, unpackedData + layout.dataASize, layout.dataBSize, layout.dataASize);
+
+    uint32_t lengthField = length + (blockType << MUM_LENGTH_BLOCKTYPE_SHIFT);
+    uint64_t info = checksum;
+    info |= (uint64_t)(lengthField & 0xffff) << 32;
+    info |= (uint64_t)(seqnum & 0xffff) << 48;
+    memcpy(packedData + layout.info, &info, sizeof(info));
     return MUM_ERROR_OK;
 }
 
-EMumError CMumRenderer::UnpackDataR4(uint8_t *unpackedData, uint32_t *length, uint32_t *seqnum)
+template <EMumBlockType blockType>
+EMumError CMumRenderer::UnpackBlock(uint8_t *packedData, uint8_t *unpackedData, uint32_t *length, uint32_t *seqnum)
 {
-    TMumBlockR4 *block = (TMumBlockR4 *)mPackedData;
+    const TMumBlockLayout &layout = mumBlockLayouts[blockType - MUM_BLOCKTYPE_128];
 
-    memcpy(unpackedData, block->dataA, MUM_BLOCK_SIZE_A_R4);
-    memcpy(unpackedData + MUM_BLOCK_SIZE_A_R4, block->dataB, MUM_BLOCK_SIZE_B_R4);
+    uint32_t checksumB = CopyChecksum(unpackedData, packedData + layout.dataA, layout.dataASize, 0);
+    checksumB += CopyChecksum(unpackedData + layout.dataASize, packedData + layout.dataB, layout.dataBSize, layout.dataASize);
 
-    uint32_t lengthField = block->length[0];
-    lengthField += block->length[1] << 8;
-    if (((lengthField & MUM_LENGTH_BLOCKTYPE_MASK) >> MUM_LENGTH_BLOCKTYPE_SHIFT) != MUM_BLOCKTYPE_512)
+    uint64_t info;
+    memcpy(&info, packedData + layout.info, sizeof(info));
+    uint32_t lengthField = (uint32_t)(info >> 32) & 0xffff;
+    if (((lengthField & MUM_LENGTH_BLOCKTYPE_MASK) >> MUM_LENGTH_BLOCKTYPE_SHIFT) != (uint32_t)blockType)
         return MUM_ERROR_INVALID_ENCRYPTED_BLOCK;
     *length = (lengthField & MUM_LENGTH_LENGTH_MASK);
-    if (*length > MUM_ENCRYPT_SIZE_R4)
+    if (*length > layout.encryptSize)
     {
         *length = 0;
         return MUM_ERROR_INVALID_ENCRYPTED_BLOCK;
     }
 
-    uint32_t checksumA = block->checksum[0];
-    checksumA += block->checksum[1] << 8;
-    checksumA += block->checksum[2] << 16;
-    checksumA += block->checksum[3] << 24;
-    uint32_t checksumB = ComputeChecksum(unpackedData, MUM_ENCRYPT_SIZE_R4);
+    uint32_t checksumA = (uint32_t)info;
     if (checksumA != checksumB)
     {
         *length = 0;
         return MUM_ERROR_INVALID_ENCRYPTED_BLOCK;
     }
 
-    *seqnum = block->seqnum[0];
-    *seqnum += block->seqnum[1] << 8;
-    return MUM_ERROR_OK;
-}
-
-
-EMumError CMumRenderer::PackDataR2(uint8_t *unpackedData, uint32_t length, uint32_t seqnum)
-{
-    TMumBlockR2 *block = (TMumBlockR2 *)mPackedData;
-
-    if (length > MUM_ENCRYPT_SIZE_R2)
-        return MUM_ERROR_INVALID_ENCRYPT_SIZE;
-
-    uint32_t checksum = ComputeChecksum(unpackedData, MUM_ENCRYPT_SIZE_R2);
-
-    // first third of padding
-    memcpy(block->paddingA, &mPadding[0], 2);
-
-    // part A of data
-    memcpy(block->dataA, unpackedData, MUM_BLOCK_SIZE_A_R2);
-    unpackedData += MUM_BLOCK_SIZE_A_R2;
-
-    // second part of padding
-    memcpy(block->paddingB, &mPadding[2], 2);
-
-
-    block->checksum[0] = (uint8_t)checksum;
-    checksum >>= 8;
-    block->checksum[1] = (uint8_t)checksum;
-    checksum >>= 8;
-    block->checksum[2] = (uint8_t)checksum;
-    checksum >>= 8;
-    block->checksum[3] = (uint8_t)checksum;
-    length += (MUM_BLOCKTYPE_256 << MUM_LENGTH_BLOCKTYPE_SHIFT);
-    block->length[0] = (uint8_t)(length % 256);
-    block->length[1] = (uint8_t)(length / 256);
-    block->seqnum[0] = (uint8_t)(seqnum % 256);
-    block->seqnum[1] = (uint8_t)(seqnum / 256);
-
-    // third part of padding
-    memcpy(block->paddingC, &mPadding[4], 2);
-
-    // second part of data
-    memcpy(block->dataB, unpackedData, MUM_BLOCK_SIZE_B_R2);
-
-    // fourth part of padding
-    memcpy(block->paddingD, &mPadding[6], 2);
+    *seqnum = (uint32_t)(info >> 48);
     return MUM_ERROR_OK;
 }
 
-EMumError CMumRenderer::UnpackDataR2(uint8_t *unpackedData, uint32_t *length, uint32_t *seqnum)
+EMumError CMumRenderer::PackData(uint8_t *packedData, uint8_t *unpackedData, uint32_t length, uint32_t seqnum)
 {
-    TMumBlockR2 *block = (TMumBlockR2 *)mPackedData;
-
-    memcpy(unpackedData, block->dataA, MUM_BLOCK_SIZE_A_R2);
-    memcpy(unpackedData + MUM_BLOCK_SIZE_A_R2, block->dataB, MUM_BLOCK_SIZE_B_R2);
-
-    uint32_t lengthField = block->length[0];
-    lengthField += block->length[1] << 8;
-    if (((lengthField & MUM_LENGTH_BLOCKTYPE_MASK) >> MUM_LENGTH_BLOCKTYPE_SHIFT) != MUM_BLOCKTYPE_256)
-        return MUM_ERROR_INVALID_ENCRYPTED_BLOCK;
-    *length = (lengthField & MUM_LENGTH_LENGTH_MASK);
-    if (*length > MUM_ENCRYPT_SIZE_R2)
-    {
-        *length = 0;
-        return MUM_ERROR_INVALID_ENCRYPTED_BLOCK;
-    }
-
-    uint32_t checksumA = block->checksum[0];
-    checksumA += block->checksum[1] << 8;
-    checksumA += block->checksum[2] << 16;
-    checksumA += block->checksum[3] << 24;
-    uint32_t checksumB = ComputeChecksum(unpackedData, MUM_ENCRYPT_SIZE_R2);
-    if (checksumA != checksumB)
+    switch (mBlockLayout->blockType)
     {
-        *length = 0;
-        return MUM_ERROR_INVALID_ENCRYPTED_BLOCK;
+    case MUM_BLOCKTYPE_128: return PackBlock<MUM_BLOCKTYPE_128>(packedData, unpackedData, length, seqnum);
+    case MUM_BLOCKTYPE_256: return PackBlock<MUM_BLOCKTYPE_256>(packedData, unpackedData, length, seqnum);
+    case MUM_BLOCKTYPE_512: return PackBlock<MUM_BLOCKTYPE_512>(packedData, unpackedData, length, seqnum);
+    case MUM_BLOCKTYPE_1024: return PackBlock<MUM_BLOCKTYPE_1024>(packedData, unpackedData, length, seqnum);
+    case MUM_BLOCKTYPE_2048: return PackBlock<MUM_BLOCKTYPE_2048>(packedData, unpackedData, length, seqnum);
+    case MUM_BLOCKTYPE_4096: return PackBlock<MUM_BLOCKTYPE_4096>(packedData, unpackedData, length, seqnum);
+    default: return PackBlock<MUM_BLOCKTYPE_8192>(packedData, unpackedData, length, seqnum);
     }
-
-    *seqnum = block->seqnum[0];
-    *seqnum += block->seqnum[1] << 8;
-    return MUM_ERROR_OK;
 }
 
-
-EMumError CMumRenderer::PackDataR1(uint8_t *unpackedData, uint32_t length, uint32_t seqnum)
+EMumError CMumRenderer::UnpackData(uint8_t *packedData, uint8_t *unpackedData, uint32_t *length, uint32_t *seqnum)
 {
-    TMumBlockR1 *block = (TMumBlockR1 *)mPackedData;
-
-    if (length > MUM_ENCRYPT_SIZE_R1)
-        return MUM_ERROR_INVALID_ENCRYPT_SIZE;
-
-    uint32_t checksum = ComputeChecksum(unpackedData, MUM_ENCRYPT_SIZE_R1);
-
-    // first third of padding
-    memcpy(block->paddingA, &mPadding[0], 2);
-
-    // part A of data
-    memcpy(block->dataA, unpackedData, MUM_BLOCK_SIZE_A_R1);
-    unpackedData += MUM_BLOCK_SIZE_A_R1;
-
-    // second part of padding
-    memcpy(block->paddingB, &mPadding[2], 2);
-
-    block->checksum[0] = (uint8_t)checksum;
-    checksum >>= 8;
-    block->checksum[1] = (uint8_t)checksum;
-    checksum >>= 8;
-    block->checksum[2] = (uint8_t)checksum;
-    checksum >>= 8;
-    block->checksum[3] = (uint8_t)checksum;
-    length += (MUM_BLOCKTYPE_128 << MUM_LENGTH_BLOCKTYPE_SHIFT);
-    block->length[0] = (uint8_t)(length % 256);
-    block->length[1] = (uint8_t)(length / 256);
-    block->seqnum[0] = (uint8_t)(seqnum % 256);
-    block->seqnum[1] = (uint8_t)(seqnum / 256);
-
-
-    // third part of padding
-    memcpy(block->paddingC, &mPadding[4], 2);
-
-    // second part of data
-    memcpy(block->dataB, unpackedData, MUM_BLOCK_SIZE_B_R1);
-
-    // fourth part of padding
-    memcpy(block->paddingD, &mPadding[6], 2);
-    return MUM_ERROR_OK;
+    switch (mBlockLayout->blockType)
+    {
+    case MUM_BLOCKTYPE_128: return UnpackBlock<MUM_BLOCKTYPE_128>(packedData, unpackedData, length, seqnum);
+    case MUM_BLOCKTYPE_256: return UnpackBlock<MUM_BLOCKTYPE_256>(packedData, unpackedData, length, seqnum);
+    case MUM_BLOCKTYPE_512: return UnpackBlock<MUM_BLOCKTYPE_512>(packedData, unpackedData, length, seqnum);
+    case MUM_BLOCKTYPE_1024: return UnpackBlock<MUM_BLOCKTYPE_1024>(packedData, unpackedData, length, seqnum);
+    case MUM_BLOCKTYPE_2048: return UnpackBlock<MUM_BLOCKTYPE_2048>(packedData, unpackedData, length, seqnum);
+    case MUM_BLOCKTYPE_4096: return UnpackBlock<MUM_BLOCKTYPE_4096>(packedData, unpackedData, length, seqnum);
+    default: return UnpackBlock<MUM_BLOCKTYPE_8192>(packedData, unpackedData, length, seqnum);
+    }
 }
 
-EMumError CMumRenderer::UnpackDataR1(uint8_t *unpackedData, uint32_t *length, uint32_t *seqnum)
+// The block checksum is the wraparound sum of the plaintext's 32-bit
+// little-endian words, so byte i of the plaintext adds byte << 8*(i%4).
+// A part of the plaintext starting at byte offset reads its words offset%4
+// bytes out of step; rotating each word by that many bytes puts every byte
+// back in its place, and the sum comes out exactly as over the whole
+// plaintext at once.
+uint32_t CMumRenderer::CopyChecksum(uint8_t *dst, uint8_t *src, uint32_t size, uint32_t offset)
 {
-    TMumBlockR1 *block = (TMumBlockR1 *)mPackedData;
-
-    memcpy(unpackedData, block->dataA, MUM_BLOCK_SIZE_A_R1);
-    memcpy(unpackedData + MUM_BLOCK_SIZE_A_R1, block->dataB, MUM_BLOCK_SIZE_B_R1);
+    uint32_t checksum = 0;
+    uint32_t rotate = 8 * (offset & 3);
+    uint32_t i = 0;
 
-    uint32_t lengthField = block->length[0];
-    lengthField += block->length[1] << 8;
-    if (((lengthField & MUM_LENGTH_BLOCKTYPE_MASK) >> MUM_LENGTH_BLOCKTYPE_SHIFT) != MUM_BLOCKTYPE_128)
-        return MUM_ERROR_INVALID_ENCRYPTED_BLOCK;
-    *length = (lengthField & MUM_LENGTH_LENGTH_MASK);
-    if (*length > MUM_ENCRYPT_SIZE_R1)
+    if (mMumInfo->cpuFeatures & MUM_CPU_FEATURE_AVX2)
     {
-        *length = 0;
-        return MUM_ERROR_INVALID_ENCRYPTED_BLOCK;
+        i = size & ~(MUM_AVX2_CHECKSUM_CHUNK - 1);
+        checksum = MumCopyChecksumAvx2(dst, src, i, rotate);
     }
-
-    uint32_t checksumA = block->checksum[0];
-    checksumA += block->checksum[1] << 8;
-    checksumA += block->checksum[2] << 16;
-    checksumA += block->checksum[3] << 24;
-    uint32_t checksumB = ComputeChecksum(unpackedData, MUM_ENCRYPT_SIZE_R1);
-    if (checksumA != checksumB)
+    for ( ; i + 4 <= size; i += 4)
     {
-        *length = 0;
-        return MUM_ERROR_INVALID_ENCRYPTED_BLOCK;
+        uint32_t word;
+        memcpy(&word, src + i, 4);
+        memcpy(dst + i, &word, 4);
+        checksum += rotate ? (word << rotate) | (word >> (32 - rotate)) : word;
+    }
+    for ( ; i < size; i++)
+    {
+        dst[i] = src[i];
+        checksum += (uint32_t)src[i] << (8 * ((offset + i) & 3));
     }
-
-    *seqnum = block->seqnum[0];
-    *seqnum += block->seqnum[1] << 8;
-    return MUM_ERROR_OK;
-}
-
-uint32_t CMumRenderer::ComputeChecksum(uint8_t *data, uint32_t size)
-{
-    uint32_t checksum = 0;
-    uint32_t *iptr = (uint32_t *)data;
-    for (uint32_t i = 0; i < size / 4; i++)
-        checksum += *iptr++;
     return checksum;
 }
 
 
 void CMumRenderer::SetPadding(uint8_t *src, uint32_t length)
 {
+    if (mPaddingReplay != nullptr)
+    {
+        // drawn ahead, see EncryptInPlace
+        memcpy(mPadding, mPaddingReplay, mMumInfo->paddingSize);
+        mPaddingReplay += mMumInfo->paddingSize;
+        if (length < mMumInfo->plaintextBlockSize)
+            memcpy(&src[length], mPaddingReplay, mMumInfo->plaintextBlockSize - length);
+        return;
+    }
     mPrng->Fetch(mPadding, mMumInfo->paddingSize);
     if (length < mMumInfo->plaintextBlockSize)
         mPrng->Fetch(&src[length], mMumInfo->plaintextBlockSize - length);
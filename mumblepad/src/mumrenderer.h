@@ -34,6 +34,13 @@
 #include "mumdefines.h"
 #include "mumprng.h"
 
+// the layout of blockType's packed block
+extern const TMumBlockLayout *MumGetBlockLayout(EMumBlockType blockType);
+// brings size bytes at src towards the caches, one cache line at a time
+extern void MumPrefetch(const uint8_t *src, uint32_t size);
+// memcpy with non-temporal stores: dst bypasses the caches
+extern void MumStreamCopy(uint8_t *dst, const uint8_t *src, uint32_t size);
+
 class CMumRenderer {
 
 public:
@@ -45,6 +52,22 @@ public:
     virtual EMumError DecryptBlock(uint8_t *src, uint8_t *dst, uint32_t *length, uint32_t *seqnum);
     virtual EMumError Encrypt(uint8_t *src, uint8_t *dst, uint32_t length, uint32_t *outlength, uint16_t seqNum);
     virtual EMumError Decrypt(uint8_t *src, uint8_t *dst, uint32_t length, uint32_t *outlength);
+    // Encrypt and Decrypt with the priority of their work on the shared
+    // workers; the renderers without workers ignore it
+    virtual EMumError EncryptWithPriority(uint8_t *src, uint8_t *dst, uint32_t length, uint32_t *outlength, uint16_t seqNum,
+        EMumPriority priority)
+    {
+        return Encrypt(src, dst, length, outlength, seqNum);
+    }
+    virtual EMumError DecryptWithPriority(uint8_t *src, uint8_t *dst, uint32_t length, uint32_t *outlength,
+        EMumPriority priority)
+    {
+        return Decrypt(src, dst, length, outlength);
+    }
+    // numBlocks full blocks; plaintext in, numBlocks encrypted blocks out
+    virtual EMumError EncryptBlocks(uint8_t *src, uint8_t *dst, uint32_t numBlocks, uint32_t seqnum);
+    // numBlocks encrypted blocks in, the unpacked data back to back out
+    virtual EMumError DecryptBlocks(uint8_t *src, uint8_t *dst, uint32_t numBlocks, uint32_t *outlength);
 
 
     virtual void EncryptDiffuse(uint32_t round) = 0;
@@ -56,37 +79,85 @@ public:
     virtual void DecryptUpload(uint8_t *data) = 0;
     virtual void DecryptDownload(uint8_t *data) = 0;
     virtual void InitKey() = 0;
-
-    void ResetEncryption() { numEncryptedBlocks = 0; }
-    void ResetDecryption() { numDecryptedBlocks = 0; }
+    // the engine changed cpuFeatures, tileBlocks or largeBufferSize; only
+    // the MT renderer keeps copies of them
+    virtual void SettingsChanged() {}
+    virtual void EncryptRounds();
+    virtual void DecryptRounds();
+
+    // full blocks EncryptBlocks reads completely before writing any, so
+    // they may share the buffer with their encrypted blocks
+    virtual uint32_t StagedBlocks() { return 1; }
+    // whether an Encrypt or Decrypt of length bytes runs in the large-buffer mode
+    virtual bool IsLargeBuffer(uint32_t length) { return length >= mMumInfo->largeBufferSize; }
+    // NUMA nodes the renderer's workers run on and what they did there;
+    // only the MT renderer has workers
+    virtual uint32_t NumNodes() { return 1; }
+    virtual EMumError GetNodeStats(uint32_t node, uint32_t *numWorkers, uint64_t *bytes, uint64_t *microseconds)
+    {
+        return MUM_ERROR_RENDERER_NOT_MULTITHREADED;
+    }
+
+    // Encrypt and Decrypt that return before the work is done; only the MT
+    // renderer has workers to run them on
+    virtual EMumError EncryptAsync(uint8_t *src, uint8_t *dst, uint32_t length, uint16_t seqNum, EMumPriority priority,
+        MumCompletionCallback callback, void *userData, void **request)
+    {
+        return MUM_ERROR_RENDERER_NOT_MULTITHREADED;
+    }
+    virtual EMumError DecryptAsync(uint8_t *src, uint8_t *dst, uint32_t length, EMumPriority priority,
+        MumCompletionCallback callback, void *userData, void **request)
+    {
+        return MUM_ERROR_RENDERER_NOT_MULTITHREADED;
+    }
+
+    // the priority of the calls made without one, and the calls small enough
+    // to run on the caller's thread; only the MT renderer has workers
+    virtual EMumError GetPriority(EMumPriority *priority) { return MUM_ERROR_RENDERER_NOT_MULTITHREADED; }
+    virtual EMumError SetPriority(EMumPriority priority) { return MUM_ERROR_RENDERER_NOT_MULTITHREADED; }
+    virtual EMumError GetInlineBlocks(uint32_t *inlineBlocks) { return MUM_ERROR_RENDERER_NOT_MULTITHREADED; }
+    virtual EMumError SetInlineBlocks(uint32_t inlineBlocks) { return MUM_ERROR_RENDERER_NOT_MULTITHREADED; }
+
+    virtual void ResetEncryption() { numEncryptedBlocks = 0; }
+    virtual void ResetDecryption() { numDecryptedBlocks = 0; }
+    // back to the state of a new renderer without a key, once its work is
+    // done: the PRNG seeded from the key is dropped until InitKey, the
+    // buffers are kept
+    virtual void Recycle();
 protected:
     TMumInfo *mMumInfo;
     CMumPrng *mPrng;
-    __int64 numEncryptedBlocks;
-    __int64 numDecryptedBlocks;
-    __int64 blockLatency;
+    int64_t numEncryptedBlocks;
+    int64_t numDecryptedBlocks;
+    int64_t blockLatency;
     uint8_t  mPackedData[MUM_MAX_BLOCK_SIZE];
     uint8_t mPingPongBlock[2][MUM_MAX_BLOCK_SIZE];
-    uint8_t mPadding[MUM_PADDING_SIZE_R32];
+    uint8_t mPadding[MUM_PADDING_SIZE_R64];
+    // when set, SetPadding takes its bytes from here instead of mPrng
+    uint8_t *mPaddingReplay;
+    // set by Encrypt and Decrypt from IsLargeBuffer
+    bool mLargeBuffer;
 
 
-    uint32_t ComputeChecksum(uint8_t *data, uint32_t size);
+    // copies size bytes of plaintext that start offset bytes into the
+    // plaintext and returns their share of the block checksum
+    uint32_t CopyChecksum(uint8_t *dst, uint8_t *src, uint32_t size, uint32_t offset);
     void SetPadding(uint8_t *src, uint32_t length);
-
-    EMumError(CMumRenderer::*packData)(uint8_t *unpackedData, uint32_t length, uint32_t seqnum);
-    EMumError(CMumRenderer::*unpackData)(uint8_t *unpackedData, uint32_t *length, uint32_t *seqnum);
-    EMumError PackDataR32(uint8_t *unpackedData, uint32_t length, uint32_t seqnum);
-    EMumError PackDataR16(uint8_t *unpackedData, uint32_t length, uint32_t seqnum);
-    EMumError PackDataR8(uint8_t *unpackedData, uint32_t length, uint32_t seqnum);
-    EMumError PackDataR4(uint8_t *unpackedData, uint32_t length, uint32_t seqnum);
-    EMumError PackDataR2(uint8_t *unpackedData, uint32_t length, uint32_t seqnum);
-    EMumError PackDataR1(uint8_t *unpackedData, uint32_t length, uint32_t seqnum);
-    EMumError UnpackDataR32(uint8_t *unpackedData, uint32_t *length, uint32_t *seqnum);
-    EMumError UnpackDataR16(uint8_t *unpackedData, uint32_t *length, uint32_t *seqnum);
-    EMumError UnpackDataR8(uint8_t *unpackedData, uint32_t *length, uint32_t *seqnum);
-    EMumError UnpackDataR4(uint8_t *unpackedData, uint32_t *length, uint32_t *seqnum);
-    EMumError UnpackDataR2(uint8_t *unpackedData, uint32_t *length, uint32_t *seqnum);
-    EMumError UnpackDataR1(uint8_t *unpackedData, uint32_t *length, uint32_t *seqnum);
+    EMumError EncryptInPlace(uint8_t *data, uint32_t length, uint32_t *outlength, uint16_t seqNum);
+
+    static bool Overlaps(uint8_t *a, uint32_t aSize, uint8_t *b, uint32_t bSize) { return a < b + bSize && b < a + aSize; }
+
+    // packedData is the encrypted-block-sized buffer the block is packed
+    // into or unpacked from; it may be the caller's dst or a tile. The
+    // parts of the block are placed after mBlockLayout, by the PackBlock
+    // and UnpackBlock of its block type.
+    EMumError PackData(uint8_t *packedData, uint8_t *unpackedData, uint32_t length, uint32_t seqnum);
+    EMumError UnpackData(uint8_t *packedData, uint8_t *unpackedData, uint32_t *length, uint32_t *seqnum);
+    template <EMumBlockType blockType>
+    EMumError PackBlock(uint8_t *packedData, uint8_t *unpackedData, uint32_t length, uint32_t seqnum);
+    template <EMumBlockType blockType>
+    EMumError UnpackBlock(uint8_t *packedData, uint8_t *unpackedData, uint32_t *length, uint32_t *seqnum);
+    const TMumBlockLayout *mBlockLayout;
 
 };
 
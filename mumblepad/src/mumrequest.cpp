@@ -0,0 +1,84 @@
+//////////////////////////////////////////////////////////////////////////
+//                                                                      //
+//   Mumblepad Block Cipher                                             //
+//   Version 1, completed March 14, 2017                                //
+//                                                                      //
+//   Key size 4096 bytes, 32768 bits                                    //
+//   Six different block sizes: 128, 256, 512, 1024, 2048, 4096 bytes   //
+//   Encryption and decryption, runs on either CPU and GPU              //
+//   May run multi-threaded on CPU.                                     //
+//   Runs on GPU with OpenGL or OpenGL ES 2.0                           //
+//                                                                      //
+//   Encrypted blocks containing same plaintext are different, due to   //
+//   small amount of per-block random number padding.                   //
+//   Encrypted block contains length, 16-bit sequence number, 32-bit    //
+//   checksum.                                                          //
+//   No block cipher mode required                                      //
+//   Can use parallel processing, multi-threaded encrypt/decrypt        //
+//                                                                      //
+//   8 rounds, 2 passes per round                                       //
+//   Encrypt: diffusion pass followed by confusion pass.                //
+//   Decrypt: inverse confusion followed by inverse diffusion.          //
+//                                                                      //
+//   Free for non-commercial use, analysis/evaluation.                  //
+//                                                                      //
+//   Copyright 2017, Kyle Granger                                       //
+//   Email contact:  kyle.granger@chello.at                             //
+//                                                                      //
+//////////////////////////////////////////////////////////////////////////
+
+
+#include "mumrequest.h"
+
+
+CMumRequest::CMumRequest(MumCompletionCallback callback, void *userData, bool detached, CMumLatch *inFlight)
+{
+    mCallback = callback;
+    mUserData = userData;
+    mDetached = detached;
+    mInFlight = inFlight;
+    mDone = false;
+    mSlots = nullptr;
+    mJob.request = this;
+    mJob.slots = nullptr;
+    mJob.numSlots = 0;
+    mJob.outlength = 0;
+    mJob.error = MUM_ERROR_OK;
+    mJob.latch.Add(1);
+    mInFlight->Add(1);
+}
+
+CMumRequest::~CMumRequest()
+{
+    mJob.latch.Wait(0);
+    delete[] mSlots;
+}
+
+// Nothing of the request is touched once it is released: its owner may
+// free it as soon as Wait returns, and a detached one is freed here. The
+// renderer outlives the count of requests in flight.
+void CMumRequest::Complete()
+{
+    CMumLatch *inFlight = mInFlight;
+    bool detached = mDetached;
+
+    if (mCallback != nullptr)
+        mCallback(mDetached ? nullptr : this, mJob.error, mJob.outlength, mUserData);
+    mDone = true;
+    mJob.latch.CountDown();
+    if (detached)
+        delete this;
+    inFlight->CountDown();
+}
+
+EMumError CMumRequest::Poll()
+{
+    return mDone ? mJob.error.load() : MUM_ERROR_REQUEST_PENDING;
+}
+
+EMumError CMumRequest::Wait(uint32_t *outlength)
+{
+    mJob.latch.Wait(0);
+    *outlength = mJob.outlength;
+    return mJob.error;
+}
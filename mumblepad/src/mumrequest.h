@@ -0,0 +1,64 @@
+//////////////////////////////////////////////////////////////////////////
+//                                                                      //
+//   Mumblepad Block Cipher                                             //
+//   Version 1, completed March 14, 2017                                //
+//                                                                      //
+//   Key size 4096 bytes, 32768 bits                                    //
+//   Six different block sizes: 128, 256, 512, 1024, 2048, 4096 bytes   //
+//   Encryption and decryption, runs on either CPU and GPU              //
+//   May run multi-threaded on CPU.                                     //
+//   Runs on GPU with OpenGL or OpenGL ES 2.0                           //
+//                                                                      //
+//   Encrypted blocks containing same plaintext are different, due to   //
+//   small amount of per-block random number padding.                   //
+//   Encrypted block contains length, 16-bit sequence number, 32-bit    //
+//   checksum.                                                          //
+//   No block cipher mode required                                      //
+//   Can use parallel processing, multi-threaded encrypt/decrypt        //
+//                                                                      //
+//   8 rounds, 2 passes per round                                       //
+//   Encrypt: diffusion pass followed by confusion pass.                //
+//   Decrypt: inverse confusion followed by inverse diffusion.          //
+//                                                                      //
+//   Free for non-commercial use, analysis/evaluation.                  //
+//                                                                      //
+//   Copyright 2017, Kyle Granger                                       //
+//   Email contact:  kyle.granger@chello.at                             //
+//                                                                      //
+//////////////////////////////////////////////////////////////////////////
+
+
+#ifndef MUMREQUEST_H
+#define MUMREQUEST_H
+
+#include <atomic>
+#include "mumblepadthread.h"
+
+// An Encrypt or Decrypt of the MT renderer that runs while its caller goes
+// on. The request owns the job and its slots; the worker that completes
+// the job calls Complete. A detached request, one the caller asked no
+// handle for, frees itself there; otherwise the caller frees it, which
+// waits for it first.
+class CMumRequest {
+public:
+    CMumRequest(MumCompletionCallback callback, void *userData, bool detached, CMumLatch *inFlight);
+    ~CMumRequest();
+
+    TMumJob mJob;
+    TMumSlot *mSlots;
+
+    void Complete();
+    // MUM_ERROR_REQUEST_PENDING until Complete has run the callback
+    EMumError Poll();
+    EMumError Wait(uint32_t *outlength);
+private:
+    MumCompletionCallback mCallback;
+    void *mUserData;
+    bool mDetached;
+    std::atomic<bool> mDone;
+    // the renderer's count of requests in flight, which it waits on when stopped
+    CMumLatch *mInFlight;
+};
+
+
+#endif
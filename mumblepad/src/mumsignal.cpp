@@ -0,0 +1,140 @@
+//////////////////////////////////////////////////////////////////////////
+//                                                                      //
+//   Mumblepad Block Cipher                                             //
+//   Version 1, completed March 14, 2017                                //
+//                                                                      //
+//   Key size 4096 bytes, 32768 bits                                    //
+//   Six different block sizes: 128, 256, 512, 1024, 2048, 4096 bytes   //
+//   Encryption and decryption, runs on either CPU and GPU              //
+//   May run multi-threaded on CPU.                                     //
+//   Runs on GPU with OpenGL or OpenGL ES 2.0                           //
+//                                                                      //
+//   Encrypted blocks containing same plaintext are different, due to   //
+//   small amount of per-block random number padding.                   //
+//   Encrypted block contains length, 16-bit sequence number, 32-bit    //
+//   checksum.                                                          //
+//   No block cipher mode required                                      //
+//   Can use parallel processing, multi-threaded encrypt/decrypt        //
+//                                                                      //
+//   8 rounds, 2 passes per round                                       //
+//   Encrypt: diffusion pass followed by confusion pass.                //
+//   Decrypt: inverse confusion followed by inverse diffusion.          //
+//                                                                      //
+//   Free for non-commercial use, analysis/evaluation.                  //
+//                                                                      //
+//   Copyright 2017, Kyle Granger                                       //
+//   Email contact:  kyle.granger@chello.at                             //
+//                                                                      //
+//////////////////////////////////////////////////////////////////////////
+
+
+
+#include <thread>
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <emmintrin.h>
+#define MUM_PAUSE_X86
+#endif
+#include "mumsignal.h"
+
+
+uint32_t MumSpinCount()
+{
+    static const uint32_t spinCount = (std::thread::hardware_concurrency() > 1) ? MUM_SPIN_COUNT : 0;
+    return spinCount;
+}
+
+void MumPause()
+{
+#ifdef MUM_PAUSE_X86
+    _mm_pause();
+#else
+    std::this_thread::yield();
+#endif
+}
+
+
+CMumSemaphore::CMumSemaphore()
+{
+    mCount = 0;
+    mWaiters = 0;
+}
+
+// The count is stored before mWaiters is read, and Acquire counts itself
+// in mWaiters before it reads the count; one of the two sees the other, so
+// no unit is released past a thread about to park.
+void CMumSemaphore::Release(uint32_t count)
+{
+    mCount += (int32_t)count;
+    if (mWaiters > 0)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mCondition.notify_all();
+    }
+}
+
+bool CMumSemaphore::TryAcquire()
+{
+    int32_t count = mCount;
+    while (count > 0)
+    {
+        if (mCount.compare_exchange_weak(count, count - 1))
+            return true;
+    }
+    return false;
+}
+
+void CMumSemaphore::Acquire()
+{
+    uint32_t spinCount = MumSpinCount();
+    for (uint32_t i = 0; i < spinCount; i++)
+    {
+        if (TryAcquire())
+            return;
+        MumPause();
+    }
+    std::unique_lock<std::mutex> lock(mMutex);
+    mWaiters++;
+    mCondition.wait(lock, [this] { return TryAcquire(); });
+    mWaiters--;
+}
+
+
+CMumLatch::CMumLatch()
+{
+    mCount = 0;
+    mBusy = 0;
+    mParked = false;
+}
+
+// The count is stored before mParked is read, and Wait stores mParked
+// before it reads the count; one of the two sees the other, so a caller
+// never sleeps through its last CountDown. mBusy is the last member
+// touched.
+void CMumLatch::CountDown()
+{
+    mBusy++;
+    mCount--;
+    if (mParked)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mCondition.notify_all();
+    }
+    mBusy--;
+}
+
+void CMumLatch::Wait(uint32_t count)
+{
+    uint32_t spinCount = MumSpinCount();
+    for (uint32_t i = 0; i < spinCount && mCount > count; i++)
+        MumPause();
+    if (mCount > count)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mParked = true;
+        mCondition.wait(lock, [this, count] { return mCount <= count; });
+        mParked = false;
+    }
+    // a CountDown that has just lowered the count may still be notifying
+    while (mBusy > 0)
+        std::this_thread::yield();
+}
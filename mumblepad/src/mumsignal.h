@@ -0,0 +1,92 @@
+//////////////////////////////////////////////////////////////////////////
+//                                                                      //
+//   Mumblepad Block Cipher                                             //
+//   Version 1, completed March 14, 2017                                //
+//                                                                      //
+//   Key size 4096 bytes, 32768 bits                                    //
+//   Six different block sizes: 128, 256, 512, 1024, 2048, 4096 bytes   //
+//   Encryption and decryption, runs on either CPU and GPU              //
+//   May run multi-threaded on CPU.                                     //
+//   Runs on GPU with OpenGL or OpenGL ES 2.0                           //
+//                                                                      //
+//   Encrypted blocks containing same plaintext are different, due to   //
+//   small amount of per-block random number padding.                   //
+//   Encrypted block contains length, 16-bit sequence number, 32-bit    //
+//   checksum.                                                          //
+//   No block cipher mode required                                      //
+//   Can use parallel processing, multi-threaded encrypt/decrypt        //
+//                                                                      //
+//   8 rounds, 2 passes per round                                       //
+//   Encrypt: diffusion pass followed by confusion pass.                //
+//   Decrypt: inverse confusion followed by inverse diffusion.          //
+//                                                                      //
+//   Free for non-commercial use, analysis/evaluation.                  //
+//                                                                      //
+//   Copyright 2017, Kyle Granger                                       //
+//   Email contact:  kyle.granger@chello.at                             //
+//                                                                      //
+//////////////////////////////////////////////////////////////////////////
+
+
+
+#ifndef MUMSIGNAL_H
+#define MUMSIGNAL_H
+
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include "mumtypes.h"
+
+// Spin-then-park: a waiter first polls for this many pause instructions,
+// a few tens of microseconds, before it sleeps in the kernel. Work that
+// arrives within the spin costs no wake-up; longer waits cost no core.
+#define MUM_SPIN_COUNT 4096
+
+// MUM_SPIN_COUNT, or 0 with a single hardware thread, where spinning only
+// delays the thread being waited for
+extern uint32_t MumSpinCount();
+// tells the core a spin-wait loop is running
+extern void MumPause();
+
+// Counting semaphore between the callers of the MT renderer and its
+// workers: Release adds units, Acquire takes one, spinning a while and then
+// parking until one is there.
+class CMumSemaphore {
+public:
+    CMumSemaphore();
+
+    void Release(uint32_t count);
+    void Acquire();
+    // takes a unit only if one is there
+    bool TryAcquire();
+private:
+    std::atomic<int32_t> mCount;
+    // threads parked in Acquire, so Release only notifies when there are any
+    std::atomic<uint32_t> mWaiters;
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+};
+
+// Counts the workers still busy with an Encrypt or Decrypt call. Workers
+// count down; the caller waits for the count to drop to a given value.
+// Wait returns only once every CountDown has left the latch, so the caller
+// may destroy it right away, e.g. when it lives on the caller's stack.
+class CMumLatch {
+public:
+    CMumLatch();
+
+    void Add(uint32_t count) { mCount += count; }
+    void CountDown();
+    // returns once the count is no more than count
+    void Wait(uint32_t count);
+private:
+    std::atomic<uint32_t> mCount;
+    // CountDown calls that have not returned yet
+    std::atomic<uint32_t> mBusy;
+    // set while the caller is parked, so CountDown only notifies then
+    std::atomic<bool> mParked;
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+};
+
+#endif
@@ -0,0 +1,225 @@
+//////////////////////////////////////////////////////////////////////////
+//                                                                      //
+//   Mumblepad Block Cipher                                             //
+//   Version 1, completed March 14, 2017                                //
+//                                                                      //
+//   Key size 4096 bytes, 32768 bits                                    //
+//   Six different block sizes: 128, 256, 512, 1024, 2048, 4096 bytes   //
+//   Encryption and decryption, runs on either CPU and GPU              //
+//   May run multi-threaded on CPU.                                     //
+//   Runs on GPU with OpenGL or OpenGL ES 2.0                           //
+//                                                                      //
+//   Encrypted blocks containing same plaintext are different, due to   //
+//   small amount of per-block random number padding.                   //
+//   Encrypted block contains length, 16-bit sequence number, 32-bit    //
+//   checksum.                                                          //
+//   No block cipher mode required                                      //
+//   Can use parallel processing, multi-threaded encrypt/decrypt        //
+//                                                                      //
+//   8 rounds, 2 passes per round                                       //
+//   Encrypt: diffusion pass followed by confusion pass.                //
+//   Decrypt: inverse confusion followed by inverse diffusion.          //
+//                                                                      //
+//   Free for non-commercial use, analysis/evaluation.                  //
+//                                                                      //
+//   Copyright 2017, Kyle Granger                                       //
+//   Email contact:  kyle.granger@chello.at                             //
+//                                                                      //
+//////////////////////////////////////////////////////////////////////////
+
+
+#include "mumtopology.h"
+#include <algorithm>
+#include <thread>
+#include "stdio.h"
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__linux__)
+#include <sched.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <string.h>
+#endif
+
+
+// As found, before nodes and cores are numbered from 0
+typedef struct TMumRawCpu
+{
+    uint32_t cpu;
+    uint32_t node;
+    uint32_t package;
+    uint32_t core;
+} TMumRawCpu;
+
+
+#if defined(__linux__)
+static bool MumReadNumber(const char *path, uint32_t *value)
+{
+    FILE *f = fopen(path, "r");
+    if (f == NULL)
+        return false;
+    bool read = (fscanf(f, "%u", value) == 1);
+    fclose(f);
+    return read;
+}
+
+// A CPU's sysfs directory links to its node as nodeN
+static uint32_t MumCpuNode(uint32_t cpu)
+{
+    char path[64];
+    uint32_t node = 0;
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u", cpu);
+    DIR *dir = opendir(path);
+    if (dir == NULL)
+        return 0;
+    while (struct dirent *entry = readdir(dir))
+    {
+        if (!strncmp(entry->d_name, "node", 4) && sscanf(entry->d_name + 4, "%u", &node) == 1)
+            break;
+    }
+    closedir(dir);
+    return node;
+}
+
+static void MumDetectCpus(std::vector<TMumRawCpu> &cpus)
+{
+    cpu_set_t set;
+    if (sched_getaffinity(0, sizeof(set), &set) != 0)
+        return;
+    for (uint32_t cpu = 0; cpu < CPU_SETSIZE; cpu++)
+    {
+        if (!CPU_ISSET(cpu, &set))
+            continue;
+        char path[96];
+        TMumRawCpu raw = { cpu, MumCpuNode(cpu), 0, cpu };
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/topology/physical_package_id", cpu);
+        MumReadNumber(path, &raw.package);
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/topology/core_id", cpu);
+        MumReadNumber(path, &raw.core);
+        cpus.push_back(raw);
+    }
+}
+#elif defined(_WIN32)
+static void MumDetectCpus(std::vector<TMumRawCpu> &cpus)
+{
+    DWORD_PTR processMask, systemMask;
+    DWORD length = 0;
+    if (!GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask))
+        return;
+    GetLogicalProcessorInformation(NULL, &length);
+    std::vector<SYSTEM_LOGICAL_PROCESSOR_INFORMATION> infos(length / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION));
+    if (infos.empty() || !GetLogicalProcessorInformation(infos.data(), &length))
+        return;
+
+    for (uint32_t cpu = 0; cpu < sizeof(DWORD_PTR) * 8; cpu++)
+    {
+        DWORD_PTR bit = (DWORD_PTR)1 << cpu;
+        if (!(processMask & bit))
+            continue;
+        TMumRawCpu raw = { cpu, 0, 0, cpu };
+        uint32_t core = 0;
+        for (size_t i = 0; i < infos.size(); i++)
+        {
+            if (infos[i].Relationship == RelationProcessorCore)
+            {
+                if (infos[i].ProcessorMask & bit)
+                    raw.core = core;
+                core++;
+            }
+            else if (infos[i].Relationship == RelationNumaNode && (infos[i].ProcessorMask & bit))
+                raw.node = infos[i].NumaNode.NodeNumber;
+        }
+        cpus.push_back(raw);
+    }
+}
+#else
+static void MumDetectCpus(std::vector<TMumRawCpu> &cpus)
+{
+}
+#endif
+
+
+CMumTopology::CMumTopology()
+{
+    mNumNodes = 1;
+    Detect();
+}
+
+// Nodes and cores are numbered in the order of their lowest CPU
+void CMumTopology::Detect()
+{
+    std::vector<TMumRawCpu> raw;
+    MumDetectCpus(raw);
+    if (raw.empty())
+    {
+        uint32_t numCpus = std::thread::hardware_concurrency();
+        for (uint32_t cpu = 0; cpu < (numCpus > 0 ? numCpus : 1); cpu++)
+        {
+            TMumRawCpu one = { cpu, 0, 0, cpu };
+            raw.push_back(one);
+        }
+    }
+
+    std::vector<uint32_t> nodes;
+    std::vector<std::pair<uint32_t, uint32_t> > cores;
+    std::vector<uint32_t> coreThreads;
+    for (size_t i = 0; i < raw.size(); i++)
+    {
+        TMumCpu cpu;
+        cpu.cpu = raw[i].cpu;
+        cpu.node = (uint32_t)(std::find(nodes.begin(), nodes.end(), raw[i].node) - nodes.begin());
+        if (cpu.node == nodes.size())
+            nodes.push_back(raw[i].node);
+        std::pair<uint32_t, uint32_t> core(raw[i].package, raw[i].core);
+        cpu.core = (uint32_t)(std::find(cores.begin(), cores.end(), core) - cores.begin());
+        if (cpu.core == cores.size())
+        {
+            cores.push_back(core);
+            coreThreads.push_back(0);
+        }
+        cpu.sibling = coreThreads[cpu.core]++;
+        mCpus.push_back(cpu);
+    }
+    mNumNodes = (uint32_t)nodes.size();
+}
+
+static bool MumPlaceBefore(const TMumCpu &a, const TMumCpu &b)
+{
+    if (a.node != b.node)
+        return a.node < b.node;
+    if (a.sibling != b.sibling)
+        return a.sibling < b.sibling;
+    return a.core < b.core;
+}
+
+std::vector<TMumCpu> CMumTopology::Places(EMumPlacementType placement)
+{
+    std::vector<TMumCpu> places;
+    if (placement == MUM_PLACEMENT_NONE)
+        return places;
+    for (size_t i = 0; i < mCpus.size(); i++)
+    {
+        if (placement == MUM_PLACEMENT_SMT || mCpus[i].sibling == 0)
+            places.push_back(mCpus[i]);
+    }
+    std::stable_sort(places.begin(), places.end(), MumPlaceBefore);
+    return places;
+}
+
+bool CMumTopology::Pin(uint32_t cpu)
+{
+#if defined(__linux__)
+    cpu_set_t set;
+    if (cpu >= CPU_SETSIZE)
+        return false;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#elif defined(_WIN32)
+    if (cpu >= sizeof(DWORD_PTR) * 8)
+        return false;
+    return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu) != 0;
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,70 @@
+//////////////////////////////////////////////////////////////////////////
+//                                                                      //
+//   Mumblepad Block Cipher                                             //
+//   Version 1, completed March 14, 2017                                //
+//                                                                      //
+//   Key size 4096 bytes, 32768 bits                                    //
+//   Six different block sizes: 128, 256, 512, 1024, 2048, 4096 bytes   //
+//   Encryption and decryption, runs on either CPU and GPU              //
+//   May run multi-threaded on CPU.                                     //
+//   Runs on GPU with OpenGL or OpenGL ES 2.0                           //
+//                                                                      //
+//   Encrypted blocks containing same plaintext are different, due to   //
+//   small amount of per-block random number padding.                   //
+//   Encrypted block contains length, 16-bit sequence number, 32-bit    //
+//   checksum.                                                          //
+//   No block cipher mode required                                      //
+//   Can use parallel processing, multi-threaded encrypt/decrypt        //
+//                                                                      //
+//   8 rounds, 2 passes per round                                       //
+//   Encrypt: diffusion pass followed by confusion pass.                //
+//   Decrypt: inverse confusion followed by inverse diffusion.          //
+//                                                                      //
+//   Free for non-commercial use, analysis/evaluation.                  //
+//                                                                      //
+//   Copyright 2017, Kyle Granger                                       //
+//   Email contact:  kyle.granger@chello.at                             //
+//                                                                      //
+//////////////////////////////////////////////////////////////////////////
+
+
+#ifndef MUMTOPOLOGY_H
+#define MUMTOPOLOGY_H
+
+#include <vector>
+#include "mumdefines.h"
+
+// A hardware thread the process may run on. node is the index of its NUMA
+// node among the nodes found, core its physical core, sibling its rank
+// among the hardware threads of that core.
+typedef struct TMumCpu
+{
+    uint32_t cpu;
+    uint32_t node;
+    uint32_t core;
+    uint32_t sibling;
+} TMumCpu;
+
+// The processors, cores and NUMA nodes of the machine, as far as the
+// process' affinity allows. Read from sysfs on Linux and from
+// GetLogicalProcessorInformation on Windows (the first 64 processors);
+// elsewhere every hardware thread counts as a core of node 0.
+class CMumTopology
+{
+public:
+    CMumTopology();
+    uint32_t NumNodes() { return mNumNodes; }
+    // The CPUs workers are placed on, in order: node by node and, within a
+    // node, one hardware thread per core before any SMT sibling, so fewer
+    // workers than places still spread over the cores. Empty for
+    // MUM_PLACEMENT_NONE.
+    std::vector<TMumCpu> Places(EMumPlacementType placement);
+    // binds the calling thread to cpu; false where that is not supported
+    static bool Pin(uint32_t cpu);
+private:
+    void Detect();
+    std::vector<TMumCpu> mCpus;
+    uint32_t mNumNodes;
+};
+
+#endif
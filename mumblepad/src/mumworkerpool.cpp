@@ -0,0 +1,126 @@
+//////////////////////////////////////////////////////////////////////////
+//                                                                      //
+//   Mumblepad Block Cipher                                             //
+//   Version 1, completed March 14, 2017                                //
+//                                                                      //
+//   Key size 4096 bytes, 32768 bits                                    //
+//   Six different block sizes: 128, 256, 512, 1024, 2048, 4096 bytes   //
+//   Encryption and decryption, runs on either CPU and GPU              //
+//   May run multi-threaded on CPU.                                     //
+//   Runs on GPU with OpenGL or OpenGL ES 2.0                           //
+//                                                                      //
+//   Encrypted blocks containing same plaintext are different, due to   //
+//   small amount of per-block random number padding.                   //
+//   Encrypted block contains length, 16-bit sequence number, 32-bit    //
+//   checksum.                                                          //
+//   No block cipher mode required                                      //
+//   Can use parallel processing, multi-threaded encrypt/decrypt        //
+//                                                                      //
+//   8 rounds, 2 passes per round                                       //
+//   Encrypt: diffusion pass followed by confusion pass.                //
+//   Decrypt: inverse confusion followed by inverse diffusion.          //
+//                                                                      //
+//   Free for non-commercial use, analysis/evaluation.                  //
+//                                                                      //
+//   Copyright 2017, Kyle Granger                                       //
+//   Email contact:  kyle.granger@chello.at                             //
+//                                                                      //
+//////////////////////////////////////////////////////////////////////////
+
+
+#include "mumworkerpool.h"
+#include "mumblepadmt.h"
+
+
+std::mutex CMumWorkerPool::sMutex;
+CMumWorkerPool *CMumWorkerPool::sPools[MUM_PLACEMENT_SMT + 1];
+thread_local CMumWorkerPool *CMumWorkerPool::tPool = nullptr;
+thread_local uint32_t CMumWorkerPool::tWorker = 0;
+
+
+CMumWorkerPool::CMumWorkerPool(EMumPlacementType placement)
+{
+    uint32_t numWorkers;
+
+    mNumEngines = 0;
+    mPlaces = CMumTopology().Places(placement);
+    if (mPlaces.empty())
+    {
+        numWorkers = std::thread::hardware_concurrency();
+        if (numWorkers == 0)
+            numWorkers = 1;
+    }
+    else
+        numWorkers = (uint32_t)mPlaces.size();
+    if (numWorkers > MUM_MAX_THREADS)
+        numWorkers = MUM_MAX_THREADS;
+    for (uint32_t i = 0; i < numWorkers; i++)
+        mThreads.push_back(std::thread(&CMumWorkerPool::Run, this, i));
+}
+
+// The engines are gone, and with them every job, so the queue is empty
+CMumWorkerPool::~CMumWorkerPool()
+{
+    mQueue.Close(NumWorkers());
+    for (uint32_t i = 0; i < mThreads.size(); i++)
+        mThreads[i].join();
+}
+
+CMumWorkerPool *CMumWorkerPool::Acquire(EMumPlacementType placement)
+{
+    std::lock_guard<std::mutex> lock(sMutex);
+    CMumWorkerPool *&pool = sPools[placement];
+    if (pool == nullptr)
+        pool = new CMumWorkerPool(placement);
+    pool->mNumEngines++;
+    return pool;
+}
+
+// A worker cannot join itself: when the last engine goes away on one of the
+// pool's own workers, in a completion callback, the pool is ended on a
+// thread of its own, which the worker's return from the callback lets
+// finish.
+void CMumWorkerPool::Release(CMumWorkerPool *pool)
+{
+    {
+        std::lock_guard<std::mutex> lock(sMutex);
+        if (--pool->mNumEngines > 0)
+            return;
+        for (uint32_t p = 0; p <= MUM_PLACEMENT_SMT; p++)
+        {
+            if (sPools[p] == pool)
+                sPools[p] = nullptr;
+        }
+    }
+    if (tPool == pool)
+        std::thread([pool]() { delete pool; }).detach();
+    else
+        delete pool;
+}
+
+// A worker of the pool that submits, from a completion callback, must not
+// wait for a full ring that only the workers drain: the tickets that do not
+// fit run on it right away, on its own state for their engine. RunTicket
+// may nest, as in CMumblepadThread::Preempt.
+void CMumWorkerPool::Push(const TMumTicket *tickets, uint32_t count, EMumPriority priority)
+{
+    if (tPool != this)
+    {
+        mQueue.Push(tickets, count, priority);
+        return;
+    }
+    for (uint32_t i = mQueue.TryPush(tickets, count, priority); i < count; i++)
+        tickets[i].job->renderer->Worker(tWorker)->RunTicket(tickets[i]);
+}
+
+void CMumWorkerPool::Run(uint32_t worker)
+{
+    TMumTicket ticket;
+
+    tPool = this;
+    tWorker = worker;
+    if (IsPlaced())
+        CMumTopology::Pin(mPlaces[worker].cpu);
+    while (mQueue.Pop(&ticket))
+        ticket.job->renderer->Worker(worker)->RunTicket(ticket);
+}
@@ -0,0 +1,83 @@
+//////////////////////////////////////////////////////////////////////////
+//                                                                      //
+//   Mumblepad Block Cipher                                             //
+//   Version 1, completed March 14, 2017                                //
+//                                                                      //
+//   Key size 4096 bytes, 32768 bits                                    //
+//   Six different block sizes: 128, 256, 512, 1024, 2048, 4096 bytes   //
+//   Encryption and decryption, runs on either CPU and GPU              //
+//   May run multi-threaded on CPU.                                     //
+//   Runs on GPU with OpenGL or OpenGL ES 2.0                           //
+//                                                                      //
+//   Encrypted blocks containing same plaintext are different, due to   //
+//   small amount of per-block random number padding.                   //
+//   Encrypted block contains length, 16-bit sequence number, 32-bit    //
+//   checksum.                                                          //
+//   No block cipher mode required                                      //
+//   Can use parallel processing, multi-threaded encrypt/decrypt        //
+//                                                                      //
+//   8 rounds, 2 passes per round                                       //
+//   Encrypt: diffusion pass followed by confusion pass.                //
+//   Decrypt: inverse confusion followed by inverse diffusion.          //
+//                                                                      //
+//   Free for non-commercial use, analysis/evaluation.                  //
+//                                                                      //
+//   Copyright 2017, Kyle Granger                                       //
+//   Email contact:  kyle.granger@chello.at                             //
+//                                                                      //
+//////////////////////////////////////////////////////////////////////////
+
+
+#ifndef MUMWORKERPOOL_H
+#define MUMWORKERPOOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include "mumqueue.h"
+#include "mumtopology.h"
+
+// The worker threads all MT engines of the process share, one pool per
+// placement, each made when the first engine with that placement is
+// created and ended with the last. A pool has a worker per hardware thread
+// (unplaced) or per place, however many engines submit to it. A ticket's
+// job names the engine, and the worker runs it on its own state for that
+// engine, see CMumblepadMt::Worker.
+class CMumWorkerPool {
+public:
+    static CMumWorkerPool *Acquire(EMumPlacementType placement);
+    static void Release(CMumWorkerPool *pool);
+
+    uint32_t NumWorkers() { return (uint32_t)mThreads.size(); }
+    // whether the workers are pinned, to Place(worker).cpu
+    bool IsPlaced() { return !mPlaces.empty(); }
+    // the CPU and NUMA node of a placed worker
+    const TMumCpu &Place(uint32_t worker) { return mPlaces[worker]; }
+    // the worker's NUMA node index, 0 unplaced
+    uint32_t Node(uint32_t worker) { return mPlaces.empty() ? 0 : mPlaces[worker].node; }
+    // queues the tickets; on a worker of this pool, the ones that do not
+    // fit are run on the calling worker
+    void Push(const TMumTicket *tickets, uint32_t count, EMumPriority priority);
+    // for a worker between two grains of a bulk job, see CMumblepadThread::Preempt
+    bool PopInteractive(TMumTicket *ticket) { return mQueue.PopInteractive(ticket); }
+private:
+    CMumWorkerPool(EMumPlacementType placement);
+    ~CMumWorkerPool();
+    void Run(uint32_t worker);
+
+    std::vector<TMumCpu> mPlaces;
+    std::vector<std::thread> mThreads;
+    CMumJobQueue mQueue;
+    // engines holding the pool, under sMutex
+    uint32_t mNumEngines;
+
+    // the pool and index of the worker running on this thread, if any
+    static thread_local CMumWorkerPool *tPool;
+    static thread_local uint32_t tWorker;
+
+    static std::mutex sMutex;
+    // by EMumPlacementType
+    static CMumWorkerPool *sPools[MUM_PLACEMENT_SMT + 1];
+};
+
+#endif
@@ -1,14 +1,28 @@
+#define _CRT_SECURE_NO_WARNINGS
 
 #include "assert.h"
 #include "string.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <time.h>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#ifdef __linux__
+#include <dirent.h>
+#endif
 #include <mumpublic.h>
-#include "windows.h"
 
 #define NUM_TEST_FILES 2
 #define NUM_ENTROPY_ITERATIONS 25000
 #define TEST_MUM_NUM_THREADS 8
+// largest block, MUM_BLOCKTYPE_8192
+#define TEST_MAX_BLOCK_SIZE 8192
+// tickets a ring of the MT engines' queue holds, MUM_QUEUE_SIZE
+#define TEST_QUEUE_SIZE 4096
 
 // store the file as binary chunk
 uint8_t *urFileData[NUM_TEST_FILES];
@@ -17,6 +31,9 @@ uint8_t *deFileData[NUM_TEST_FILES];
 size_t fileLength[NUM_TEST_FILES];
 int bitsSet[256];
 
+// the files in ../testfiles are not part of the repository
+bool haveTestFiles = false;
+
 uint8_t *largePlaintext = nullptr;
 uint8_t *largeEncrypt = nullptr;
 uint8_t *largeDecrypt = nullptr;
@@ -24,61 +41,84 @@ uint8_t *largeDecrypt = nullptr;
 
 // original files
 char *testfile[NUM_TEST_FILES] = {
-    "..\\testfiles\\image.jpg",
-    "..\\testfiles\\music.m4a"
+    "../testfiles/image.jpg",
+    "../testfiles/music.m4a"
 };
 
 // encrypted files
 char *testfileE[NUM_TEST_FILES] = {
-    "..\\testfiles\\imageEncrypted.jpg",
-    "..\\testfiles\\musicEncrypted.m4a"
+    "../testfiles/imageEncrypted.jpg",
+    "../testfiles/musicEncrypted.m4a"
 };
 
 // decrypted files
 char *testfileD[NUM_TEST_FILES] = {
-    "..\\testfiles\\imageDecrypted.jpg",
-    "..\\testfiles\\musicDecrypted.m4a"
+    "../testfiles/imageDecrypted.jpg",
+    "../testfiles/musicDecrypted.m4a"
 };
 
 // #define CREATE_REFERENCE_FILES
 #define NUM_REFERENCE_FILES 2
-char *referenceFileKey = "..\\referencefiles\\key.bin";
-char *referenceTempFile = "..\\referencefiles\\temp";
+char *referenceFileKey = "../referencefiles/key.bin";
+char *referenceTempFile = "../referencefiles/temp";
 char *referenceFiles[NUM_REFERENCE_FILES] = {
-    "..\\referencefiles\\image.jpg",
-    "..\\referencefiles\\constitution.pdf"
+    "../referencefiles/image.jpg",
+    "../referencefiles/constitution.pdf"
 };
 
 
+// the GPU engines are only built with USE_MUM_OPENGL
+#ifdef USE_MUM_OPENGL
 #define TEST_NUM_ENGINES 4
+#else
+#define TEST_NUM_ENGINES 2
+#endif
 EMumEngineType engineList[TEST_NUM_ENGINES] = {
     MUM_ENGINE_TYPE_CPU,
 	MUM_ENGINE_TYPE_CPU_MT,
+#ifdef USE_MUM_OPENGL
 	MUM_ENGINE_TYPE_GPU_A,
 	MUM_ENGINE_TYPE_GPU_B,
+#endif
 };
 
 // the GPU-B engine only supports 4K block size
 EMumBlockType firstTestBlockTypeList[TEST_NUM_ENGINES] = {
     MUM_BLOCKTYPE_128,
     MUM_BLOCKTYPE_128,
+#ifdef USE_MUM_OPENGL
     MUM_BLOCKTYPE_128,
     MUM_BLOCKTYPE_4096
+#endif
+};
+
+// the 8K block size is CPU only
+EMumBlockType lastBlockTypeList[TEST_NUM_ENGINES] = {
+    MUM_BLOCKTYPE_8192,
+    MUM_BLOCKTYPE_8192,
+#ifdef USE_MUM_OPENGL
+    MUM_BLOCKTYPE_4096,
+    MUM_BLOCKTYPE_4096
+#endif
 };
 
 // We'll only profile 4K block size for GPU-A
 EMumBlockType firstProfilingBlockTypeList[TEST_NUM_ENGINES] = {
     MUM_BLOCKTYPE_128,
     MUM_BLOCKTYPE_128,
+#ifdef USE_MUM_OPENGL
     MUM_BLOCKTYPE_4096,
     MUM_BLOCKTYPE_4096
+#endif
 };
 
 char *engineName[TEST_NUM_ENGINES] = {
     "CPU-engine",
     "CPU-MT-engine",
+#ifdef USE_MUM_OPENGL
     "GPU-A-engine",
     "GPU-B-engine",
+#endif
 };
 
 // #define TEST_WITH_PADDING_OFF
@@ -110,23 +150,17 @@ char *paddingName[TEST_NUM_PADDING_TYPES] = {
 
 
 
-double pcfreq = 0.0;
-__int64 counterstart = 0;
+std::chrono::steady_clock::time_point counterstart;
 
 void startCounter()
 {
-    LARGE_INTEGER li;
-    QueryPerformanceFrequency(&li);
-    pcfreq = double(li.QuadPart) / 1000.0;
-    QueryPerformanceCounter(&li);
-    counterstart = li.QuadPart;
+    counterstart = std::chrono::steady_clock::now();
 }
 
+// milliseconds since startCounter
 double getCounter()
 {
-    LARGE_INTEGER li;
-    QueryPerformanceCounter(&li);
-    return double(li.QuadPart - counterstart)/pcfreq;
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - counterstart).count();
 }
 
 void fillRandomly(uint8_t *data, uint32_t size)
@@ -146,12 +180,37 @@ void fillSequentially(uint8_t *data, uint32_t size)
     }
 }
 
+// the size of an unplaced worker pool
+uint32_t numHardwareThreads()
+{
+    uint32_t numCores = std::thread::hardware_concurrency();
+    return numCores > 0 ? numCores : 1;
+}
+
+// threads of the process, where that can be told
+uint32_t numProcessThreads()
+{
+    uint32_t numThreads = 0;
+#ifdef __linux__
+    DIR *dir = opendir("/proc/self/task");
+    if (dir == nullptr)
+        return 0;
+    while (struct dirent *entry = readdir(dir))
+    {
+        if (entry->d_name[0] != '.')
+            numThreads++;
+    }
+    closedir(dir);
+#endif
+    return numThreads;
+}
+
 bool loadFile(char *filename, uint8_t **data, size_t *length)
 {
     FILE *f;
     size_t res, size;
 
-    fopen_s(&f, filename, "rb");
+    f = fopen(filename, "rb");
     if (!f) return false;
 
     fseek(f, 0, SEEK_END);
@@ -362,12 +421,12 @@ void createRandomBlocksWithOneBitDifference(uint8_t *block1, uint8_t *block2, ui
 bool testEntropyNoPadding(void *engine, char *engineType)
 {
 	EMumError error;
-	uint8_t plaintext1[4096];
-	uint8_t plaintext2[4096];
-	uint8_t encrypt1[4096];
-	uint8_t encrypt2[4096];
-	uint8_t decrypt1[4096];
-	uint8_t decrypt2[4096];
+	uint8_t plaintext1[TEST_MAX_BLOCK_SIZE];
+	uint8_t plaintext2[TEST_MAX_BLOCK_SIZE];
+	uint8_t encrypt1[TEST_MAX_BLOCK_SIZE];
+	uint8_t encrypt2[TEST_MAX_BLOCK_SIZE];
+	uint8_t decrypt1[TEST_MAX_BLOCK_SIZE];
+	uint8_t decrypt2[TEST_MAX_BLOCK_SIZE];
 	uint32_t outlength, i, iter;
 	uint32_t bitsChanged, bitsTotal;
 	uint32_t bytesChanged, bytesTotal;
@@ -422,11 +481,11 @@ bool testEntropyNoPadding(void *engine, char *engineType)
 bool testEntropy(void *engine, char *engineType, EMumPaddingType paddingType)
 {
     EMumError error;
-    uint8_t plaintext[4096];
-    uint8_t encrypt1[4096];
-    uint8_t encrypt2[4096];
-    uint8_t decrypt1[4096];
-    uint8_t decrypt2[4096];
+    uint8_t plaintext[TEST_MAX_BLOCK_SIZE];
+    uint8_t encrypt1[TEST_MAX_BLOCK_SIZE];
+    uint8_t encrypt2[TEST_MAX_BLOCK_SIZE];
+    uint8_t decrypt1[TEST_MAX_BLOCK_SIZE];
+    uint8_t decrypt2[TEST_MAX_BLOCK_SIZE];
     uint32_t outlength, i, iter;
     uint32_t bitsChanged, bitsTotal;
     uint32_t bytesChanged, bytesTotal;
@@ -436,7 +495,13 @@ bool testEntropy(void *engine, char *engineType, EMumPaddingType paddingType)
 
     uint32_t encryptedBlockSize, plaintextBlockSize;
     error = MumPlaintextBlockSize(engine, &plaintextBlockSize);
-    error = MumEncryptedBlockSize(engine, &encryptedBlockSize);
+    if (error == MUM_ERROR_OK)
+        error = MumEncryptedBlockSize(engine, &encryptedBlockSize);
+    if (error != MUM_ERROR_OK)
+    {
+        printf("FAILED testEntropy, engine %s, error %d\n", engineType, error);
+        return false;
+    }
 
     bitsChanged = 0;
     bitsTotal = 0;
@@ -446,9 +511,17 @@ bool testEntropy(void *engine, char *engineType, EMumPaddingType paddingType)
     {
         fillRandomly(plaintext, plaintextBlockSize);
         error = MumEncrypt(engine, plaintext, encrypt1, plaintextBlockSize, &outlength, 0);
-        error = MumEncrypt(engine, plaintext, encrypt2, plaintextBlockSize, &outlength, 0);
-        error = MumDecrypt(engine, encrypt1, decrypt1, encryptedBlockSize, &outlength);
-        error = MumDecrypt(engine, encrypt2, decrypt2, encryptedBlockSize, &outlength);
+        if (error == MUM_ERROR_OK)
+            error = MumEncrypt(engine, plaintext, encrypt2, plaintextBlockSize, &outlength, 0);
+        if (error == MUM_ERROR_OK)
+            error = MumDecrypt(engine, encrypt1, decrypt1, encryptedBlockSize, &outlength);
+        if (error == MUM_ERROR_OK)
+            error = MumDecrypt(engine, encrypt2, decrypt2, encryptedBlockSize, &outlength);
+        if (error != MUM_ERROR_OK)
+        {
+            printf("FAILED testEntropy, engine %s, plaintextSize %d, error %d\n", engineType, plaintextBlockSize, error);
+            return false;
+        }
         // first, reality check; make sure both encryptions return same plaintext
         for (i = 0; i < plaintextBlockSize; i++)
         {
@@ -499,9 +572,17 @@ bool testEntropy(void *engine, char *engineType, EMumPaddingType paddingType)
     for (iter = 0; iter < NUM_ENTROPY_ITERATIONS; iter++)
     {
         error = MumEncrypt(engine, plaintext, encrypt1, plaintextBlockSize, &outlength, 0);
-        error = MumEncrypt(engine, plaintext, encrypt2, plaintextBlockSize, &outlength, 0);
-        error = MumDecrypt(engine, encrypt1, decrypt1, encryptedBlockSize, &outlength);
-        error = MumDecrypt(engine, encrypt2, decrypt2, encryptedBlockSize, &outlength);
+        if (error == MUM_ERROR_OK)
+            error = MumEncrypt(engine, plaintext, encrypt2, plaintextBlockSize, &outlength, 0);
+        if (error == MUM_ERROR_OK)
+            error = MumDecrypt(engine, encrypt1, decrypt1, encryptedBlockSize, &outlength);
+        if (error == MUM_ERROR_OK)
+            error = MumDecrypt(engine, encrypt2, decrypt2, encryptedBlockSize, &outlength);
+        if (error != MUM_ERROR_OK)
+        {
+            printf("FAILED testEntropy, engine %s, plaintextSize %d, error %d\n", engineType, plaintextBlockSize, error);
+            return false;
+        }
         // first, reality check; make sure both encryptions return same plaintext
         for (i = 0; i < plaintextBlockSize; i++)
         {
@@ -581,14 +662,21 @@ bool testEntropySubkeyPair(void *engine, int index1, int index2)
 
 
 
-bool testSubkeyEntropy(void *engine, char *engineType, EMumPaddingType paddingType)
+bool testSubkeyEntropy(void *engine, char *engineType, EMumPaddingType paddingType, EMumBlockType blockType)
 {
     if (paddingType == MUM_PADDING_TYPE_OFF)
         return true;
 
-    for (int i = 0; i < MUM_NUM_SUBKEYS - 1; i++)
+    int numSubkeys = (blockType == MUM_BLOCKTYPE_8192) ? MUM_NUM_SUBKEYS : MUM_NUM_SUBKEYS_4096;
+    uint8_t subkey[MUM_KEY_SIZE];
+    if (MumGetSubkey(engine, numSubkeys, subkey) != MUM_ERROR_SUBKEY_INDEX_OUTOFRANGE)
+    {
+        printf("FAILED testSubkeyEntropy, subkey %d, engine %s\n", numSubkeys, engineType);
+        return false;
+    }
+    for (int i = 0; i < numSubkeys - 1; i++)
     {
-        for (int j = i + 1; j < MUM_NUM_SUBKEYS; j++)
+        for (int j = i + 1; j < numSubkeys; j++)
         {
             if (!testEntropySubkeyPair(engine, i, j))
                 return false;
@@ -603,10 +691,10 @@ bool testSubkeyEntropy(void *engine, char *engineType, EMumPaddingType paddingTy
 bool testSimpleBlocks(void *engine, char *engineType)
 {
     EMumError error;
-    uint8_t plaintext[4096];
-    uint8_t random[4096];
-    uint8_t encrypt[4096];
-    uint8_t decrypt[4096];
+    uint8_t plaintext[TEST_MAX_BLOCK_SIZE];
+    uint8_t random[TEST_MAX_BLOCK_SIZE];
+    uint8_t encrypt[TEST_MAX_BLOCK_SIZE];
+    uint8_t decrypt[TEST_MAX_BLOCK_SIZE];
     uint32_t length, i;
 
     uint32_t encryptedBlockSize, plaintextBlockSize;
@@ -647,9 +735,9 @@ bool testSimpleBlocks(void *engine, char *engineType)
 bool testUnitializedEngine(void *engine, char *engineType)
 {
     EMumError error;
-    uint8_t plaintext[4096];
-    uint8_t encrypt[4096];
-    uint8_t decrypt[4096];
+    uint8_t plaintext[TEST_MAX_BLOCK_SIZE];
+    uint8_t encrypt[TEST_MAX_BLOCK_SIZE];
+    uint8_t decrypt[TEST_MAX_BLOCK_SIZE];
     uint32_t length;
 
     uint32_t encryptedBlockSize, plaintextBlockSize;
@@ -693,9 +781,9 @@ bool testRandomlySizedBlocks(void *engine, char *engineType, EMumPaddingType pad
     error = MumPlaintextBlockSize(engine, &plaintextBlockSize);
     error = MumEncryptedBlockSize(engine, &encryptedBlockSize);
 
-    uint8_t *plaintext = new uint8_t[1024*1024+4096];
+    uint8_t *plaintext = new uint8_t[1024*1024+TEST_MAX_BLOCK_SIZE];
     uint8_t *encrypt = new uint8_t[1280 * 1024];
-    uint8_t *decrypt = new uint8_t[1024 * 1024 + 4096];
+    uint8_t *decrypt = new uint8_t[1024 * 1024 + TEST_MAX_BLOCK_SIZE];
     for (int test = 0; test < 64; test++)
     {
         // Pick random number between 1 and 1048576
@@ -801,15 +889,20 @@ bool doTest(void *engine, char *engineType, EMumPaddingType paddingType, EMumBlo
 
     fillRandomly(clavier, MUM_KEY_SIZE);
     error = MumInitKey(engine, clavier);
+    if (error != MUM_ERROR_OK)
+    {
+        printf("FAILED doTest, engine %s, MumInitKey error %d\n", engineType, error);
+        return false;
+    }
     if (!testSimpleBlocks(engine, engineType))
         return false;
     if (!testRandomlySizedBlocks(engine, engineType, paddingType))
         return false;
     if (!testEntropy(engine, engineType, paddingType))
         return false;
-    if (!testSubkeyEntropy(engine, engineType, paddingType))
+    if (!testSubkeyEntropy(engine, engineType, paddingType, blockType))
         return false;
-    if (!testFileEncrypt(engine, engineType))
+    if (haveTestFiles && !testFileEncrypt(engine, engineType))
         return false;
     if (paddingType == MUM_PADDING_TYPE_ON && !testReferenceFileDecrypt(engine, engineType, blockType))
         return false;
@@ -824,6 +917,8 @@ bool doProfiling(void *engine, char *engineType, bool withPadding)
 
     fillRandomly(clavier, MUM_KEY_SIZE);
 	error = MumInitKey(engine, clavier);
+    if (error != MUM_ERROR_OK)
+        return false;
     if (!profileLargeBlocks(engine, engineType))
         return false;
     return true;
@@ -909,13 +1004,15 @@ bool doMultiEngineTest(EMumEngineType engineType1, EMumEngineType engineType2,
     error = MumInitKey(engine1, clavier);
 
     void * engine2 = MumCreateEngine(MUM_ENGINE_TYPE_GPU_A, blockType, MUM_PADDING_TYPE_ON, 0);
-    error = MumInitKey(engine2, clavier);
+    if (error == MUM_ERROR_OK)
+        error = MumInitKey(engine2, clavier);
 
-    if (!multiTest(engine1, engine2))
+    if (error != MUM_ERROR_OK || !multiTest(engine1, engine2))
         return false;
 
     uint32_t encryptedBlockSize;
-    error = MumEncryptedBlockSize(engine1, &encryptedBlockSize);
+    if (MumEncryptedBlockSize(engine1, &encryptedBlockSize) != MUM_ERROR_OK)
+        return false;
     printf("SUCCESS doMultiEngineTest, engine %s, block size %d\n",
         testString, encryptedBlockSize);
 
@@ -924,161 +1021,2497 @@ bool doMultiEngineTest(EMumEngineType engineType1, EMumEngineType engineType2,
     return true;
 }
 
+// Encrypts the same data on two single-threaded CPU engines of different
+// types with the same key, then decrypts each one's output with the other.
+// The padding PRNG restarts whenever the key is loaded, so the ciphertexts
+// must match byte for byte, with padding too.
+bool crossEngineTest(EMumEngineType engineType1, EMumEngineType engineType2, EMumBlockType blockType, EMumPaddingType paddingType)
+{
+    EMumError error;
+    uint32_t encryptSize, plaintextBlockSize, outlength1, outlength2;
+    uint32_t plaintextSize = 28657;
+    uint8_t clavier[MUM_KEY_SIZE];
+    bool success = true;
+
+    fillRandomly(clavier, MUM_KEY_SIZE);
+    void *engine1 = MumCreateEngine(engineType1, blockType, paddingType, 0);
+    void *engine2 = MumCreateEngine(engineType2, blockType, paddingType, 0);
+    error = MumInitKey(engine1, clavier);
+    if (error == MUM_ERROR_OK)
+        error = MumInitKey(engine2, clavier);
+    if (error == MUM_ERROR_OK)
+        error = MumPlaintextBlockSize(engine1, &plaintextBlockSize);
+    if (error == MUM_ERROR_OK)
+        error = MumEncryptedSize(engine1, plaintextSize, &encryptSize);
+    if (error != MUM_ERROR_OK)
+    {
+        printf("FAILED crossEngineTest, engines %d and %d, block type %d, error %d\n", engineType1, engineType2, blockType, error);
+        MumDestroyEngine(engine1);
+        MumDestroyEngine(engine2);
+        return false;
+    }
+
+    // without padding no length is stored, whole blocks come back
+    uint32_t decryptSize = (paddingType == MUM_PADDING_TYPE_ON) ? plaintextSize : encryptSize;
+    std::vector<uint8_t> src(plaintextSize), enc1(encryptSize), enc2(encryptSize), dec(encryptSize + plaintextBlockSize);
+    fillRandomly(src.data(), plaintextSize);
+
+    if (MumEncrypt(engine1, src.data(), enc1.data(), plaintextSize, &outlength1, 0) != MUM_ERROR_OK
+        || MumEncrypt(engine2, src.data(), enc2.data(), plaintextSize, &outlength2, 0) != MUM_ERROR_OK
+        || outlength1 != encryptSize || outlength2 != encryptSize)
+        success = false;
+    if (success && memcmp(enc1.data(), enc2.data(), encryptSize) != 0)
+        success = false;
+    if (success && (MumDecrypt(engine2, enc1.data(), dec.data(), encryptSize, &outlength2) != MUM_ERROR_OK
+        || outlength2 != decryptSize || memcmp(dec.data(), src.data(), plaintextSize) != 0))
+        success = false;
+    if (success && (MumDecrypt(engine1, enc2.data(), dec.data(), encryptSize, &outlength1) != MUM_ERROR_OK
+        || outlength1 != decryptSize || memcmp(dec.data(), src.data(), plaintextSize) != 0))
+        success = false;
+
+    if (success)
+        printf("SUCCESS crossEngineTest, engines %d and %d, padding %d, block type %d\n", engineType1, engineType2, paddingType, blockType);
+    else
+        printf("FAILED crossEngineTest, engines %d and %d, padding %d, block type %d\n", engineType1, engineType2, paddingType, blockType);
 
-bool doTests()
+    MumDestroyEngine(engine1);
+    MumDestroyEngine(engine2);
+    return success;
+}
+
+// The specialized and the JIT renderers against the generic one
+bool doCrossEngineTests()
 {
-	for (int paddingIndex = 0; paddingIndex < TEST_NUM_PADDING_TYPES; paddingIndex++)
+    EMumEngineType engineTypes[] = { MUM_ENGINE_TYPE_CPU, MUM_ENGINE_TYPE_CPU_JIT };
+    EMumPaddingType paddingTypes[] = { MUM_PADDING_TYPE_ON, MUM_PADDING_TYPE_OFF };
+
+    for (uint32_t e = 0; e < sizeof(engineTypes) / sizeof(engineTypes[0]); e++)
     {
-        for (int engineIndex = 0; engineIndex < TEST_NUM_ENGINES; engineIndex++)
+        for (uint32_t p = 0; p < sizeof(paddingTypes) / sizeof(paddingTypes[0]); p++)
         {
-            for (int blockType = firstTestBlockTypeList[engineIndex]; blockType <= MUM_BLOCKTYPE_4096; blockType++)
+            for (int blockType = MUM_BLOCKTYPE_128; blockType <= MUM_BLOCKTYPE_8192; blockType++)
             {
-                void * engine = MumCreateEngine(engineList[engineIndex], (EMumBlockType)blockType, paddingList[paddingIndex], TEST_MUM_NUM_THREADS);
-                char testName[128];
-                sprintf_s(testName, "%s:%s", engineName[engineIndex], paddingName[paddingIndex]);
-                if (!doTest(engine, testName, paddingList[paddingIndex], (EMumBlockType)blockType))
+                if (!crossEngineTest(engineTypes[e], MUM_ENGINE_TYPE_CPU_GENERIC, (EMumBlockType)blockType, paddingTypes[p]))
                     return false;
-                MumDestroyEngine(engine);
-                engine = NULL;
             }
         }
     }
-	return true;
+    return true;
 }
 
-#ifdef CREATE_REFERENCE_FILES
-bool createReferenceFilesFromEngine(void * engine, EMumBlockType blockType)
+// Encrypts the same data on two CPU engines, the generic one restricted to
+// the scalar passes and engineType with the given SIMD features. The padding
+// PRNG restarts whenever the key is loaded, so the ciphertexts must match
+// byte for byte, and both engines must decrypt the reference files.
+bool cpuFeatureTest(EMumEngineType engineType, EMumBlockType blockType, uint32_t features)
 {
     EMumError error;
+    uint32_t encryptSize, outlength1, outlength2, plaintextBlockSize;
+    uint32_t plaintextSize = 28657;
 
-    for (int i = 0; i < NUM_REFERENCE_FILES; i++)
+    // the generic renderer without SIMD is the reference
+    void *scalarEngine = MumCreateEngine(MUM_ENGINE_TYPE_CPU_GENERIC, blockType, MUM_PADDING_TYPE_ON, 0);
+    void *simdEngine = MumCreateEngine(engineType, blockType, MUM_PADDING_TYPE_ON, 0);
+    MumSetCpuFeatures(scalarEngine, MUM_CPU_FEATURE_NONE);
+    MumSetCpuFeatures(simdEngine, features);
+    MumGetCpuFeatures(simdEngine, &features);
+
+    if (!testReferenceFileDecrypt(scalarEngine, "CPU-engine:scalar", blockType))
+        return false;
+    if (!testReferenceFileDecrypt(simdEngine, "CPU-engine:simd", blockType))
+        return false;
+
+    error = MumPlaintextBlockSize(scalarEngine, &plaintextBlockSize);
+    error = MumEncryptedSize(scalarEngine, plaintextSize, &encryptSize);
+    uint8_t *src = new uint8_t[plaintextSize];
+    uint8_t *enc1 = new uint8_t[encryptSize];
+    uint8_t *enc2 = new uint8_t[encryptSize];
+    uint8_t *dec = new uint8_t[plaintextSize + plaintextBlockSize];
+    fillRandomly(src, plaintextSize);
+
+    bool success = true;
+    error = MumEncrypt(scalarEngine, src, enc1, plaintextSize, &outlength1, 0);
+    if (error != MUM_ERROR_OK)
+        success = false;
+    error = MumEncrypt(simdEngine, src, enc2, plaintextSize, &outlength2, 0);
+    if (error != MUM_ERROR_OK || outlength1 != outlength2)
+        success = false;
+    if (success && memcmp(enc1, enc2, outlength1) != 0)
     {
-        char encryptedname[512];
-        error = MumCreateEncryptedFileName(blockType, referenceFiles[i], encryptedname, 512);
-        if (error != MUM_ERROR_OK)
-            return false;
-        error = MumEncryptFile(engine, referenceFiles[i], encryptedname);
-        if (error != MUM_ERROR_OK)
-            return false;
+        printf("FAILED cpuFeatureTest, engine %d, features 0x%x, block type %d: ciphertexts differ\n", engineType, features, blockType);
+        success = false;
     }
-    return true;
-}
 
+    // each engine decrypts the other's output
+    error = MumDecrypt(simdEngine, enc1, dec, outlength1, &outlength2);
+    if (success && (error != MUM_ERROR_OK || memcmp(src, dec, plaintextSize) != 0))
+        success = false;
+    error = MumDecrypt(scalarEngine, enc2, dec, outlength1, &outlength2);
+    if (success && (error != MUM_ERROR_OK || memcmp(src, dec, plaintextSize) != 0))
+        success = false;
 
+    if (success)
+        printf("SUCCESS cpuFeatureTest, engine %d, features 0x%x, block type %d\n", engineType, features, blockType);
+    else
+        printf("FAILED cpuFeatureTest, engine %d, features 0x%x, block type %d\n", engineType, features, blockType);
+
+    delete[] src;
+    delete[] enc1;
+    delete[] enc2;
+    delete[] dec;
+    MumDestroyEngine(scalarEngine);
+    MumDestroyEngine(simdEngine);
+    return success;
+}
 
-bool createReferenceFiles()
+// The CPU renderers pack straight into dst and run the rounds there, and
+// decrypt straight from src. Block by block, with some blocks encrypted
+// and decrypted in place, must give the same bytes as MumEncrypt.
+bool blockPathTest(EMumEngineType engineType, EMumBlockType blockType)
 {
-    char *referenceFileKey = "..\\referencefiles\\key.bin";
-
-    // create key
+    EMumError error;
+    uint32_t encryptSize, outlength, plaintextBlockSize, encryptedBlockSize;
+    uint32_t numBlocks = 9;
     uint8_t clavier[MUM_KEY_SIZE];
-    srand(610);
+    uint8_t block[TEST_MAX_BLOCK_SIZE];
+
+    void *engine1 = MumCreateEngine(engineType, blockType, MUM_PADDING_TYPE_ON, 4);
+    void *engine2 = MumCreateEngine(engineType, blockType, MUM_PADDING_TYPE_ON, 4);
     fillRandomly(clavier, MUM_KEY_SIZE);
+    error = MumInitKey(engine1, clavier);
+    error = MumInitKey(engine2, clavier);
+    error = MumPlaintextBlockSize(engine1, &plaintextBlockSize);
+    error = MumEncryptedBlockSize(engine1, &encryptedBlockSize);
 
-    // write it to disk
-    FILE *f;
-    size_t res;
-    fopen_s(&f, referenceFileKey, "wb");
-    if (!f) return false;
-    res = fwrite(clavier, 1, MUM_KEY_SIZE, f);
-    fclose(f);
-    if (res != MUM_KEY_SIZE)
-        return false;
+    uint32_t plaintextSize = numBlocks * plaintextBlockSize - 5;
+    error = MumEncryptedSize(engine1, plaintextSize, &encryptSize);
+    uint8_t *src = new uint8_t[plaintextSize];
+    uint8_t *enc1 = new uint8_t[encryptSize];
+    uint8_t *enc2 = new uint8_t[encryptSize];
+    fillRandomly(src, plaintextSize);
 
-    for (int blockType = MUM_BLOCKTYPE_128; blockType <= MUM_BLOCKTYPE_4096; blockType++)
+    bool success = (MumEncrypt(engine1, src, enc1, plaintextSize, &outlength, 0) == MUM_ERROR_OK);
+    for (uint32_t b = 0; success && b < numBlocks; b++)
     {
-        void * engine = MumCreateEngine(MUM_ENGINE_TYPE_CPU, (EMumBlockType)blockType, MUM_PADDING_TYPE_ON, TEST_MUM_NUM_THREADS);
-        EMumError error = MumLoadKey(engine, referenceFileKey);
-        if (error != MUM_ERROR_OK)
-            return false;
-        if (!createReferenceFilesFromEngine(engine, (EMumBlockType)blockType))
-            return false;
-        MumDestroyEngine(engine);
-        engine = NULL;
+        uint32_t length = (b == numBlocks - 1) ? plaintextBlockSize - 5 : plaintextBlockSize;
+        uint8_t *dst = enc2 + b * encryptedBlockSize;
+        memset(block, 0, sizeof(block));
+        memcpy(block, src + b * plaintextBlockSize, length);
+        if (b & 1)
+        {
+            error = MumEncryptBlock(engine2, block, block, length, b);
+            memcpy(dst, block, encryptedBlockSize);
+        }
+        else
+        {
+            error = MumEncryptBlock(engine2, block, dst, length, b);
+        }
+        success = (error == MUM_ERROR_OK);
+    }
+    if (success && memcmp(enc1, enc2, encryptSize) != 0)
+        success = false;
+
+    for (uint32_t b = 0; success && b < numBlocks; b++)
+    {
+        uint32_t length, seqnum;
+        memcpy(block, enc1 + b * encryptedBlockSize, encryptedBlockSize);
+        error = MumDecryptBlock(engine2, block, block, &length, &seqnum);
+        uint32_t expected = (b == numBlocks - 1) ? plaintextBlockSize - 5 : plaintextBlockSize;
+        if (error != MUM_ERROR_OK || length != expected || seqnum != b || memcmp(block, src + b * plaintextBlockSize, length) != 0)
+            success = false;
+    }
+
+    if (success)
+        printf("SUCCESS blockPathTest, engine %d, block type %d\n", engineType, blockType);
+    else
+        printf("FAILED blockPathTest, engine %d, block type %d\n", engineType, blockType);
+
+    delete[] src;
+    delete[] enc1;
+    delete[] enc2;
+    MumDestroyEngine(engine1);
+    MumDestroyEngine(engine2);
+    return success;
+}
+
+bool doBlockPathTests()
+{
+    EMumEngineType engineTypes[] = { MUM_ENGINE_TYPE_CPU, MUM_ENGINE_TYPE_CPU_GENERIC, MUM_ENGINE_TYPE_CPU_JIT };
+
+    for (uint32_t e = 0; e < sizeof(engineTypes) / sizeof(engineTypes[0]); e++)
+    {
+        for (int blockType = MUM_BLOCKTYPE_128; blockType <= MUM_BLOCKTYPE_8192; blockType++)
+        {
+            if (!blockPathTest(engineTypes[e], (EMumBlockType)blockType))
+                return false;
+        }
     }
     return true;
 }
-#endif
 
-bool doProfilings()
+// Encrypts and decrypts with src == dst. With padding the multi-threaded
+// output depends on which worker took which job, so the encrypted buffer is
+// only compared with a single worker; otherwise both engines must agree.
+bool inPlaceTest(EMumEngineType engineType, EMumBlockType blockType, EMumPaddingType paddingType, uint32_t numThreads)
 {
-    printf("\n");
-    for (int engineIndex = 0; engineIndex < TEST_NUM_ENGINES; engineIndex++)
+    EMumError error;
+    uint32_t encryptSize, outlength1, outlength2;
+    // several MT jobs and CPU tiles, and a partial last block
+    uint32_t plaintextSize = 300007;
+    uint8_t clavier[MUM_KEY_SIZE];
+
+    void *engine1 = MumCreateEngine(engineType, blockType, paddingType, numThreads);
+    void *engine2 = MumCreateEngine(engineType, blockType, paddingType, numThreads);
+    fillRandomly(clavier, MUM_KEY_SIZE);
+    error = MumInitKey(engine1, clavier);
+    error = MumInitKey(engine2, clavier);
+    error = MumEncryptedSize(engine1, plaintextSize, &encryptSize);
+
+    uint8_t *src = new uint8_t[plaintextSize];
+    uint8_t *enc = new uint8_t[encryptSize];
+    uint8_t *buffer = new uint8_t[encryptSize];
+    fillRandomly(src, plaintextSize);
+    memcpy(buffer, src, plaintextSize);
+
+    bool sameOutput = (engineType != MUM_ENGINE_TYPE_CPU_MT || numThreads == 1 || paddingType == MUM_PADDING_TYPE_OFF);
+    bool success = (MumEncrypt(engine1, src, enc, plaintextSize, &outlength1, 0) == MUM_ERROR_OK);
+    error = MumEncrypt(engine2, buffer, buffer, plaintextSize, &outlength2, 0);
+    if (error != MUM_ERROR_OK || outlength1 != outlength2 || outlength2 != encryptSize)
+        success = false;
+    if (success && sameOutput && memcmp(enc, buffer, encryptSize) != 0)
+        success = false;
+
+    // each engine decrypts the other's output in place
+    memcpy(enc, buffer, encryptSize);
+    error = MumDecrypt(engine1, buffer, buffer, encryptSize, &outlength1);
+    if (success && (error != MUM_ERROR_OK || memcmp(src, buffer, plaintextSize) != 0))
+        success = false;
+    error = MumDecrypt(engine2, enc, enc, encryptSize, &outlength2);
+    if (success && (error != MUM_ERROR_OK || memcmp(src, enc, plaintextSize) != 0))
+        success = false;
+
+    // buffers that overlap without being the same are refused
+    if (success && MumEncrypt(engine1, src, src + 1, 1000, &outlength1, 0) != MUM_ERROR_OVERLAPPING_BUFFERS)
+        success = false;
+
+    if (success)
+        printf("SUCCESS inPlaceTest, engine %d, threads %d, padding %d, block type %d\n", engineType, numThreads, paddingType, blockType);
+    else
+        printf("FAILED inPlaceTest, engine %d, threads %d, padding %d, block type %d\n", engineType, numThreads, paddingType, blockType);
+
+    delete[] src;
+    delete[] enc;
+    delete[] buffer;
+    MumDestroyEngine(engine1);
+    MumDestroyEngine(engine2);
+    return success;
+}
+
+bool doInPlaceTests()
+{
+    EMumEngineType engineTypes[] = { MUM_ENGINE_TYPE_CPU, MUM_ENGINE_TYPE_CPU_GENERIC, MUM_ENGINE_TYPE_CPU_JIT, MUM_ENGINE_TYPE_CPU_MT, MUM_ENGINE_TYPE_CPU_MT };
+    uint32_t numThreads[] = { 0, 0, 0, 1, TEST_MUM_NUM_THREADS };
+    EMumPaddingType paddingTypes[] = { MUM_PADDING_TYPE_ON, MUM_PADDING_TYPE_OFF };
+
+    for (uint32_t e = 0; e < sizeof(engineTypes) / sizeof(engineTypes[0]); e++)
     {
-        for (int paddingIndex = 0; paddingIndex < TEST_NUM_PADDING_TYPES; paddingIndex++)
+        for (uint32_t p = 0; p < sizeof(paddingTypes) / sizeof(paddingTypes[0]); p++)
         {
-            for (int blockType = firstProfilingBlockTypeList[engineIndex]; blockType <= MUM_BLOCKTYPE_4096; blockType++)
+            for (int blockType = MUM_BLOCKTYPE_128; blockType <= MUM_BLOCKTYPE_8192; blockType++)
             {
-                for (int i = 0; i < 1; i++)
-                {
-                    void * engine = MumCreateEngine(engineList[engineIndex], (EMumBlockType)blockType, paddingList[paddingIndex], TEST_MUM_NUM_THREADS);
-                    char testName[128];
-                    sprintf_s(testName, "%s:%s", engineName[engineIndex], paddingName[paddingIndex]);
-                    if (!doProfiling(engine, testName, (paddingIndex == 1)))
-                        return false;
-                    MumDestroyEngine(engine);
-                    engine = NULL;
-                }
+                if (!inPlaceTest(engineTypes[e], (EMumBlockType)blockType, paddingTypes[p], numThreads[e]))
+                    return false;
             }
         }
     }
     return true;
 }
 
-bool doMultiEngineTests()
+// The large-buffer mode only changes how the data moves, never the
+// output: one engine with it always on, one with it off.
+bool largeBufferTest(EMumEngineType engineType, EMumBlockType blockType, EMumPaddingType paddingType, uint32_t numThreads)
 {
-    for (int blockType = MUM_BLOCKTYPE_128; blockType <= MUM_BLOCKTYPE_4096; blockType++)
-    {
-        if (!doMultiEngineTest(
-			MUM_ENGINE_TYPE_CPU,
-			MUM_ENGINE_TYPE_GPU_A,
-            (EMumBlockType)blockType,
-            "CPU + GPUA"))
-            return false;
-    }
+    EMumError error;
+    uint32_t encryptSize, outlength1, outlength2;
+    uint32_t plaintextSize = 300007;
+    uint8_t clavier[MUM_KEY_SIZE];
 
-    if (!doMultiEngineTest(
-		MUM_ENGINE_TYPE_CPU,
-		MUM_ENGINE_TYPE_GPU_B,
-        MUM_BLOCKTYPE_4096,
-        "CPU + GPUB"))
-        return false;
+    void *engine1 = MumCreateEngine(engineType, blockType, paddingType, numThreads);
+    void *engine2 = MumCreateEngine(engineType, blockType, paddingType, numThreads);
+    fillRandomly(clavier, MUM_KEY_SIZE);
+    error = MumInitKey(engine1, clavier);
+    error = MumInitKey(engine2, clavier);
+    error = MumSetLargeBufferSize(engine1, 0xffffffff);
+    error = MumSetLargeBufferSize(engine2, 0);
+    error = MumEncryptedSize(engine1, plaintextSize, &encryptSize);
 
-    return true;
-}
+    uint8_t *src = new uint8_t[plaintextSize];
+    uint8_t *enc1 = new uint8_t[encryptSize];
+    uint8_t *enc2 = new uint8_t[encryptSize];
+    uint8_t *dec = new uint8_t[encryptSize];
+    fillRandomly(src, plaintextSize);
+
+    bool sameOutput = (engineType != MUM_ENGINE_TYPE_CPU_MT || numThreads == 1 || paddingType == MUM_PADDING_TYPE_OFF);
+    bool success = (MumEncrypt(engine1, src, enc1, plaintextSize, &outlength1, 0) == MUM_ERROR_OK);
+    error = MumEncrypt(engine2, src, enc2, plaintextSize, &outlength2, 0);
+    if (error != MUM_ERROR_OK || outlength1 != outlength2 || outlength2 != encryptSize)
+        success = false;
+    if (success && sameOutput && memcmp(enc1, enc2, encryptSize) != 0)
+        success = false;
+
+    // the large-buffer engine decrypts both, one of them in place
+    error = MumDecrypt(engine2, enc1, dec, encryptSize, &outlength2);
+    if (success && (error != MUM_ERROR_OK || memcmp(src, dec, plaintextSize) != 0))
+        success = false;
+    error = MumDecrypt(engine2, enc2, enc2, encryptSize, &outlength2);
+    if (success && (error != MUM_ERROR_OK || memcmp(src, enc2, plaintextSize) != 0))
+        success = false;
+
+    if (success)
+        printf("SUCCESS largeBufferTest, engine %d, threads %d, padding %d, block type %d\n", engineType, numThreads, paddingType, blockType);
+    else
+        printf("FAILED largeBufferTest, engine %d, threads %d, padding %d, block type %d\n", engineType, numThreads, paddingType, blockType);
 
+    delete[] src;
+    delete[] enc1;
+    delete[] enc2;
+    delete[] dec;
+    MumDestroyEngine(engine1);
+    MumDestroyEngine(engine2);
+    return success;
+}
 
-int main(int argc, char* argv[])
+bool doLargeBufferTests()
 {
-    int result = 0;
-#ifdef CREATE_REFERENCE_FILES
-    if (createReferenceFiles())
-        return -1;
-#endif
+    EMumEngineType engineTypes[] = { MUM_ENGINE_TYPE_CPU, MUM_ENGINE_TYPE_CPU_GENERIC, MUM_ENGINE_TYPE_CPU_JIT, MUM_ENGINE_TYPE_CPU_MT, MUM_ENGINE_TYPE_CPU_MT };
+    uint32_t numThreads[] = { 0, 0, 0, 1, TEST_MUM_NUM_THREADS };
+    EMumPaddingType paddingTypes[] = { MUM_PADDING_TYPE_ON, MUM_PADDING_TYPE_OFF };
 
-    init();
+    for (uint32_t e = 0; e < sizeof(engineTypes) / sizeof(engineTypes[0]); e++)
+    {
+        for (uint32_t p = 0; p < sizeof(paddingTypes) / sizeof(paddingTypes[0]); p++)
+        {
+            for (int blockType = MUM_BLOCKTYPE_128; blockType <= MUM_BLOCKTYPE_8192; blockType++)
+            {
+                if (!largeBufferTest(engineTypes[e], (EMumBlockType)blockType, paddingTypes[p], numThreads[e]))
+                    return false;
+            }
+        }
+    }
+    return true;
+}
 
-    srand(GetTickCount());
+// Requests of a few blocks up to a few grains per worker, each with a
+// partial last block, so the grains get split and stolen in every way.
+// Without padding the MT engine must match the CPU engine; with padding
+// it must decrypt its own output, copied and in place.
+bool schedulerTest(EMumBlockType blockType, EMumPaddingType paddingType, uint32_t numThreads)
+{
+    EMumError error;
+    uint32_t numBlocksList[] = { 1, 2, 3, 5, 9, 17, 31, 64, 65, 127, 300 };
+    uint32_t plaintextBlockSize, encryptSize, outlength1, outlength2;
+    uint8_t clavier[MUM_KEY_SIZE];
+    bool success = true;
 
-    if (!loadUrFiles())
-        result = -1;
-	
-	if (!doTests() )
-        result = -1;
+    void *engine1 = MumCreateEngine(MUM_ENGINE_TYPE_CPU, blockType, paddingType, 0);
+    void *engine2 = MumCreateEngine(MUM_ENGINE_TYPE_CPU_MT, blockType, paddingType, numThreads);
+    fillRandomly(clavier, MUM_KEY_SIZE);
+    error = MumInitKey(engine1, clavier);
+    error = MumInitKey(engine2, clavier);
+    error = MumPlaintextBlockSize(engine1, &plaintextBlockSize);
 
-    if (!doProfilings())
-        result = -1;
+    for (uint32_t n = 0; success && n < sizeof(numBlocksList) / sizeof(numBlocksList[0]); n++)
+    {
+        uint32_t plaintextSize = numBlocksList[n] * plaintextBlockSize - 7;
+        error = MumEncryptedSize(engine1, plaintextSize, &encryptSize);
+        // without padding no length is stored, whole blocks come back
+        uint32_t decryptSize = (paddingType == MUM_PADDING_TYPE_ON) ? plaintextSize : encryptSize;
+        uint8_t *src = new uint8_t[plaintextSize];
+        uint8_t *enc1 = new uint8_t[encryptSize];
+        uint8_t *enc2 = new uint8_t[encryptSize];
+        uint8_t *dec = new uint8_t[encryptSize];
+        fillRandomly(src, plaintextSize);
+
+        error = MumEncrypt(engine1, src, enc1, plaintextSize, &outlength1, 0);
+        if (MumEncrypt(engine2, src, enc2, plaintextSize, &outlength2, 0) != MUM_ERROR_OK || outlength1 != outlength2 || outlength2 != encryptSize)
+            success = false;
+        if (success && paddingType == MUM_PADDING_TYPE_OFF && memcmp(enc1, enc2, encryptSize) != 0)
+            success = false;
+        error = MumDecrypt(engine2, enc2, dec, encryptSize, &outlength2);
+        if (success && (error != MUM_ERROR_OK || outlength2 != decryptSize || memcmp(src, dec, plaintextSize) != 0))
+            success = false;
 
-    // if ( !doMultiEngineTests() )
-    // return -1;
+        memcpy(dec, src, plaintextSize);
+        error = MumEncrypt(engine2, dec, dec, plaintextSize, &outlength2, 0);
+        if (success && (error != MUM_ERROR_OK || outlength2 != encryptSize))
+            success = false;
+        error = MumDecrypt(engine2, dec, dec, encryptSize, &outlength2);
+        if (success && (error != MUM_ERROR_OK || outlength2 != decryptSize || memcmp(src, dec, plaintextSize) != 0))
+            success = false;
 
-    if (result != -1)
-        printf_s("Success!!! Done!!!\n");
-    else
-        printf_s("Done...but we failed someplace.\n");
+        if (!success)
+            printf("FAILED schedulerTest, %d blocks, threads %d, padding %d, block type %d\n", numBlocksList[n], numThreads, paddingType, blockType);
+        delete[] src;
+        delete[] enc1;
+        delete[] enc2;
+        delete[] dec;
+    }
+    if (success)
+        printf("SUCCESS schedulerTest, threads %d, padding %d, block type %d\n", numThreads, paddingType, blockType);
 
-    while (true)
-        ;
+    MumDestroyEngine(engine1);
+    MumDestroyEngine(engine2);
+    return success;
+}
+
+bool doSchedulerTests()
+{
+    // past 16 workers share PRNG subkey areas, on streams of their own
+    uint32_t numThreads[] = { 1, 3, TEST_MUM_NUM_THREADS, 16, 40 };
+    EMumPaddingType paddingTypes[] = { MUM_PADDING_TYPE_ON, MUM_PADDING_TYPE_OFF };
+
+    for (uint32_t t = 0; t < sizeof(numThreads) / sizeof(numThreads[0]); t++)
+    {
+        for (uint32_t p = 0; p < sizeof(paddingTypes) / sizeof(paddingTypes[0]); p++)
+        {
+            for (int blockType = MUM_BLOCKTYPE_128; blockType <= MUM_BLOCKTYPE_8192; blockType++)
+            {
+                if (!schedulerTest((EMumBlockType)blockType, paddingTypes[p], numThreads[t]))
+                    return false;
+            }
+        }
+    }
+    return true;
+}
+
+// A placed engine must give the output of the CPU engine, and its node
+// statistics must add up to the workers of its pool, one per hardware
+// thread at most whatever numThreads is, and to the bytes it was given.
+bool placementTest(EMumPlacementType placement, uint32_t numThreads)
+{
+    EMumError error;
+    uint32_t plaintextSize = 300000;
+    uint32_t encryptSize, outlength1, outlength2, numNodes;
+    uint32_t numWorkers, totalWorkers = 0;
+    uint64_t bytes, microseconds, totalBytes = 0;
+    uint8_t clavier[MUM_KEY_SIZE];
+
+    void *engine1 = MumCreateEngine(MUM_ENGINE_TYPE_CPU, MUM_BLOCKTYPE_1024, MUM_PADDING_TYPE_OFF, 0);
+    void *engine2 = MumCreateEngineWithPlacement(MUM_ENGINE_TYPE_CPU_MT, MUM_BLOCKTYPE_1024, MUM_PADDING_TYPE_OFF, numThreads, placement);
+    fillRandomly(clavier, MUM_KEY_SIZE);
+    error = MumInitKey(engine1, clavier);
+    error = MumInitKey(engine2, clavier);
+    error = MumEncryptedSize(engine1, plaintextSize, &encryptSize);
+
+    uint8_t *src = new uint8_t[plaintextSize];
+    uint8_t *enc1 = new uint8_t[encryptSize];
+    uint8_t *enc2 = new uint8_t[encryptSize];
+    uint8_t *dec = new uint8_t[encryptSize];
+    fillRandomly(src, plaintextSize);
+
+    bool success = (MumEncrypt(engine1, src, enc1, plaintextSize, &outlength1, 0) == MUM_ERROR_OK);
+    error = MumEncrypt(engine2, src, enc2, plaintextSize, &outlength2, 0);
+    if (error != MUM_ERROR_OK || outlength1 != outlength2 || memcmp(enc1, enc2, encryptSize) != 0)
+        success = false;
+    error = MumDecrypt(engine2, enc2, dec, encryptSize, &outlength2);
+    if (error != MUM_ERROR_OK || memcmp(src, dec, plaintextSize) != 0)
+        success = false;
+
+    error = MumGetNumNodes(engine2, &numNodes);
+    for (uint32_t node = 0; node < numNodes; node++)
+    {
+        if (MumGetNodeStats(engine2, node, &numWorkers, &bytes, &microseconds) != MUM_ERROR_OK)
+            success = false;
+        totalWorkers += numWorkers;
+        totalBytes += bytes;
+    }
+    if (numNodes == 0 || totalWorkers == 0 || totalWorkers > numHardwareThreads())
+        success = false;
+    if (placement == MUM_PLACEMENT_NONE && totalWorkers != numHardwareThreads())
+        success = false;
+    if (totalBytes != (uint64_t)plaintextSize + encryptSize)
+        success = false;
+    if (MumGetNodeStats(engine2, numNodes, &numWorkers, &bytes, &microseconds) != MUM_ERROR_INVALID_NODE)
+        success = false;
+    if (MumGetNodeStats(engine1, 0, &numWorkers, &bytes, &microseconds) != MUM_ERROR_RENDERER_NOT_MULTITHREADED)
+        success = false;
+
+    if (success)
+        printf("SUCCESS placementTest, placement %d, threads %d, %d nodes, %d workers\n", placement, numThreads, numNodes, totalWorkers);
+    else
+        printf("FAILED placementTest, placement %d, threads %d\n", placement, numThreads);
+
+    delete[] src;
+    delete[] enc1;
+    delete[] enc2;
+    delete[] dec;
+    MumDestroyEngine(engine1);
+    MumDestroyEngine(engine2);
+    return success;
+}
+
+bool doPlacementTests()
+{
+    EMumPlacementType placements[] = { MUM_PLACEMENT_NONE, MUM_PLACEMENT_CORE, MUM_PLACEMENT_SMT };
+    // 0 takes one worker per place; more workers than places share them
+    uint32_t numThreads[] = { 0, 3, 40 };
+
+    EMumPlacementType badPlacement = (EMumPlacementType)(MUM_PLACEMENT_SMT + 1);
+    if (MumCreateEngineWithPlacement(MUM_ENGINE_TYPE_CPU_MT, MUM_BLOCKTYPE_1024, MUM_PADDING_TYPE_OFF, 0, badPlacement) != NULL)
+    {
+        printf("FAILED doPlacementTests, placement %d accepted\n", badPlacement);
+        return false;
+    }
+    for (uint32_t p = 0; p < sizeof(placements) / sizeof(placements[0]); p++)
+    {
+        for (uint32_t t = 0; t < sizeof(numThreads) / sizeof(numThreads[0]); t++)
+        {
+            if (placements[p] == MUM_PLACEMENT_NONE && numThreads[t] == 0)
+                continue;
+            if (!placementTest(placements[p], numThreads[t]))
+                return false;
+        }
+    }
+    return true;
+}
+
+// Several app threads share one MT engine, each with calls of its own
+// sizes, Encrypt and Decrypt as well as single blocks. Without padding
+// every call must give the CPU engine's output; with padding it must
+// decrypt back to its plaintext. The data is made up front, rand() is not
+// for threads.
+bool concurrentCallsTest(EMumBlockType blockType, EMumPaddingType paddingType, uint32_t numThreads, uint32_t numCallers)
+{
+    EMumError error;
+    uint32_t numBlocksList[] = { 1, 3, 17, 64, 130 };
+    uint32_t numIterations = 4;
+    uint32_t plaintextBlockSize, encryptedBlockSize;
+    uint8_t clavier[MUM_KEY_SIZE];
+
+    void *engine1 = MumCreateEngine(MUM_ENGINE_TYPE_CPU, blockType, paddingType, 0);
+    void *engine2 = MumCreateEngine(MUM_ENGINE_TYPE_CPU_MT, blockType, paddingType, numThreads);
+    fillRandomly(clavier, MUM_KEY_SIZE);
+    error = MumInitKey(engine1, clavier);
+    if (error != MUM_ERROR_OK)
+        return false;
+    error = MumInitKey(engine2, clavier);
+    if (error != MUM_ERROR_OK)
+        return false;
+    error = MumPlaintextBlockSize(engine1, &plaintextBlockSize);
+    if (error != MUM_ERROR_OK)
+        return false;
+    error = MumEncryptedBlockSize(engine1, &encryptedBlockSize);
+    if (error != MUM_ERROR_OK)
+        return false;
+
+    std::vector<std::vector<uint8_t> > plaintexts(numCallers);
+    std::vector<std::vector<uint8_t> > references(numCallers);
+    std::vector<uint32_t> plaintextSizes(numCallers);
+    std::vector<uint32_t> encryptSizes(numCallers);
+    for (uint32_t c = 0; c < numCallers; c++)
+    {
+        uint32_t numBlocks = numBlocksList[c % (sizeof(numBlocksList) / sizeof(numBlocksList[0]))];
+        uint32_t outlength;
+        plaintextSizes[c] = numBlocks * plaintextBlockSize - 5;
+        error = MumEncryptedSize(engine1, plaintextSizes[c], &encryptSizes[c]);
+        if (error != MUM_ERROR_OK)
+            return false;
+        plaintexts[c].resize(plaintextSizes[c]);
+        references[c].resize(encryptSizes[c]);
+        fillRandomly(plaintexts[c].data(), plaintextSizes[c]);
+        error = MumEncrypt(engine1, plaintexts[c].data(), references[c].data(), plaintextSizes[c], &outlength, (uint16_t)c);
+        if (error != MUM_ERROR_OK)
+            return false;
+    }
+
+    // not std::vector<bool>, whose elements share bytes
+    std::vector<uint8_t> results(numCallers, 1);
+    std::vector<std::thread> callers;
+    for (uint32_t c = 0; c < numCallers; c++)
+    {
+        callers.push_back(std::thread([&, c]() {
+            uint32_t plaintextSize = plaintextSizes[c];
+            uint32_t encryptSize = encryptSizes[c];
+            // without padding no length is stored, whole blocks come back
+            uint32_t decryptSize = (paddingType == MUM_PADDING_TYPE_ON) ? plaintextSize : encryptSize;
+            std::vector<uint8_t> enc(encryptSize), dec(encryptSize);
+            uint32_t outlength, seqnum;
+
+            for (uint32_t i = 0; i < numIterations && results[c]; i++)
+            {
+                if (MumEncrypt(engine2, plaintexts[c].data(), enc.data(), plaintextSize, &outlength, (uint16_t)c) != MUM_ERROR_OK || outlength != encryptSize)
+                    results[c] = 0;
+                if (paddingType == MUM_PADDING_TYPE_OFF && memcmp(enc.data(), references[c].data(), encryptSize) != 0)
+                    results[c] = 0;
+                if (MumDecrypt(engine2, enc.data(), dec.data(), encryptSize, &outlength) != MUM_ERROR_OK || outlength != decryptSize)
+                    results[c] = 0;
+                if (memcmp(dec.data(), plaintexts[c].data(), plaintextSize) != 0)
+                    results[c] = 0;
+
+                if (MumEncryptBlock(engine2, plaintexts[c].data(), enc.data(), plaintextBlockSize, c + i) != MUM_ERROR_OK)
+                    results[c] = 0;
+                if (MumDecryptBlock(engine2, enc.data(), dec.data(), &outlength, &seqnum) != MUM_ERROR_OK)
+                    results[c] = 0;
+                if (paddingType == MUM_PADDING_TYPE_ON && (outlength != plaintextBlockSize || seqnum != ((c + i) & 0xffff)))
+                    results[c] = 0;
+                if (memcmp(dec.data(), plaintexts[c].data(), plaintextBlockSize) != 0)
+                    results[c] = 0;
+            }
+        }));
+    }
+    bool success = true;
+    for (uint32_t c = 0; c < numCallers; c++)
+    {
+        callers[c].join();
+        if (!results[c])
+            success = false;
+    }
+
+    if (success)
+        printf("SUCCESS concurrentCallsTest, threads %d, callers %d, padding %d, block type %d\n", numThreads, numCallers, paddingType, blockType);
+    else
+        printf("FAILED concurrentCallsTest, threads %d, callers %d, padding %d, block type %d\n", numThreads, numCallers, paddingType, blockType);
+
+    MumDestroyEngine(engine1);
+    MumDestroyEngine(engine2);
+    return success;
+}
+
+bool doConcurrentTests()
+{
+    uint32_t numThreads[] = { 1, 3, TEST_MUM_NUM_THREADS, 40 };
+    uint32_t numCallers[] = { 2, 5, 32 };
+    EMumPaddingType paddingTypes[] = { MUM_PADDING_TYPE_ON, MUM_PADDING_TYPE_OFF };
+    EMumBlockType blockTypes[] = { MUM_BLOCKTYPE_128, MUM_BLOCKTYPE_1024, MUM_BLOCKTYPE_8192 };
+
+    for (uint32_t t = 0; t < sizeof(numThreads) / sizeof(numThreads[0]); t++)
+    {
+        for (uint32_t c = 0; c < sizeof(numCallers) / sizeof(numCallers[0]); c++)
+        {
+            for (uint32_t p = 0; p < sizeof(paddingTypes) / sizeof(paddingTypes[0]); p++)
+            {
+                for (uint32_t b = 0; b < sizeof(blockTypes) / sizeof(blockTypes[0]); b++)
+                {
+                    if (!concurrentCallsTest(blockTypes[b], paddingTypes[p], numThreads[t], numCallers[c]))
+                        return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+// Completions seen by countCompletion, from any worker
+typedef struct TAsyncCounter
+{
+    std::atomic<uint32_t> completed;
+    std::atomic<uint32_t> failed;
+    std::atomic<uint64_t> bytes;
+} TAsyncCounter;
+
+void countCompletion(void *request, EMumError error, uint32_t outlength, void *userData)
+{
+    TAsyncCounter *counter = (TAsyncCounter *)userData;
+    if (error != MUM_ERROR_OK)
+        counter->failed++;
+    counter->bytes += outlength;
+    counter->completed++;
+}
+
+// Many requests in flight at once, half of them with a handle that is
+// polled or waited for, half detached and only seen by their callback.
+// Without padding the output must match the CPU engine; with padding it
+// must decrypt back, asynchronously as well. Detached requests still in
+// flight must complete before MumDestroyEngine returns.
+bool asyncRequestTest(EMumBlockType blockType, EMumPaddingType paddingType, uint32_t numThreads)
+{
+    EMumError error;
+    const uint32_t numRequests = 64;
+    uint32_t numBlocksList[] = { 1, 2, 7, 33, 100 };
+    uint32_t plaintextBlockSize, outlength;
+    uint8_t clavier[MUM_KEY_SIZE];
+    TAsyncCounter counter;
+    bool success = true;
+    counter.completed = 0;
+    counter.failed = 0;
+    counter.bytes = 0;
+
+    void *engine1 = MumCreateEngine(MUM_ENGINE_TYPE_CPU, blockType, paddingType, 0);
+    void *engine2 = MumCreateEngine(MUM_ENGINE_TYPE_CPU_MT, blockType, paddingType, numThreads);
+    fillRandomly(clavier, MUM_KEY_SIZE);
+    error = MumInitKey(engine1, clavier);
+    if (error != MUM_ERROR_OK)
+        return false;
+    error = MumInitKey(engine2, clavier);
+    if (error != MUM_ERROR_OK)
+        return false;
+    error = MumPlaintextBlockSize(engine1, &plaintextBlockSize);
+    if (error != MUM_ERROR_OK)
+        return false;
+
+    void *request = nullptr;
+    if (MumEncryptAsync(engine1, largePlaintext, largeEncrypt, plaintextBlockSize, 0, nullptr, nullptr, &request) != MUM_ERROR_RENDERER_NOT_MULTITHREADED)
+        success = false;
+    if (MumEncryptAsync(engine2, largePlaintext, largeEncrypt, 0, 0, countCompletion, &counter, &request) != MUM_ERROR_OK
+        || MumPollRequest(request) != MUM_ERROR_OK || counter.completed != 1)
+        success = false;
+    MumDestroyRequest(request);
+    counter.completed = 0;
+
+    std::vector<uint32_t> plaintextSizes(numRequests), encryptSizes(numRequests);
+    std::vector<uint32_t> plaintextOffsets(numRequests), encryptOffsets(numRequests);
+    std::vector<void *> requests(numRequests, nullptr);
+    uint32_t plaintextOffset = 0, encryptOffset = 0;
+    uint64_t detachedBytes = 0;
+    for (uint32_t r = 0; r < numRequests; r++)
+    {
+        plaintextSizes[r] = numBlocksList[r % (sizeof(numBlocksList) / sizeof(numBlocksList[0]))] * plaintextBlockSize - r % 3;
+        error = MumEncryptedSize(engine1, plaintextSizes[r], &encryptSizes[r]);
+        plaintextOffsets[r] = plaintextOffset;
+        encryptOffsets[r] = encryptOffset;
+        plaintextOffset += plaintextSizes[r];
+        encryptOffset += encryptSizes[r];
+        if (r % 2)
+            detachedBytes += encryptSizes[r];
+    }
+    fillRandomly(largePlaintext, plaintextOffset);
+
+    for (uint32_t r = 0; r < numRequests && success; r++)
+    {
+        error = MumEncryptAsync(engine2, largePlaintext + plaintextOffsets[r], largeEncrypt + encryptOffsets[r], plaintextSizes[r],
+            (uint16_t)r, (r % 2) ? countCompletion : nullptr, &counter, (r % 2) ? nullptr : &requests[r]);
+        if (error != MUM_ERROR_OK)
+            success = false;
+    }
+    for (uint32_t r = 0; r < numRequests && success; r += 2)
+    {
+        // the first ones are polled, the rest waited for
+        if (r < numRequests / 2)
+        {
+            while ((error = MumPollRequest(requests[r])) == MUM_ERROR_REQUEST_PENDING)
+                std::this_thread::yield();
+        }
+        if (MumWaitRequest(requests[r], &outlength) != MUM_ERROR_OK || error != MUM_ERROR_OK || outlength != encryptSizes[r])
+            success = false;
+        MumDestroyRequest(requests[r]);
+    }
+    while (success && counter.completed < numRequests / 2)
+        std::this_thread::yield();
+    if (counter.failed != 0 || counter.bytes != detachedBytes)
+        success = false;
+
+    for (uint32_t r = 0; r < numRequests && success; r++)
+    {
+        uint8_t *encrypted = largeEncrypt + encryptOffsets[r];
+        if (paddingType == MUM_PADDING_TYPE_OFF)
+        {
+            error = MumEncrypt(engine1, largePlaintext + plaintextOffsets[r], largeDecrypt, plaintextSizes[r], &outlength, (uint16_t)r);
+            if (memcmp(largeDecrypt, encrypted, encryptSizes[r]) != 0)
+                success = false;
+            continue;
+        }
+        // decrypted in place, half of them
+        uint8_t *dst = (r % 2) ? encrypted : largeDecrypt;
+        error = MumDecryptAsync(engine2, encrypted, dst, encryptSizes[r], nullptr, nullptr, &request);
+        if (error != MUM_ERROR_OK)
+            success = false;
+        else if (MumWaitRequest(request, &outlength) != MUM_ERROR_OK || outlength != plaintextSizes[r]
+            || memcmp(dst, largePlaintext + plaintextOffsets[r], plaintextSizes[r]) != 0)
+            success = false;
+        if (error == MUM_ERROR_OK)
+            MumDestroyRequest(request);
+    }
+
+    // left in flight for MumDestroyEngine
+    counter.completed = 0;
+    for (uint32_t r = 0; r < numRequests && success; r++)
+        error = MumEncryptAsync(engine2, largePlaintext + plaintextOffsets[r], largeEncrypt + encryptOffsets[r], plaintextSizes[r],
+            (uint16_t)r, countCompletion, &counter, nullptr);
+    MumDestroyEngine(engine1);
+    MumDestroyEngine(engine2);
+    if (success && counter.completed != numRequests)
+        success = false;
+
+    if (success)
+        printf("SUCCESS asyncRequestTest, threads %d, padding %d, block type %d\n", numThreads, paddingType, blockType);
+    else
+        printf("FAILED asyncRequestTest, threads %d, padding %d, block type %d\n", numThreads, paddingType, blockType);
+    return success;
+}
+
+// A block changed in a buffer of many grains: the worker of that grain
+// sees the bad checksum, and MumDecrypt, the waited-for and the detached
+// asynchronous decrypt must all report it, in place or not.
+bool asyncTamperedTest(EMumBlockType blockType, uint32_t numThreads)
+{
+    const uint32_t numBlocks = 100;
+    uint32_t plaintextBlockSize, encryptedBlockSize, encrypted, outlength;
+    uint8_t clavier[MUM_KEY_SIZE];
+    TAsyncCounter counter;
+    bool success = true;
+    counter.completed = 0;
+    counter.failed = 0;
+    counter.bytes = 0;
+
+    void *engine = MumCreateEngine(MUM_ENGINE_TYPE_CPU_MT, blockType, MUM_PADDING_TYPE_ON, numThreads);
+    fillRandomly(clavier, MUM_KEY_SIZE);
+    EMumError error = MumInitKey(engine, clavier);
+    if (error != MUM_ERROR_OK)
+        return false;
+    error = MumPlaintextBlockSize(engine, &plaintextBlockSize);
+    if (error != MUM_ERROR_OK)
+        return false;
+    error = MumEncryptedBlockSize(engine, &encryptedBlockSize);
+    if (error != MUM_ERROR_OK)
+        return false;
+    uint32_t plaintextSize = numBlocks * plaintextBlockSize;
+    fillRandomly(largePlaintext, plaintextSize);
+    error = MumEncrypt(engine, largePlaintext, largeEncrypt, plaintextSize, &encrypted, 0);
+    if (error != MUM_ERROR_OK)
+        return false;
+    largeEncrypt[(numBlocks / 2) * encryptedBlockSize + encryptedBlockSize / 2] ^= 0x01;
+
+    if (MumDecrypt(engine, largeEncrypt, largeDecrypt, encrypted, &outlength) != MUM_ERROR_INVALID_ENCRYPTED_BLOCK)
+        success = false;
+    void *request;
+    for (int inPlace = 0; inPlace <= 1 && success; inPlace++)
+    {
+        uint8_t *dst = inPlace ? largeEncrypt : largeDecrypt;
+        error = MumDecryptAsync(engine, largeEncrypt, dst, encrypted, nullptr, nullptr, &request);
+        if (error != MUM_ERROR_OK)
+            success = false;
+        else
+        {
+            if (MumWaitRequest(request, &outlength) != MUM_ERROR_INVALID_ENCRYPTED_BLOCK)
+                success = false;
+            MumDestroyRequest(request);
+        }
+    }
+    error = MumDecryptAsync(engine, largeEncrypt, largeDecrypt, encrypted, countCompletion, &counter, nullptr);
+    if (error != MUM_ERROR_OK)
+        success = false;
+    MumDestroyEngine(engine);
+    if (success && (counter.completed != 1 || counter.failed != 1))
+        success = false;
+
+    if (success)
+        printf("SUCCESS asyncTamperedTest, threads %d, block type %d\n", numThreads, blockType);
+    else
+        printf("FAILED asyncTamperedTest, threads %d, block type %d\n", numThreads, blockType);
+    return success;
+}
+
+// Encrypts a file one chunk at a time, reading the next chunks while the
+// earlier ones are still being encrypted: each of numInFlight buffers is
+// read into, handed to MumEncryptAsync and only waited for when its turn
+// to be read into comes round again. numInFlight 0 reads and encrypts in
+// turn with MumEncrypt. The encrypted chunks are decrypted in one call and
+// compared with the file.
+bool encryptFileInChunks(void *engine, char *filename, uint32_t numInFlight, double *time)
+{
+    EMumError error = MUM_ERROR_OK;
+    uint32_t plaintextBlockSize, encryptedBlockSize, outlength;
+    uint32_t chunkBlocks = 16;
+    TAsyncCounter counter;
+    counter.completed = 0;
+    counter.failed = 0;
+    counter.bytes = 0;
+
+    error = MumPlaintextBlockSize(engine, &plaintextBlockSize);
+    error = MumEncryptedBlockSize(engine, &encryptedBlockSize);
+    uint32_t chunkSize = chunkBlocks * plaintextBlockSize;
+    uint32_t encryptedChunkSize = chunkBlocks * encryptedBlockSize;
+
+    FILE *f = fopen(filename, "rb");
+    if (!f)
+        return false;
+    fseek(f, 0, SEEK_END);
+    uint32_t fileSize = (uint32_t)ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint32_t numChunks = (fileSize + chunkSize - 1) / chunkSize;
+
+    std::vector<uint8_t> encrypted((size_t)numChunks * encryptedChunkSize);
+    std::vector<std::vector<uint8_t> > buffers(numInFlight > 0 ? numInFlight : 1, std::vector<uint8_t>(chunkSize));
+    std::vector<void *> requests(buffers.size(), nullptr);
+    uint64_t encryptedSize = 0;
+
+    startCounter();
+    for (uint32_t c = 0; c < numChunks && error == MUM_ERROR_OK; c++)
+    {
+        uint32_t b = c % buffers.size();
+        if (requests[b] != nullptr)
+        {
+            error = MumWaitRequest(requests[b], &outlength);
+            encryptedSize += outlength;
+            MumDestroyRequest(requests[b]);
+            requests[b] = nullptr;
+        }
+        uint32_t size = (uint32_t)fread(buffers[b].data(), 1, chunkSize, f);
+        if (numInFlight == 0)
+        {
+            if (error == MUM_ERROR_OK)
+                error = MumEncrypt(engine, buffers[b].data(), &encrypted[(size_t)c * encryptedChunkSize], size, &outlength, (uint16_t)(c * chunkBlocks));
+            encryptedSize += outlength;
+        }
+        else if (error == MUM_ERROR_OK)
+            error = MumEncryptAsync(engine, buffers[b].data(), &encrypted[(size_t)c * encryptedChunkSize], size, (uint16_t)(c * chunkBlocks),
+                countCompletion, &counter, &requests[b]);
+    }
+    for (uint32_t b = 0; b < requests.size(); b++)
+    {
+        if (requests[b] == nullptr)
+            continue;
+        if (MumWaitRequest(requests[b], &outlength) != MUM_ERROR_OK)
+            error = MUM_ERROR_INVALID_ENCRYPTED_BLOCK;
+        encryptedSize += outlength;
+        MumDestroyRequest(requests[b]);
+    }
+    *time = getCounter();
+    fclose(f);
+
+    // only the last chunk is short
+    uint32_t lastEncryptedSize;
+    error = MumEncryptedSize(engine, fileSize - (numChunks - 1) * chunkSize, &lastEncryptedSize);
+    if (error != MUM_ERROR_OK || encryptedSize != (uint64_t)(numChunks - 1) * encryptedChunkSize + lastEncryptedSize)
+        return false;
+    if (numInFlight > 0 && (counter.completed != numChunks || counter.failed != 0 || counter.bytes != encryptedSize))
+        return false;
+
+    size_t length;
+    uint8_t *original = nullptr;
+    if (!loadFile(filename, &original, &length))
+        return false;
+    std::vector<uint8_t> decrypted(encrypted.size());
+    error = MumDecrypt(engine, encrypted.data(), decrypted.data(), (uint32_t)encryptedSize, &outlength);
+    bool success = (error == MUM_ERROR_OK && outlength == length && memcmp(original, decrypted.data(), length) == 0);
+    free(original);
+    return success;
+}
+
+bool asyncFileTest(EMumBlockType blockType)
+{
+    uint32_t numInFlightList[] = { 0, 1, 4, 16 };
+    uint8_t clavier[MUM_KEY_SIZE];
+    double time;
+    bool success = true;
+
+    void *engine = MumCreateEngine(MUM_ENGINE_TYPE_CPU_MT, blockType, MUM_PADDING_TYPE_ON, TEST_MUM_NUM_THREADS);
+    fillRandomly(clavier, MUM_KEY_SIZE);
+    EMumError error = MumInitKey(engine, clavier);
+    if (error != MUM_ERROR_OK)
+        return false;
+    for (uint32_t i = 0; i < NUM_REFERENCE_FILES && success; i++)
+    {
+        for (uint32_t n = 0; n < sizeof(numInFlightList) / sizeof(numInFlightList[0]) && success; n++)
+        {
+            if (!encryptFileInChunks(engine, referenceFiles[i], numInFlightList[n], &time))
+            {
+                printf("FAILED asyncFileTest, %s, %d in flight, block type %d\n", referenceFiles[i], numInFlightList[n], blockType);
+                success = false;
+            }
+        }
+    }
+    if (success)
+        printf("SUCCESS asyncFileTest, block type %d\n", blockType);
+    MumDestroyEngine(engine);
+    return success;
+}
+
+// What a callback that submits from a worker needs: the engine, and more
+// one-block requests than the pool's queue holds
+typedef struct TCallbackSubmit
+{
+    void *engine;
+    uint32_t numRequests;
+    uint32_t plaintextBlockSize;
+    uint32_t encryptedBlockSize;
+    std::atomic<uint32_t> submitted;
+    TAsyncCounter counter;
+} TCallbackSubmit;
+
+void submitFromCallback(void *request, EMumError error, uint32_t outlength, void *userData)
+{
+    TCallbackSubmit *submit = (TCallbackSubmit *)userData;
+    for (uint32_t r = 0; r < submit->numRequests; r++)
+    {
+        if (MumEncryptAsync(submit->engine, largePlaintext + r * submit->plaintextBlockSize, largeEncrypt + r * submit->encryptedBlockSize,
+            submit->plaintextBlockSize, (uint16_t)r, countCompletion, &submit->counter, nullptr) == MUM_ERROR_OK)
+            submit->submitted++;
+    }
+}
+
+// A completion callback runs on a pool worker. When it queues more tickets
+// than the ring holds, with the workers busy, the worker has to run the
+// rest itself rather than wait for the ring it is meant to drain.
+bool callbackSubmitTest()
+{
+    uint8_t clavier[MUM_KEY_SIZE];
+    uint32_t outlength;
+    TCallbackSubmit submit;
+    bool success = true;
+
+    submit.engine = MumCreateEngine(MUM_ENGINE_TYPE_CPU_MT, MUM_BLOCKTYPE_128, MUM_PADDING_TYPE_ON, 1);
+    submit.numRequests = 3 * TEST_QUEUE_SIZE;
+    submit.submitted = 0;
+    submit.counter.completed = 0;
+    submit.counter.failed = 0;
+    submit.counter.bytes = 0;
+    fillRandomly(clavier, MUM_KEY_SIZE);
+    EMumError error = MumInitKey(submit.engine, clavier);
+    if (error != MUM_ERROR_OK)
+        return false;
+    error = MumPlaintextBlockSize(submit.engine, &submit.plaintextBlockSize);
+    if (error != MUM_ERROR_OK)
+        return false;
+    error = MumEncryptedBlockSize(submit.engine, &submit.encryptedBlockSize);
+    if (error != MUM_ERROR_OK)
+        return false;
+
+    void *request;
+    error = MumEncryptAsync(submit.engine, largePlaintext, largeDecrypt, submit.plaintextBlockSize, 0, submitFromCallback, &submit, &request);
+    if (error != MUM_ERROR_OK)
+        return false;
+    if (MumWaitRequest(request, &outlength) != MUM_ERROR_OK)
+        success = false;
+    MumDestroyRequest(request);
+    // waits for the detached requests
+    MumDestroyEngine(submit.engine);
+    if (submit.submitted != submit.numRequests || submit.counter.completed != submit.numRequests
+        || submit.counter.failed != 0 || submit.counter.bytes != (uint64_t)submit.numRequests * submit.encryptedBlockSize)
+        success = false;
+
+    if (success)
+        printf("SUCCESS callbackSubmitTest, %d requests\n", submit.numRequests);
+    else
+        printf("FAILED callbackSubmitTest, %d requests\n", submit.numRequests);
+    return success;
+}
+
+bool doAsyncTests()
+{
+    uint32_t numThreads[] = { 1, 3, TEST_MUM_NUM_THREADS };
+    EMumPaddingType paddingTypes[] = { MUM_PADDING_TYPE_ON, MUM_PADDING_TYPE_OFF };
+
+    for (uint32_t t = 0; t < sizeof(numThreads) / sizeof(numThreads[0]); t++)
+    {
+        for (uint32_t p = 0; p < sizeof(paddingTypes) / sizeof(paddingTypes[0]); p++)
+        {
+            for (int blockType = MUM_BLOCKTYPE_128; blockType <= MUM_BLOCKTYPE_8192; blockType++)
+            {
+                if (!asyncRequestTest((EMumBlockType)blockType, paddingTypes[p], numThreads[t]))
+                    return false;
+            }
+        }
+    }
+    for (uint32_t t = 0; t < sizeof(numThreads) / sizeof(numThreads[0]); t++)
+    {
+        for (int blockType = MUM_BLOCKTYPE_128; blockType <= MUM_BLOCKTYPE_8192; blockType++)
+        {
+            if (!asyncTamperedTest((EMumBlockType)blockType, numThreads[t]))
+                return false;
+        }
+    }
+    for (int blockType = MUM_BLOCKTYPE_128; blockType <= MUM_BLOCKTYPE_8192; blockType++)
+    {
+        if (!asyncFileTest((EMumBlockType)blockType))
+            return false;
+    }
+    if (!callbackSubmitTest())
+        return false;
+    return true;
+}
+
+// A process full of MT engines, of every block type, each with its own key
+// and its own numThreads, used from a thread each at once. The engines
+// share one pool, so the process gains no more threads than the hardware
+// has, and every engine must still give the CPU engine's output.
+bool sharedPoolTest(uint32_t numEngines)
+{
+    EMumError error;
+    uint32_t numThreadsList[] = { 1, 3, TEST_MUM_NUM_THREADS, 40 };
+    uint32_t numThreadsBefore = numProcessThreads();
+    std::vector<void *> engines1(numEngines), engines2(numEngines);
+    std::vector<std::vector<uint8_t> > plaintexts(numEngines), references(numEngines);
+    uint8_t clavier[MUM_KEY_SIZE];
+    bool success = true;
+
+    for (uint32_t e = 0; e < numEngines; e++)
+    {
+        EMumBlockType blockType = (EMumBlockType)(MUM_BLOCKTYPE_128 + e % MUM_BLOCKTYPE_8192);
+        uint32_t numThreads = numThreadsList[e % (sizeof(numThreadsList) / sizeof(numThreadsList[0]))];
+        uint32_t plaintextBlockSize, encryptSize, outlength;
+        engines1[e] = MumCreateEngine(MUM_ENGINE_TYPE_CPU, blockType, MUM_PADDING_TYPE_OFF, 0);
+        engines2[e] = MumCreateEngine(MUM_ENGINE_TYPE_CPU_MT, blockType, MUM_PADDING_TYPE_OFF, numThreads);
+        fillRandomly(clavier, MUM_KEY_SIZE);
+        error = MumInitKey(engines1[e], clavier);
+        if (error != MUM_ERROR_OK)
+            return false;
+        error = MumInitKey(engines2[e], clavier);
+        if (error != MUM_ERROR_OK)
+            return false;
+        error = MumPlaintextBlockSize(engines1[e], &plaintextBlockSize);
+        if (error != MUM_ERROR_OK)
+            return false;
+        plaintexts[e].resize(37 * plaintextBlockSize);
+        fillRandomly(plaintexts[e].data(), (uint32_t)plaintexts[e].size());
+        error = MumEncryptedSize(engines1[e], (uint32_t)plaintexts[e].size(), &encryptSize);
+        if (error != MUM_ERROR_OK)
+            return false;
+        references[e].resize(encryptSize);
+        error = MumEncrypt(engines1[e], plaintexts[e].data(), references[e].data(), (uint32_t)plaintexts[e].size(), &outlength, 0);
+        if (error != MUM_ERROR_OK)
+            return false;
+    }
+    uint32_t numThreadsAfter = numProcessThreads();
+    if (numThreadsAfter > numThreadsBefore + numHardwareThreads())
+        success = false;
+
+    std::vector<uint8_t> results(numEngines, 1);
+    std::vector<std::thread> callers;
+    for (uint32_t e = 0; e < numEngines; e++)
+    {
+        callers.push_back(std::thread([&, e]() {
+            std::vector<uint8_t> enc(references[e].size()), dec(references[e].size());
+            uint32_t outlength;
+            for (uint32_t i = 0; i < 3; i++)
+            {
+                if (MumEncrypt(engines2[e], plaintexts[e].data(), enc.data(), (uint32_t)plaintexts[e].size(), &outlength, 0) != MUM_ERROR_OK
+                    || memcmp(enc.data(), references[e].data(), enc.size()) != 0)
+                    results[e] = 0;
+                if (MumDecrypt(engines2[e], enc.data(), dec.data(), (uint32_t)enc.size(), &outlength) != MUM_ERROR_OK
+                    || memcmp(dec.data(), plaintexts[e].data(), plaintexts[e].size()) != 0)
+                    results[e] = 0;
+            }
+        }));
+    }
+    for (uint32_t e = 0; e < numEngines; e++)
+    {
+        callers[e].join();
+        if (!results[e])
+            success = false;
+    }
+    for (uint32_t e = 0; e < numEngines; e++)
+    {
+        MumDestroyEngine(engines1[e]);
+        MumDestroyEngine(engines2[e]);
+    }
+    // the last engine ends the pool
+    if (numProcessThreads() > numThreadsBefore)
+        success = false;
+
+    if (success)
+        printf("SUCCESS sharedPoolTest, %d engines, %d threads before, %d with the engines\n", numEngines, numThreadsBefore, numThreadsAfter);
+    else
+        printf("FAILED sharedPoolTest, %d engines, %d threads before, %d with the engines\n", numEngines, numThreadsBefore, numThreadsAfter);
+    return success;
+}
+
+bool doSharedPoolTests()
+{
+    uint32_t numEnginesList[] = { 1, 7, 64 };
+    for (uint32_t n = 0; n < sizeof(numEnginesList) / sizeof(numEnginesList[0]); n++)
+    {
+        if (!sharedPoolTest(numEnginesList[n]))
+            return false;
+    }
+    return true;
+}
+
+// Callers of small requests share the workers with a caller of bulk
+// requests on another engine, with the given priority and inline
+// threshold, and with the other priority given per call. Sizes on both
+// sides of the threshold are run, in place too, and asynchronously.
+// Without padding every call must give the CPU engine's output; with
+// padding it must decrypt back to its plaintext.
+bool priorityTest(EMumBlockType blockType, EMumPaddingType paddingType, EMumPriority priority, uint32_t inlineBlocks)
+{
+    EMumError error;
+    EMumPriority otherPriority = (priority == MUM_PRIORITY_BULK) ? MUM_PRIORITY_INTERACTIVE : MUM_PRIORITY_BULK;
+    uint32_t numBlocksList[] = { 1, 2, 4, 5, 17 };
+    uint32_t numCallers = 4;
+    uint32_t bulkSize = 1000000;
+    uint32_t plaintextBlockSize, encryptedBlockSize, bulkEncryptSize, value;
+    EMumPriority gotPriority;
+    uint8_t clavier[MUM_KEY_SIZE];
+    bool success = true;
+
+    void *engine1 = MumCreateEngine(MUM_ENGINE_TYPE_CPU, blockType, paddingType, 0);
+    void *engine2 = MumCreateEngine(MUM_ENGINE_TYPE_CPU_MT, blockType, paddingType, TEST_MUM_NUM_THREADS);
+    void *bulkEngine = MumCreateEngine(MUM_ENGINE_TYPE_CPU_MT, blockType, paddingType, TEST_MUM_NUM_THREADS);
+    fillRandomly(clavier, MUM_KEY_SIZE);
+    error = MumInitKey(engine1, clavier);
+    if (error == MUM_ERROR_OK)
+        error = MumInitKey(engine2, clavier);
+    if (error == MUM_ERROR_OK)
+        error = MumInitKey(bulkEngine, clavier);
+    if (error == MUM_ERROR_OK)
+        error = MumPlaintextBlockSize(engine1, &plaintextBlockSize);
+    if (error == MUM_ERROR_OK)
+        error = MumEncryptedBlockSize(engine1, &encryptedBlockSize);
+    if (error == MUM_ERROR_OK)
+        error = MumEncryptedSize(engine1, bulkSize, &bulkEncryptSize);
+    if (error != MUM_ERROR_OK)
+    {
+        MumDestroyEngine(engine1);
+        MumDestroyEngine(engine2);
+        MumDestroyEngine(bulkEngine);
+        return false;
+    }
+
+    if (MumGetPriority(engine2, &gotPriority) != MUM_ERROR_OK || gotPriority != MUM_PRIORITY_BULK)
+        success = false;
+    if (MumGetInlineBlocks(engine2, &value) != MUM_ERROR_OK || value != MUM_INLINE_BLOCKS)
+        success = false;
+    if (MumSetPriority(engine2, priority) != MUM_ERROR_OK || MumSetInlineBlocks(engine2, inlineBlocks) != MUM_ERROR_OK)
+        success = false;
+    if (MumGetPriority(engine2, &gotPriority) != MUM_ERROR_OK || gotPriority != priority)
+        success = false;
+    if (MumGetInlineBlocks(engine2, &value) != MUM_ERROR_OK || value != inlineBlocks)
+        success = false;
+    if (MumSetPriority(engine1, priority) != MUM_ERROR_RENDERER_NOT_MULTITHREADED
+        || MumGetInlineBlocks(engine1, &value) != MUM_ERROR_RENDERER_NOT_MULTITHREADED)
+        success = false;
+    // the CPU engine has no workers to queue on
+    if (MumEncryptAsyncWithPriority(engine1, NULL, NULL, 0, 0, priority, NULL, NULL, NULL) != MUM_ERROR_RENDERER_NOT_MULTITHREADED)
+        success = false;
+    // the job queue has a ring for each priority, and nothing beyond them
+    EMumPriority badPriority = (EMumPriority)(MUM_PRIORITY_INTERACTIVE + 1);
+    std::vector<uint8_t> badSrc(plaintextBlockSize), badDst(2 * encryptedBlockSize);
+    uint32_t badLength;
+    if (MumSetPriority(engine2, badPriority) != MUM_ERROR_INVALID_PRIORITY
+        || MumSetPriority(engine1, badPriority) != MUM_ERROR_INVALID_PRIORITY
+        || MumSetPriority(engine2, (EMumPriority)-1) != MUM_ERROR_INVALID_PRIORITY)
+        success = false;
+    if (MumGetPriority(engine2, &gotPriority) != MUM_ERROR_OK || gotPriority != priority)
+        success = false;
+    if (MumEncryptWithPriority(engine2, badSrc.data(), badDst.data(), plaintextBlockSize, &badLength, 0, badPriority) != MUM_ERROR_INVALID_PRIORITY
+        || MumDecryptWithPriority(engine2, badDst.data(), badSrc.data(), encryptedBlockSize, &badLength, badPriority) != MUM_ERROR_INVALID_PRIORITY
+        || MumEncryptWithPriority(engine1, badSrc.data(), badDst.data(), plaintextBlockSize, &badLength, 0, badPriority) != MUM_ERROR_INVALID_PRIORITY)
+        success = false;
+    if (MumEncryptAsyncWithPriority(engine2, badSrc.data(), badDst.data(), plaintextBlockSize, 0, badPriority, NULL, NULL, NULL) != MUM_ERROR_INVALID_PRIORITY
+        || MumDecryptAsyncWithPriority(engine2, badDst.data(), badSrc.data(), encryptedBlockSize, badPriority, NULL, NULL, NULL) != MUM_ERROR_INVALID_PRIORITY)
+        success = false;
+
+    uint32_t numSizes = sizeof(numBlocksList) / sizeof(numBlocksList[0]);
+    std::vector<std::vector<uint8_t> > plaintexts(numSizes), references(numSizes);
+    std::vector<uint32_t> plaintextSizes(numSizes), encryptSizes(numSizes);
+    for (uint32_t s = 0; s < numSizes; s++)
+    {
+        uint32_t outlength;
+        plaintextSizes[s] = numBlocksList[s] * plaintextBlockSize - 3;
+        if (MumEncryptedSize(engine1, plaintextSizes[s], &encryptSizes[s]) != MUM_ERROR_OK)
+            success = false;
+        plaintexts[s].resize(plaintextSizes[s]);
+        references[s].resize(encryptSizes[s]);
+        fillRandomly(plaintexts[s].data(), plaintextSizes[s]);
+        if (MumEncryptWithPriority(engine1, plaintexts[s].data(), references[s].data(), plaintextSizes[s], &outlength, (uint16_t)s, priority) != MUM_ERROR_OK)
+            success = false;
+    }
+    std::vector<uint8_t> bulkPlaintext(bulkSize);
+    fillRandomly(bulkPlaintext.data(), bulkSize);
+
+    std::atomic<bool> done(false);
+    std::atomic<uint32_t> bulkCalls(0);
+    std::thread bulkCaller([&]() {
+        std::vector<uint8_t> enc(bulkEncryptSize);
+        uint32_t outlength;
+        while (!done)
+        {
+            if (MumEncrypt(bulkEngine, bulkPlaintext.data(), enc.data(), bulkSize, &outlength, 0) != MUM_ERROR_OK || outlength != bulkEncryptSize)
+                done = true;
+            else
+                bulkCalls++;
+        }
+    });
+
+    // not std::vector<bool>, whose elements share bytes
+    std::vector<uint8_t> results(numCallers, 1);
+    std::vector<std::thread> callers;
+    for (uint32_t c = 0; c < numCallers; c++)
+    {
+        callers.push_back(std::thread([&, c]() {
+            for (uint32_t i = 0; i < 3 * numSizes && results[c]; i++)
+            {
+                uint32_t s = (c + i) % numSizes;
+                uint32_t plaintextSize = plaintextSizes[s];
+                uint32_t encryptSize = encryptSizes[s];
+                // without padding no length is stored, whole blocks come back
+                uint32_t decryptSize = (paddingType == MUM_PADDING_TYPE_ON) ? plaintextSize : encryptSize;
+                std::vector<uint8_t> enc(encryptSize), dec(encryptSize);
+                uint32_t outlength, seqnum;
+                void *request;
+
+                if (MumEncrypt(engine2, plaintexts[s].data(), enc.data(), plaintextSize, &outlength, (uint16_t)s) != MUM_ERROR_OK || outlength != encryptSize)
+                    results[c] = 0;
+                if (paddingType == MUM_PADDING_TYPE_OFF && memcmp(enc.data(), references[s].data(), encryptSize) != 0)
+                    results[c] = 0;
+                if (MumDecrypt(engine2, enc.data(), dec.data(), encryptSize, &outlength) != MUM_ERROR_OK || outlength != decryptSize
+                    || memcmp(dec.data(), plaintexts[s].data(), plaintextSize) != 0)
+                    results[c] = 0;
+
+                // in place, through the same buffer
+                memcpy(dec.data(), plaintexts[s].data(), plaintextSize);
+                if (MumEncrypt(engine2, dec.data(), dec.data(), plaintextSize, &outlength, (uint16_t)s) != MUM_ERROR_OK || outlength != encryptSize)
+                    results[c] = 0;
+                if (MumDecrypt(engine2, dec.data(), dec.data(), encryptSize, &outlength) != MUM_ERROR_OK || outlength != decryptSize
+                    || memcmp(dec.data(), plaintexts[s].data(), plaintextSize) != 0)
+                    results[c] = 0;
+
+                if (MumEncryptAsync(engine2, plaintexts[s].data(), enc.data(), plaintextSize, (uint16_t)s, NULL, NULL, &request) != MUM_ERROR_OK
+                    || MumWaitRequest(request, &outlength) != MUM_ERROR_OK || outlength != encryptSize)
+                    results[c] = 0;
+                MumDestroyRequest(request);
+                if (paddingType == MUM_PADDING_TYPE_OFF && memcmp(enc.data(), references[s].data(), encryptSize) != 0)
+                    results[c] = 0;
+
+                // at the other priority, given per call
+                if (MumEncryptWithPriority(engine2, plaintexts[s].data(), enc.data(), plaintextSize, &outlength, (uint16_t)s, otherPriority) != MUM_ERROR_OK
+                    || outlength != encryptSize)
+                    results[c] = 0;
+                if (paddingType == MUM_PADDING_TYPE_OFF && memcmp(enc.data(), references[s].data(), encryptSize) != 0)
+                    results[c] = 0;
+                if (MumDecryptAsyncWithPriority(engine2, enc.data(), dec.data(), encryptSize, otherPriority, NULL, NULL, &request) != MUM_ERROR_OK
+                    || MumWaitRequest(request, &outlength) != MUM_ERROR_OK || outlength != decryptSize
+                    || memcmp(dec.data(), plaintexts[s].data(), plaintextSize) != 0)
+                    results[c] = 0;
+                MumDestroyRequest(request);
+                if (MumEncryptAsyncWithPriority(engine2, plaintexts[s].data(), enc.data(), plaintextSize, (uint16_t)s, otherPriority, NULL, NULL, &request) != MUM_ERROR_OK
+                    || MumWaitRequest(request, &outlength) != MUM_ERROR_OK || outlength != encryptSize)
+                    results[c] = 0;
+                MumDestroyRequest(request);
+                if (MumDecryptWithPriority(engine2, enc.data(), dec.data(), encryptSize, &outlength, otherPriority) != MUM_ERROR_OK
+                    || outlength != decryptSize || memcmp(dec.data(), plaintexts[s].data(), plaintextSize) != 0)
+                    results[c] = 0;
+
+                if (MumEncryptBlock(engine2, plaintexts[s].data(), enc.data(), plaintextBlockSize, c + i) != MUM_ERROR_OK)
+                    results[c] = 0;
+                if (MumDecryptBlock(engine2, enc.data(), dec.data(), &outlength, &seqnum) != MUM_ERROR_OK)
+                    results[c] = 0;
+                if (paddingType == MUM_PADDING_TYPE_ON && (outlength != plaintextBlockSize || seqnum != c + i))
+                    results[c] = 0;
+                if (memcmp(dec.data(), plaintexts[s].data(), plaintextBlockSize) != 0)
+                    results[c] = 0;
+            }
+        }));
+    }
+    for (uint32_t c = 0; c < numCallers; c++)
+    {
+        callers[c].join();
+        if (!results[c])
+            success = false;
+    }
+    done = true;
+    bulkCaller.join();
+
+    if (success)
+        printf("SUCCESS priorityTest, priority %d, inline blocks %d, padding %d, block type %d, %d bulk calls\n", priority, inlineBlocks, paddingType, blockType, (uint32_t)bulkCalls);
+    else
+        printf("FAILED priorityTest, priority %d, inline blocks %d, padding %d, block type %d\n", priority, inlineBlocks, paddingType, blockType);
+
+    MumDestroyEngine(engine1);
+    MumDestroyEngine(engine2);
+    MumDestroyEngine(bulkEngine);
+    return success;
+}
+
+bool doPriorityTests()
+{
+    EMumPriority priorities[] = { MUM_PRIORITY_BULK, MUM_PRIORITY_INTERACTIVE };
+    uint32_t inlineBlocksList[] = { 0, MUM_INLINE_BLOCKS, 1000 };
+    EMumPaddingType paddingTypes[] = { MUM_PADDING_TYPE_ON, MUM_PADDING_TYPE_OFF };
+    EMumBlockType blockTypes[] = { MUM_BLOCKTYPE_128, MUM_BLOCKTYPE_2048 };
+
+    for (uint32_t p = 0; p < sizeof(priorities) / sizeof(priorities[0]); p++)
+    {
+        for (uint32_t i = 0; i < sizeof(inlineBlocksList) / sizeof(inlineBlocksList[0]); i++)
+        {
+            for (uint32_t d = 0; d < sizeof(paddingTypes) / sizeof(paddingTypes[0]); d++)
+            {
+                for (uint32_t b = 0; b < sizeof(blockTypes) / sizeof(blockTypes[0]); b++)
+                {
+                    if (!priorityTest(blockTypes[b], paddingTypes[d], priorities[p], inlineBlocksList[i]))
+                        return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+// The settings of an engine, compared between a recycled engine and a new one
+bool sameSettings(void *engine1, void *engine2)
+{
+    uint32_t value1 = 0, value2 = 0;
+    EMumPriority priority1 = MUM_PRIORITY_BULK, priority2 = MUM_PRIORITY_BULK;
+    MumGetTileBlocks(engine1, &value1);
+    MumGetTileBlocks(engine2, &value2);
+    if (value1 != value2)
+        return false;
+    MumGetLargeBufferSize(engine1, &value1);
+    MumGetLargeBufferSize(engine2, &value2);
+    if (value1 != value2)
+        return false;
+    MumGetCpuFeatures(engine1, &value1);
+    MumGetCpuFeatures(engine2, &value2);
+    if (value1 != value2)
+        return false;
+    if (MumGetPriority(engine1, &priority1) != MumGetPriority(engine2, &priority2) || priority1 != priority2)
+        return false;
+    if (MumGetInlineBlocks(engine1, &value1) != MumGetInlineBlocks(engine2, &value2) || value1 != value2)
+        return false;
+    return true;
+}
+
+// An engine given back to the pool and taken again must be the same
+// engine, but behave as a new one: no usable key, the settings of a new
+// engine, and with a key, the output of a new engine with that key. Without
+// padding that is the CPU engine's output; with padding only the CPU
+// engines' is repeatable, the MT engine's has to decrypt back.
+bool enginePoolTest(EMumEngineType engineType, EMumBlockType blockType, EMumPaddingType paddingType)
+{
+    EMumError error;
+    uint32_t plaintextSize = 20000;
+    uint32_t encryptSize, outlength, value;
+    uint8_t key1[MUM_KEY_SIZE], key2[MUM_KEY_SIZE], subkey[MUM_KEY_SIZE];
+    bool repeatable = (paddingType == MUM_PADDING_TYPE_OFF || engineType != MUM_ENGINE_TYPE_CPU_MT);
+    uint32_t numThreadsBefore = numProcessThreads();
+    bool success = true;
+
+    if (MumGetEnginePoolSize(&value) != MUM_ERROR_OK || value != 0)
+        success = false;
+    fillRandomly(key1, MUM_KEY_SIZE);
+    fillRandomly(key2, MUM_KEY_SIZE);
+    if (MumSetEnginePoolSize(2) != MUM_ERROR_OK)
+        success = false;
+
+    // both new, the pool is empty
+    void *fresh = MumCreateEngine(engineType, blockType, paddingType, TEST_MUM_NUM_THREADS);
+    void *engine = MumCreateEngine(engineType, blockType, paddingType, TEST_MUM_NUM_THREADS);
+    error = MumEncryptedSize(fresh, plaintextSize, &encryptSize);
+    if (error != MUM_ERROR_OK)
+    {
+        MumDestroyEngine(fresh);
+        MumDestroyEngine(engine);
+        MumSetEnginePoolSize(0);
+        return false;
+    }
+    std::vector<uint8_t> src(plaintextSize), enc(encryptSize), ref(encryptSize), dec(encryptSize);
+    fillRandomly(src.data(), plaintextSize);
+
+    error = MumInitKey(engine, key1);
+    if (error == MUM_ERROR_OK)
+        error = MumSetTileBlocks(engine, 1);
+    if (error == MUM_ERROR_OK)
+        error = MumSetLargeBufferSize(engine, 0);
+    if (error == MUM_ERROR_OK)
+        error = MumSetCpuFeatures(engine, MUM_CPU_FEATURE_NONE);
+    if (error == MUM_ERROR_OK)
+        error = MumEncrypt(engine, src.data(), enc.data(), plaintextSize, &outlength, 0);
+    if (error != MUM_ERROR_OK)
+        success = false;
+    // only the MT engine has these
+    if (engineType == MUM_ENGINE_TYPE_CPU_MT
+        && (MumSetPriority(engine, MUM_PRIORITY_INTERACTIVE) != MUM_ERROR_OK || MumSetInlineBlocks(engine, 0) != MUM_ERROR_OK))
+        success = false;
+    MumDestroyEngine(engine);
+
+    void *recycled = MumCreateEngine(engineType, blockType, paddingType, TEST_MUM_NUM_THREADS);
+    if (recycled != engine)
+        success = false;
+    if (MumGetSubkey(recycled, 0, subkey) != MUM_ERROR_KEY_NOT_INITIALIZED
+        || MumEncrypt(recycled, src.data(), enc.data(), plaintextSize, &outlength, 0) != MUM_ERROR_KEY_NOT_INITIALIZED)
+        success = false;
+    if (!sameSettings(recycled, fresh))
+        success = false;
+    if (engineType == MUM_ENGINE_TYPE_CPU_MT)
+    {
+        uint32_t numWorkers;
+        uint64_t bytes, microseconds;
+        if (MumGetNodeStats(recycled, 0, &numWorkers, &bytes, &microseconds) != MUM_ERROR_OK || bytes != 0 || microseconds != 0)
+            success = false;
+    }
+
+    // the key it held before, another one, and back
+    uint8_t *keys[] = { key1, key2, key1 };
+    for (uint32_t k = 0; k < sizeof(keys) / sizeof(keys[0]); k++)
+    {
+        if (MumInitKey(fresh, keys[k]) != MUM_ERROR_OK || MumInitKey(recycled, keys[k]) != MUM_ERROR_OK)
+            success = false;
+        if (MumEncrypt(fresh, src.data(), ref.data(), plaintextSize, &outlength, 0) != MUM_ERROR_OK)
+            success = false;
+        if (MumEncrypt(recycled, src.data(), enc.data(), plaintextSize, &outlength, 0) != MUM_ERROR_OK || outlength != encryptSize)
+            success = false;
+        if (repeatable && memcmp(enc.data(), ref.data(), encryptSize) != 0)
+            success = false;
+        if (MumDecrypt(fresh, enc.data(), dec.data(), encryptSize, &outlength) != MUM_ERROR_OK
+            || memcmp(dec.data(), src.data(), plaintextSize) != 0)
+            success = false;
+    }
+
+    // both kept; for the MT engines the workers keep running until the pool is emptied
+    MumDestroyEngine(recycled);
+    MumDestroyEngine(fresh);
+    if (engineType == MUM_ENGINE_TYPE_CPU_MT && numProcessThreads() <= numThreadsBefore)
+        success = false;
+    if (MumSetEnginePoolSize(0) != MUM_ERROR_OK)
+        success = false;
+    if (MumGetEnginePoolSize(&value) != MUM_ERROR_OK || value != 0)
+        success = false;
+    if (numProcessThreads() > numThreadsBefore)
+        success = false;
+
+    if (success)
+        printf("SUCCESS enginePoolTest, engine type %d, padding %d, block type %d\n", engineType, paddingType, blockType);
+    else
+        printf("FAILED enginePoolTest, engine type %d, padding %d, block type %d\n", engineType, paddingType, blockType);
+    return success;
+}
+
+bool doEnginePoolTests()
+{
+    EMumEngineType engineTypes[] = { MUM_ENGINE_TYPE_CPU, MUM_ENGINE_TYPE_CPU_GENERIC, MUM_ENGINE_TYPE_CPU_JIT, MUM_ENGINE_TYPE_CPU_MT };
+    EMumPaddingType paddingTypes[] = { MUM_PADDING_TYPE_ON, MUM_PADDING_TYPE_OFF };
+    EMumBlockType blockTypes[] = { MUM_BLOCKTYPE_128, MUM_BLOCKTYPE_8192 };
+
+    for (uint32_t e = 0; e < sizeof(engineTypes) / sizeof(engineTypes[0]); e++)
+    {
+        for (uint32_t p = 0; p < sizeof(paddingTypes) / sizeof(paddingTypes[0]); p++)
+        {
+            for (uint32_t b = 0; b < sizeof(blockTypes) / sizeof(blockTypes[0]); b++)
+            {
+                if (!enginePoolTest(engineTypes[e], blockTypes[b], paddingTypes[p]))
+                    return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool doCpuFeatureTests()
+{
+    // the specialized and the JIT renderer without SIMD, each SIMD level on
+    // its own, then everything the CPU has; SSE4.1 alone runs the generated
+    // diffusion with the scalar confusion
+    EMumEngineType engineTypes[] = { MUM_ENGINE_TYPE_CPU, MUM_ENGINE_TYPE_CPU_JIT };
+    uint32_t featureList[] = { MUM_CPU_FEATURE_NONE, MUM_CPU_FEATURE_SSE41, MUM_CPU_FEATURE_AVX2, MUM_CPU_FEATURE_AVX512VBMI, 0xffffffff };
+
+    for (uint32_t e = 0; e < sizeof(engineTypes) / sizeof(engineTypes[0]); e++)
+    {
+        for (uint32_t f = 0; f < sizeof(featureList) / sizeof(featureList[0]); f++)
+        {
+            for (int blockType = MUM_BLOCKTYPE_128; blockType <= MUM_BLOCKTYPE_8192; blockType++)
+            {
+                if (!cpuFeatureTest(engineTypes[e], (EMumBlockType)blockType, featureList[f]))
+                    return false;
+            }
+        }
+    }
+    return true;
+}
+
+
+bool doTests()
+{
+	for (int paddingIndex = 0; paddingIndex < TEST_NUM_PADDING_TYPES; paddingIndex++)
+    {
+        for (int engineIndex = 0; engineIndex < TEST_NUM_ENGINES; engineIndex++)
+        {
+            for (int blockType = firstTestBlockTypeList[engineIndex]; blockType <= lastBlockTypeList[engineIndex]; blockType++)
+            {
+                void * engine = MumCreateEngine(engineList[engineIndex], (EMumBlockType)blockType, paddingList[paddingIndex], TEST_MUM_NUM_THREADS);
+                char testName[128];
+                snprintf(testName, sizeof(testName), "%s:%s", engineName[engineIndex], paddingName[paddingIndex]);
+                if (!doTest(engine, testName, paddingList[paddingIndex], (EMumBlockType)blockType))
+                    return false;
+                MumDestroyEngine(engine);
+                engine = NULL;
+            }
+        }
+    }
+	return true;
+}
+
+#ifdef CREATE_REFERENCE_FILES
+bool createReferenceFilesFromEngine(void * engine, EMumBlockType blockType)
+{
+    EMumError error;
+
+    for (int i = 0; i < NUM_REFERENCE_FILES; i++)
+    {
+        char encryptedname[512];
+        error = MumCreateEncryptedFileName(blockType, referenceFiles[i], encryptedname, 512);
+        if (error != MUM_ERROR_OK)
+            return false;
+        error = MumEncryptFile(engine, referenceFiles[i], encryptedname);
+        if (error != MUM_ERROR_OK)
+            return false;
+    }
+    return true;
+}
+
+
+
+bool createReferenceFiles()
+{
+    char *referenceFileKey = "../referencefiles/key.bin";
+
+    // create key
+    uint8_t clavier[MUM_KEY_SIZE];
+    srand(610);
+    fillRandomly(clavier, MUM_KEY_SIZE);
+
+    // write it to disk
+    FILE *f;
+    size_t res;
+    f = fopen(referenceFileKey, "wb");
+    if (!f) return false;
+    res = fwrite(clavier, 1, MUM_KEY_SIZE, f);
+    fclose(f);
+    if (res != MUM_KEY_SIZE)
+        return false;
+
+    for (int blockType = MUM_BLOCKTYPE_128; blockType <= MUM_BLOCKTYPE_8192; blockType++)
+    {
+        void * engine = MumCreateEngine(MUM_ENGINE_TYPE_CPU, (EMumBlockType)blockType, MUM_PADDING_TYPE_ON, TEST_MUM_NUM_THREADS);
+        EMumError error = MumLoadKey(engine, referenceFileKey);
+        if (error != MUM_ERROR_OK)
+            return false;
+        if (!createReferenceFilesFromEngine(engine, (EMumBlockType)blockType))
+            return false;
+        MumDestroyEngine(engine);
+        engine = NULL;
+    }
+    return true;
+}
+#endif
+
+bool doProfilings()
+{
+    printf("\n");
+    for (int engineIndex = 0; engineIndex < TEST_NUM_ENGINES; engineIndex++)
+    {
+        for (int paddingIndex = 0; paddingIndex < TEST_NUM_PADDING_TYPES; paddingIndex++)
+        {
+            for (int blockType = firstProfilingBlockTypeList[engineIndex]; blockType <= lastBlockTypeList[engineIndex]; blockType++)
+            {
+                for (int i = 0; i < 1; i++)
+                {
+                    void * engine = MumCreateEngine(engineList[engineIndex], (EMumBlockType)blockType, paddingList[paddingIndex], TEST_MUM_NUM_THREADS);
+                    char testName[128];
+                    snprintf(testName, sizeof(testName), "%s:%s", engineName[engineIndex], paddingName[paddingIndex]);
+                    if (!doProfiling(engine, testName, (paddingIndex == 1)))
+                        return false;
+                    MumDestroyEngine(engine);
+                    engine = NULL;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+// Round-major tiles: 1 block is the block-at-a-time loop, where every
+// block cycles all eight rounds' tables through the cache; larger tiles
+// reuse each round's tables across the tile.
+bool profileTileSizes(EMumBlockType blockType)
+{
+    EMumError error;
+    uint32_t plaintextSize = 32000000;
+    uint32_t encryptBufferSize = plaintextSize * 5 / 4;
+    uint32_t tileList[] = { 1, 2, 4, 8, 16, 32, MUM_MAX_TILE_BLOCKS };
+    uint8_t clavier[MUM_KEY_SIZE];
+
+    void *engine = MumCreateEngine(MUM_ENGINE_TYPE_CPU, blockType, MUM_PADDING_TYPE_ON, 0);
+    fillRandomly(clavier, MUM_KEY_SIZE);
+    error = MumInitKey(engine, clavier);
+    fillSequentially(largePlaintext, plaintextSize);
+    memset(largeEncrypt, 7, encryptBufferSize);
+
+    uint32_t plaintextBlockSize;
+    error = MumPlaintextBlockSize(engine, &plaintextBlockSize);
+    printf("profileTileSizes: block size %d, total bytes %d\n", plaintextBlockSize, plaintextSize);
+
+    bool success = true;
+    for (uint32_t i = 0; i < sizeof(tileList) / sizeof(tileList[0]); i++)
+    {
+        error = MumSetTileBlocks(engine, tileList[i]);
+        if (error != MUM_ERROR_OK)
+        {
+            success = false;
+            break;
+        }
+
+        uint32_t encrypted = 0;
+        startCounter();
+        error = MumEncrypt(engine, largePlaintext, largeEncrypt, plaintextSize, &encrypted, 0);
+        double encryptTime = getCounter();
+
+        uint32_t decrypted = 0;
+        startCounter();
+        if (error == MUM_ERROR_OK)
+            error = MumDecrypt(engine, largeEncrypt, largeDecrypt, encrypted, &decrypted);
+        double decryptTime = getCounter();
+
+        if (error != MUM_ERROR_OK || decrypted != plaintextSize || memcmp(largePlaintext, largeDecrypt, plaintextSize) != 0)
+        {
+            printf("FAILED profileTileSizes, block size %d, tile %d\n", plaintextBlockSize, tileList[i]);
+            success = false;
+            break;
+        }
+        float mb = (float)(plaintextSize) / 1000000.0f;
+        printf("   tile %2d blocks: encrypt MB/sec %f, decrypt MB/sec %f\n",
+            tileList[i], mb / (encryptTime / 1000.0), mb / (decryptTime / 1000.0));
+    }
+    printf("\n");
+
+    MumDestroyEngine(engine);
+    return success;
+}
+
+// CPU renderer specialized per block type against the generic one.
+bool profileSpecializedRenderer(EMumBlockType blockType)
+{
+    EMumError error;
+    uint32_t plaintextSize = 32000000;
+    uint8_t clavier[MUM_KEY_SIZE];
+    EMumEngineType engineTypes[2] = { MUM_ENGINE_TYPE_CPU_GENERIC, MUM_ENGINE_TYPE_CPU };
+    char *engineNames[2] = { "generic", "specialized" };
+
+    fillRandomly(clavier, MUM_KEY_SIZE);
+    fillSequentially(largePlaintext, plaintextSize);
+
+    for (int i = 0; i < 2; i++)
+    {
+        void *engine = MumCreateEngine(engineTypes[i], blockType, MUM_PADDING_TYPE_ON, 0);
+        error = MumInitKey(engine, clavier);
+
+        uint32_t encrypted = 0;
+        startCounter();
+        error = MumEncrypt(engine, largePlaintext, largeEncrypt, plaintextSize, &encrypted, 0);
+        double encryptTime = getCounter();
+
+        uint32_t decrypted = 0;
+        startCounter();
+        if (error == MUM_ERROR_OK)
+            error = MumDecrypt(engine, largeEncrypt, largeDecrypt, encrypted, &decrypted);
+        double decryptTime = getCounter();
+        MumDestroyEngine(engine);
+
+        if (error != MUM_ERROR_OK || decrypted != plaintextSize || memcmp(largePlaintext, largeDecrypt, plaintextSize) != 0)
+        {
+            printf("FAILED profileSpecializedRenderer, %s, block type %d\n", engineNames[i], blockType);
+            return false;
+        }
+        float mb = (float)(plaintextSize) / 1000000.0f;
+        printf("profileSpecializedRenderer: block type %d, %-11s encrypt MB/sec %f, decrypt MB/sec %f\n",
+            blockType, engineNames[i], mb / (encryptTime / 1000.0), mb / (decryptTime / 1000.0));
+    }
+    return true;
+}
+
+// Single blocks through MumEncryptBlock/MumDecryptBlock. Encryption used
+// to pack into a staging block, upload it to the ping-pong buffer and
+// download the result, decryption to upload and download before unpacking;
+// now the rounds read and write the caller's buffers directly.
+bool profileBlockPath(EMumBlockType blockType)
+{
+    EMumError error = MUM_ERROR_OK;
+    uint32_t plaintextSize = 32000000;
+    uint32_t plaintextBlockSize, encryptedBlockSize;
+    uint8_t clavier[MUM_KEY_SIZE];
+
+    void *engine = MumCreateEngine(MUM_ENGINE_TYPE_CPU, blockType, MUM_PADDING_TYPE_ON, 0);
+    fillRandomly(clavier, MUM_KEY_SIZE);
+    error = MumInitKey(engine, clavier);
+    error = MumPlaintextBlockSize(engine, &plaintextBlockSize);
+    error = MumEncryptedBlockSize(engine, &encryptedBlockSize);
+    fillSequentially(largePlaintext, plaintextSize);
+
+    uint32_t numBlocks = plaintextSize / plaintextBlockSize;
+    startCounter();
+    for (uint32_t b = 0; b < numBlocks && error == MUM_ERROR_OK; b++)
+        error = MumEncryptBlock(engine, largePlaintext + b * plaintextBlockSize, largeEncrypt + b * encryptedBlockSize, plaintextBlockSize, b);
+    double encryptTime = getCounter();
+
+    startCounter();
+    for (uint32_t b = 0; b < numBlocks && error == MUM_ERROR_OK; b++)
+    {
+        uint32_t length, seqnum;
+        error = MumDecryptBlock(engine, largeEncrypt + b * encryptedBlockSize, largeDecrypt + b * plaintextBlockSize, &length, &seqnum);
+    }
+    double decryptTime = getCounter();
+    MumDestroyEngine(engine);
+
+    if (error != MUM_ERROR_OK || memcmp(largePlaintext, largeDecrypt, numBlocks * plaintextBlockSize) != 0)
+    {
+        printf("FAILED profileBlockPath, block type %d\n", blockType);
+        return false;
+    }
+    float mb = (float)(numBlocks * plaintextBlockSize) / 1000000.0f;
+    printf("profileBlockPath: block size %d, bytes copied per block: encrypt %d -> 0, decrypt %d -> 0; encrypt MB/sec %f, decrypt MB/sec %f\n",
+        encryptedBlockSize, 3 * encryptedBlockSize, 2 * encryptedBlockSize, mb / (encryptTime / 1000.0), mb / (decryptTime / 1000.0));
+    return true;
+}
+
+// Diffusion compiled for the key against the table-driven passes, first
+// with the scalar confusion, then with every SIMD feature the CPU has.
+bool profileJitRenderer(EMumBlockType blockType)
+{
+    EMumError error;
+    uint32_t plaintextSize = 32000000;
+    uint8_t clavier[MUM_KEY_SIZE];
+    EMumEngineType engineTypes[2] = { MUM_ENGINE_TYPE_CPU_GENERIC, MUM_ENGINE_TYPE_CPU_JIT };
+    char *engineNames[2] = { "generic", "jit" };
+    uint32_t featureList[2] = { MUM_CPU_FEATURE_SSE41, 0xffffffff };
+
+    fillRandomly(clavier, MUM_KEY_SIZE);
+    fillSequentially(largePlaintext, plaintextSize);
+
+    for (int f = 0; f < 2; f++)
+    {
+        for (int i = 0; i < 2; i++)
+        {
+            uint32_t features;
+            void *engine = MumCreateEngine(engineTypes[i], blockType, MUM_PADDING_TYPE_ON, 0);
+            error = MumSetCpuFeatures(engine, featureList[f]);
+            error = MumGetCpuFeatures(engine, &features);
+            error = MumInitKey(engine, clavier);
+
+            uint32_t encrypted = 0;
+            startCounter();
+            error = MumEncrypt(engine, largePlaintext, largeEncrypt, plaintextSize, &encrypted, 0);
+            double encryptTime = getCounter();
+
+            uint32_t decrypted = 0;
+            startCounter();
+            if (error == MUM_ERROR_OK)
+                error = MumDecrypt(engine, largeEncrypt, largeDecrypt, encrypted, &decrypted);
+            double decryptTime = getCounter();
+            MumDestroyEngine(engine);
+
+            if (error != MUM_ERROR_OK || decrypted != plaintextSize || memcmp(largePlaintext, largeDecrypt, plaintextSize) != 0)
+            {
+                printf("FAILED profileJitRenderer, %s, block type %d\n", engineNames[i], blockType);
+                return false;
+            }
+            float mb = (float)(plaintextSize) / 1000000.0f;
+            printf("profileJitRenderer: block type %d, features 0x%x, %-7s encrypt MB/sec %f, decrypt MB/sec %f\n",
+                blockType, features, engineNames[i], mb / (encryptTime / 1000.0), mb / (decryptTime / 1000.0));
+        }
+    }
+    return true;
+}
+
+// Prefetch and streaming stores against the cached copies out of the
+// tile, on a buffer several times the size of the last-level cache.
+bool profileLargeBuffer(EMumEngineType engineType, EMumBlockType blockType)
+{
+    EMumError error = MUM_ERROR_OK;
+    uint32_t plaintextSize = 128000000;
+    uint8_t clavier[MUM_KEY_SIZE];
+    char *modeNames[2] = { "cached", "streamed" };
+
+    fillRandomly(clavier, MUM_KEY_SIZE);
+    fillSequentially(largePlaintext, plaintextSize);
+
+    for (int m = 0; m < 2; m++)
+    {
+        void *engine = MumCreateEngine(engineType, blockType, MUM_PADDING_TYPE_ON, TEST_MUM_NUM_THREADS);
+        error = MumInitKey(engine, clavier);
+        // the default size switches the mode on for this buffer
+        if (m == 0)
+            error = MumSetLargeBufferSize(engine, 0xffffffff);
+
+        uint32_t encrypted = 0;
+        startCounter();
+        error = MumEncrypt(engine, largePlaintext, largeEncrypt, plaintextSize, &encrypted, 0);
+        double encryptTime = getCounter();
+
+        uint32_t decrypted = 0;
+        startCounter();
+        if (error == MUM_ERROR_OK)
+            error = MumDecrypt(engine, largeEncrypt, largeDecrypt, encrypted, &decrypted);
+        double decryptTime = getCounter();
+        MumDestroyEngine(engine);
+
+        if (error != MUM_ERROR_OK || decrypted != plaintextSize || memcmp(largePlaintext, largeDecrypt, plaintextSize) != 0)
+        {
+            printf("FAILED profileLargeBuffer, engine %d, %s, block type %d\n", engineType, modeNames[m], blockType);
+            return false;
+        }
+        float mb = (float)(plaintextSize) / 1000000.0f;
+        printf("profileLargeBuffer: engine %d, block type %d, %-8s encrypt MB/sec %f, decrypt MB/sec %f\n",
+            engineType, blockType, modeNames[m], mb / (encryptTime / 1000.0), mb / (decryptTime / 1000.0));
+    }
+    return true;
+}
+
+bool doTileProfilings()
+{
+    for (int blockType = MUM_BLOCKTYPE_128; blockType <= MUM_BLOCKTYPE_8192; blockType++)
+    {
+        if (!profileTileSizes((EMumBlockType)blockType))
+            return false;
+        if (!profileSpecializedRenderer((EMumBlockType)blockType))
+            return false;
+        if (!profileBlockPath((EMumBlockType)blockType))
+            return false;
+        if (!profileJitRenderer((EMumBlockType)blockType))
+            return false;
+        if (!profileLargeBuffer(MUM_ENGINE_TYPE_CPU, (EMumBlockType)blockType))
+            return false;
+        if (!profileLargeBuffer(MUM_ENGINE_TYPE_CPU_MT, (EMumBlockType)blockType))
+            return false;
+    }
+    return true;
+}
+
+// Calls of a few blocks are dominated by handing the jobs to the workers
+// and waiting for them to finish, large calls by the rounds.
+bool profileCallSizes(EMumBlockType blockType)
+{
+    EMumError error = MUM_ERROR_OK;
+    uint32_t numBlocksList[] = { 1, 2, 5, 10, 20, 50, 100, 200, 500, 1000 };
+    uint32_t plaintextBlockSize;
+    uint8_t clavier[MUM_KEY_SIZE];
+
+    void *engine = MumCreateEngine(MUM_ENGINE_TYPE_CPU_MT, blockType, MUM_PADDING_TYPE_ON, TEST_MUM_NUM_THREADS);
+    fillRandomly(clavier, MUM_KEY_SIZE);
+    error = MumInitKey(engine, clavier);
+    error = MumPlaintextBlockSize(engine, &plaintextBlockSize);
+
+    for (uint32_t n = 0; n < sizeof(numBlocksList) / sizeof(numBlocksList[0]); n++)
+    {
+        uint32_t plaintextSize = numBlocksList[n] * plaintextBlockSize;
+        uint32_t numCalls = 20000 / numBlocksList[n];
+        uint32_t encrypted = 0, decrypted = 0;
+        fillRandomly(largePlaintext, plaintextSize);
+
+        startCounter();
+        for (uint32_t c = 0; c < numCalls && error == MUM_ERROR_OK; c++)
+            error = MumEncrypt(engine, largePlaintext, largeEncrypt, plaintextSize, &encrypted, 0);
+        double encryptTime = getCounter();
+
+        startCounter();
+        for (uint32_t c = 0; c < numCalls && error == MUM_ERROR_OK; c++)
+            error = MumDecrypt(engine, largeEncrypt, largeDecrypt, encrypted, &decrypted);
+        double decryptTime = getCounter();
+
+        if (error != MUM_ERROR_OK || decrypted != plaintextSize || memcmp(largePlaintext, largeDecrypt, plaintextSize) != 0)
+        {
+            printf("FAILED profileCallSizes, block type %d, %d blocks\n", blockType, numBlocksList[n]);
+            MumDestroyEngine(engine);
+            return false;
+        }
+        float mb = (float)plaintextSize * numCalls / 1000000.0f;
+        printf("profileCallSizes: block type %d, %4d blocks, encrypt %9.1f us/call %8.1f MB/sec, decrypt %9.1f us/call %8.1f MB/sec\n",
+            blockType, numBlocksList[n], encryptTime * 1000.0 / numCalls, mb / (encryptTime / 1000.0),
+            decryptTime * 1000.0 / numCalls, mb / (decryptTime / 1000.0));
+    }
+    MumDestroyEngine(engine);
+    return true;
+}
+
+bool doCallSizeProfilings()
+{
+    if (!profileCallSizes(MUM_BLOCKTYPE_1024))
+        return false;
+    if (!profileCallSizes(MUM_BLOCKTYPE_4096))
+        return false;
+    return true;
+}
+
+// Times every call on its own: the median shows how the work scales with
+// the workers, the 99th percentile and the maximum how well the last
+// blocks of a call are balanced between them. The number of workers a
+// call is spread over doubles up to the number of hardware threads, which
+// is measured last.
+bool profileThreadScaling(EMumBlockType blockType)
+{
+    EMumError error = MUM_ERROR_OK;
+    uint32_t numBlocksList[] = { 10, 100, 1000, 10000 };
+    uint32_t plaintextBlockSize, encrypted = 0;
+    uint8_t clavier[MUM_KEY_SIZE];
+    fillRandomly(clavier, MUM_KEY_SIZE);
+
+    std::vector<uint32_t> numThreadsList;
+    uint32_t numCores = std::thread::hardware_concurrency();
+    for (uint32_t numThreads = 1; numThreads < numCores; numThreads *= 2)
+        numThreadsList.push_back(numThreads);
+    numThreadsList.push_back(numCores > 0 ? numCores : 1);
+
+    for (uint32_t t = 0; t < numThreadsList.size(); t++)
+    {
+        void *engine = MumCreateEngine(MUM_ENGINE_TYPE_CPU_MT, blockType, MUM_PADDING_TYPE_ON, numThreadsList[t]);
+        error = MumInitKey(engine, clavier);
+        error = MumPlaintextBlockSize(engine, &plaintextBlockSize);
+
+        for (uint32_t n = 0; n < sizeof(numBlocksList) / sizeof(numBlocksList[0]); n++)
+        {
+            uint32_t plaintextSize = numBlocksList[n] * plaintextBlockSize;
+            uint32_t numCalls = 20000 / numBlocksList[n] + 2;
+            std::vector<double> times;
+            fillRandomly(largePlaintext, plaintextSize);
+
+            for (uint32_t c = 0; c < numCalls && error == MUM_ERROR_OK; c++)
+            {
+                startCounter();
+                error = MumEncrypt(engine, largePlaintext, largeEncrypt, plaintextSize, &encrypted, 0);
+                times.push_back(getCounter());
+            }
+            if (error != MUM_ERROR_OK)
+            {
+                printf("FAILED profileThreadScaling, block type %d, %d threads, %d blocks\n", blockType, numThreadsList[t], numBlocksList[n]);
+                MumDestroyEngine(engine);
+                return false;
+            }
+            std::sort(times.begin(), times.end());
+            double median = times[times.size() / 2];
+            printf("profileThreadScaling: block type %d, %3d threads, %5d blocks, median %9.1f us %8.1f MB/sec, p99 %9.1f us, max %9.1f us\n",
+                blockType, numThreadsList[t], numBlocksList[n], median * 1000.0, plaintextSize / (median * 1000.0),
+                times[times.size() * 99 / 100] * 1000.0, times.back() * 1000.0);
+        }
+        MumDestroyEngine(engine);
+    }
+    return true;
+}
+
+// The same calls on as many workers as hardware threads, placed by the OS
+// and by each policy, with each node's share of the bytes and the rate of
+// its workers while they were busy.
+bool profilePlacement(EMumBlockType blockType)
+{
+    EMumError error = MUM_ERROR_OK;
+    EMumPlacementType placements[] = { MUM_PLACEMENT_NONE, MUM_PLACEMENT_CORE, MUM_PLACEMENT_SMT };
+    uint32_t numCores = std::thread::hardware_concurrency();
+    uint32_t plaintextBlockSize, encrypted = 0, numNodes = 1;
+    uint32_t numBlocks = 1000, numCalls = 50;
+    uint8_t clavier[MUM_KEY_SIZE];
+    fillRandomly(clavier, MUM_KEY_SIZE);
+
+    for (uint32_t p = 0; p < sizeof(placements) / sizeof(placements[0]); p++)
+    {
+        uint32_t numThreads = (placements[p] == MUM_PLACEMENT_NONE) ? (numCores > 0 ? numCores : 1) : 0;
+        void *engine = MumCreateEngineWithPlacement(MUM_ENGINE_TYPE_CPU_MT, blockType, MUM_PADDING_TYPE_ON, numThreads, placements[p]);
+        error = MumInitKey(engine, clavier);
+        error = MumPlaintextBlockSize(engine, &plaintextBlockSize);
+        uint32_t plaintextSize = numBlocks * plaintextBlockSize;
+        fillRandomly(largePlaintext, plaintextSize);
+
+        startCounter();
+        for (uint32_t c = 0; c < numCalls && error == MUM_ERROR_OK; c++)
+            error = MumEncrypt(engine, largePlaintext, largeEncrypt, plaintextSize, &encrypted, 0);
+        double time = getCounter();
+        if (error != MUM_ERROR_OK)
+        {
+            printf("FAILED profilePlacement, placement %d\n", placements[p]);
+            MumDestroyEngine(engine);
+            return false;
+        }
+        printf("profilePlacement: block type %d, placement %d, %8.1f MB/sec\n",
+            blockType, placements[p], (float)plaintextSize * numCalls / 1000000.0f / (time / 1000.0));
+
+        error = MumGetNumNodes(engine, &numNodes);
+        for (uint32_t node = 0; node < numNodes; node++)
+        {
+            uint32_t numWorkers;
+            uint64_t bytes, microseconds;
+            error = MumGetNodeStats(engine, node, &numWorkers, &bytes, &microseconds);
+            printf("profilePlacement:     node %d, %3d workers, %5.1f%% of the bytes, %8.1f MB/sec per busy worker\n",
+                node, numWorkers, 100.0 * bytes / ((double)plaintextSize * numCalls),
+                microseconds ? (double)bytes / microseconds : 0.0);
+        }
+        MumDestroyEngine(engine);
+    }
+    return true;
+}
+
+// App threads calling one MT engine at once, each with calls of 16 blocks,
+// against the same calls serialized by a mutex around the engine. Shows
+// the rate of all callers together and the 99th percentile of a call,
+// waiting included.
+bool profileContention(EMumBlockType blockType)
+{
+    uint32_t numCallersList[] = { 1, 2, 4, 8, 32 };
+    uint32_t numBlocks = 16, numCalls = 2000;
+    uint32_t plaintextBlockSize;
+    uint8_t clavier[MUM_KEY_SIZE];
+    uint32_t numCores = std::thread::hardware_concurrency();
+    fillRandomly(clavier, MUM_KEY_SIZE);
+
+    void *engine = MumCreateEngine(MUM_ENGINE_TYPE_CPU_MT, blockType, MUM_PADDING_TYPE_ON, numCores > 0 ? numCores : 1);
+    EMumError error = MumInitKey(engine, clavier);
+    if (error != MUM_ERROR_OK)
+        return false;
+    error = MumPlaintextBlockSize(engine, &plaintextBlockSize);
+    if (error != MUM_ERROR_OK)
+        return false;
+    uint32_t plaintextSize = numBlocks * plaintextBlockSize;
+
+    for (uint32_t n = 0; n < sizeof(numCallersList) / sizeof(numCallersList[0]); n++)
+    {
+        uint32_t numCallers = numCallersList[n];
+        for (int serialized = 1; serialized >= 0; serialized--)
+        {
+            std::mutex engineMutex;
+            std::vector<std::vector<double> > times(numCallers);
+            std::vector<uint8_t> results(numCallers, 1);
+            std::vector<std::thread> callers;
+
+            startCounter();
+            for (uint32_t c = 0; c < numCallers; c++)
+            {
+                callers.push_back(std::thread([&, c]() {
+                    std::vector<uint8_t> src(plaintextSize, (uint8_t)c);
+                    std::vector<uint8_t> enc(plaintextSize * 2);
+                    uint32_t encrypted;
+                    for (uint32_t i = 0; i < numCalls / numCallers; i++)
+                    {
+                        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                        if (serialized)
+                            engineMutex.lock();
+                        if (MumEncrypt(engine, src.data(), enc.data(), plaintextSize, &encrypted, 0) != MUM_ERROR_OK)
+                            results[c] = 0;
+                        if (serialized)
+                            engineMutex.unlock();
+                        times[c].push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+                    }
+                }));
+            }
+            for (uint32_t c = 0; c < numCallers; c++)
+                callers[c].join();
+            double time = getCounter();
+
+            std::vector<double> allTimes;
+            for (uint32_t c = 0; c < numCallers; c++)
+            {
+                if (!results[c])
+                {
+                    printf("FAILED profileContention, %d callers\n", numCallers);
+                    MumDestroyEngine(engine);
+                    return false;
+                }
+                allTimes.insert(allTimes.end(), times[c].begin(), times[c].end());
+            }
+            std::sort(allTimes.begin(), allTimes.end());
+            printf("profileContention: block type %d, %3d workers, %2d callers, %s, %8.1f MB/sec, p99 %9.1f us\n",
+                blockType, numCores, numCallers, serialized ? "mutex " : "shared",
+                (double)plaintextSize * allTimes.size() / 1000.0 / time, allTimes[allTimes.size() * 99 / 100]);
+        }
+    }
+    MumDestroyEngine(engine);
+    return true;
+}
+
+// The reference files read and encrypted a chunk at a time, in turn and
+// with the reads overlapping the encryption of earlier chunks
+bool profileAsyncFile(EMumBlockType blockType)
+{
+    uint32_t numInFlightList[] = { 0, 1, 4, 16 };
+    uint32_t numRepeats = 20;
+    uint8_t clavier[MUM_KEY_SIZE];
+    uint32_t numCores = std::thread::hardware_concurrency();
+    fillRandomly(clavier, MUM_KEY_SIZE);
+
+    void *engine = MumCreateEngine(MUM_ENGINE_TYPE_CPU_MT, blockType, MUM_PADDING_TYPE_ON, numCores > 0 ? numCores : 1);
+    EMumError error = MumInitKey(engine, clavier);
+    if (error != MUM_ERROR_OK)
+        return false;
+    for (uint32_t i = 0; i < NUM_REFERENCE_FILES; i++)
+    {
+        for (uint32_t n = 0; n < sizeof(numInFlightList) / sizeof(numInFlightList[0]); n++)
+        {
+            std::vector<double> times;
+            for (uint32_t r = 0; r < numRepeats; r++)
+            {
+                double time;
+                if (!encryptFileInChunks(engine, referenceFiles[i], numInFlightList[n], &time))
+                {
+                    printf("FAILED profileAsyncFile, %s, %d in flight\n", referenceFiles[i], numInFlightList[n]);
+                    MumDestroyEngine(engine);
+                    return false;
+                }
+                times.push_back(time);
+            }
+            std::sort(times.begin(), times.end());
+            printf("profileAsyncFile: block type %d, %s, %2d in flight%s, median %8.2f ms\n", blockType, referenceFiles[i],
+                numInFlightList[n], numInFlightList[n] == 0 ? " (MumEncrypt)" : "", times[times.size() / 2]);
+        }
+    }
+    MumDestroyEngine(engine);
+    return true;
+}
+
+// Latency of single-block calls on one engine while other callers keep
+// the shared workers busy with large calls on another: queued behind the
+// bulk work, given priority over it, and run on the caller's thread.
+bool profilePriority(EMumBlockType blockType)
+{
+    EMumPriority priorities[] = { MUM_PRIORITY_BULK, MUM_PRIORITY_INTERACTIVE, MUM_PRIORITY_INTERACTIVE };
+    uint32_t inlineBlocksList[] = { 0, 0, MUM_INLINE_BLOCKS };
+    uint32_t numBulkCallers = 2, bulkSize = 16 * 1024 * 1024, numCalls = 200;
+    uint32_t plaintextBlockSize, bulkEncryptSize;
+    uint8_t clavier[MUM_KEY_SIZE];
+    uint32_t numCores = std::thread::hardware_concurrency();
+    fillRandomly(clavier, MUM_KEY_SIZE);
+
+    void *engine = MumCreateEngine(MUM_ENGINE_TYPE_CPU_MT, blockType, MUM_PADDING_TYPE_ON, numCores > 0 ? numCores : 1);
+    void *bulkEngine = MumCreateEngine(MUM_ENGINE_TYPE_CPU_MT, blockType, MUM_PADDING_TYPE_ON, numCores > 0 ? numCores : 1);
+    EMumError error = MumInitKey(engine, clavier);
+    if (error == MUM_ERROR_OK)
+        error = MumInitKey(bulkEngine, clavier);
+    if (error == MUM_ERROR_OK)
+        error = MumPlaintextBlockSize(engine, &plaintextBlockSize);
+    if (error == MUM_ERROR_OK)
+        error = MumEncryptedSize(bulkEngine, bulkSize, &bulkEncryptSize);
+    if (error != MUM_ERROR_OK)
+    {
+        MumDestroyEngine(engine);
+        MumDestroyEngine(bulkEngine);
+        return false;
+    }
+
+    for (uint32_t n = 0; n < sizeof(priorities) / sizeof(priorities[0]); n++)
+    {
+        std::atomic<bool> done(false);
+        std::atomic<uint64_t> bulkBytes(0);
+        std::vector<std::thread> bulkCallers;
+        bool success = true;
+
+        if (MumSetPriority(engine, priorities[n]) != MUM_ERROR_OK || MumSetInlineBlocks(engine, inlineBlocksList[n]) != MUM_ERROR_OK)
+            success = false;
+        startCounter();
+        for (uint32_t c = 0; c < numBulkCallers; c++)
+        {
+            bulkCallers.push_back(std::thread([&, c]() {
+                std::vector<uint8_t> src(bulkSize, (uint8_t)c);
+                std::vector<uint8_t> enc(bulkEncryptSize);
+                uint32_t encrypted;
+                while (!done)
+                {
+                    if (MumEncrypt(bulkEngine, src.data(), enc.data(), bulkSize, &encrypted, 0) == MUM_ERROR_OK)
+                        bulkBytes += bulkSize;
+                }
+            }));
+        }
+        // the bulk calls under way first
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+        std::vector<uint8_t> src(plaintextBlockSize, 0x5a), enc(plaintextBlockSize * 2);
+        std::vector<double> times;
+        uint32_t encrypted;
+        for (uint32_t i = 0; i < numCalls; i++)
+        {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            if (MumEncrypt(engine, src.data(), enc.data(), plaintextBlockSize, &encrypted, (uint16_t)i) != MUM_ERROR_OK)
+                success = false;
+            times.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+        }
+        done = true;
+        for (uint32_t c = 0; c < numBulkCallers; c++)
+            bulkCallers[c].join();
+        double time = getCounter();
+        if (!success)
+        {
+            printf("FAILED profilePriority, priority %d, inline blocks %d\n", priorities[n], inlineBlocksList[n]);
+            MumDestroyEngine(engine);
+            MumDestroyEngine(bulkEngine);
+            return false;
+        }
+
+        std::sort(times.begin(), times.end());
+        printf("profilePriority: block type %d, %3d workers, %-11s inline %d, 1 block p50 %9.1f us, p99 %9.1f us, max %9.1f us, bulk %8.1f MB/sec\n",
+            blockType, numCores, priorities[n] == MUM_PRIORITY_BULK ? "bulk," : "interactive,", inlineBlocksList[n],
+            times[times.size() / 2], times[times.size() * 99 / 100], times.back(), (double)bulkBytes / 1000.0 / time);
+    }
+    MumDestroyEngine(engine);
+    MumDestroyEngine(bulkEngine);
+    return true;
+}
+
+bool doThreadScalingProfilings()
+{
+    if (!profileThreadScaling(MUM_BLOCKTYPE_1024))
+        return false;
+    if (!profilePlacement(MUM_BLOCKTYPE_1024))
+        return false;
+    if (!profileContention(MUM_BLOCKTYPE_1024))
+        return false;
+    if (!profileAsyncFile(MUM_BLOCKTYPE_1024))
+        return false;
+    return profilePriority(MUM_BLOCKTYPE_1024);
+}
+
+// Median times of MumCreateEngine, MumInitKey and MumDestroyEngine, for
+// engines made anew each time and for engines taken from the engine pool.
+// A pooled engine schedules the key in full, as a new one does, and its
+// destruction wipes the key.
+bool profileEngineCreation(EMumBlockType blockType)
+{
+    EMumEngineType engineTypes[] = { MUM_ENGINE_TYPE_CPU, MUM_ENGINE_TYPE_CPU_JIT, MUM_ENGINE_TYPE_CPU_MT };
+    uint32_t poolSizes[] = { 0, 1 };
+    uint32_t numRepeats = 50;
+    uint8_t clavier[MUM_KEY_SIZE];
+    fillRandomly(clavier, MUM_KEY_SIZE);
+
+    for (uint32_t e = 0; e < sizeof(engineTypes) / sizeof(engineTypes[0]); e++)
+    {
+        for (uint32_t p = 0; p < sizeof(poolSizes) / sizeof(poolSizes[0]); p++)
+        {
+            std::vector<double> createTimes, keyTimes, destroyTimes;
+            if (MumSetEnginePoolSize(poolSizes[p]) != MUM_ERROR_OK)
+                return false;
+            for (uint32_t r = 0; r < numRepeats; r++)
+            {
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                void *engine = MumCreateEngine(engineTypes[e], blockType, MUM_PADDING_TYPE_ON, TEST_MUM_NUM_THREADS);
+                std::chrono::steady_clock::time_point created = std::chrono::steady_clock::now();
+                EMumError error = MumInitKey(engine, clavier);
+                std::chrono::steady_clock::time_point keyed = std::chrono::steady_clock::now();
+                MumDestroyEngine(engine);
+                std::chrono::steady_clock::time_point destroyed = std::chrono::steady_clock::now();
+                if (error != MUM_ERROR_OK)
+                {
+                    printf("FAILED profileEngineCreation, engine type %d\n", engineTypes[e]);
+                    MumSetEnginePoolSize(0);
+                    return false;
+                }
+                createTimes.push_back(std::chrono::duration<double, std::micro>(created - start).count());
+                keyTimes.push_back(std::chrono::duration<double, std::micro>(keyed - created).count());
+                destroyTimes.push_back(std::chrono::duration<double, std::micro>(destroyed - keyed).count());
+            }
+            std::sort(createTimes.begin(), createTimes.end());
+            std::sort(keyTimes.begin(), keyTimes.end());
+            std::sort(destroyTimes.begin(), destroyTimes.end());
+            printf("profileEngineCreation: block type %d, engine type %d, pool size %d, create %9.1f us, init key %9.1f us, destroy %9.1f us\n",
+                blockType, engineTypes[e], poolSizes[p], createTimes[numRepeats / 2], keyTimes[numRepeats / 2], destroyTimes[numRepeats / 2]);
+        }
+    }
+    MumSetEnginePoolSize(0);
+    return true;
+}
+
+bool doEngineCreationProfilings()
+{
+    if (!profileEngineCreation(MUM_BLOCKTYPE_128))
+        return false;
+    return profileEngineCreation(MUM_BLOCKTYPE_8192);
+}
+
+bool doMultiEngineTests()
+{
+    for (int blockType = MUM_BLOCKTYPE_128; blockType <= MUM_BLOCKTYPE_4096; blockType++)
+    {
+        if (!doMultiEngineTest(
+			MUM_ENGINE_TYPE_CPU,
+			MUM_ENGINE_TYPE_GPU_A,
+            (EMumBlockType)blockType,
+            "CPU + GPUA"))
+            return false;
+    }
+
+    if (!doMultiEngineTest(
+		MUM_ENGINE_TYPE_CPU,
+		MUM_ENGINE_TYPE_GPU_B,
+        MUM_BLOCKTYPE_4096,
+        "CPU + GPUB"))
+        return false;
+
+    return true;
+}
+
+
+int main(int argc, char* argv[])
+{
+    int result = 0;
+#ifdef CREATE_REFERENCE_FILES
+    if (createReferenceFiles())
+        return -1;
+#endif
+
+    init();
+
+    srand((unsigned int)time(NULL));
+
+    // --no-profiling runs the tests only
+    bool profiling = !(argc > 1 && !strcmp(argv[1], "--no-profiling"));
+
+    haveTestFiles = loadUrFiles();
+    if (!haveTestFiles)
+    {
+        printf("no files in ../testfiles, skipping testFileEncrypt\n");
+    }
+	
+	if (!doTests() )
+        result = -1;
+
+    if (!doCpuFeatureTests())
+        result = -1;
+
+    if (!doCrossEngineTests())
+        result = -1;
+
+    if (!doBlockPathTests())
+        result = -1;
+
+    if (!doInPlaceTests())
+        result = -1;
+
+    if (!doLargeBufferTests())
+        result = -1;
+
+    if (!doSchedulerTests())
+        result = -1;
+
+    if (!doPlacementTests())
+        result = -1;
+
+    if (!doConcurrentTests())
+        result = -1;
+
+    if (!doAsyncTests())
+        result = -1;
+
+    if (!doSharedPoolTests())
+        result = -1;
+
+    if (!doPriorityTests())
+        result = -1;
+
+    if (!doEnginePoolTests())
+        result = -1;
+
+    if (profiling && !doProfilings())
+        result = -1;
+
+    if (profiling && !doTileProfilings())
+        result = -1;
+
+    if (profiling && !doCallSizeProfilings())
+        result = -1;
+
+    if (profiling && !doThreadScalingProfilings())
+        result = -1;
+
+    if (profiling && !doEngineCreationProfilings())
+        result = -1;
+
+    // if ( !doMultiEngineTests() )
+    // return -1;
+
+    if (result != -1)
+        printf("Success!!! Done!!!\n");
+    else
+        printf("Done...but we failed someplace.\n");
+
+#ifdef _WIN32
+    // keeps the console of a debugger run open
+    if (profiling)
+    {
+        while (true)
+            ;
+    }
+#endif
     return result;
 }
 